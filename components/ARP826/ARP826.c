@@ -52,6 +52,9 @@ void vARPAddCacheEntry(struct rinarpHandle_t *pxHandle, uint8_t ucAge);
  * Array of ARPCacheRows. The type ARPCacheRow_t has been set at ARP.h */
 static ARPCacheRow_t xARPCache[ARP_CACHE_ENTRIES];
 
+/** @brief Find the cache row holding a GPA, comparing the address bytes. */
+static const ARPCacheRow_t *prvARPFindEntry(const gpa_t *pxGpa);
+
 /** @brief Grow up an address GPA filling with 0x00 until the required GPA length*/
 BaseType_t xARPAddressGPAGrow(gpa_t *pxGpa, size_t xlength, uint8_t ucFiller);
 
@@ -341,27 +344,11 @@ BaseType_t vARPSendRequest(gpa_t *pxTpa, gpa_t *pxSpa, gha_t *pxSha)
 
 		prvARPGeneratePacket(pxNetworkBuffer, pxSha, pxSpa, pxTpa, ARP_REQUEST);
 
-		if (xIsCallingFromIPCPTask() != pdFALSE)
-		{
-
-			/* Only the IPCP-task is allowed to call this function directly. */
-			(void)xNetworkInterfaceOutput(pxNetworkBuffer, pdTRUE);
-		}
-		else
+		/* Queue it for the task that talks to the driver, which may be
+		 * this one. The buffer is released if the queue is full. */
+		if (xNetworkInterfaceEnqueue(pxNetworkBuffer) == pdFALSE)
 		{
-			RINAStackEvent_t xSendEvent;
-
-			/* Send a message to the IPCP-task to send this ARP packet. */
-			xSendEvent.eEventType = eNetworkTxEvent;
-			xSendEvent.pvData = pxNetworkBuffer;
-
-			if (xSendEventStructToIPCPTask(&xSendEvent, (TickType_t)portMAX_DELAY) == pdFAIL)
-			{
-				/* Failed to send the message, so release the network buffer. */
-				vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
-				return pdFALSE;
-			}
-			ESP_LOGI(TAG_SHIM, "send by event\n");
+			return pdFALSE;
 		}
 	}
 	else
@@ -550,6 +537,9 @@ eFrameProcessingResult_t eARPProcessPacket(ARPPacket_t *const pxARPFrame)
 	gpa_t *pxTmpTpa;
 	gha_t *pxTmpTha;
 
+	const ARPCacheRow_t *pxLocalEntry;
+	uint8_t ucTmpPa[UINT8_MAX];
+
 	// Get ARPHeader from the ARPFrame
 	pxARPHeader = &(pxARPFrame->xARPHeader);
 
@@ -598,24 +588,15 @@ eFrameProcessingResult_t eARPProcessPacket(ARPPacket_t *const pxARPFrame)
 	ucPtr = ucPtr + pxARPHeader->ucPALength;
 
 	
-	pxTmpSpa = pxShimCreateGPA(ucSpa, (size_t)ucPlen+1);
+	pxTmpSpa = pxShimCreateGPA(ucSpa, (size_t)ucPlen);
 	pxTmpSha = pxShimCreateGHA(MAC_ADDR_802_3, (MACAddress_t *)ucSha);
-	pxTmpTpa = pxShimCreateGPA(ucTpa, (size_t)ucPlen+1);
+	pxTmpTpa = pxShimCreateGPA(ucTpa, (size_t)ucPlen);
 	pxTmpTha = pxShimCreateGHA(MAC_ADDR_802_3, (MACAddress_t *)ucTha);
 	vARPPrintCache();
 
-	if (xARPAddressGPAShrink(pxTmpSpa, 0x00))
+	if (!pxTmpSpa || !pxTmpSha || !pxTmpTpa || !pxTmpTha)
 	{
-		ESP_LOGE(TAG_ARP, "Problems parsing the source GPA");
-		vShimGPADestroy(pxTmpSpa);
-		vShimGPADestroy(pxTmpTpa);
-		vShimGHADestroy(pxTmpSha);
-		vShimGHADestroy(pxTmpTha);
-		return eReturn;
-	}
-	if (xARPAddressGPAShrink(pxTmpTpa, 0x00))
-	{
-		ESP_LOGE(TAG_ARP, "Got problems parsing the target GPA");
+		ESP_LOGE(TAG_ARP, "Problems parsing the ARP addresses");
 		vShimGPADestroy(pxTmpSpa);
 		vShimGPADestroy(pxTmpTpa);
 		vShimGHADestroy(pxTmpSha);
@@ -623,6 +604,11 @@ eFrameProcessingResult_t eARPProcessPacket(ARPPacket_t *const pxARPFrame)
 		return eReturn;
 	}
 
+	/* The shorter address is padded with 0x00, a GPA that has no filler
+	 * is left as it is. */
+	(void)xARPAddressGPAShrink(pxTmpSpa, 0x00);
+	(void)xARPAddressGPAShrink(pxTmpTpa, 0x00);
+
 	/*ESP_LOGE(TAG_ARP, "ShimGPAAddressToString");
 	string_t *xTmpSpaString = xShimGPAAddressToString(pxTmpSpa);
 
@@ -638,16 +624,14 @@ eFrameProcessingResult_t eARPProcessPacket(ARPPacket_t *const pxARPFrame)
 	{
 	case ARP_REQUEST:
 
-		// rinarpHandle_t * handle;
-		// handle = pvPortMalloc(sizeof(*handle));
-		// Check Cache by Address
+		ESP_LOGI(TAG_ARP, "ARP_REQUEST ptype 0x%04X", usPtype);
 
-		ESP_LOGE(TAG_ARP, "ARP_REQUEST ptype 0x%04X", usOperation);
+		/* Only the applications registered on this node are answered. */
+		pxLocalEntry = prvARPFindEntry(pxTmpTpa);
 
-		if (eARPLookupGPA(pxTmpSpa) == eARPCacheMiss)
+		if (pxLocalEntry == NULL)
 		{
-			ESP_LOGE(TAG_ARP, "I don't have a table for ptype 0x%04X",
-					 usPtype);
+			ESP_LOGI(TAG_ARP, "ARP request is not for a local application");
 			vShimGPADestroy(pxTmpSpa);
 			vShimGPADestroy(pxTmpTpa);
 			vShimGHADestroy(pxTmpSha);
@@ -655,20 +639,46 @@ eFrameProcessingResult_t eARPProcessPacket(ARPPacket_t *const pxARPFrame)
 			return eReturn;
 		}
 
-		// handle->ha = sha;
-		// handle->pa = spa;
+		/* Learn the requester, it is about to talk to us. */
+		if (prvARPFindEntry(pxTmpSpa) == NULL)
+		{
+			pxHandle = pvPortMalloc(sizeof(*pxHandle));
+
+			if (pxHandle != NULL)
+			{
+				pxHandle->pxHa = pxTmpSha;
+				pxHandle->pxPa = pxTmpSpa;
+				vARPAddCacheEntry(pxHandle, 3);
+				pxTmpSha = NULL;
+				pxTmpSpa = NULL;
+			}
+		}
+
+		/* Generate the reply in the same buffer: the requester becomes the
+		 * target and the requested address is answered with our MAC. */
+		memcpy(ucTmpPa, ucSpa, ucPlen);
+		memcpy(ucSpa, ucTpa, ucPlen);
+		memcpy(ucTpa, ucTmpPa, ucPlen);
 
-		// vARPAddCacheEntry( handle );
+		memcpy(ucTha, ucSha, ucHlen);
+		memcpy(ucSha, pxLocalEntry->pxMACAddress->xAddress.ucBytes, ucHlen);
 
-		// The request is for the address of this IoT node.  Add the
-		// entry into the ARP cache, or refresh the entry if it
-		// already exists.
-		vARPRefreshCacheEntry(pxTmpSpa, pxTmpSha);
-		// ESP_LOGE(TAG_ARP,"TArget:%s", pxTmpSha);
+		memcpy(pxARPFrame->xEthernetHeader.xDestinationAddress.ucBytes, ucTha, ucHlen);
+		memcpy(pxARPFrame->xEthernetHeader.xSourceAddress.ucBytes, ucSha, ucHlen);
 
-		// Generate a reply payload in the same buffer.
 		pxARPHeader->usOperation = (uint16_t)ARP_REPLY;
 
+		if (pxTmpSpa != NULL)
+		{
+			vShimGPADestroy(pxTmpSpa);
+		}
+		if (pxTmpSha != NULL)
+		{
+			vShimGHADestroy(pxTmpSha);
+		}
+		vShimGPADestroy(pxTmpTpa);
+		vShimGHADestroy(pxTmpTha);
+
 		eReturn = eReturnEthernetFrame;
 
 		break;
@@ -726,6 +736,49 @@ gha_t *pxARPLookupGHA(const gpa_t *pxGpaToLookup)
 	return NULL;
 }
 
+static size_t prvARPGPALength(const gpa_t *pxGpa)
+{
+	size_t uxLength = pxGpa->uxLength;
+
+	/* Addresses are padded with 0x00 up to the length of the longest one. */
+	while ((uxLength > 0U) && (pxGpa->ucAddress[uxLength - 1U] == 0x00))
+	{
+		uxLength--;
+	}
+
+	return uxLength;
+}
+
+static const ARPCacheRow_t *prvARPFindEntry(const gpa_t *pxGpa)
+{
+	BaseType_t x;
+	size_t uxLength;
+
+	if (pxGpa == NULL || pxGpa->ucAddress == NULL)
+	{
+		return NULL;
+	}
+
+	uxLength = prvARPGPALength(pxGpa);
+
+	for (x = 0; x < ARP_CACHE_ENTRIES; x++)
+	{
+		const gpa_t *pxCached = xARPCache[x].pxProtocolAddress;
+
+		if (xARPCache[x].ucValid == (uint8_t)pdFALSE || pxCached == NULL || xARPCache[x].pxMACAddress == NULL)
+		{
+			continue;
+		}
+
+		if (prvARPGPALength(pxCached) == uxLength && memcmp(pxCached->ucAddress, pxGpa->ucAddress, uxLength) == 0)
+		{
+			return &xARPCache[x];
+		}
+	}
+
+	return NULL;
+}
+
 eARPLookupResult_t eARPLookupGPA(const gpa_t *pxGpaToLookup)
 {
 	BaseType_t x;
@@ -909,11 +962,13 @@ void vARPPrintCache(void)
 
 	for (x = 0; x < ARP_CACHE_ENTRIES; x++)
 	{
-		if ((xARPCache[x].pxProtocolAddress->ucAddress != 0UL) && (xARPCache[x].ucValid != 0))
+		if ((xARPCache[x].ucValid != 0) && (xARPCache[x].pxProtocolAddress != NULL))
 		{
-			ESP_LOGI(TAG_ARP, "Arp Entry %i: %3d - %s - %02x:%02x:%02x:%02x:%02x:%02x\n",
+			/* Learnt addresses are not NUL terminated. */
+			ESP_LOGI(TAG_ARP, "Arp Entry %i: %3d - %.*s - %02x:%02x:%02x:%02x:%02x:%02x\n",
 					 x,
 					 xARPCache[x].ucAge,
+					 (int)xARPCache[x].pxProtocolAddress->uxLength,
 					 xARPCache[x].pxProtocolAddress->ucAddress,
 					 xARPCache[x].pxMACAddress->xAddress.ucBytes[0],
 					 xARPCache[x].pxMACAddress->xAddress.ucBytes[1],
@@ -138,7 +138,7 @@ void vARPUpdateMACAddress( const uint8_t ucMACAddress[ MAC_ADDRESS_LENGTH_BYTES
 void RINA_vARPMapping( uint32_t ulIPCPAddress );
 
 // Adds a mapping of application name to MAC address in the ARP cache.
-int vARPSendRequest( gpa_t * tpa, gpa_t * spa, gha_t * sha );
+BaseType_t vARPSendRequest( gpa_t * tpa, gpa_t * spa, gha_t * sha );
 
 // Remove all ARP entry in the ARP cache.
 void vARPRemoveAll( void);
@@ -17,6 +17,10 @@
 
 #include "esp_log.h"
 
+#if ( NETWORK_BUFFER_MAGAZINE_SIZE > 0 ) && ( NETWORK_BUFFER_MAGAZINE_PER_THREAD == 1 )
+    #include <pthread.h>
+#endif
+
 /* The obtained network buffer must be large enough to hold a packet that might
  * replace the packet that was requested to be sent. */
 #if ipconfigUSE_TCP == 1
@@ -46,6 +50,9 @@ static List_t xFreeBuffersList;
 /* Some statistics about the use of buffers. */
 static size_t uxMinimumFreeNetworkBuffers;
 
+/* Descriptors parked in the magazines. They are counted as free. */
+static UBaseType_t uxMagazineCached;
+
 /* Declares the pool of NetworkBufferDescriptor_t structures that are available
  * to the system.  All the network buffers referenced from xFreeBuffersList exist
  * in this array.  The array is not accessed directly except during initialisation,
@@ -53,6 +60,14 @@ static size_t uxMinimumFreeNetworkBuffers;
  * is booted). */
 static NetworkBufferDescriptor_t xNetworkBufferDescriptors[ NUM_NETWORK_BUFFER_DESCRIPTORS ];
 
+/* Descriptors reserved for pxNetworkBufferGetFromISR(). They are not counted
+ * by xNetworkBufferSemaphore and always go back to xIsrFreeBuffersList. */
+static NetworkBufferDescriptor_t xIsrNetworkBufferDescriptors[ NUM_NETWORK_BUFFER_ISR_DESCRIPTORS ];
+static List_t xIsrFreeBuffersList;
+
+/* Requests from interrupt context that found the reserved pool empty. */
+static UBaseType_t uxIsrDrops;
+
 /* This constant is defined as false to let FreeRTOS_TCP_IP.c know that the
  * network buffers have a variable size: resizing may be necessary */
 const BaseType_t xBufferAllocFixedSize = pdFALSE;
@@ -62,6 +77,406 @@ static SemaphoreHandle_t xNetworkBufferSemaphore = NULL;
 
 static portMUX_TYPE mutex = portMUX_INITIALIZER_UNLOCKED;
 
+/* Payload storage. Each size class owns a statically allocated array that is
+ * cut into fixed size slots at initialisation. Free slots are chained through
+ * their first word, so taking or returning a slot is O(1) and the heap is
+ * never used once the stack is running. */
+typedef struct xNETWORK_BUFFER_SLOT
+{
+    /* Number of descriptors sharing the slot, see pxNetworkBufferClone(). */
+    UBaseType_t uxRefCount;
+
+    /* While the slot is shared, the lowest data start of all sharers. Only
+     * the headroom below it may still be written by a push. */
+    uint8_t * pucDataFloor;
+} NetworkBufferSlot_t;
+
+typedef struct xNETWORK_BUFFER_SLAB
+{
+    size_t uxSlotSize;
+    UBaseType_t uxSlotCount;
+    uint8_t * pucStorage;
+    NetworkBufferSlot_t * pxSlots;
+    void * pvFreeSlots;
+
+    /* Statistics, read through xGetNetworkBufferClassStats(). */
+    UBaseType_t uxInUse;
+    UBaseType_t uxMaxInUse;
+    UBaseType_t uxAllocFailures;
+
+    /* Slots kept by descriptors parked in a magazine, reported as free. */
+    UBaseType_t uxCached;
+} NetworkBufferSlab_t;
+
+/* Declared as size_t so every slot starts suitably aligned. */
+static size_t xSmallSlabStorage[ ( NETWORK_BUFFER_SMALL_SIZE * NETWORK_BUFFER_SMALL_COUNT ) / sizeof( size_t ) ];
+static size_t xLargeSlabStorage[ ( NETWORK_BUFFER_LARGE_SIZE * NETWORK_BUFFER_LARGE_COUNT ) / sizeof( size_t ) ];
+
+static NetworkBufferSlot_t xSmallSlabSlots[ NETWORK_BUFFER_SMALL_COUNT ];
+static NetworkBufferSlot_t xLargeSlabSlots[ NETWORK_BUFFER_LARGE_COUNT ];
+
+static size_t xIsrSlabStorage[ ( NETWORK_BUFFER_LARGE_SIZE * NUM_NETWORK_BUFFER_ISR_DESCRIPTORS ) / sizeof( size_t ) ];
+static NetworkBufferSlot_t xIsrSlabSlots[ NUM_NETWORK_BUFFER_ISR_DESCRIPTORS ];
+
+/* Ordered from the smallest to the largest slot size. */
+static NetworkBufferSlab_t xSlabs[] =
+{
+    { NETWORK_BUFFER_SMALL_SIZE, NETWORK_BUFFER_SMALL_COUNT, ( uint8_t * ) xSmallSlabStorage, xSmallSlabSlots, NULL, 0U, 0U, 0U, 0U },
+    { NETWORK_BUFFER_LARGE_SIZE, NETWORK_BUFFER_LARGE_COUNT, ( uint8_t * ) xLargeSlabStorage, xLargeSlabSlots, NULL, 0U, 0U, 0U, 0U },
+};
+
+#define NUM_SLAB_CLASSES    ( sizeof( xSlabs ) / sizeof( xSlabs[ 0 ] ) )
+
+/* Driver memory wrapped by pxNetworkBufferWrapFromISR(). The slot metadata
+ * comes first so that clones and pushes treat it like a slab slot. */
+typedef struct xNETWORK_BUFFER_EXTERNAL
+{
+    NetworkBufferSlot_t xSlot;
+    NetworkBufferExternalFree_t pxFree;
+    void * pvHandle;
+    struct xNETWORK_BUFFER_EXTERNAL * pxNextFree;
+} NetworkBufferExternal_t;
+
+static NetworkBufferExternal_t xExternalBuffers[ NUM_NETWORK_BUFFER_EXTERNAL ];
+static NetworkBufferExternal_t * pxFreeExternalBuffers;
+
+/* Released from an ISR, where the driver free function may not be called:
+ * the next get or release from a task gives the memory back. */
+static NetworkBufferExternal_t * pxDeferredExternalBuffers;
+
+/* Payload bytes per segment when pxGetNetworkBufferChain() has to chain,
+ * chosen so that each segment, once rounded up, fits a small class slot. */
+#define baSEGMENT_SIZE      ( ( size_t ) NETWORK_BUFFER_SMALL_SIZE - BUFFER_PADDING - BUFFER_HEADROOM - sizeof( size_t ) )
+
+/* Slots backing the reserved ISR descriptors, never used by prvSlabAlloc(). */
+static NetworkBufferSlab_t xIsrSlab =
+{
+    NETWORK_BUFFER_LARGE_SIZE, NUM_NETWORK_BUFFER_ISR_DESCRIPTORS, ( uint8_t * ) xIsrSlabStorage, xIsrSlabSlots, NULL, 0U, 0U, 0U, 0U
+};
+
+static void prvSlabInitialise( void );
+static void prvSlabInitialiseOne( NetworkBufferSlab_t * pxSlab );
+static uint8_t * prvSlabTake( NetworkBufferSlab_t * pxSlab );
+static uint8_t * prvSlabAlloc( size_t xSize );
+static void prvSlabFree( uint8_t * pucSlot );
+static NetworkBufferSlab_t * prvSlabOf( const uint8_t * pucBuffer );
+static NetworkBufferSlab_t * prvSlabBestFit( size_t xSize );
+static size_t prvRoundedSize( size_t xRequestedSizeBytes );
+static NetworkBufferSlot_t * prvSlotOf( const NetworkBufferDescriptor_t * pxNetworkBuffer );
+static BaseType_t prvIsIsrDescriptor( const NetworkBufferDescriptor_t * pxNetworkBuffer );
+static BaseType_t prvSegmentReleaseFromISR( NetworkBufferDescriptor_t * const pxNetworkBuffer );
+static NetworkBufferDescriptor_t * prvSegmentClone( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                                    TickType_t xBlockTimeTicks );
+static BaseType_t prvSegmentMakeWritable( NetworkBufferDescriptor_t * const pxNetworkBuffer );
+static NetworkBufferExternalFree_t prvExternalUnref( NetworkBufferExternal_t * pxExternal,
+                                                     void ** ppvHandle );
+static void prvExternalUnrefFromISR( NetworkBufferExternal_t * pxExternal );
+static void prvExternalDrainDeferred( void );
+
+/*-----------------------------------------------------------*/
+
+static void prvSlabInitialiseOne( NetworkBufferSlab_t * pxSlab )
+{
+    UBaseType_t x;
+    uint8_t * pucSlot;
+
+    configASSERT( ( pxSlab->uxSlotSize & ( sizeof( size_t ) - 1U ) ) == 0U );
+
+    pxSlab->pvFreeSlots = NULL;
+
+    /* Chain the slots backwards so the first slot ends up at the head. */
+    for( x = pxSlab->uxSlotCount; x > 0U; x-- )
+    {
+        pucSlot = pxSlab->pucStorage + ( ( x - 1U ) * pxSlab->uxSlotSize );
+        *( ( void ** ) pucSlot ) = pxSlab->pvFreeSlots;
+        pxSlab->pvFreeSlots = pucSlot;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSlabInitialise( void )
+{
+    UBaseType_t uxClass;
+
+    for( uxClass = 0U; uxClass < NUM_SLAB_CLASSES; uxClass++ )
+    {
+        prvSlabInitialiseOne( &xSlabs[ uxClass ] );
+    }
+
+    prvSlabInitialiseOne( &xIsrSlab );
+}
+/*-----------------------------------------------------------*/
+
+/* Pops a free slot of one class, NULL if it has none. Must be called with
+ * the buffer mutex held. */
+static uint8_t * prvSlabTake( NetworkBufferSlab_t * pxSlab )
+{
+    uint8_t * pucSlot = ( uint8_t * ) pxSlab->pvFreeSlots;
+    UBaseType_t x;
+
+    if( pucSlot != NULL )
+    {
+        pxSlab->pvFreeSlots = *( ( void ** ) pucSlot );
+
+        x = ( UBaseType_t ) ( ( size_t ) ( pucSlot - pxSlab->pucStorage ) / pxSlab->uxSlotSize );
+        pxSlab->pxSlots[ x ].uxRefCount = 1U;
+        pxSlab->pxSlots[ x ].pucDataFloor = NULL;
+
+        pxSlab->uxInUse++;
+
+        if( pxSlab->uxInUse > pxSlab->uxMaxInUse )
+        {
+            pxSlab->uxMaxInUse = pxSlab->uxInUse;
+        }
+    }
+
+    return pucSlot;
+}
+/*-----------------------------------------------------------*/
+
+/* Takes a slot of at least xSize bytes, or NULL if no class can serve it.
+ * Must be called with the buffer mutex held. */
+static uint8_t * prvSlabAlloc( size_t xSize )
+{
+    UBaseType_t uxClass;
+    NetworkBufferSlab_t * pxSlab;
+    NetworkBufferSlab_t * pxBestFit = NULL;
+    uint8_t * pucSlot = NULL;
+
+    for( uxClass = 0U; uxClass < NUM_SLAB_CLASSES; uxClass++ )
+    {
+        pxSlab = &xSlabs[ uxClass ];
+
+        if( pxSlab->uxSlotSize < xSize )
+        {
+            continue;
+        }
+
+        if( pxBestFit == NULL )
+        {
+            pxBestFit = pxSlab;
+        }
+
+        pucSlot = prvSlabTake( pxSlab );
+
+        if( pucSlot != NULL )
+        {
+            break;
+        }
+    }
+
+    if( pucSlot == NULL )
+    {
+        /* Oversized requests are charged to the largest class. */
+        if( pxBestFit == NULL )
+        {
+            pxBestFit = &xSlabs[ NUM_SLAB_CLASSES - 1U ];
+        }
+
+        pxBestFit->uxAllocFailures++;
+    }
+
+    return pucSlot;
+}
+/*-----------------------------------------------------------*/
+
+/* The payload size pxGetNetworkBufferWithDescriptor() allocates for a
+ * request of xRequestedSizeBytes, before the padding and headroom. */
+static size_t prvRoundedSize( size_t xRequestedSizeBytes )
+{
+    if( ( xRequestedSizeBytes < ( size_t ) baMINIMAL_BUFFER_SIZE ) )
+    {
+        /* ARP packets can replace application packets, so the storage must be
+         * at least large enough to hold an ARP. */
+        xRequestedSizeBytes = baMINIMAL_BUFFER_SIZE;
+    }
+
+    /* Add 2 bytes to xRequestedSizeBytes and round up xRequestedSizeBytes
+     * to the nearest multiple of N bytes, where N equals 'sizeof( size_t )'. */
+    xRequestedSizeBytes += 2U;
+
+    if( ( xRequestedSizeBytes & ( sizeof( size_t ) - 1U ) ) != 0U )
+    {
+        xRequestedSizeBytes = ( xRequestedSizeBytes | ( sizeof( size_t ) - 1U ) ) + 1U;
+    }
+
+    return xRequestedSizeBytes;
+}
+/*-----------------------------------------------------------*/
+
+/* The class prvSlabAlloc() tries first for a request of xSize bytes. */
+static NetworkBufferSlab_t * prvSlabBestFit( size_t xSize )
+{
+    UBaseType_t uxClass;
+
+    for( uxClass = 0U; uxClass < NUM_SLAB_CLASSES; uxClass++ )
+    {
+        if( xSlabs[ uxClass ].uxSlotSize >= xSize )
+        {
+            return &xSlabs[ uxClass ];
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static NetworkBufferSlab_t * prvSlabOf( const uint8_t * pucBuffer )
+{
+    UBaseType_t uxClass;
+    NetworkBufferSlab_t * pxSlab;
+
+    for( uxClass = 0U; uxClass < NUM_SLAB_CLASSES; uxClass++ )
+    {
+        pxSlab = &xSlabs[ uxClass ];
+
+        if( ( pucBuffer >= pxSlab->pucStorage ) &&
+            ( pucBuffer < ( pxSlab->pucStorage + ( pxSlab->uxSlotSize * pxSlab->uxSlotCount ) ) ) )
+        {
+            return pxSlab;
+        }
+    }
+
+    if( ( pucBuffer >= xIsrSlab.pucStorage ) &&
+        ( pucBuffer < ( xIsrSlab.pucStorage + ( xIsrSlab.uxSlotSize * xIsrSlab.uxSlotCount ) ) ) )
+    {
+        return &xIsrSlab;
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+/* Drops one reference to the slot containing pucBuffer and returns the slot
+ * to its class once nobody uses it. Must be called with the buffer mutex held. */
+static void prvSlabFree( uint8_t * pucBuffer )
+{
+    NetworkBufferSlab_t * pxSlab = prvSlabOf( pucBuffer );
+    UBaseType_t x;
+    uint8_t * pucSlot;
+
+    configASSERT( pxSlab != NULL );
+
+    if( pxSlab != NULL )
+    {
+        x = ( UBaseType_t ) ( ( size_t ) ( pucBuffer - pxSlab->pucStorage ) / pxSlab->uxSlotSize );
+        configASSERT( pxSlab->pxSlots[ x ].uxRefCount > 0U );
+
+        if( --pxSlab->pxSlots[ x ].uxRefCount == 0U )
+        {
+            pucSlot = pxSlab->pucStorage + ( x * pxSlab->uxSlotSize );
+            *( ( void ** ) pucSlot ) = pxSlab->pvFreeSlots;
+            pxSlab->pvFreeSlots = pucSlot;
+            pxSlab->uxInUse--;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Slot metadata of the storage referenced by a descriptor, NULL if it has none. */
+static NetworkBufferSlot_t * prvSlotOf( const NetworkBufferDescriptor_t * pxNetworkBuffer )
+{
+    NetworkBufferSlab_t * pxSlab;
+    UBaseType_t x;
+
+    if( pxNetworkBuffer->pxExternal != NULL )
+    {
+        return &( pxNetworkBuffer->pxExternal->xSlot );
+    }
+
+    if( pxNetworkBuffer->pucBufferStart == NULL )
+    {
+        return NULL;
+    }
+
+    pxSlab = prvSlabOf( pxNetworkBuffer->pucBufferStart );
+
+    if( pxSlab == NULL )
+    {
+        return NULL;
+    }
+
+    x = ( UBaseType_t ) ( ( size_t ) ( pxNetworkBuffer->pucBufferStart - pxSlab->pucStorage ) / pxSlab->uxSlotSize );
+
+    return &pxSlab->pxSlots[ x ];
+}
+/*-----------------------------------------------------------*/
+
+/* Drops one reference to wrapped driver memory. Returns the function that
+ * gives the memory back to the driver once nobody uses it, to be called by
+ * the caller outside the critical section, and NULL otherwise. Must be
+ * called with the buffer mutex held. */
+static NetworkBufferExternalFree_t prvExternalUnref( NetworkBufferExternal_t * pxExternal,
+                                                     void ** ppvHandle )
+{
+    NetworkBufferExternalFree_t pxFree = NULL;
+
+    configASSERT( pxExternal->xSlot.uxRefCount > 0U );
+
+    if( --pxExternal->xSlot.uxRefCount == 0U )
+    {
+        pxFree = pxExternal->pxFree;
+        *ppvHandle = pxExternal->pvHandle;
+
+        pxExternal->pxFree = NULL;
+        pxExternal->pvHandle = NULL;
+        pxExternal->pxNextFree = pxFreeExternalBuffers;
+        pxFreeExternalBuffers = pxExternal;
+    }
+
+    return pxFree;
+}
+/*-----------------------------------------------------------*/
+
+/* Same as prvExternalUnref(), but the memory nobody uses any more is only
+ * put on the deferred list. Must be called with the buffer mutex held. */
+static void prvExternalUnrefFromISR( NetworkBufferExternal_t * pxExternal )
+{
+    configASSERT( pxExternal->xSlot.uxRefCount > 0U );
+
+    if( --pxExternal->xSlot.uxRefCount == 0U )
+    {
+        pxExternal->pxNextFree = pxDeferredExternalBuffers;
+        pxDeferredExternalBuffers = pxExternal;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Gives the memory released from an ISR back to the driver. Task context. */
+static void prvExternalDrainDeferred( void )
+{
+    NetworkBufferExternal_t * pxExternal;
+    NetworkBufferExternal_t * pxNext;
+
+    if( __atomic_load_n( &pxDeferredExternalBuffers, __ATOMIC_RELAXED ) == NULL )
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL(&mutex);
+    {
+        pxExternal = pxDeferredExternalBuffers;
+        pxDeferredExternalBuffers = NULL;
+    }
+    taskEXIT_CRITICAL(&mutex);
+
+    while( pxExternal != NULL )
+    {
+        pxNext = pxExternal->pxNextFree;
+        pxExternal->pxFree( pxExternal->pvHandle );
+
+        taskENTER_CRITICAL(&mutex);
+        {
+            pxExternal->pxFree = NULL;
+            pxExternal->pvHandle = NULL;
+            pxExternal->pxNextFree = pxFreeExternalBuffers;
+            pxFreeExternalBuffers = pxExternal;
+        }
+        taskEXIT_CRITICAL(&mutex);
+
+        pxExternal = pxNext;
+    }
+}
 /*-----------------------------------------------------------*/
 
 BaseType_t xNetworkBuffersInitialise( void )
@@ -109,6 +524,7 @@ BaseType_t xNetworkBuffersInitialise( void )
             #endif /*  ipconfigINCLUDE_EXAMPLE_FREERTOS_PLUS_TRACE_CALLS == 1 */
 
             vListInitialise( &xFreeBuffersList );
+            prvSlabInitialise();
 
             /* Initialise all the network buffers.  No storage is allocated to
              * the buffers yet. */
@@ -116,6 +532,9 @@ BaseType_t xNetworkBuffersInitialise( void )
             {
                 /* Initialise and set the owner of the buffer list items. */
                 xNetworkBufferDescriptors[ x ].pucEthernetBuffer = NULL;
+                xNetworkBufferDescriptors[ x ].pucBufferStart = NULL;
+                xNetworkBufferDescriptors[ x ].xBufferSize = 0U;
+                xNetworkBufferDescriptors[ x ].pxExternal = NULL;
                 vListInitialiseItem( &( xNetworkBufferDescriptors[ x ].xBufferListItem ) );
                 listSET_LIST_ITEM_OWNER( &( xNetworkBufferDescriptors[ x ].xBufferListItem ), &xNetworkBufferDescriptors[ x ] );
 
@@ -124,6 +543,28 @@ BaseType_t xNetworkBuffersInitialise( void )
             }
 
             uxMinimumFreeNetworkBuffers = NUM_NETWORK_BUFFER_DESCRIPTORS;
+
+            vListInitialise( &xIsrFreeBuffersList );
+
+            for( x = 0U; x < NUM_NETWORK_BUFFER_ISR_DESCRIPTORS; x++ )
+            {
+                xIsrNetworkBufferDescriptors[ x ].pucEthernetBuffer = NULL;
+                xIsrNetworkBufferDescriptors[ x ].pucBufferStart = NULL;
+                xIsrNetworkBufferDescriptors[ x ].xBufferSize = 0U;
+                xIsrNetworkBufferDescriptors[ x ].pxExternal = NULL;
+                vListInitialiseItem( &( xIsrNetworkBufferDescriptors[ x ].xBufferListItem ) );
+                listSET_LIST_ITEM_OWNER( &( xIsrNetworkBufferDescriptors[ x ].xBufferListItem ), &xIsrNetworkBufferDescriptors[ x ] );
+                vListInsert( &xIsrFreeBuffersList, &( xIsrNetworkBufferDescriptors[ x ].xBufferListItem ) );
+            }
+
+            pxFreeExternalBuffers = NULL;
+            pxDeferredExternalBuffers = NULL;
+
+            for( x = 0U; x < NUM_NETWORK_BUFFER_EXTERNAL; x++ )
+            {
+                xExternalBuffers[ x ].pxNextFree = pxFreeExternalBuffers;
+                pxFreeExternalBuffers = &xExternalBuffers[ x ];
+            }
         }
     }
 
@@ -163,11 +604,14 @@ uint8_t * pucGetNetworkBuffer( size_t * pxRequestedSizeBytes )
 
     *pxRequestedSizeBytes = xSize;
 
-    /* Allocate a buffer large enough to store the requested Ethernet frame size
+    /* Take a slot large enough to store the requested Ethernet frame size
      * and a pointer to a network buffer structure (hence the addition of
      * ipBUFFER_PADDING bytes). */
-    pucEthernetBuffer = ( uint8_t * ) pvPortMalloc( xSize + BUFFER_PADDING );
-    configASSERT( pucEthernetBuffer != NULL );
+    taskENTER_CRITICAL(&mutex);
+    {
+        pucEthernetBuffer = prvSlabAlloc( xSize + BUFFER_PADDING );
+    }
+    taskEXIT_CRITICAL(&mutex);
 
     if( pucEthernetBuffer != NULL )
     {
@@ -189,69 +633,538 @@ void vReleaseNetworkBuffer( uint8_t * pucEthernetBuffer )
     if( pucEthernetBuffer != NULL )
     {
         pucEthernetBuffer -= BUFFER_PADDING;
-        vPortFree( ( void * ) pucEthernetBuffer );
+
+        taskENTER_CRITICAL(&mutex);
+        {
+            prvSlabFree( pucEthernetBuffer );
+        }
+        taskEXIT_CRITICAL(&mutex);
     }
 }
 /*-----------------------------------------------------------*/
 
-NetworkBufferDescriptor_t * pxGetNetworkBufferWithDescriptor( size_t xRequestedSizeBytes,
-                                                              TickType_t xBlockTimeTicks )
+/* Free descriptors, those parked in the magazines included. */
+static UBaseType_t prvFreeDescriptors( void )
+{
+    /* Reading UBaseType_t, no critical section needed. */
+    return listCURRENT_LIST_LENGTH( &xFreeBuffersList ) +
+           __atomic_load_n( &uxMagazineCached, __ATOMIC_RELAXED );
+}
+/*-----------------------------------------------------------*/
+
+static void prvUpdateMinimumFree( void )
+{
+    UBaseType_t uxCount = prvFreeDescriptors();
+
+    if( uxMinimumFreeNetworkBuffers > uxCount )
+    {
+        uxMinimumFreeNetworkBuffers = uxCount;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Takes a free descriptor from the global list, blocking up to
+ * xBlockTimeTicks. */
+static NetworkBufferDescriptor_t * prvDescriptorTakeGlobal( TickType_t xBlockTimeTicks )
 {
     NetworkBufferDescriptor_t * pxReturn = NULL;
-    size_t uxCount;
 
-    if( xNetworkBufferSemaphore != NULL )
+    /* If there is a semaphore available, there is a network buffer available. */
+    if( xSemaphoreTake( xNetworkBufferSemaphore, xBlockTimeTicks ) == pdPASS )
     {
-        /* If there is a semaphore available, there is a network buffer available. */
-        if( xSemaphoreTake( xNetworkBufferSemaphore, xBlockTimeTicks ) == pdPASS )
+        /* Protect the structure as it is accessed from tasks and interrupts. */
+        taskENTER_CRITICAL(&mutex);
         {
-            /* Protect the structure as it is accessed from tasks and interrupts. */
-            taskENTER_CRITICAL(&mutex);
-            {
-                pxReturn = ( NetworkBufferDescriptor_t * ) listGET_OWNER_OF_HEAD_ENTRY( &xFreeBuffersList );
-                ( void ) uxListRemove( &( pxReturn->xBufferListItem ) );
-            }
-            taskEXIT_CRITICAL(&mutex);
+            pxReturn = ( NetworkBufferDescriptor_t * ) listGET_OWNER_OF_HEAD_ENTRY( &xFreeBuffersList );
+            ( void ) uxListRemove( &( pxReturn->xBufferListItem ) );
+        }
+        taskEXIT_CRITICAL(&mutex);
 
-            /* Reading UBaseType_t, no critical section needed. */
-            uxCount = listCURRENT_LIST_LENGTH( &xFreeBuffersList );
+        prvUpdateMinimumFree();
+    }
 
-            if( uxMinimumFreeNetworkBuffers > uxCount )
-            {
-                uxMinimumFreeNetworkBuffers = uxCount;
-            }
+    return pxReturn;
+}
+/*-----------------------------------------------------------*/
 
-            /* Allocate storage of exactly the requested size to the buffer. */
-            configASSERT( pxReturn->pucEthernetBuffer == NULL );
+/* Gives a descriptor without storage back to the global list. */
+static void prvDescriptorReturnGlobal( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+    BaseType_t xListItemAlreadyInFreeList;
 
-            if( xRequestedSizeBytes > 0U )
-            {
-                if( ( xRequestedSizeBytes < ( size_t ) baMINIMAL_BUFFER_SIZE ) )
-                {
-                    /* ARP packets can replace application packets, so the storage must be
-                     * at least large enough to hold an ARP. */
-                    xRequestedSizeBytes = baMINIMAL_BUFFER_SIZE;
-                }
+    /* Ensure the buffer is returned to the list of free buffers before the
+    * counting semaphore is 'given' to say a buffer is available. */
+    taskENTER_CRITICAL(&mutex);
+    {
+        xListItemAlreadyInFreeList = listIS_CONTAINED_WITHIN( &xFreeBuffersList, &( pxNetworkBuffer->xBufferListItem ) );
 
-                /* Add 2 bytes to xRequestedSizeBytes and round up xRequestedSizeBytes
-                 * to the nearest multiple of N bytes, where N equals 'sizeof( size_t )'. */
-                xRequestedSizeBytes += 2U;
+        if( xListItemAlreadyInFreeList == pdFALSE )
+        {
+            vListInsertEnd( &xFreeBuffersList, &( pxNetworkBuffer->xBufferListItem ) );
+        }
+    }
+    taskEXIT_CRITICAL(&mutex);
 
-                if( ( xRequestedSizeBytes & ( sizeof( size_t ) - 1U ) ) != 0U )
-                {
-                    xRequestedSizeBytes = ( xRequestedSizeBytes | ( sizeof( size_t ) - 1U ) ) + 1U;
-                }
+    /*
+     * Update the network state machine, unless the program fails to release its 'xNetworkBufferSemaphore'.
+     * The program should only try to release its semaphore if 'xListItemAlreadyInFreeList' is false.
+     */
+    if( xListItemAlreadyInFreeList == pdFALSE )
+    {
+        if( xSemaphoreGive( xNetworkBufferSemaphore ) == pdTRUE )
+        {
 
-                /* Extra space is obtained so a pointer to the network buffer can
-                 * be stored at the beginning of the buffer. */
-                pxReturn->pucEthernetBuffer = ( uint8_t * ) pvPortMalloc( xRequestedSizeBytes + BUFFER_PADDING );
+        }
+    }
+    else
+    {
+        /* No action. */
 
-                if( pxReturn->pucEthernetBuffer == NULL )
-                {
-                    /* The attempt to allocate storage for the buffer payload failed,
-                     * so the network buffer structure cannot be used and must be
-                     * released. */
-                    vReleaseNetworkBufferAndDescriptor( pxReturn );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvIsIsrDescriptor( const NetworkBufferDescriptor_t * pxNetworkBuffer )
+{
+    return ( ( pxNetworkBuffer >= &xIsrNetworkBufferDescriptors[ 0 ] ) &&
+             ( pxNetworkBuffer < &xIsrNetworkBufferDescriptors[ NUM_NETWORK_BUFFER_ISR_DESCRIPTORS ] ) ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+/* Releases the payload storage referenced by a descriptor. */
+static void prvDescriptorReleaseStorage( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+    NetworkBufferExternalFree_t pxFree = NULL;
+    void * pvHandle = NULL;
+
+    if( pxNetworkBuffer->pxExternal != NULL )
+    {
+        taskENTER_CRITICAL(&mutex);
+        {
+            pxFree = prvExternalUnref( pxNetworkBuffer->pxExternal, &pvHandle );
+        }
+        taskEXIT_CRITICAL(&mutex);
+
+        pxNetworkBuffer->pxExternal = NULL;
+
+        if( pxFree != NULL )
+        {
+            pxFree( pvHandle );
+        }
+    }
+    else
+    {
+        vReleaseNetworkBuffer( pxNetworkBuffer->pucBufferStart );
+    }
+
+    pxNetworkBuffer->pucBufferStart = NULL;
+    pxNetworkBuffer->xBufferSize = 0U;
+}
+/*-----------------------------------------------------------*/
+
+#if ( NETWORK_BUFFER_MAGAZINE_SIZE > 0 )
+
+/* A magazine caches free descriptors for one core (one thread on the host
+ * build). Only its owner touches it, so the common get/release path needs
+ * neither xNetworkBufferSemaphore nor the global mutex. A parked descriptor
+ * keeps its payload slot when it was the only user of it, so the next get of
+ * a similar size reuses the slot without touching the slabs either.
+ *
+ * Parked descriptors still count as free in the statistics. Once the global
+ * list is down to NETWORK_BUFFER_MAGAZINE_LOW_WATER descriptors a release
+ * empties the magazine instead of filling it, and a refill takes a single
+ * descriptor, so other tasks are not starved by descriptors cached here. */
+typedef struct xNETWORK_BUFFER_MAGAZINE
+{
+    UBaseType_t uxCount;
+    NetworkBufferDescriptor_t * pxDescriptors[ NETWORK_BUFFER_MAGAZINE_SIZE ];
+} NetworkBufferMagazine_t;
+
+/* Descriptors moved between a magazine and the global list at once. */
+#define MAGAZINE_BATCH    ( ( NETWORK_BUFFER_MAGAZINE_SIZE + 1U ) / 2U )
+
+#if ( NETWORK_BUFFER_MAGAZINE_PER_THREAD == 1 )
+    static __thread NetworkBufferMagazine_t xMagazine;
+    static __thread BaseType_t xMagazineRegistered;
+
+    /* Flushes the magazine of a thread when it exits. */
+    static pthread_key_t xMagazineKey;
+    static pthread_once_t xMagazineKeyOnce = PTHREAD_ONCE_INIT;
+
+    #define magazineLOCK( uxMask )      ( void ) ( uxMask )
+    #define magazineUNLOCK( uxMask )    ( void ) ( uxMask )
+    #define magazineGET()               ( &xMagazine )
+#else
+    static NetworkBufferMagazine_t xMagazines[ portNUM_PROCESSORS ];
+
+    /* Masking interrupts on the local core pins the caller to that core and
+     * keeps every other task on it away from the magazine. The other core
+     * only ever uses its own magazine. */
+    #define magazineLOCK( uxMask )      ( uxMask ) = portSET_INTERRUPT_MASK_FROM_ISR()
+    #define magazineUNLOCK( uxMask )    portCLEAR_INTERRUPT_MASK_FROM_ISR( uxMask )
+    #define magazineGET()               ( &xMagazines[ xPortGetCoreID() ] )
+#endif
+
+static void prvMagazineFlush( NetworkBufferMagazine_t * pxMagazine );
+
+/* Accounts for a descriptor, and the slot it keeps, entering or leaving a
+ * magazine. */
+static void prvMagazineAccount( const NetworkBufferDescriptor_t * pxNetworkBuffer,
+                                BaseType_t xParked )
+{
+    NetworkBufferSlab_t * pxSlab = NULL;
+
+    if( pxNetworkBuffer->pucBufferStart != NULL )
+    {
+        pxSlab = prvSlabOf( pxNetworkBuffer->pucBufferStart );
+    }
+
+    if( xParked != pdFALSE )
+    {
+        __atomic_add_fetch( &uxMagazineCached, 1U, __ATOMIC_RELAXED );
+
+        if( pxSlab != NULL )
+        {
+            __atomic_add_fetch( &( pxSlab->uxCached ), 1U, __ATOMIC_RELAXED );
+        }
+    }
+    else
+    {
+        __atomic_sub_fetch( &uxMagazineCached, 1U, __ATOMIC_RELAXED );
+
+        if( pxSlab != NULL )
+        {
+            __atomic_sub_fetch( &( pxSlab->uxCached ), 1U, __ATOMIC_RELAXED );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvMagazinePoolLow( void )
+{
+    /* Reading UBaseType_t, no critical section needed. */
+    return ( listCURRENT_LIST_LENGTH( &xFreeBuffersList ) <= NETWORK_BUFFER_MAGAZINE_LOW_WATER ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+#if ( NETWORK_BUFFER_MAGAZINE_PER_THREAD == 1 )
+
+static void prvMagazineThreadExit( void * pvMagazine )
+{
+    prvMagazineFlush( ( NetworkBufferMagazine_t * ) pvMagazine );
+}
+/*-----------------------------------------------------------*/
+
+static void prvMagazineKeyCreate( void )
+{
+    configASSERT( pthread_key_create( &xMagazineKey, prvMagazineThreadExit ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+/* Makes sure the magazine of the calling thread is flushed when it exits. */
+static void prvMagazineRegister( void )
+{
+    if( xMagazineRegistered == pdFALSE )
+    {
+        ( void ) pthread_once( &xMagazineKeyOnce, prvMagazineKeyCreate );
+        ( void ) pthread_setspecific( xMagazineKey, &xMagazine );
+        xMagazineRegistered = pdTRUE;
+    }
+}
+/*-----------------------------------------------------------*/
+
+#else /* NETWORK_BUFFER_MAGAZINE_PER_THREAD */
+
+/* A core never exits. */
+#define prvMagazineRegister()
+
+#endif /* NETWORK_BUFFER_MAGAZINE_PER_THREAD */
+
+static NetworkBufferDescriptor_t * prvDescriptorTake( TickType_t xBlockTimeTicks )
+{
+    NetworkBufferDescriptor_t * pxReturn = NULL;
+    NetworkBufferDescriptor_t * pxBatch[ MAGAZINE_BATCH ];
+    NetworkBufferMagazine_t * pxMagazine;
+    UBaseType_t uxMask = 0U;
+    UBaseType_t uxBatch, x;
+
+    magazineLOCK( uxMask );
+    {
+        pxMagazine = magazineGET();
+
+        if( pxMagazine->uxCount > 0U )
+        {
+            pxReturn = pxMagazine->pxDescriptors[ --pxMagazine->uxCount ];
+            prvMagazineAccount( pxReturn, pdFALSE );
+        }
+    }
+    magazineUNLOCK( uxMask );
+
+    if( pxReturn != NULL )
+    {
+        prvUpdateMinimumFree();
+        return pxReturn;
+    }
+
+    /* Refill. Only the first descriptor may block, the rest of the batch is
+     * taken if it is available straight away and the pool is not low. */
+    pxBatch[ 0 ] = prvDescriptorTakeGlobal( xBlockTimeTicks );
+
+    if( pxBatch[ 0 ] == NULL )
+    {
+        return NULL;
+    }
+
+    for( uxBatch = 1U; ( uxBatch < MAGAZINE_BATCH ) && ( prvMagazinePoolLow() == pdFALSE ); uxBatch++ )
+    {
+        pxBatch[ uxBatch ] = prvDescriptorTakeGlobal( ( TickType_t ) 0U );
+
+        if( pxBatch[ uxBatch ] == NULL )
+        {
+            break;
+        }
+    }
+
+    pxReturn = pxBatch[ 0 ];
+
+    if( uxBatch > 1U )
+    {
+        prvMagazineRegister();
+    }
+
+    /* The caller may have moved to the other core while refilling, the spare
+     * descriptors go to whichever magazine is local now. */
+    magazineLOCK( uxMask );
+    {
+        pxMagazine = magazineGET();
+
+        for( x = 1U; ( x < uxBatch ) && ( pxMagazine->uxCount < NETWORK_BUFFER_MAGAZINE_SIZE ); x++ )
+        {
+            pxMagazine->pxDescriptors[ pxMagazine->uxCount++ ] = pxBatch[ x ];
+            prvMagazineAccount( pxBatch[ x ], pdTRUE );
+            pxBatch[ x ] = NULL;
+        }
+    }
+    magazineUNLOCK( uxMask );
+
+    for( x = 1U; x < uxBatch; x++ )
+    {
+        if( pxBatch[ x ] != NULL )
+        {
+            prvDescriptorReturnGlobal( pxBatch[ x ] );
+        }
+    }
+
+    return pxReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvDescriptorRelease( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+    NetworkBufferDescriptor_t * pxBatch[ NETWORK_BUFFER_MAGAZINE_SIZE ];
+    NetworkBufferMagazine_t * pxMagazine;
+    NetworkBufferSlot_t * pxSlot;
+    UBaseType_t uxMask = 0U;
+    UBaseType_t uxBatch = 0U, x;
+    BaseType_t xPoolLow = prvMagazinePoolLow();
+
+    /* Keep the slot only if nobody else references it and the descriptor is
+     * going to be parked. A count of one cannot change under us, since only
+     * a holder can clone the buffer. Wrapped driver memory always goes back
+     * to the driver. */
+    pxSlot = prvSlotOf( pxNetworkBuffer );
+
+    if( ( xPoolLow != pdFALSE ) || ( pxSlot == NULL ) || ( pxSlot->uxRefCount != 1U ) || ( pxNetworkBuffer->pxExternal != NULL ) )
+    {
+        prvDescriptorReleaseStorage( pxNetworkBuffer );
+    }
+
+    pxNetworkBuffer->pucEthernetBuffer = NULL;
+    pxNetworkBuffer->xDataLength = 0U;
+
+    if( xPoolLow != pdFALSE )
+    {
+        /* Other tasks may be waiting, hand back everything cached here. */
+        vNetworkBufferMagazineFlush();
+        prvDescriptorReturnGlobal( pxNetworkBuffer );
+        return;
+    }
+
+    prvMagazineRegister();
+
+    magazineLOCK( uxMask );
+    {
+        pxMagazine = magazineGET();
+
+        if( pxMagazine->uxCount == NETWORK_BUFFER_MAGAZINE_SIZE )
+        {
+            /* Full, flush the oldest half back to the global list. */
+            for( uxBatch = 0U; uxBatch < MAGAZINE_BATCH; uxBatch++ )
+            {
+                pxBatch[ uxBatch ] = pxMagazine->pxDescriptors[ uxBatch ];
+                prvMagazineAccount( pxBatch[ uxBatch ], pdFALSE );
+            }
+
+            for( x = uxBatch; x < pxMagazine->uxCount; x++ )
+            {
+                pxMagazine->pxDescriptors[ x - uxBatch ] = pxMagazine->pxDescriptors[ x ];
+            }
+
+            pxMagazine->uxCount -= uxBatch;
+        }
+
+        pxMagazine->pxDescriptors[ pxMagazine->uxCount++ ] = pxNetworkBuffer;
+        prvMagazineAccount( pxNetworkBuffer, pdTRUE );
+    }
+    magazineUNLOCK( uxMask );
+
+    for( x = 0U; x < uxBatch; x++ )
+    {
+        prvDescriptorReleaseStorage( pxBatch[ x ] );
+        prvDescriptorReturnGlobal( pxBatch[ x ] );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Empties pxMagazine, or the caller's own magazine if it is NULL. */
+static void prvMagazineFlush( NetworkBufferMagazine_t * pxMagazine )
+{
+    NetworkBufferDescriptor_t * pxBatch[ NETWORK_BUFFER_MAGAZINE_SIZE ];
+    UBaseType_t uxMask = 0U;
+    UBaseType_t uxCount, x;
+
+    magazineLOCK( uxMask );
+    {
+        if( pxMagazine == NULL )
+        {
+            pxMagazine = magazineGET();
+        }
+
+        uxCount = pxMagazine->uxCount;
+
+        for( x = 0U; x < uxCount; x++ )
+        {
+            pxBatch[ x ] = pxMagazine->pxDescriptors[ x ];
+            prvMagazineAccount( pxBatch[ x ], pdFALSE );
+        }
+
+        pxMagazine->uxCount = 0U;
+    }
+    magazineUNLOCK( uxMask );
+
+    for( x = 0U; x < uxCount; x++ )
+    {
+        prvDescriptorReleaseStorage( pxBatch[ x ] );
+        prvDescriptorReturnGlobal( pxBatch[ x ] );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vNetworkBufferMagazineFlush( void )
+{
+    prvMagazineFlush( NULL );
+}
+/*-----------------------------------------------------------*/
+
+void vNetworkBufferMagazineIdle( void )
+{
+    /* A per-core magazine is used by whichever task runs next on the core,
+     * only a thread's own magazine is stranded while it sleeps. */
+    #if ( NETWORK_BUFFER_MAGAZINE_PER_THREAD == 1 )
+        prvMagazineFlush( NULL );
+    #endif
+}
+/*-----------------------------------------------------------*/
+
+#else /* NETWORK_BUFFER_MAGAZINE_SIZE */
+
+static NetworkBufferDescriptor_t * prvDescriptorTake( TickType_t xBlockTimeTicks )
+{
+    return prvDescriptorTakeGlobal( xBlockTimeTicks );
+}
+/*-----------------------------------------------------------*/
+
+static void prvDescriptorRelease( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+    prvDescriptorReleaseStorage( pxNetworkBuffer );
+    pxNetworkBuffer->pucEthernetBuffer = NULL;
+    pxNetworkBuffer->xDataLength = 0U;
+
+    prvDescriptorReturnGlobal( pxNetworkBuffer );
+}
+/*-----------------------------------------------------------*/
+
+void vNetworkBufferMagazineFlush( void )
+{
+}
+/*-----------------------------------------------------------*/
+
+void vNetworkBufferMagazineIdle( void )
+{
+}
+/*-----------------------------------------------------------*/
+
+#endif /* NETWORK_BUFFER_MAGAZINE_SIZE */
+
+NetworkBufferDescriptor_t * pxGetNetworkBufferWithDescriptor( size_t xRequestedSizeBytes,
+                                                              TickType_t xBlockTimeTicks )
+{
+    NetworkBufferDescriptor_t * pxReturn = NULL;
+    NetworkBufferSlab_t * pxCachedSlab = NULL;
+    uint8_t * pucSlot;
+
+    if( xNetworkBufferSemaphore != NULL )
+    {
+        prvExternalDrainDeferred();
+
+        pxReturn = prvDescriptorTake( xBlockTimeTicks );
+
+        if( pxReturn != NULL )
+        {
+            /* Allocate storage of exactly the requested size to the buffer. */
+            configASSERT( pxReturn->pucEthernetBuffer == NULL );
+            pxReturn->pxNextSegment = NULL;
+
+            if( pxReturn->pucBufferStart != NULL )
+            {
+                pxCachedSlab = prvSlabOf( pxReturn->pucBufferStart );
+            }
+
+            if( xRequestedSizeBytes > 0U )
+            {
+                xRequestedSizeBytes = prvRoundedSize( xRequestedSizeBytes );
+
+                /* Extra space is obtained so a pointer to the network buffer can
+                 * be stored at the beginning of the buffer, followed by the
+                 * headroom left for headers pushed by the lower layers. A slot
+                 * kept by a cached descriptor is reused if it is the best fit. */
+                if( ( pxCachedSlab != NULL ) &&
+                    ( pxCachedSlab == prvSlabBestFit( xRequestedSizeBytes + BUFFER_PADDING + BUFFER_HEADROOM ) ) )
+                {
+                    pucSlot = pxReturn->pucBufferStart - BUFFER_PADDING;
+                }
+                else
+                {
+                    taskENTER_CRITICAL(&mutex);
+                    {
+                        if( pxCachedSlab != NULL )
+                        {
+                            prvSlabFree( pxReturn->pucBufferStart );
+                        }
+
+                        pucSlot = prvSlabAlloc( xRequestedSizeBytes + BUFFER_PADDING + BUFFER_HEADROOM );
+                    }
+                    taskEXIT_CRITICAL(&mutex);
+
+                    pxReturn->pucBufferStart = NULL;
+                }
+
+                if( pucSlot == NULL )
+                {
+                    /* The attempt to allocate storage for the buffer payload failed,
+                     * so the network buffer structure cannot be used and must be
+                     * released. */
+                    vReleaseNetworkBufferAndDescriptor( pxReturn );
                     pxReturn = NULL;
                 }
                 else
@@ -260,136 +1173,764 @@ NetworkBufferDescriptor_t * pxGetNetworkBufferWithDescriptor( size_t xRequestedS
                      * buffer storage area, then move the buffer pointer on past the
                      * stored pointer so the pointer value is not overwritten by the
                      * application when the buffer is used. */
-                    *( ( NetworkBufferDescriptor_t ** ) ( pxReturn->pucEthernetBuffer ) ) = pxReturn;
-                    pxReturn->pucEthernetBuffer += BUFFER_PADDING;
+                    *( ( NetworkBufferDescriptor_t ** ) pucSlot ) = pxReturn;
+                    pxReturn->pucBufferStart = pucSlot + BUFFER_PADDING;
+                    pxReturn->xBufferSize = prvSlabOf( pucSlot )->uxSlotSize - BUFFER_PADDING;
+                    pxReturn->pucEthernetBuffer = pxReturn->pucBufferStart + BUFFER_HEADROOM;
+
+                    /* Store the actual size of the allocated buffer, which may be
+                     * greater than the original requested size. */
+                    pxReturn->xDataLength = xRequestedSizeBytes;
+
+                    #if ( USE_LINKED_RX_MESSAGES != 0 )
+                        {
+                            /* make sure the buffer is not linked */
+                            pxReturn->pxNextBuffer = NULL;
+                        }
+                    #endif /* USE_LINKED_RX_MESSAGES */
+                }
+            }
+            else
+            {
+                /* A descriptor is being returned without an associated buffer being
+                 * allocated. */
+                if( pxCachedSlab != NULL )
+                {
+                    prvDescriptorReleaseStorage( pxReturn );
+                }
+            }
+        }
+    }
+
+    if( pxReturn == NULL )
+    {
+
+    }
+    else
+    {
+        /* No action. */
+
+    }
+    count = count + 1;
+    //ESP_LOGI(TAG_NETBUFFER, "Taking Buffer");
+    //ESP_LOGI(TAG_NETBUFFER, "Count:%d", count);
+
+    return pxReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vReleaseNetworkBufferAndDescriptor( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+    NetworkBufferDescriptor_t * pxSegment = pxNetworkBuffer;
+    NetworkBufferDescriptor_t * pxNext;
+
+    prvExternalDrainDeferred();
+
+    /* A chained SDU is released together with all its segments. */
+    while( pxSegment != NULL )
+    {
+        pxNext = pxSegment->pxNextSegment;
+        pxSegment->pxNextSegment = NULL;
+
+        if( prvIsIsrDescriptor( pxSegment ) != pdFALSE )
+        {
+            prvDescriptorReleaseStorage( pxSegment );
+            pxSegment->pucEthernetBuffer = NULL;
+            pxSegment->xDataLength = 0U;
+
+            taskENTER_CRITICAL(&mutex);
+            {
+                if( listIS_CONTAINED_WITHIN( &xIsrFreeBuffersList, &( pxSegment->xBufferListItem ) ) == pdFALSE )
+                {
+                    vListInsertEnd( &xIsrFreeBuffersList, &( pxSegment->xBufferListItem ) );
+                }
+            }
+            taskEXIT_CRITICAL(&mutex);
+        }
+        else
+        {
+            /* The payload slot goes back to its size class, unless the descriptor
+             * is cached together with it. */
+            prvDescriptorRelease( pxSegment );
+        }
+
+        pxSegment = pxNext;
+    }
+
+    count = count - 1 ;
+    //ESP_LOGI(TAG_NETBUFFER, "Releasing Buffer....!!!");
+    //ESP_LOGI(TAG_NETBUFFER, "Buffer actived:%d", count);
+}
+/*-----------------------------------------------------------*/
+
+NetworkBufferDescriptor_t * pxNetworkBufferGetFromISR( size_t xRequestedSizeBytes )
+{
+    NetworkBufferDescriptor_t * pxReturn = NULL;
+    uint8_t * pucSlot = NULL;
+
+    if( xNetworkBufferSemaphore == NULL )
+    {
+        return NULL;
+    }
+
+    if( xRequestedSizeBytes < ( size_t ) baMINIMAL_BUFFER_SIZE )
+    {
+        xRequestedSizeBytes = baMINIMAL_BUFFER_SIZE;
+    }
+
+    /* Never blocks: the reserved pool either has a descriptor and a slot now,
+     * or the frame is dropped and counted. */
+    taskENTER_CRITICAL_ISR(&mutex);
+    {
+        if( ( ( xRequestedSizeBytes + BUFFER_PADDING + BUFFER_HEADROOM ) <= xIsrSlab.uxSlotSize ) &&
+            ( listCURRENT_LIST_LENGTH( &xIsrFreeBuffersList ) > 0U ) )
+        {
+            pucSlot = prvSlabTake( &xIsrSlab );
+        }
+
+        if( pucSlot != NULL )
+        {
+            pxReturn = ( NetworkBufferDescriptor_t * ) listGET_OWNER_OF_HEAD_ENTRY( &xIsrFreeBuffersList );
+            ( void ) uxListRemove( &( pxReturn->xBufferListItem ) );
+        }
+        else
+        {
+            uxIsrDrops++;
+        }
+    }
+    taskEXIT_CRITICAL_ISR(&mutex);
+
+    if( pxReturn != NULL )
+    {
+        pxReturn->pucBufferStart = pucSlot + BUFFER_PADDING;
+        pxReturn->xBufferSize = xIsrSlab.uxSlotSize - BUFFER_PADDING;
+        pxReturn->pucEthernetBuffer = pxReturn->pucBufferStart + BUFFER_HEADROOM;
+        pxReturn->xDataLength = xRequestedSizeBytes;
+        pxReturn->pxNextSegment = NULL;
+
+        #if ( USE_LINKED_RX_MESSAGES != 0 )
+            pxReturn->pxNextBuffer = NULL;
+        #endif
+    }
+
+    return pxReturn;
+}
+/*-----------------------------------------------------------*/
+
+NetworkBufferDescriptor_t * pxNetworkBufferWrapFromISR( uint8_t * pucData,
+                                                        size_t uxLength,
+                                                        NetworkBufferExternalFree_t pxFree,
+                                                        void * pvHandle )
+{
+    NetworkBufferDescriptor_t * pxReturn = NULL;
+    NetworkBufferExternal_t * pxExternal = NULL;
+
+    if( ( xNetworkBufferSemaphore == NULL ) || ( pucData == NULL ) || ( pxFree == NULL ) )
+    {
+        return NULL;
+    }
+
+    /* Same reserved descriptors as pxNetworkBufferGetFromISR(), but no slot. */
+    taskENTER_CRITICAL_ISR(&mutex);
+    {
+        if( ( pxFreeExternalBuffers != NULL ) &&
+            ( listCURRENT_LIST_LENGTH( &xIsrFreeBuffersList ) > 0U ) )
+        {
+            pxExternal = pxFreeExternalBuffers;
+            pxFreeExternalBuffers = pxExternal->pxNextFree;
+
+            pxReturn = ( NetworkBufferDescriptor_t * ) listGET_OWNER_OF_HEAD_ENTRY( &xIsrFreeBuffersList );
+            ( void ) uxListRemove( &( pxReturn->xBufferListItem ) );
+        }
+        else
+        {
+            uxIsrDrops++;
+        }
+    }
+    taskEXIT_CRITICAL_ISR(&mutex);
+
+    if( pxReturn != NULL )
+    {
+        pxExternal->xSlot.uxRefCount = 1U;
+        pxExternal->xSlot.pucDataFloor = NULL;
+        pxExternal->pxFree = pxFree;
+        pxExternal->pvHandle = pvHandle;
+        pxExternal->pxNextFree = NULL;
+
+        pxReturn->pxExternal = pxExternal;
+        pxReturn->pucBufferStart = pucData;
+        pxReturn->xBufferSize = uxLength;
+        pxReturn->pucEthernetBuffer = pucData;
+        pxReturn->xDataLength = uxLength;
+        pxReturn->pxNextSegment = NULL;
+
+        #if ( USE_LINKED_RX_MESSAGES != 0 )
+            pxReturn->pxNextBuffer = NULL;
+        #endif
+    }
+
+    return pxReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t vNetworkBufferReleaseFromISR( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+    NetworkBufferDescriptor_t * pxSegment = pxNetworkBuffer;
+    NetworkBufferDescriptor_t * pxNext;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    while( pxSegment != NULL )
+    {
+        pxNext = pxSegment->pxNextSegment;
+        pxSegment->pxNextSegment = NULL;
+
+        if( prvSegmentReleaseFromISR( pxSegment ) != pdFALSE )
+        {
+            xHigherPriorityTaskWoken = pdTRUE;
+        }
+
+        pxSegment = pxNext;
+    }
+
+    return xHigherPriorityTaskWoken;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSegmentReleaseFromISR( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    BaseType_t xIsIsrDescriptor = prvIsIsrDescriptor( pxNetworkBuffer );
+    BaseType_t xGive = pdFALSE;
+    List_t * pxList = ( xIsIsrDescriptor != pdFALSE ) ? &xIsrFreeBuffersList : &xFreeBuffersList;
+
+    /* Bypasses the magazines, which belong to tasks. */
+    taskENTER_CRITICAL_ISR(&mutex);
+    {
+        if( pxNetworkBuffer->pxExternal != NULL )
+        {
+            prvExternalUnrefFromISR( pxNetworkBuffer->pxExternal );
+            pxNetworkBuffer->pxExternal = NULL;
+        }
+        else if( pxNetworkBuffer->pucBufferStart != NULL )
+        {
+            prvSlabFree( pxNetworkBuffer->pucBufferStart - BUFFER_PADDING );
+        }
+
+        pxNetworkBuffer->pucBufferStart = NULL;
+        pxNetworkBuffer->xBufferSize = 0U;
+        pxNetworkBuffer->pucEthernetBuffer = NULL;
+        pxNetworkBuffer->xDataLength = 0U;
+
+        if( listIS_CONTAINED_WITHIN( pxList, &( pxNetworkBuffer->xBufferListItem ) ) == pdFALSE )
+        {
+            vListInsertEnd( pxList, &( pxNetworkBuffer->xBufferListItem ) );
+            xGive = ( xIsIsrDescriptor == pdFALSE ) ? pdTRUE : pdFALSE;
+        }
+    }
+    taskEXIT_CRITICAL_ISR(&mutex);
+
+    if( xGive != pdFALSE )
+    {
+        ( void ) xSemaphoreGiveFromISR( xNetworkBufferSemaphore, &xHigherPriorityTaskWoken );
+    }
+
+    return xHigherPriorityTaskWoken;
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxGetNetworkBufferIsrDrops( void )
+{
+    return uxIsrDrops;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Returns the number of free network buffers
+ */
+UBaseType_t uxGetNumberOfFreeNetworkBuffers( void )
+{
+    return prvFreeDescriptors();
+}
+/*-----------------------------------------------------------*/
 
-                    /* Store the actual size of the allocated buffer, which may be
-                     * greater than the original requested size. */
-                    pxReturn->xDataLength = xRequestedSizeBytes;
+UBaseType_t uxGetMinimumFreeNetworkBuffers( void )
+{
+    return uxMinimumFreeNetworkBuffers;
+}
+/*-----------------------------------------------------------*/
 
-                    #if ( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
-                        {
-                            /* make sure the buffer is not linked */
-                            pxReturn->pxNextBuffer = NULL;
-                        }
-                    #endif /* ipconfigUSE_LINKED_RX_MESSAGES */
-                }
+UBaseType_t uxGetNetworkBufferClassCount( void )
+{
+    return ( UBaseType_t ) NUM_SLAB_CLASSES;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xGetNetworkBufferClassStats( UBaseType_t uxClass,
+                                        NetworkBufferClassStats_t * pxStats )
+{
+    NetworkBufferSlab_t * pxSlab;
+
+    if( ( uxClass >= NUM_SLAB_CLASSES ) || ( pxStats == NULL ) )
+    {
+        return pdFALSE;
+    }
+
+    pxSlab = &xSlabs[ uxClass ];
+
+    taskENTER_CRITICAL(&mutex);
+    {
+        pxStats->uxSlotSize = pxSlab->uxSlotSize;
+        pxStats->uxSlotCount = pxSlab->uxSlotCount;
+        pxStats->uxInUse = pxSlab->uxInUse - __atomic_load_n( &( pxSlab->uxCached ), __ATOMIC_RELAXED );
+        pxStats->uxMaxInUse = pxSlab->uxMaxInUse;
+        pxStats->uxAllocFailures = pxSlab->uxAllocFailures;
+    }
+    taskEXIT_CRITICAL(&mutex);
+
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+NetworkBufferDescriptor_t * pxResizeNetworkBufferWithDescriptor( NetworkBufferDescriptor_t * pxNetworkBuffer,
+                                                                 size_t xNewSizeBytes )
+{
+    size_t xCopyLength;
+    size_t uxHeadroom;
+    uint8_t * pucBuffer;
+
+    uxHeadroom = uxNetworkBufferHeadroom( pxNetworkBuffer );
+
+    /* The slot may already be large enough, in which case only the length
+     * changes. Shared storage is only shrunk in place. */
+    if( ( ( uxHeadroom + xNewSizeBytes ) <= pxNetworkBuffer->xBufferSize ) &&
+        ( ( xNewSizeBytes <= pxNetworkBuffer->xDataLength ) || ( xNetworkBufferIsShared( pxNetworkBuffer ) == pdFALSE ) ) )
+    {
+        pxNetworkBuffer->xDataLength = xNewSizeBytes;
+        return pxNetworkBuffer;
+    }
+
+    /* Keep the same headroom in the new storage. */
+    xCopyLength = xNewSizeBytes + uxHeadroom;
+
+    pucBuffer = pucGetNetworkBuffer( &( xCopyLength ) );
+
+    if( pucBuffer == NULL )
+    {
+        /* In case the allocation fails, return NULL. */
+        pxNetworkBuffer = NULL;
+    }
+    else
+    {
+        xCopyLength = pxNetworkBuffer->xDataLength;
+
+        if( xNewSizeBytes < xCopyLength )
+        {
+            xCopyLength = xNewSizeBytes;
+        }
+
+        ( void ) memcpy( pucBuffer + uxHeadroom, pxNetworkBuffer->pucEthernetBuffer, xCopyLength );
+        prvDescriptorReleaseStorage( pxNetworkBuffer );
+
+        pxNetworkBuffer->pucBufferStart = pucBuffer;
+        pxNetworkBuffer->xBufferSize = prvSlabOf( pucBuffer - BUFFER_PADDING )->uxSlotSize - BUFFER_PADDING;
+        pxNetworkBuffer->pucEthernetBuffer = pucBuffer + uxHeadroom;
+        pxNetworkBuffer->xDataLength = xNewSizeBytes;
+    }
+
+    return pxNetworkBuffer;
+}
+/*-----------------------------------------------------------*/
+
+uint8_t * pucNetworkBufferPush( NetworkBufferDescriptor_t * pxNetworkBuffer,
+                                size_t uxLength )
+{
+    NetworkBufferSlot_t * pxSlot;
+    BaseType_t xInUse = pdFALSE;
+
+    if( uxNetworkBufferHeadroom( pxNetworkBuffer ) < uxLength )
+    {
+        return NULL;
+    }
+
+    pxSlot = prvSlotOf( pxNetworkBuffer );
+
+    taskENTER_CRITICAL(&mutex);
+    {
+        /* On shared storage the headroom can only be claimed by the sharer
+         * whose data starts lowest, otherwise another clone's bytes would
+         * be overwritten. */
+        if( ( pxSlot != NULL ) && ( pxSlot->uxRefCount > 1U ) )
+        {
+            if( pxNetworkBuffer->pucEthernetBuffer > pxSlot->pucDataFloor )
+            {
+                xInUse = pdTRUE;
             }
             else
             {
-                /* A descriptor is being returned without an associated buffer being
-                 * allocated. */
+                pxSlot->pucDataFloor = pxNetworkBuffer->pucEthernetBuffer - uxLength;
             }
         }
     }
+    taskEXIT_CRITICAL(&mutex);
 
-    if( pxReturn == NULL )
+    if( xInUse != pdFALSE )
     {
+        return NULL;
+    }
+
+    pxNetworkBuffer->pucEthernetBuffer -= uxLength;
+    pxNetworkBuffer->xDataLength += uxLength;
+
+    return pxNetworkBuffer->pucEthernetBuffer;
+}
+/*-----------------------------------------------------------*/
 
+uint8_t * pucNetworkBufferPull( NetworkBufferDescriptor_t * pxNetworkBuffer,
+                                size_t uxLength )
+{
+    if( ( pxNetworkBuffer->pucEthernetBuffer == NULL ) || ( pxNetworkBuffer->xDataLength < uxLength ) )
+    {
+        return NULL;
     }
-    else
+
+    pxNetworkBuffer->pucEthernetBuffer += uxLength;
+    pxNetworkBuffer->xDataLength -= uxLength;
+
+    return pxNetworkBuffer->pucEthernetBuffer;
+}
+/*-----------------------------------------------------------*/
+
+uint8_t * pucNetworkBufferPut( NetworkBufferDescriptor_t * pxNetworkBuffer,
+                               size_t uxLength )
+{
+    uint8_t * pucTail;
+
+    /* The tail of shared storage may hold another clone's data. */
+    if( ( uxNetworkBufferTailroom( pxNetworkBuffer ) < uxLength ) ||
+        ( xNetworkBufferIsShared( pxNetworkBuffer ) != pdFALSE ) )
     {
-        /* No action. */
+        return NULL;
+    }
+
+    pucTail = pxNetworkBuffer->pucEthernetBuffer + pxNetworkBuffer->xDataLength;
+    pxNetworkBuffer->xDataLength += uxLength;
+
+    return pucTail;
+}
+/*-----------------------------------------------------------*/
 
+size_t uxNetworkBufferHeadroom( const NetworkBufferDescriptor_t * pxNetworkBuffer )
+{
+    if( pxNetworkBuffer->pucEthernetBuffer == NULL )
+    {
+        return 0U;
     }
-    count = count + 1;
-    //ESP_LOGI(TAG_NETBUFFER, "Taking Buffer");
-    //ESP_LOGI(TAG_NETBUFFER, "Count:%d", count);
 
-    return pxReturn;
+    return ( size_t ) ( pxNetworkBuffer->pucEthernetBuffer - pxNetworkBuffer->pucBufferStart );
 }
 /*-----------------------------------------------------------*/
 
-void vReleaseNetworkBufferAndDescriptor( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+size_t uxNetworkBufferTailroom( const NetworkBufferDescriptor_t * pxNetworkBuffer )
 {
-    BaseType_t xListItemAlreadyInFreeList;
+    size_t uxUsed;
 
-    /* Ensure the buffer is returned to the list of free buffers before the
-    * counting semaphore is 'given' to say a buffer is available.  Release the
-    * storage allocated to the buffer payload.  THIS FILE SHOULD NOT BE USED
-    * IF THE PROJECT INCLUDES A MEMORY ALLOCATOR THAT WILL FRAGMENT THE HEAP
-    * MEMORY.  For example, heap_2 must not be used, heap_4 can be used. */
-    vReleaseNetworkBuffer( pxNetworkBuffer->pucEthernetBuffer );
-    pxNetworkBuffer->pucEthernetBuffer = NULL;
-    pxNetworkBuffer->xDataLength = 0U;
+    if( pxNetworkBuffer->pucEthernetBuffer == NULL )
+    {
+        return 0U;
+    }
 
-    taskENTER_CRITICAL(&mutex);
+    uxUsed = uxNetworkBufferHeadroom( pxNetworkBuffer ) + pxNetworkBuffer->xDataLength;
+
+    return ( uxUsed < pxNetworkBuffer->xBufferSize ) ? ( pxNetworkBuffer->xBufferSize - uxUsed ) : 0U;
+}
+/*-----------------------------------------------------------*/
+
+NetworkBufferDescriptor_t * pxNetworkBufferClone( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                                  TickType_t xBlockTimeTicks )
+{
+    NetworkBufferDescriptor_t * pxHead = NULL;
+    NetworkBufferDescriptor_t * pxTail = NULL;
+    NetworkBufferDescriptor_t * pxSegment;
+    NetworkBufferDescriptor_t * pxClone;
+
+    /* Every segment of a chain gets its own descriptor. */
+    for( pxSegment = pxNetworkBuffer; pxSegment != NULL; pxSegment = pxSegment->pxNextSegment )
     {
-        xListItemAlreadyInFreeList = listIS_CONTAINED_WITHIN( &xFreeBuffersList, &( pxNetworkBuffer->xBufferListItem ) );
+        pxClone = prvSegmentClone( pxSegment, xBlockTimeTicks );
 
-        if( xListItemAlreadyInFreeList == pdFALSE )
+        if( pxClone == NULL )
         {
-            vListInsertEnd( &xFreeBuffersList, &( pxNetworkBuffer->xBufferListItem ) );
+            if( pxHead != NULL )
+            {
+                vReleaseNetworkBufferAndDescriptor( pxHead );
+            }
+
+            return NULL;
+        }
+
+        if( pxTail == NULL )
+        {
+            pxHead = pxClone;
+        }
+        else
+        {
+            pxTail->pxNextSegment = pxClone;
         }
+
+        pxTail = pxClone;
     }
-    taskEXIT_CRITICAL(&mutex);
 
-    /*
-     * Update the network state machine, unless the program fails to release its 'xNetworkBufferSemaphore'.
-     * The program should only try to release its semaphore if 'xListItemAlreadyInFreeList' is false.
-     */
-    if( xListItemAlreadyInFreeList == pdFALSE )
+    return pxHead;
+}
+/*-----------------------------------------------------------*/
+
+static NetworkBufferDescriptor_t * prvSegmentClone( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                                    TickType_t xBlockTimeTicks )
+{
+    NetworkBufferDescriptor_t * pxClone;
+    NetworkBufferSlot_t * pxSlot;
+
+    /* Only a descriptor is taken, the payload storage is shared. */
+    pxClone = pxGetNetworkBufferWithDescriptor( 0U, xBlockTimeTicks );
+
+    if( pxClone == NULL )
     {
-        if( xSemaphoreGive( xNetworkBufferSemaphore ) == pdTRUE )
+        return NULL;
+    }
+
+    pxSlot = prvSlotOf( pxNetworkBuffer );
+
+    if( pxSlot != NULL )
+    {
+        taskENTER_CRITICAL(&mutex);
         {
+            if( pxSlot->uxRefCount == 1U )
+            {
+                pxSlot->pucDataFloor = pxNetworkBuffer->pucEthernetBuffer;
+            }
 
+            pxSlot->uxRefCount++;
         }
+        taskEXIT_CRITICAL(&mutex);
     }
-    else
+
+    pxClone->pxExternal = pxNetworkBuffer->pxExternal;
+    pxClone->pucBufferStart = pxNetworkBuffer->pucBufferStart;
+    pxClone->xBufferSize = pxNetworkBuffer->xBufferSize;
+    pxClone->pucEthernetBuffer = pxNetworkBuffer->pucEthernetBuffer;
+    pxClone->xDataLength = pxNetworkBuffer->xDataLength;
+    pxClone->ulGpa = pxNetworkBuffer->ulGpa;
+    pxClone->ulPort = pxNetworkBuffer->ulPort;
+    pxClone->ulBoundPort = pxNetworkBuffer->ulBoundPort;
+
+    return pxClone;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xNetworkBufferIsShared( const NetworkBufferDescriptor_t * pxNetworkBuffer )
+{
+    NetworkBufferSlot_t * pxSlot = prvSlotOf( pxNetworkBuffer );
+
+    /* Reading UBaseType_t, no critical section needed. */
+    return ( ( pxSlot != NULL ) && ( pxSlot->uxRefCount > 1U ) ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xNetworkBufferMakeWritable( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+    NetworkBufferDescriptor_t * pxSegment;
+
+    for( pxSegment = pxNetworkBuffer; pxSegment != NULL; pxSegment = pxSegment->pxNextSegment )
     {
-        /* No action. */
+        if( prvSegmentMakeWritable( pxSegment ) == pdFALSE )
+        {
+            return pdFALSE;
+        }
+    }
+
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSegmentMakeWritable( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+    size_t uxHeadroom;
+    uint8_t * pucSlot;
 
+    if( xNetworkBufferIsShared( pxNetworkBuffer ) == pdFALSE )
+    {
+        return pdTRUE;
     }
-    count = count - 1 ;
-    //ESP_LOGI(TAG_NETBUFFER, "Releasing Buffer....!!!");
-    //ESP_LOGI(TAG_NETBUFFER, "Buffer actived:%d", count);
+
+    uxHeadroom = uxNetworkBufferHeadroom( pxNetworkBuffer );
+
+    /* Take private storage of the same capacity and copy the headroom along
+     * with the data, so headers already pulled (such as a decapsulated PCI)
+     * stay valid at the same offset. */
+    taskENTER_CRITICAL(&mutex);
+    {
+        pucSlot = prvSlabAlloc( pxNetworkBuffer->xBufferSize + BUFFER_PADDING );
+    }
+    taskEXIT_CRITICAL(&mutex);
+
+    if( pucSlot == NULL )
+    {
+        return pdFALSE;
+    }
+
+    ( void ) memcpy( pucSlot + BUFFER_PADDING, pxNetworkBuffer->pucBufferStart, uxHeadroom + pxNetworkBuffer->xDataLength );
+
+    prvDescriptorReleaseStorage( pxNetworkBuffer );
+
+    pxNetworkBuffer->pucBufferStart = pucSlot + BUFFER_PADDING;
+    pxNetworkBuffer->xBufferSize = prvSlabOf( pucSlot )->uxSlotSize - BUFFER_PADDING;
+    pxNetworkBuffer->pucEthernetBuffer = pxNetworkBuffer->pucBufferStart + uxHeadroom;
+
+    return pdTRUE;
 }
 /*-----------------------------------------------------------*/
 
-/*
- * Returns the number of free network buffers
- */
-UBaseType_t uxGetNumberOfFreeNetworkBuffers( void )
+NetworkBufferDescriptor_t * pxGetNetworkBufferChain( size_t xRequestedSizeBytes,
+                                                     TickType_t xBlockTimeTicks )
 {
-    return listCURRENT_LIST_LENGTH( &xFreeBuffersList );
+    NetworkBufferDescriptor_t * pxHead;
+    NetworkBufferDescriptor_t * pxSegment;
+    size_t uxLength;
+
+    if( xRequestedSizeBytes == 0U )
+    {
+        return NULL;
+    }
+
+    /* A single buffer is still preferred when a class has slots that large,
+     * chaining is the fallback when none of them is free. Larger requests
+     * chain straight away rather than count as a failure of the class. */
+    if( prvSlabBestFit( prvRoundedSize( xRequestedSizeBytes ) + BUFFER_PADDING + BUFFER_HEADROOM ) != NULL )
+    {
+        pxHead = pxGetNetworkBufferWithDescriptor( xRequestedSizeBytes, xBlockTimeTicks );
+
+        if( pxHead != NULL )
+        {
+            pxHead->xDataLength = xRequestedSizeBytes;
+            return pxHead;
+        }
+    }
+
+    pxHead = NULL;
+
+    while( xRequestedSizeBytes > 0U )
+    {
+        uxLength = ( xRequestedSizeBytes < baSEGMENT_SIZE ) ? xRequestedSizeBytes : baSEGMENT_SIZE;
+        pxSegment = pxGetNetworkBufferWithDescriptor( uxLength, xBlockTimeTicks );
+
+        if( pxSegment == NULL )
+        {
+            if( pxHead != NULL )
+            {
+                vReleaseNetworkBufferAndDescriptor( pxHead );
+            }
+
+            return NULL;
+        }
+
+        pxSegment->xDataLength = uxLength;
+        xRequestedSizeBytes -= uxLength;
+
+        if( pxHead == NULL )
+        {
+            pxHead = pxSegment;
+        }
+        else
+        {
+            vNetworkBufferAppendSegment( pxHead, pxSegment );
+        }
+    }
+
+    return pxHead;
 }
 /*-----------------------------------------------------------*/
 
-UBaseType_t uxGetMinimumFreeNetworkBuffers( void )
+void vNetworkBufferAppendSegment( NetworkBufferDescriptor_t * pxHead,
+                                  NetworkBufferDescriptor_t * pxSegment )
 {
-    return uxMinimumFreeNetworkBuffers;
+    while( pxHead->pxNextSegment != NULL )
+    {
+        pxHead = pxHead->pxNextSegment;
+    }
+
+    pxHead->pxNextSegment = pxSegment;
 }
 /*-----------------------------------------------------------*/
 
-NetworkBufferDescriptor_t * pxResizeNetworkBufferWithDescriptor( NetworkBufferDescriptor_t * pxNetworkBuffer,
-                                                                 size_t xNewSizeBytes )
+size_t uxNetworkBufferChainLength( const NetworkBufferDescriptor_t * pxHead )
 {
-    size_t xOriginalLength;
-    uint8_t * pucBuffer;
+    size_t uxLength = 0U;
 
-    xOriginalLength = pxNetworkBuffer->xDataLength + BUFFER_PADDING;
-    xNewSizeBytes = xNewSizeBytes + BUFFER_PADDING;
+    for( ; pxHead != NULL; pxHead = pxHead->pxNextSegment )
+    {
+        uxLength += pxHead->xDataLength;
+    }
 
-    pucBuffer = pucGetNetworkBuffer( &( xNewSizeBytes ) );
+    return uxLength;
+}
+/*-----------------------------------------------------------*/
 
-    if( pucBuffer == NULL )
+UBaseType_t uxNetworkBufferSegmentCount( const NetworkBufferDescriptor_t * pxHead )
+{
+    UBaseType_t uxCount = 0U;
+
+    for( ; pxHead != NULL; pxHead = pxHead->pxNextSegment )
     {
-        /* In case the allocation fails, return NULL. */
-        pxNetworkBuffer = NULL;
+        uxCount++;
     }
-    else
+
+    return uxCount;
+}
+/*-----------------------------------------------------------*/
+
+size_t uxNetworkBufferGather( const NetworkBufferDescriptor_t * pxHead,
+                              uint8_t * pucDestination,
+                              size_t uxMaxLength )
+{
+    size_t uxCopied = 0U;
+    size_t uxLength;
+
+    for( ; ( pxHead != NULL ) && ( uxCopied < uxMaxLength ); pxHead = pxHead->pxNextSegment )
     {
-        pxNetworkBuffer->xDataLength = xNewSizeBytes;
+        uxLength = pxHead->xDataLength;
 
-        if( xNewSizeBytes > xOriginalLength )
+        if( uxLength > ( uxMaxLength - uxCopied ) )
         {
-            xNewSizeBytes = xOriginalLength;
+            uxLength = uxMaxLength - uxCopied;
         }
 
-        ( void ) memcpy( pucBuffer - BUFFER_PADDING, pxNetworkBuffer->pucEthernetBuffer - BUFFER_PADDING, xNewSizeBytes );
-        vReleaseNetworkBuffer( pxNetworkBuffer->pucEthernetBuffer );
-        pxNetworkBuffer->pucEthernetBuffer = pucBuffer;
+        ( void ) memcpy( pucDestination + uxCopied, pxHead->pucEthernetBuffer, uxLength );
+        uxCopied += uxLength;
     }
 
-    return pxNetworkBuffer;
+    return uxCopied;
+}
+/*-----------------------------------------------------------*/
+
+size_t uxNetworkBufferScatter( NetworkBufferDescriptor_t * pxHead,
+                               const uint8_t * pucSource,
+                               size_t uxLength )
+{
+    size_t uxCopied = 0U;
+    size_t uxSegmentLength;
+
+    for( ; ( pxHead != NULL ) && ( uxCopied < uxLength ); pxHead = pxHead->pxNextSegment )
+    {
+        uxSegmentLength = pxHead->xDataLength;
+
+        if( uxSegmentLength > ( uxLength - uxCopied ) )
+        {
+            uxSegmentLength = uxLength - uxCopied;
+        }
+
+        ( void ) memcpy( pxHead->pucEthernetBuffer, pucSource + uxCopied, uxSegmentLength );
+        uxCopied += uxSegmentLength;
+    }
+
+    return uxCopied;
 }
@@ -0,0 +1,165 @@
+/*
+ * BufferManagementBench.c
+ *
+ * Contention benchmark for the network buffer pool. Every producer task
+ * repeatedly takes two buffers (a data sized and a management sized one, as
+ * a PDU and its CDAP reply would) and releases them again, so the numbers
+ * reflect the get/release path only.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+/* RINA includes. */
+#include "configSensor.h"
+#include "BufferManagement.h"
+
+#include "esp_log.h"
+
+#if ( NETWORK_BUFFER_BENCHMARK == 1 )
+
+#define BENCH_DATA_SIZE         ( MTU )
+#define BENCH_MGMT_SIZE         ( 64 )
+#define BENCH_TASK_PRIORITY     ( tskIDLE_PRIORITY + 1 )
+#define BENCH_TASK_STACK_WORDS  ( configMINIMAL_STACK_SIZE * 2 )
+
+typedef struct xBENCH_PRODUCER
+{
+    uint32_t ulIterations;
+    uint32_t ulFailures;
+    SemaphoreHandle_t xDone;
+} BenchProducer_t;
+
+static void prvBenchProducerTask( void * pvParameters )
+{
+    BenchProducer_t * pxProducer = ( BenchProducer_t * ) pvParameters;
+    NetworkBufferDescriptor_t * pxData;
+    NetworkBufferDescriptor_t * pxMgmt;
+    uint32_t x;
+
+    for( x = 0; x < pxProducer->ulIterations; x++ )
+    {
+        pxData = pxGetNetworkBufferWithDescriptor( BENCH_DATA_SIZE, portMAX_DELAY );
+        pxMgmt = pxGetNetworkBufferWithDescriptor( BENCH_MGMT_SIZE, pdMS_TO_TICKS( 10 ) );
+
+        if( ( pxData == NULL ) || ( pxMgmt == NULL ) )
+        {
+            pxProducer->ulFailures++;
+        }
+
+        if( pxData != NULL )
+        {
+            pxData->pucEthernetBuffer[ 0 ] = ( uint8_t ) x;
+            vReleaseNetworkBufferAndDescriptor( pxData );
+        }
+
+        if( pxMgmt != NULL )
+        {
+            pxMgmt->pucEthernetBuffer[ 0 ] = ( uint8_t ) x;
+            vReleaseNetworkBufferAndDescriptor( pxMgmt );
+        }
+    }
+
+    /* Do not leave descriptors stranded in a per-thread magazine. */
+    vNetworkBufferMagazineFlush();
+
+    xSemaphoreGive( pxProducer->xDone );
+    vTaskDelete( NULL );
+}
+
+static void prvBenchRun( UBaseType_t uxProducers,
+                         uint32_t ulIterations )
+{
+    BenchProducer_t xProducer[ uxProducers ];
+    SemaphoreHandle_t xDone;
+    TickType_t xStart, xElapsed;
+    uint32_t ulPairs, ulFailures = 0;
+    UBaseType_t x;
+
+    xDone = xSemaphoreCreateCounting( uxProducers, 0 );
+
+    if( xDone == NULL )
+    {
+        ESP_LOGE( TAG_NETBUFFER, "Benchmark: no semaphore" );
+        return;
+    }
+
+    xStart = xTaskGetTickCount();
+
+    for( x = 0; x < uxProducers; x++ )
+    {
+        xProducer[ x ].ulIterations = ulIterations;
+        xProducer[ x ].ulFailures = 0;
+        xProducer[ x ].xDone = xDone;
+
+        if( xTaskCreate( prvBenchProducerTask, "BufBench", BENCH_TASK_STACK_WORDS,
+                         &xProducer[ x ], BENCH_TASK_PRIORITY, NULL ) != pdPASS )
+        {
+            ESP_LOGE( TAG_NETBUFFER, "Benchmark: could not create producer %u", ( unsigned ) x );
+            xSemaphoreGive( xDone );
+        }
+    }
+
+    for( x = 0; x < uxProducers; x++ )
+    {
+        ( void ) xSemaphoreTake( xDone, portMAX_DELAY );
+    }
+
+    xElapsed = xTaskGetTickCount() - xStart;
+
+    if( xElapsed == 0 )
+    {
+        xElapsed = 1;
+    }
+
+    for( x = 0; x < uxProducers; x++ )
+    {
+        ulFailures += xProducer[ x ].ulFailures;
+    }
+
+    ulPairs = ( uint32_t ) uxProducers * ulIterations * 2U;
+
+    ESP_LOGI( TAG_NETBUFFER, "Benchmark: %u producer(s), %u get/release pairs in %u ms, %u pairs/s, %u failures",
+              ( unsigned ) uxProducers, ( unsigned ) ulPairs,
+              ( unsigned ) ( xElapsed * portTICK_PERIOD_MS ),
+              ( unsigned ) ( ( uint64_t ) ulPairs * 1000U / ( xElapsed * portTICK_PERIOD_MS ) ),
+              ( unsigned ) ulFailures );
+
+    vQueueDelete( xDone );
+}
+
+void vNetworkBufferBenchmark( UBaseType_t uxProducers,
+                              uint32_t ulIterations )
+{
+    NetworkBufferClassStats_t xStats;
+    UBaseType_t x;
+
+    prvBenchRun( 1, ulIterations );
+    prvBenchRun( 2, ulIterations );
+
+    if( uxProducers > 2 )
+    {
+        prvBenchRun( uxProducers, ulIterations );
+    }
+
+    ESP_LOGI( TAG_NETBUFFER, "Benchmark: minimum free descriptors %u",
+              ( unsigned ) uxGetMinimumFreeNetworkBuffers() );
+
+    for( x = 0; x < uxGetNetworkBufferClassCount(); x++ )
+    {
+        if( xGetNetworkBufferClassStats( x, &xStats ) )
+        {
+            ESP_LOGI( TAG_NETBUFFER, "Benchmark: class %u (%u bytes) max in use %u/%u, failures %u",
+                      ( unsigned ) x, ( unsigned ) xStats.uxSlotSize,
+                      ( unsigned ) xStats.uxMaxInUse, ( unsigned ) xStats.uxSlotCount,
+                      ( unsigned ) xStats.uxAllocFailures );
+        }
+    }
+}
+
+#endif /* NETWORK_BUFFER_BENCHMARK */
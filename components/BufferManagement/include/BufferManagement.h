@@ -28,26 +28,80 @@
 
 
 
+/* Occupancy of one payload size class, see xGetNetworkBufferClassStats(). */
+    typedef struct xNETWORK_BUFFER_CLASS_STATS
+    {
+        size_t uxSlotSize;            /* Bytes of payload storage per slot. */
+        UBaseType_t uxSlotCount;      /* Slots carved for this class. */
+        UBaseType_t uxInUse;          /* Slots currently handed out, or kept by a descriptor cached in a magazine. */
+        UBaseType_t uxMaxInUse;       /* High-water mark of uxInUse. */
+        UBaseType_t uxAllocFailures;  /* Requests that found no free slot in this or any larger class. */
+    } NetworkBufferClassStats_t;
+
 /* NOTE PUBLIC API FUNCTIONS. */
     BaseType_t xNetworkBuffersInitialise( void );
     NetworkBufferDescriptor_t * pxGetNetworkBufferWithDescriptor( size_t xRequestedSizeBytes,
                                                                   TickType_t xBlockTimeTicks );
 
-/* The definition of the below function is only available if BufferAllocation_2.c has been linked into the source. */
+/* Non-blocking variant for interrupt and driver context, served from a
+ * reserved pool of NUM_NETWORK_BUFFER_ISR_DESCRIPTORS buffers. Returns NULL,
+ * and counts a drop, when the reserved pool is empty. */
     NetworkBufferDescriptor_t * pxNetworkBufferGetFromISR( size_t xRequestedSizeBytes );
     void vReleaseNetworkBufferAndDescriptor( NetworkBufferDescriptor_t * const pxNetworkBuffer );
 
-/* The definition of the below function is only available if BufferAllocation_2.c has been linked into the source. */
+/* Release any buffer from interrupt context. Returns pdTRUE if a task waiting
+ * for a buffer was woken and a context switch should be requested. Wrapped
+ * driver memory is given back by the next get or release from a task. */
     BaseType_t vNetworkBufferReleaseFromISR( NetworkBufferDescriptor_t * const pxNetworkBuffer );
+
+/* Zero-copy receive. Wraps uxLength bytes of memory owned by a driver in a
+ * reserved descriptor, the data is not copied and has no headroom. Once the
+ * last descriptor referencing the memory (clones included) is released,
+ * pxFree( pvHandle ) hands it back to the driver, always from a task.
+ * Returns NULL, and counts a drop, when no descriptor is
+ * available; the memory then still belongs to the caller. */
+    typedef void ( * NetworkBufferExternalFree_t )( void * pvHandle );
+
+    NetworkBufferDescriptor_t * pxNetworkBufferWrapFromISR( uint8_t * pucData,
+                                                            size_t uxLength,
+                                                            NetworkBufferExternalFree_t pxFree,
+                                                            void * pvHandle );
+
+/* Number of pxNetworkBufferGetFromISR() and pxNetworkBufferWrapFromISR()
+ * calls that found the reserved pool empty. */
+    UBaseType_t uxGetNetworkBufferIsrDrops( void );
     uint8_t * pucGetNetworkBuffer( size_t * pxRequestedSizeBytes );
     void vReleaseNetworkBuffer( uint8_t * pucEthernetBuffer );
 
 /* Get the current number of free network buffers. */
     UBaseType_t uxGetNumberOfFreeNetworkBuffers( void );
 
-/* Get the lowest number of free network buffers. */
+/* Get the lowest number of free network buffers. Descriptors cached in the
+ * per-core magazines are counted as free by both functions. */
     UBaseType_t uxGetMinimumFreeNetworkBuffers( void );
 
+/* Return the descriptors cached in the caller's magazine to the global pool.
+ * On the host build each thread has its own magazine, flushed automatically
+ * when the thread exits. */
+    void vNetworkBufferMagazineFlush( void );
+
+/* Called by a task before it blocks for an unbounded time. Flushes the
+ * caller's magazine when it belongs to the thread rather than the core. */
+    void vNetworkBufferMagazineIdle( void );
+
+/* Measure get/release throughput with 1, 2 and uxProducers concurrent tasks,
+ * each doing ulIterations get/release pairs. Results are logged. */
+    #if ( NETWORK_BUFFER_BENCHMARK == 1 )
+        void vNetworkBufferBenchmark( UBaseType_t uxProducers,
+                                      uint32_t ulIterations );
+    #endif
+
+/* Get the number of payload size classes and the statistics of one of them.
+ * Classes are numbered from the smallest slot size upwards. */
+    UBaseType_t uxGetNetworkBufferClassCount( void );
+    BaseType_t xGetNetworkBufferClassStats( UBaseType_t uxClass,
+                                            NetworkBufferClassStats_t * pxStats );
+
 /* Copy a network buffer into a bigger buffer. */
     NetworkBufferDescriptor_t * pxDuplicateNetworkBufferWithDescriptor( const NetworkBufferDescriptor_t * const pxNetworkBuffer,
                                                                         size_t uxNewLength );
@@ -57,6 +111,66 @@
     NetworkBufferDescriptor_t * pxResizeNetworkBufferWithDescriptor( NetworkBufferDescriptor_t * pxNetworkBuffer,
                                                                      size_t xNewSizeBytes );
 
+/* Header manipulation in the style of sk_buff. Push prepends uxLength bytes
+ * into the headroom, Pull strips them from the front and Put appends them at
+ * the tail. Each returns a pointer to the affected area, or NULL if the buffer
+ * has not enough room (or data, for Pull) and is left untouched. On shared
+ * storage Push and Put also fail where a clone may be using the bytes. */
+    uint8_t * pucNetworkBufferPush( NetworkBufferDescriptor_t * pxNetworkBuffer,
+                                    size_t uxLength );
+    uint8_t * pucNetworkBufferPull( NetworkBufferDescriptor_t * pxNetworkBuffer,
+                                    size_t uxLength );
+    uint8_t * pucNetworkBufferPut( NetworkBufferDescriptor_t * pxNetworkBuffer,
+                                   size_t uxLength );
+
+/* Free bytes in front of and behind the data held by a network buffer. */
+    size_t uxNetworkBufferHeadroom( const NetworkBufferDescriptor_t * pxNetworkBuffer );
+    size_t uxNetworkBufferTailroom( const NetworkBufferDescriptor_t * pxNetworkBuffer );
+
+/* Take a new descriptor that shares the payload storage of pxNetworkBuffer.
+ * The storage is reference counted and returned to the pool when the last
+ * descriptor using it is released. */
+    NetworkBufferDescriptor_t * pxNetworkBufferClone( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                                      TickType_t xBlockTimeTicks );
+
+/* pdTRUE if the payload storage is shared with a clone. Shared storage is
+ * read-only, except that the clone whose data starts lowest may still push
+ * headers into the headroom. */
+    BaseType_t xNetworkBufferIsShared( const NetworkBufferDescriptor_t * pxNetworkBuffer );
+
+/* Give the descriptor a private copy of shared storage (copy-on-write).
+ * Returns pdFALSE if no storage was available, leaving the buffer shared. */
+    BaseType_t xNetworkBufferMakeWritable( NetworkBufferDescriptor_t * const pxNetworkBuffer );
+
+/* Scatter-gather. An SDU may be held by a chain of buffers linked through
+ * pxNextSegment, the head carrying the headroom for the headers pushed by the
+ * lower layers. Releasing, cloning or making the head writable applies to the
+ * whole chain; the other buffer functions act on a single segment. */
+    #define networkbufferFOR_EACH_SEGMENT( pxSegment, pxHead ) \
+    for( ( pxSegment ) = ( pxHead ); ( pxSegment ) != NULL; ( pxSegment ) = ( pxSegment )->pxNextSegment )
+
+/* Get xRequestedSizeBytes of payload, in a single buffer if a slot large
+ * enough is free and as a chain of small buffers otherwise. xDataLength of
+ * the segments adds up to exactly xRequestedSizeBytes. Each buffer taken may
+ * wait up to xBlockTimeTicks for a descriptor. */
+    NetworkBufferDescriptor_t * pxGetNetworkBufferChain( size_t xRequestedSizeBytes,
+                                                         TickType_t xBlockTimeTicks );
+    void vNetworkBufferAppendSegment( NetworkBufferDescriptor_t * pxHead,
+                                      NetworkBufferDescriptor_t * pxSegment );
+
+/* Total data length of a chain and its number of segments. */
+    size_t uxNetworkBufferChainLength( const NetworkBufferDescriptor_t * pxHead );
+    UBaseType_t uxNetworkBufferSegmentCount( const NetworkBufferDescriptor_t * pxHead );
+
+/* Copy the data of a chain into contiguous memory, or contiguous memory into
+ * the data of a chain, up to the given length. Return the bytes copied. */
+    size_t uxNetworkBufferGather( const NetworkBufferDescriptor_t * pxHead,
+                                  uint8_t * pucDestination,
+                                  size_t uxMaxLength );
+    size_t uxNetworkBufferScatter( NetworkBufferDescriptor_t * pxHead,
+                                   const uint8_t * pucSource,
+                                   size_t uxLength );
+
     #if ipconfigTCP_IP_SANITY
 
 /*
@@ -103,6 +103,7 @@ static struct efcp_t * pxEfcpCreate(void)
         pxEfcpInstance->xState = eEfcpAllocated;
         
         pxEfcpInstance->pxDelim = NULL;
+        pxEfcpInstance->pxUserIpcp = NULL;
 
         ESP_LOGI(TAG_EFCP,"Instance %pK initialized successfully", pxEfcpInstance);
 
@@ -186,7 +187,7 @@ BaseType_t xEfcpReceive(struct efcp_t *pxEfcp, struct du_t *pxDu)
                 return pdTRUE;
         }
 
-        if (xDtpReceive(pxEfcp->pxDtp, pxDu))
+        if (!xDtpReceive(pxEfcp->pxDtp, pxDu))
         {
                 ESP_LOGE(TAG_EFCP, "DTP cannot receive this PDU");
                 return pdFALSE;
@@ -229,14 +230,8 @@ static BaseType_t xEfcpWrite(struct efcp_t *pxEfcp, struct du_t *pxDu)
 	}
 #endif
 
-        /* No fragmentation */
-        if (xDtpWrite(pxEfcp->pxDtp, pxDu))
-        {
-                ESP_LOGE(TAG_EFCP, "Could not write SDU to DTP");
-                return pdFALSE;
-        }
-
-        return pdTRUE;
+        /* No fragmentation. DTP or the RMT log why if the SDU is lost. */
+        return xDtpWrite(pxEfcp->pxDtp, pxDu);
 }
 
 
@@ -323,7 +318,7 @@ BaseType_t xEfcpContainerReceive(struct efcpContainer_t *pxEfcpContainer, cepId_
         {
                 /* Check that the destination cep-id is set to avoid races,
         	 * otherwise set it*/
-                pxEfcp->pxConnection->xDestinationCepId = pxDu->pxPci->connectionId_t.xDestination;
+                pxEfcp->pxConnection->xDestinationCepId = pxDu->pxPci->connectionId_t.xSource;
         }
 
         //spin_unlock_bh(&container->lock);
@@ -383,6 +378,19 @@ BaseType_t xEfcpContainerWrite(struct efcpContainer_t *pxEfcpContainer, cepId_t
         return ret;
 }
 
+void vEfcpContainerCongestion(struct efcpContainer_t *pxEfcpContainer, cepId_t xCepId)
+{
+        struct efcp_t *pxEfcp;
+
+        (void)pxEfcpContainer;
+
+        pxEfcp = pxEfcpImapFind( xCepId );
+        if (!pxEfcp || pxEfcp->xState == eEfcpDeallocated || !pxEfcp->pxDtp)
+                return;
+
+        vDtpCongestion(pxEfcp->pxDtp);
+}
+
 
 BaseType_t xEfcpEnqueue(struct efcp_t *pxEfcp, portId_t xPort, struct du_t *pxDu)
 {
@@ -396,6 +404,14 @@ BaseType_t xEfcpEnqueue(struct efcp_t *pxEfcp, portId_t xPort, struct du_t *pxDu
                 return pdFALSE;
         }
 
+        /* No reassembly, the SDU goes to the user of the port as it is */
+        if (!pxEfcp->pxUserIpcp->pxOps->duEnqueue(pxEfcp->pxUserIpcp->pxData,
+                                                  xPort, pxDu))
+        {
+                ESP_LOGE(TAG_EFCP, "Upper ipcp could not enqueue sdu to port: %d", xPort);
+                return pdFALSE;
+        }
+
 #if 0
         /* Reassembly goes here */
         if (pxEfcp->pxDelim) {
@@ -435,6 +451,33 @@ BaseType_t xEfcpEnqueue(struct efcp_t *pxEfcp, portId_t xPort, struct du_t *pxDu
         return pdTRUE;
 }
 
+BaseType_t xEfcpConnectionUpdate(struct efcpContainer_t * pxContainer,
+                                 ipcpInstance_t * pxUserIpcp,
+                                 cepId_t xFrom,
+                                 cepId_t xTo)
+{
+        struct efcp_t * pxEfcp;
+
+        if (!pxContainer || !pxUserIpcp || !is_cep_id_ok(xTo)) {
+                ESP_LOGE(TAG_EFCP, "Bogus connection update");
+                return pdFALSE;
+        }
+
+        pxEfcp = pxEfcpImapFind(xFrom);
+        if (!pxEfcp) {
+                ESP_LOGE(TAG_EFCP, "Cannot get instance for cep-id %d", xFrom);
+                return pdFALSE;
+        }
+
+        pxEfcp->pxConnection->xDestinationCepId = xTo;
+        pxEfcp->pxUserIpcp = pxUserIpcp;
+
+        ESP_LOGI(TAG_EFCP, "Connection updated (Source cep-id %d, "
+                 "Destination cep-id %d)", xFrom, xTo);
+
+        return pdTRUE;
+}
+
 
 BaseType_t xEfcpConnectionDestroy(struct efcpContainer_t * pxContainer,
                             cepId_t                xId)
@@ -538,6 +581,7 @@ cepId_t xEfcpConnectionCreate(struct efcpContainer_t * pxContainer,
 
         configASSERT( pxDtpCfg );
 
+        pxConnection->xSourceAddress = xSrcAddr;
         pxConnection->xDestinationAddress = xDstAddr;
         pxConnection->xPortId = xPortId;
         pxConnection->xQosId = xQosId;
@@ -553,9 +597,9 @@ cepId_t xEfcpConnectionCreate(struct efcpContainer_t * pxContainer,
 
        // pxEfcp->pxUserIpcp = xUserIpcp;
 
-        //xCepId = cidm_allocate(container->cidm);
-        //hardcode to test
-        xCepId = 1;
+        /* Each connection its own cep-id: with the same one the imap finds
+         * only the first of them */
+        xCepId = xCepIdmAllocate(pxContainer->pxCidm);
         if (!is_cep_id_ok(xCepId)) {
                 ESP_LOGE(TAG_EFCP,"CIDM generated wrong CEP ID");
                 xEfcpDestroy(pxEfcp);
@@ -565,7 +609,7 @@ cepId_t xEfcpConnectionCreate(struct efcpContainer_t * pxContainer,
         /* We must ensure that the DTP is instantiated, at least ... */
 
         ESP_LOGE(TAG_EFCP,"xEfcpConnectionCreate: pxContainer");
-        pxEfcp->pvContainer = pxContainer;
+        pxEfcp->pxContainer = pxContainer;
         pxConnection->xSourceCepId = xCepId;
         if (!is_candidate_connection_ok((const struct connection_t *) pxConnection)) {
                 ESP_LOGE(TAG_EFCP,"Bogus connection passed, bailing out");
@@ -760,7 +804,7 @@ struct efcp_t * pxEfcpImapFind( cepId_t xCepIdKey )
         int x = 0;
         BaseType_t check = pdFALSE;
 
-        xEfcpFounded = pvPortMalloc(sizeof(struct efcp_t*));
+        xEfcpFounded = NULL;
 
 
         for (x = 0; x < EFCP_IMAP_ENTRIES; x++) //lookup in the MAP for the EFCP Instance based on cepIdKey
@@ -11,6 +11,9 @@
 #include "du.h"
 #include "common.h"
 #include "Rmt.h"
+#include "IPCP.h"
+#include "dtp.h"
+#include "configRINA.h"
 
 #define TAG_DTP         "[DTP]"
 
@@ -22,6 +25,8 @@ static dtpSv_t default_sv = {
         .xMaxSeqNumberRcvd                = 0,
 	.stats = {
 		.drop_pdus = 0,
+		.late_pdus = 0,
+		.ecn_pdus = 0,
 		.err_pdus = 0,
 		.tx_pdus = 0,
 		.tx_bytes = 0,
@@ -39,50 +44,199 @@ static dtpSv_t default_sv = {
         //.A                    = 0,
         //.tr                   = 0,
         .xRcvLeftWindowEdge = 0,
+        .ulRcvDelivered     = 0,
         .xWindowClosed        = false,
         .xDrfFlag             = true,
+        .uxSndrRate           = 0,
+        .uxRateBeforeCut      = 0,
+        .uxPdusSentInTimeUnit = 0,
+        .uxPdusSentLastUnit   = 0,
+        .xTimeUnitStart       = 0,
+        .xRateCut             = false,
 };
 
+#if DTP_REORDER_WINDOW > 32
+#error DTP_REORDER_WINDOW must fit the 32 bits of ulRcvDelivered
+#endif
+
+/* Totals of all the DTP instances, for vDtpGetStats. */
+static DtpStats_t xDtpStats;
+
+/* Inactivity time of uxTimes (MPL + R + A). */
+static TickType_t prvDtpInactivityTicks(dtp_t * pxDtp, UBaseType_t uxTimes)
+{
+        return pdMS_TO_TICKS(uxTimes * (DTP_MAX_PDU_LIFETIME + pxDtp->pxDtpCfg->xInitialATimer));
+}
+
+/* Nothing sent for a while, the next PDU starts a new data run. */
+static void prvDtpSenderInactivity(void * pvArgument)
+{
+        dtp_t * pxDtp = (dtp_t *) pvArgument;
+
+        vIpcpDataPlaneLock();
+        pxDtp->pxDtpStateVector->xDrfFlag = pdTRUE;
+        vIpcpDataPlaneUnlock();
+}
+
+/* Nothing received for a while, the next PDU must start a new data run. */
+static void prvDtpReceiverInactivity(void * pvArgument)
+{
+        dtp_t * pxDtp = (dtp_t *) pvArgument;
+
+        vIpcpDataPlaneLock();
+        pxDtp->pxDtpStateVector->xDrfRequired = pdTRUE;
+        vIpcpDataPlaneUnlock();
+}
+
+/* Paced while the rate is cut or PDUs wait for the next time units. */
+static BaseType_t prvDtpPaced(dtp_t * pxDtp)
+{
+        return pxDtp->pxDtpStateVector->uxRateBeforeCut > 0 ||
+               pxDtp->pxCwq->uxCount > 0;
+}
+
+static BaseType_t prvDtpCwqPush(cwq_t * pxCwq, struct du_t * pxDu)
+{
+        if (pxCwq->uxCount == DTP_CWQ_LENGTH)
+                return pdFALSE;
+
+        pxCwq->pxDus[(pxCwq->uxHead + pxCwq->uxCount) % DTP_CWQ_LENGTH] = pxDu;
+        pxCwq->uxCount++;
+
+        return pdTRUE;
+}
+
+static struct du_t * prvDtpCwqPop(cwq_t * pxCwq)
+{
+        struct du_t * pxDu;
+
+        if (pxCwq->uxCount == 0)
+                return NULL;
+
+        pxDu = pxCwq->pxDus[pxCwq->uxHead];
+        pxCwq->uxHead = (pxCwq->uxHead + 1) % DTP_CWQ_LENGTH;
+        pxCwq->uxCount--;
 
+        return pxDu;
+}
 
 BaseType_t xDtpPduSend(dtp_t * pxDtp, rmt_t * pxRmt, struct du_t * pxDu);
 
-BaseType_t xDtpPduSend(dtp_t * pxDtp, rmt_t * pxRmt, struct du_t * pxDu)
+/* Starts a new time unit, the PDUs sent in the one before are its
+ * measured rate (none if the sender was idle for more than a unit). */
+static void prvDtpNewTimeUnit(dtpSv_t * pxSv)
 {
-	struct efcpContainer_t * pxEfcpContainer;
-	cepId_t		destCepId;
+        TickType_t xNow = xTaskGetTickCount();
+
+        if (xNow - pxSv->xTimeUnitStart < 2 * pdMS_TO_TICKS(DTP_RATE_TIME_UNIT))
+                pxSv->uxPdusSentLastUnit = pxSv->uxPdusSentInTimeUnit;
+        else
+                pxSv->uxPdusSentLastUnit = 0;
+
+        pxSv->uxPdusSentInTimeUnit = 0;
+        pxSv->xTimeUnitStart = xNow;
+}
+
+/* A time unit is over: the rate grows back by a share of itself and the
+ * PDUs waiting are sent, as many as it allows. */
+static void prvDtpRateWindow(void * pvArgument)
+{
+        dtp_t * pxDtp = (dtp_t *) pvArgument;
+        dtpSv_t * pxSv = pxDtp->pxDtpStateVector;
+        struct du_t * pxDu;
+
+        vIpcpDataPlaneLock();
+
+        prvDtpNewTimeUnit(pxSv);
+        pxSv->xRateCut = pdFALSE;
+        pxSv->uxSndrRate += pxSv->uxSndrRate / DTP_RATE_GROWTH + 1;
+        if (pxSv->uxSndrRate >= pxSv->uxRateBeforeCut)
+                pxSv->uxRateBeforeCut = 0;
+
+        while (pxSv->uxPdusSentInTimeUnit < pxSv->uxSndrRate) {
+                pxDu = prvDtpCwqPop(pxDtp->pxCwq);
+                if (!pxDu)
+                        break;
+
+                pxSv->uxPdusSentInTimeUnit++;
+                (void)xDtpPduSend(pxDtp, pxDtp->pxRmt, pxDu);
+        }
 
+        if (prvDtpPaced(pxDtp))
+                vIpcpTimerStart(&pxDtp->xRateWindowTimer, pdMS_TO_TICKS(DTP_RATE_TIME_UNIT));
+
+        vIpcpDataPlaneUnlock();
+}
+
+void vDtpCongestion(dtp_t * pxInstance)
+{
+        dtpSv_t * pxSv = pxInstance->pxDtpStateVector;
+        uint_t uxMeasured;
+
+        /* The marks of one build-up of the queue cut it once */
+        if (pxSv->xRateCut)
+                return;
+
+        /* Halves what the sender really sent: the last time unit, or this
+         * one if it already sent more. Paced, it can't be over the rate. */
+        uxMeasured = pxSv->uxPdusSentLastUnit;
+        if (pxSv->uxPdusSentInTimeUnit > uxMeasured)
+                uxMeasured = pxSv->uxPdusSentInTimeUnit;
+
+        pxSv->xRateCut = pdTRUE;
+        pxSv->uxRateBeforeCut = uxMeasured;
+        pxSv->uxSndrRate = uxMeasured / 2;
+        if (pxSv->uxSndrRate < DTP_RATE_MIN)
+                pxSv->uxSndrRate = DTP_RATE_MIN;
+
+        xDtpStats.ulRateCuts++;
+        ESP_LOGW(TAG_DTP, "Congestion, rate down to %u PDUs per %u ms",
+                 (unsigned)pxSv->uxSndrRate, (unsigned)DTP_RATE_TIME_UNIT);
+
+        /* Starts pacing, in a new time unit */
+        if (!xTimerWheelIsRunning(&pxInstance->xRateWindowTimer)) {
+                prvDtpNewTimeUnit(pxSv);
+                vIpcpTimerStart(&pxInstance->xRateWindowTimer, pdMS_TO_TICKS(DTP_RATE_TIME_UNIT));
+        }
+}
+
+
+
+BaseType_t xDtpPduSend(dtp_t * pxDtp, rmt_t * pxRmt, struct du_t * pxDu)
+{
         ESP_LOGI(TAG_DTP,"xDtpPduSend");
-	/* Remote flow case */
-	if (pxDu->pxPci->xSource != pxDu->pxPci->xDestination) {
-		/*if (dtp->dtcp->sv->rendezvous_rcvr) {
-			ESP_LOGI(TAG_DTP,"Sending to RMT in RV at RCVR");
-		}*/
-
-		if (xRmtSend(pxRmt, pxDu)) {
-			ESP_LOGE(TAG_DTP,"Problems sending PDU to RMT");
-			return pdFALSE;
-		}
 
-		return pdTRUE;
-	}
+	/*if (dtp->dtcp->sv->rendezvous_rcvr) {
+		ESP_LOGI(TAG_DTP,"Sending to RMT in RV at RCVR");
+	}*/
+
+	xDtpStats.ulSent++;
+
+	/* The RMT has counted and logged the PDU if it dropped it */
+	return xRmtSend(pxRmt, pxDu);
+}
+
+/* Both ends of the connection are in this IPCP: the du goes to the EFCP
+ * of the other end as it is, without PCI in its buffer nor the RMT. */
+static BaseType_t prvDtpLoopback(dtp_t * pxDtp, struct du_t * pxDu)
+{
+	struct efcpContainer_t * pxEfcpContainer;
 
-	/* Local flow case */
-	destCepId = pxDu;
         pxEfcpContainer = pxDtp->pxEfcp->pxContainer;
-	//pxEfcpContainer = pxDtp->pxEfcp->pxEfcpContainer;
-	if (unlikely(!pxEfcpContainer || xDuDecap(pxDu) || !xDuIsOk(pxDu))) { /*Decap PDU */
+	if (unlikely(!pxEfcpContainer)) {
 	        ESP_LOGE(TAG_DTP,"Could not retrieve the EFCP container in"
 	        "loopback operation");
 	        xDuDestroy(pxDu);
 	        return pdFALSE;
  	}
-	if (xEfcpContainerReceive(pxEfcpContainer, destCepId, pxDu)) {
+
+	if (!xEfcpContainerReceive(pxEfcpContainer,
+				   pxDu->pxPci->connectionId_t.xDestination, pxDu)) {
 	        ESP_LOGE(TAG_DTP,"Problems sending PDU to loopback EFCP");
 	        return pdFALSE;
 	}
 
-	return 0;
+	return pdTRUE;
 }
 
 BaseType_t xDtpWrite(dtp_t * pxDtpInstance, struct du_t * pxDu)
@@ -97,16 +251,13 @@ BaseType_t xDtpWrite(dtp_t * pxDtpInstance, struct du_t * pxDu)
         uint_t          uxSc;
        // timeout_t         mpl, r, a, rv;
         BaseType_t      xStartRvTimer;
+        BaseType_t      xLoopback;
+        dtpSv_t *       pxSv = pxDtpInstance->pxDtpStateVector;
 
         pxTempEfcp = pxDtpInstance->pxEfcp;
         pxDtcp = pxDtpInstance->pxDtcp;
         
 
-        /* Stop SenderInactivityTimer */
-        /*if (rtimer_stop(&instance->timers.sender_inactivity)) {
-                LOG_ERR("Failed to stop timer");
-        }*/
-
         /*
          * FIXME: The two ways of carrying out flow control
          * could exist at once, thus reconciliation should be
@@ -126,9 +277,17 @@ BaseType_t xDtpWrite(dtp_t * pxDtpInstance, struct du_t * pxDu)
 
 	sbytes = xDuLen(pxDu);
 
-        ESP_LOGI(TAG_DTP,"Calling DUEncap");
+        /* To an address of this IPCP: no PCI in the buffer, it isn't
+         * going through the RMT */
+        xLoopback = xRmtAddressIsLocal(pxDtpInstance->pxRmt,
+                                       pxTempEfcp->pxConnection->xDestinationAddress) ||
+                    pxTempEfcp->pxConnection->xDestinationAddress ==
+                    pxTempEfcp->pxConnection->xSourceAddress;
+
         ESP_LOGI(TAG_DTP,"Sbytes: %d", sbytes);
-	if (!xDuEncap(pxDu, PDU_TYPE_DT)){
+        if (xLoopback) {
+                pxDu->pxPci = &pxDtpInstance->xLoopbackPci;
+        } else if (!xDuEncap(pxDu, PDU_TYPE_DT)){
 		ESP_LOGE(TAG_DTP,"Could not encap PDU");
 		xDuDestroy(pxDu);
 	        return pdFALSE;
@@ -147,7 +306,8 @@ BaseType_t xDtpWrite(dtp_t * pxDtpInstance, struct du_t * pxDu)
         
         pxDu->pxPci->xFlags = 0;
         pxDu->pxPci->xType = PDU_TYPE_DT;
-        pxDu->pxPci->xPduLen = pxDu->pxNetworkBuffer->xDataLength;
+        /* As on the wire, with the PCI a loopback du goes without */
+        pxDu->pxPci->xPduLen = xDuLen(pxDu) + (xLoopback ? sizeof(pci_t) : 0);
         pxDu->pxPci->xSequenceNumber = xCsn;
 
 
@@ -179,7 +339,36 @@ BaseType_t xDtpWrite(dtp_t * pxDtpInstance, struct du_t * pxDu)
 		xPciFlags = pxDu->pxPci->xFlags;
 		xPciFlags |= PDU_FLAGS_DATA_RUN;
                 pxDu->pxPci->xFlags = xPciFlags;
+                pxDtpInstance->pxDtpStateVector->xDrfFlag = pdFALSE;
 	}
+
+        /* Start SenderInactivityTimer */
+        vIpcpTimerStart(&pxDtpInstance->xSenderInactivityTimer,
+                        prvDtpInactivityTicks(pxDtpInstance, 3));
+
+        if (xLoopback)
+                return prvDtpLoopback(pxDtpInstance, pxDu);
+
+        /* Over the rate of this time unit, it waits for the next ones.
+         * Unpaced, the time units are only counted for vDtpCongestion. */
+        if (prvDtpPaced(pxDtpInstance)) {
+                if (pxDtpInstance->pxCwq->uxCount > 0 ||
+                    pxSv->uxPdusSentInTimeUnit >= pxSv->uxSndrRate) {
+                        if (!prvDtpCwqPush(pxDtpInstance->pxCwq, pxDu)) {
+                                ESP_LOGE(TAG_DTP, "Closed window queue full, dropping PDU");
+                                pxSv->stats.drop_pdus++;
+                                xDtpStats.ulDropped++;
+                                xDuDestroy(pxDu);
+                                return pdFALSE;
+                        }
+                        return pdTRUE;
+                }
+        } else if (xTaskGetTickCount() - pxSv->xTimeUnitStart >=
+                   pdMS_TO_TICKS(DTP_RATE_TIME_UNIT)) {
+                prvDtpNewTimeUnit(pxSv);
+        }
+
+        pxSv->uxPdusSentInTimeUnit++;
   #if 0
         LOG_DBG("DTP Sending PDU %u (CPU: %d)", csn, smp_processor_id());
         mpl = instance->sv->MPL;
@@ -257,7 +446,7 @@ BaseType_t xDtpWrite(dtp_t * pxDtpInstance, struct du_t * pxDu)
 			}
                 }
                 if (instance->sv->rexmsn_ctrl) {
-                        cdu = du_dup_ni(du);
+                        cdu = pxDuClone(du);
                         if (!cdu) {
                                 LOG_ERR("Failed to copy PDU. PDU type: %d",
                                 	 pci_type(&du->pci));
@@ -295,7 +484,7 @@ BaseType_t xDtpWrite(dtp_t * pxDtpInstance, struct du_t * pxDu)
                 return 0;
         }
  #endif
-        if (xDtpPduSend(pxDtpInstance,
+        if (!xDtpPduSend(pxDtpInstance,
                          pxDtpInstance->pxRmt,
                          pxDu))
 		return pdFALSE;
@@ -306,13 +495,55 @@ BaseType_t xDtpWrite(dtp_t * pxDtpInstance, struct du_t * pxDu)
        
 }
 
+/* Without DTCP there is no retransmission to wait for, so a PDU past a
+ * gap is delivered and moves the window edge. A late one behind the edge
+ * is delivered if it is within DTP_REORDER_WINDOW and not seen yet. */
+static BaseType_t prvDtpRcvAccept(dtpSv_t * pxSv, seqNum_t xSeqNum)
+{
+        seqNum_t xDistance;
+
+        if (xSeqNum > pxSv->xRcvLeftWindowEdge) {
+                xDistance = xSeqNum - pxSv->xRcvLeftWindowEdge;
+                if (xDistance < 32)
+                        pxSv->ulRcvDelivered = (pxSv->ulRcvDelivered << xDistance) | 1;
+                else
+                        pxSv->ulRcvDelivered = 1;
+                pxSv->xRcvLeftWindowEdge = xSeqNum;
+                return pdTRUE;
+        }
+
+        xDistance = pxSv->xRcvLeftWindowEdge - xSeqNum;
+        if (xDistance >= DTP_REORDER_WINDOW ||
+            (pxSv->ulRcvDelivered & (1UL << xDistance)))
+                return pdFALSE;
+
+        pxSv->ulRcvDelivered |= 1UL << xDistance;
+        return pdTRUE;
+}
+
+static void prvDtpRcvStats(dtpSv_t * pxSv, int sbytes, BaseType_t xLate)
+{
+        pxSv->stats.rx_pdus++;
+        pxSv->stats.rx_bytes += sbytes;
+        xDtpStats.ulDelivered++;
+        if (xLate) {
+                pxSv->stats.late_pdus++;
+                xDtpStats.ulLate++;
+        }
+}
+
+void vDtpGetStats(DtpStats_t * pxStats)
+{
+        *pxStats = xDtpStats;
+}
+
 static inline BaseType_t xDtpPduPost(dtp_t * pxDtpInstance, struct du_t * pxDu)
 {
         struct efcp_t *   pxEfcp;
 
         pxEfcp = pxDtpInstance->pxEfcp;
 
-        if (xEfcpEnqueue(pxEfcp, pxEfcp->pxConnection->xPortId, pxDu)) {
+        if (!xEfcpEnqueue(pxEfcp, pxEfcp->pxConnection->xPortId, pxDu)) {
         	ESP_LOGE( TAG_DTP, "Could not enqueue SDU to EFCP");
         	return pdFALSE;
         }
@@ -360,27 +591,29 @@ BaseType_t xDtpReceive( dtp_t * pxInstance, struct du_t * pxDu)
         xSeqNum = pxDu->pxPci->xSequenceNumber;
 	sbytes = xDuDataLen(pxDu);
 
+        /* Marked by an RMT on the way. There is no DTCP to tell the
+         * sender, only its own RMT makes it slow down. */
+        if (pxDu->pxPci->xFlags & PDU_FLAGS_EXPLICIT_CONGESTION) {
+                pxInstance->pxDtpStateVector->stats.ecn_pdus++;
+                xDtpStats.ulEcn++;
+        }
+
         //LOG_DBG("local_soft_irq_pending: %d", local_softirq_pending());
         /*LOG_DBG("DTP Received PDU %u (CPU: %d)",
                 seq_num, smp_processor_id());*/
 
         if (pxInstance->pxDtpStateVector->xDrfRequired) {
                 /* Start ReceiverInactivityTimer */
-               /* if (rtimer_restart(&instance->timers.receiver_inactivity,
-                                   2 * (mpl + r + a))) {
-                        ESP_LOGE(TAG_DTP,"Failed to start Receiver Inactivity timer");
-                        
-                        xDuDestroy(pxDu);
-                        return pdFALSE;
-                }*/
+                vIpcpTimerStart(&pxInstance->xReceiverInactivityTimer,
+                                prvDtpInactivityTicks(pxInstance, 2));
 
                 if (pxDu->pxPci->xFlags & PDU_FLAGS_DATA_RUN) {
                 	ESP_LOGI( TAG_DTP, "Data Run Flag");
 
                 	pxInstance->pxDtpStateVector->xDrfRequired = pdFALSE;
                         pxInstance->pxDtpStateVector->xRcvLeftWindowEdge = xSeqNum;
-
-                        
+                        pxInstance->pxDtpStateVector->ulRcvDelivered = 1;
+                        prvDtpRcvStats(pxInstance->pxDtpStateVector, sbytes, pdFALSE);
 
                         //dtp_squeue_flush(pxInstance);
                         /*if (instance->rttq) {
@@ -395,17 +628,16 @@ BaseType_t xDtpReceive( dtp_t * pxInstance, struct du_t * pxDu)
                         }*/
 
                        // dtp_send_pending_ctrl_pdus(instance);
-                        //pdu_post(instance, du);
 			//stats_inc_bytes(rx, instance->sv, sbytes);
 
-                        return pdTRUE;
+                        return xDtpPduPost(pxInstance, pxDu);
                 }
 
                 ESP_LOGE(TAG_DTP, "Expecting DRF but not present, dropping PDU %d...",
                         xSeqNum);
 
-		//stats_inc(drop, instance->sv);
-		//spin_unlock_bh(&instance->sv_lock);
+		pxInstance->pxDtpStateVector->stats.drop_pdus++;
+		xDtpStats.ulDropped++;
 
                 xDuDestroy(pxDu);
                 return pdTRUE;
@@ -416,14 +648,13 @@ BaseType_t xDtpReceive( dtp_t * pxInstance, struct du_t * pxDu)
          *   no need to check presence of in_order or dtcp because in case
          *   they are not, LWE is not updated and always 0
          */
-        if (xSeqNum <= xLWE) 
+        if (!prvDtpRcvAccept(pxInstance->pxDtpStateVector, xSeqNum))
         {
-        	/* Duplicate PDU or flow control overrun */
-        	ESP_LOGE(TAG_DTP,"Duplicate PDU or flow control overrun.SN: %u, LWE:%u",
+        	/* Duplicate PDU, or too late for the reorder window */
+        	ESP_LOGE(TAG_DTP,"Duplicate or late PDU dropped. SN: %u, LWE:%u",
         		 xSeqNum, xLWE);
-                //stats_inc(drop, instance->sv);
-
-                //spin_unlock_bh(&instance->sv_lock);
+                pxInstance->pxDtpStateVector->stats.drop_pdus++;
+                xDtpStats.ulDropped++;
 
                 xDuDestroy(pxDu);
 
@@ -441,13 +672,8 @@ BaseType_t xDtpReceive( dtp_t * pxInstance, struct du_t * pxDu)
         }
 
         /* Start ReceiverInactivityTimer */
-       /* if (rtimer_restart(&instance->timers.receiver_inactivity,
-                           2 * (mpl + r + a ))) {
-        	spin_unlock_bh(&instance->sv_lock);
-                LOG_ERR("Failed to start Receiver Inactivity timer");
-                du_destroy(du);
-                return -1;
-        }*/
+        vIpcpTimerStart(&pxInstance->xReceiverInactivityTimer,
+                        prvDtpInactivityTicks(pxInstance, 2));
 
 #if 0
         /* This is an acceptable data PDU, stop reliable ACK timer */
@@ -505,12 +731,12 @@ BaseType_t xDtpReceive( dtp_t * pxInstance, struct du_t * pxDu)
         xLWE = pxInstance->pxDtpStateVector->xRcvLeftWindowEdge;
         
         ESP_LOGI(TAG_DTP,"DTP receive LWE: %u", xLWE);
-        if (xSeqNum == xLWE + 1) {
-        	pxInstance->pxDtpStateVector->xRcvLeftWindowEdge = xSeqNum;
-         
-         //       ringq_push(instance->to_post, pxDu);
-                xLWE = xSeqNum;
-        } /*else {
+
+        prvDtpRcvStats(pxInstance->pxDtpStateVector, sbytes, xSeqNum < xLWE);
+
+        if (!xDtpPduPost(pxInstance, pxDu))
+                return pdFALSE;
+        /*else {
                 seq_queue_push_ni(instance->seqq->queue, du);
         }
 
@@ -575,9 +801,11 @@ BaseType_t xDtpDestroy(dtp_t * pxInstance)
         /* tf_a posts workers that restart sender_inactivity timer, so the wq
          * must be flushed before destroying the timer */
 
-        /*rtimer_stop(&instance->timers.sender_inactivity);
-        rtimer_stop(&instance->timers.receiver_inactivity);
-        rtimer_stop(&instance->timers.rate_window);
+        vIpcpTimerStop(&pxInstance->xSenderInactivityTimer);
+        vIpcpTimerStop(&pxInstance->xReceiverInactivityTimer);
+        vIpcpTimerStop(&pxInstance->xRateWindowTimer);
+
+        /*rtimer_stop(&instance->timers.rate_window);
         rtimer_stop(&instance->timers.rtx);
         rtimer_stop(&instance->timers.rendezvous);*/
 
@@ -657,6 +885,14 @@ BaseType_t xDtpDestroy(dtp_t * pxInstance)
 
 #endif
 	//robject_del(&instance->robj);
+        if (pxInstance->pxCwq) {
+                struct du_t * pxDu;
+
+                while ((pxDu = prvDtpCwqPop(pxInstance->pxCwq)) != NULL)
+                        xDuDestroy(pxDu);
+                vPortFree(pxInstance->pxCwq);
+        }
+
         vPortFree(pxInstance);
 
         ESP_LOGI(TAG_DTP,"DTP %pK destroyed successfully", pxInstance);
@@ -693,7 +929,6 @@ dtp_t * pxDtpCreate(struct efcp_t *       pxEfcp,
 {
         dtp_t * pxDtp;
         string_t *   psName;
-        dtcpSv_t *pxDtcpSv;
 
         if (!pxEfcp) {
                 ESP_LOGE(TAG_DTP,"No EFCP passed, bailing out");
@@ -718,6 +953,11 @@ dtp_t * pxDtpCreate(struct efcp_t *       pxEfcp,
 
         pxDtp->pxEfcp = pxEfcp;
 
+        vTimerWheelTimerInit(&pxDtp->xSenderInactivityTimer, prvDtpSenderInactivity, pxDtp);
+        vTimerWheelTimerInit(&pxDtp->xReceiverInactivityTimer, prvDtpReceiverInactivity, pxDtp);
+        vTimerWheelTimerInit(&pxDtp->xRateWindowTimer, prvDtpRateWindow, pxDtp);
+        pxDtp->pxCwq = NULL;
+
 	/*if (robject_init_and_add(&dtp->robj,
 				 &dtp_rtype,
 				 parent,
@@ -726,8 +966,7 @@ dtp_t * pxDtpCreate(struct efcp_t *       pxEfcp,
                 return NULL;
 	}*/
 
-        pxDtcpSv = pvPortMalloc(sizeof(*pxDtcpSv));
-        pxDtp->pxDtpStateVector = pxDtcpSv;
+        pxDtp->pxDtpStateVector = pvPortMalloc(sizeof(*pxDtp->pxDtpStateVector));
         if (!pxDtp->pxDtpStateVector) {
                 ESP_LOGE(TAG_DTP,"Cannot create DTP state-vector");
 
@@ -735,6 +974,16 @@ dtp_t * pxDtpCreate(struct efcp_t *       pxEfcp,
                 return NULL;
         }
         *pxDtp->pxDtpStateVector = default_sv;
+
+        pxDtp->pxCwq = pvPortMalloc(sizeof(*pxDtp->pxCwq));
+        if (!pxDtp->pxCwq) {
+                ESP_LOGE(TAG_DTP,"Cannot create the closed window queue");
+
+                xDtpDestroy(pxDtp);
+                return NULL;
+        }
+        pxDtp->pxCwq->uxHead = 0;
+        pxDtp->pxCwq->uxCount = 0;
         /* FIXME: fixups to the state-vector should be placed here */
 
         //spin_lock_init(&dtp->sv_lock);
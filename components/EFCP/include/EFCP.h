@@ -21,8 +21,16 @@ BaseType_t xEfcpReceive(struct efcp_t * pxEfcp,  struct du_t *  pxDu);
 struct efcpContainer_t * pxEfcpContainerCreate(void);
 BaseType_t xEfcpContainerWrite(struct efcpContainer_t *pxEfcpContainer, cepId_t xCepId, struct du_t *pxDu);
 
+/* A PDU of the connection xCepId sent from here was marked with ECN */
+void vEfcpContainerCongestion(struct efcpContainer_t *pxEfcpContainer, cepId_t xCepId);
+
 BaseType_t xEfcpConnectionDestroy(struct efcpContainer_t * pxContainer, cepId_t xId);
 
+BaseType_t xEfcpConnectionUpdate(struct efcpContainer_t * pxContainer,
+                                 ipcpInstance_t * pxUserIpcp,
+                                 cepId_t xFrom,
+                                 cepId_t xTo);
+
 cepId_t xEfcpConnectionCreate(struct efcpContainer_t * pxContainer,
                                 address_t               xSrcAddr,
                                 address_t               xDstAddr,
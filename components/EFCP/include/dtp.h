@@ -8,11 +8,28 @@
 #ifndef COMPONENTS_EFCP_INCLUDE_DTP_H_
 #define COMPONENTS_EFCP_INCLUDE_DTP_H_
 
+/* PDUs the DTP instances of this IPCP handed to the RMT, delivered (late
+ * ones, behind the window edge, included), dropped and received marked
+ * with ECN, and the times a sender's rate was cut */
+typedef struct xDTP_STATS
+{
+        uint32_t ulSent;
+        uint32_t ulDelivered;
+        uint32_t ulLate;
+        uint32_t ulDropped;
+        uint32_t ulEcn;
+        uint32_t ulRateCuts;
+} DtpStats_t;
 
 BaseType_t xDtpWrite(dtp_t * pxDtpInstance, struct du_t * pxDu);
 BaseType_t xDtpReceive( dtp_t * pxInstance, struct du_t * pxDu);
 BaseType_t xDtpDestroy(dtp_t * pxInstance);
 
+/* Halve the measured rate of the sender, once per DTP_RATE_TIME_UNIT at most */
+void vDtpCongestion(dtp_t * pxInstance);
+
+void vDtpGetStats(DtpStats_t * pxStats);
+
 dtp_t * pxDtpCreate(struct efcp_t *       pxEfcp,
                         rmt_t *        pxRmt,
                         dtpConfig_t * pxDtpCfg);
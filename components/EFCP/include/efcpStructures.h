@@ -20,8 +20,10 @@
 #include "du.h"
 #include "Rmt.h"
 #include "common.h"
+#include "configSensor.h"
 #include "delim.h"
 #include "cepidm.h"
+#include "timerWheel.h"
 
 /* Retransmission Queue RTXQ used to buffer those PDUs
  * that may require retransmission */
@@ -36,9 +38,9 @@
  * that cannot be transmitted when using flow control*/
 typedef struct xCWQ
 {
-
-        QueueHandle_t *pxQueue;
-        // spinlock_t      lock;
+        struct du_t *pxDus[ DTP_CWQ_LENGTH ];
+        UBaseType_t uxHead;
+        UBaseType_t uxCount;
 } cwq_t;
 
 typedef struct xRTX_QUEUE
@@ -52,7 +54,7 @@ typedef struct xRTXQ
 {
         // spinlock_t                lock;
         struct dtp_t *pxParent;
-        struct rmt_t *rmt;
+        struct xRMT *rmt;
         rtxqueue_t *queue;
 } rtxq_t;
 
@@ -81,6 +83,8 @@ typedef struct xDTP_SV
         // timeout_t    A;
         // timeout_t    tr;
         seqNum_t xRcvLeftWindowEdge;
+        /* Bit n is set once PDU xRcvLeftWindowEdge - n was delivered */
+        uint32_t ulRcvDelivered;
         BaseType_t xWindowClosed;
 
         /* Indicates that the next PDU sent should have the
@@ -93,6 +97,8 @@ typedef struct xDTP_SV
         struct
         {
                 unsigned int drop_pdus;
+                unsigned int late_pdus;
+                unsigned int ecn_pdus;
                 unsigned int err_pdus;
                 unsigned int tx_pdus;
                 unsigned int tx_bytes;
@@ -109,6 +115,17 @@ typedef struct xDTP_SV
         BaseType_t xDrfRequired;
         BaseType_t xRateFulfiled;
 
+        /* Congestion: PDUs the sender may send per DTP_RATE_TIME_UNIT,
+         * the rate it sent at when it was cut (0 once it is back to it
+         * and not paced), PDUs it sent in this unit and the one before,
+         * when this one started and if the rate was cut in it */
+        uint_t uxSndrRate;
+        uint_t uxRateBeforeCut;
+        uint_t uxPdusSentInTimeUnit;
+        uint_t uxPdusSentLastUnit;
+        TickType_t xTimeUnitStart;
+        BaseType_t xRateCut;
+
 } dtpSv_t;
 
 typedef struct xDTCP_SV
@@ -258,7 +275,7 @@ typedef struct xDTCP
         dtcpSv_t *pxSv; /* The state-vector */
 
         struct dtcpConfig_t *pxCfg;
-        struct rmt_t *pxRmt;
+        struct xRMT *pxRmt;
         // struct timer_list 	   rendezvous_rcv;
 
 } dtcp_t;
@@ -281,7 +298,7 @@ typedef struct xDTP
                                    // spinlock_t          sv_lock; /* The state vector lock (DTP & DTCP) */
 
         dtpConfig_t *pxDtpCfg;
-        struct rmt_t *pxRmt;
+        struct xRMT *pxRmt;
         // struct squeue *           seqq;
         // struct ringq *            to_post;
         // struct ringq *            to_send;
@@ -293,6 +310,14 @@ typedef struct xDTP
                 struct timer_list rtx;
                 struct timer_list rendezvous;
         } timers;*/
+        timerWheelTimer_t xSenderInactivityTimer;
+        timerWheelTimer_t xReceiverInactivityTimer;
+        timerWheelTimer_t xRateWindowTimer;
+
+        /* PCI of the PDUs sent to an address of this IPCP. They go to the
+         * EFCP of the other end with their buffer untouched, and it reads
+         * the PCI here while it receives them. */
+        pci_t xLoopbackPci;
 
 } dtp_t;
 
@@ -328,7 +353,7 @@ struct efcpContainer_t
         efcpImapRow_t           *pxEfcpImap;
         cepIdm_t                *pxCidm;
         efcpConfig_t            *pxConfig;
-        struct rmt_t            *pxRmt;
+        struct xRMT             *pxRmt;
         // struct kfa *         kfa;
         // spinlock_t           lock;
         // wait_queue_head_t    del_wq;
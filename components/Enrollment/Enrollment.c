@@ -21,11 +21,27 @@
 #include "pb_decode.h"
 #include "Rib.h"
 #include "SerdesMsg.h"
+#include "factoryIPCP.h"
+#include "IpcManager.h"
+#include "pff.h"
 
 #include "esp_log.h"
 
 static neighborsTableRow_t xNeighborsTable[NEIGHBOR_TABLE_SIZE];
 
+/* The neighbor is reached through the N-1 port enrollment ran on. */
+static void prvEnrollmentAddRoute(neighborInfo_t *pxNeighbor)
+{
+        ipcpInstance_t *pxNormalInstance = pxIpcManagerFindInstanceByType(eNormal);
+
+        if (!pxNormalInstance ||
+            !pxNormalInstance->pxOps->pffAdd(pxNormalInstance->pxData, pxNeighbor->xNeighborAddress,
+                                             PFF_QOS_ANY, &pxNeighbor->xN1Port, 1))
+        {
+                ESP_LOGE(TAG_ENROLLMENT, "No route added to %s", pxNeighbor->pcApName);
+        }
+}
+
 void vEnrollmentAddNeighborEntry(neighborInfo_t *pxNeighbor)
 {
 
@@ -49,7 +65,11 @@ neighborInfo_t *pxEnrollmentFindNeighbor(string_t pcRemoteApName)
 
         BaseType_t x = 0;
         neighborInfo_t *pxNeighbor;
-        pxNeighbor = pvPortMalloc(sizeof(*pxNeighbor));
+
+        if (!pcRemoteApName)
+        {
+                return NULL;
+        }
 
         ESP_LOGI(TAG_ENROLLMENT, "Looking for '%s'", pcRemoteApName);
         for (x = 0; x < NEIGHBOR_TABLE_SIZE; x++)
@@ -78,7 +98,7 @@ address_t xEnrollmentGetNeighborAddress(string_t pcRemoteApName)
 
         BaseType_t x = 0;
         neighborInfo_t *pxNeighbor;
-        pxNeighbor = pvPortMalloc(sizeof(*pxNeighbor));
+
         if(!pcRemoteApName)
         {
                 ESP_LOGE(TAG_ENROLLMENT, "No Remote Application Name valid");
@@ -127,7 +147,7 @@ neighborInfo_t *pxEnrollmentNeighborLookup(string_t pcRemoteApName)
         while (pxListItem != pxListEnd)
         {
 
-                pxNeigh = (neighborInfo_t *)listGET_LIST_ITEM_VALUE(pxListItem);
+                pxNeigh = (neighborInfo_t *)listGET_LIST_ITEM_OWNER(pxListItem);
                 ESP_LOGE(TAG_ENROLLMENT, "--------------pxNeigh:%p", pxNeigh);
 
                 if (strcmp(pxNeigh->xAPName, pcRemoteApName))
@@ -210,7 +230,40 @@ void xEnrollmentInit(portId_t xPortId)
         /*Creating Operational Status into the the RIB*/
         pxRibCreateObject("/difm/ops", 1, "OperationalStatus", "OperationalStatus", OPERATIONAL);
 
+#if NORMAL_ENROLLER
+        /* The neighbors start enrollment, with an M_CONNECT. */
+        (void)pxSource;
+        (void)pxDestInfo;
+        (void)pxAuth;
+#else
         xRibdConnectToIpcp(pxSource, pxDestInfo, xPortId, pxAuth);
+#endif
+}
+
+BaseType_t xEnrollmentHandleConnect(string_t pcRemoteApName, int invokeId, portId_t xN1Port)
+{
+        neighborInfo_t *pxNeighborInfo;
+
+        // Check if the neighbor is already in the neighbor list, add it if not.
+        pxNeighborInfo = pxEnrollmentFindNeighbor(pcRemoteApName);
+
+        if (pxNeighborInfo == NULL)
+        {
+                // We don't know the neigh address yet, set it -1 by now. We need to
+                // wait for the M_START CDAP msg
+                pxNeighborInfo = pxEnrollmentCreateNeighInfo(pcRemoteApName, xN1Port);
+        }
+
+        if (!xRibdSendConnectResponse(invokeId, xN1Port))
+        {
+                ESP_LOGE(TAG_ENROLLMENT, "abort enrollment");
+                return pdFALSE;
+        }
+
+        ESP_LOGI(TAG_ENROLLMENT, "EE <-- ER M_CONNECT_R(enrollment)");
+        pxNeighborInfo->eEnrollmentState = eENROLLMENT_IN_PROGRESS;
+
+        return pdTRUE;
 }
 
 BaseType_t xEnrollmentEnroller(struct ribObject_t *pxEnrRibObj, serObjectValue_t *pxObjValue, string_t pcRemoteApName,
@@ -265,33 +318,46 @@ BaseType_t xEnrollmentEnroller(struct ribObject_t *pxEnrRibObj, serObjectValue_t
                 // Decode the serialized object value from the CDAP message
                 enrollmentMessage_t *pxEnrollmentMsg = pxSerdesMsgEnrollmentDecode(pxObjValue->pvSerBuffer, pxObjValue->xSerLength);
 
+                if (pxEnrollmentMsg == NULL)
+                {
+                        return pdFALSE;
+                }
+
                 // Update the neighbor address in the neighbor database
                 pxNeighborInfo->xNeighborAddress = pxEnrollmentMsg->ullAddress;
+                vPortFree(pxEnrollmentMsg);
 
                 // Send M_START_R to the enrollee
-                enrollmentMessage_t *pxResponseEnrObj = pvPortMalloc(sizeof(*pxResponseEnrObj));
+                enrollmentMessage_t xResponseEnrObj = {0};
 
-                pxResponseEnrObj->ullAddress = LOCAL_ADDRESS;
+                xResponseEnrObj.ullAddress = LOCAL_ADDRESS;
 
-                serObjectValue_t *pxResponseObjValue = pxSerdesMsgEnrollmentEncode(pxResponseEnrObj);
+                serObjectValue_t *pxResponseObjValue = pxSerdesMsgEnrollmentEncode(&xResponseEnrObj);
 
-                /*ribd_send_resp(ipcp, enr_rib_obj->obj_class, enr_rib_obj->obj_name,
-                               enr_rib_obj->obj_inst, 0, NULL, M_START_R, invoke_id,
-                               n1_port, resp_obj_value);
+                if (!xRibdSendResponse(pxEnrRibObj->ucObjClass, pxEnrRibObj->ucObjName, pxEnrRibObj->ulObjInst,
+                                       0, NULL, M_START_R, invokeId, xN1Port, pxResponseObjValue))
+                {
+                        ESP_LOGE(TAG_ENROLLMENT, "Failed to sent M_START_R via n-1 port: %d", xN1Port);
+                        return pdFALSE;
+                }
 
-                debug("EE <-- ER: M_START_R(enrollment)");
+                ESP_LOGI(TAG_ENROLLMENT, "EE <-- ER: M_START_R(enrollment)");
 
                 // TODO Send M_CREATE to the enrollee in order to initialize the
                 // Static and Near Static information required.
 
                 // Send M_STOP to the enrollee to indicate enrollment has finished
-                ribd_send_req(ipcp, enr_rib_obj->obj_class, enr_rib_obj->obj_name,
-                              enr_rib_obj->obj_inst, M_STOP, n1_port, NULL);
+                if (!xRibdSendRequest(pxEnrRibObj->ucObjClass, pxEnrRibObj->ucObjName, pxEnrRibObj->ulObjInst,
+                                      M_STOP, xN1Port, NULL))
+                {
+                        ESP_LOGE(TAG_ENROLLMENT, "Failed to sent M_STOP via n-1 port: %d", xN1Port);
+                        return pdFALSE;
+                }
 
-                ngh_info->enr_state       = ENROLLED;
-                ipcp->ipcp_info->enrolled = 1;
+                pxNeighborInfo->eEnrollmentState = eENROLLED;
+                prvEnrollmentAddRoute(pxNeighborInfo);
 
-                debug("EE <-- ER: M_STOP");*/
+                ESP_LOGI(TAG_ENROLLMENT, "EE <-- ER: M_STOP");
         }
 
         break;
@@ -352,8 +418,6 @@ BaseType_t xEnrollmentHandleStartR(string_t pcRemoteApName, serObjectValue_t *px
         enrollmentMessage_t *pxEnrollmentMsg;
         neighborInfo_t *pxNeighborInfo;
 
-        /*
-
         if ( pxSerObjValue == NULL)
         {
                 ESP_LOGE(TAG_ENROLLMENT,"Serialized Object Value is NULL");
@@ -361,15 +425,23 @@ BaseType_t xEnrollmentHandleStartR(string_t pcRemoteApName, serObjectValue_t *px
         }
 
         pxEnrollmentMsg = pxSerdesMsgEnrollmentDecode((uint8_t *)pxSerObjValue->pvSerBuffer, pxSerObjValue->xSerLength);
+        if (pxEnrollmentMsg == NULL)
+        {
+                return pdFALSE;
+        }
 
-        pxNeighborInfo = pxEnrollmentFindNeighbor(xRemoteApName);
+        pxNeighborInfo = pxEnrollmentFindNeighbor(pcRemoteApName);
         if (pxNeighborInfo == NULL)
         {
                 ESP_LOGE(TAG_ENROLLMENT, "There is no Neighbor Info in the List");
+                vPortFree(pxEnrollmentMsg);
                 return pdFALSE;
         }
 
-        pxNeighborInfo->xNeighborAddress = pxEnrollmentMsg->ullAddress;*/
+        pxNeighborInfo->xNeighborAddress = pxEnrollmentMsg->ullAddress;
+        vPortFree(pxEnrollmentMsg);
+
+        prvEnrollmentAddRoute(pxNeighborInfo);
 
         return pdTRUE;
 }
@@ -415,10 +487,16 @@ BaseType_t xEnrollmentHandleStop(struct ribObject_t *pxEnrRibObj,
 
         pxNeighborInfo->eEnrollmentState = eENROLLED;
 
-        /* Decoding Object Value */
-        pxEnrollmentMsg = pxSerdesMsgEnrollmentDecode(pxSerObjectValue->pvSerBuffer, pxSerObjectValue->xSerLength);
+        /* Decoding Object Value, the enroller may send none */
+        if (pxSerObjectValue != NULL)
+        {
+                pxEnrollmentMsg = pxSerdesMsgEnrollmentDecode(pxSerObjectValue->pvSerBuffer, pxSerObjectValue->xSerLength);
 
-        pxNeighborInfo->pcToken = pxEnrollmentMsg->pcToken;
+                if (pxEnrollmentMsg != NULL)
+                {
+                        pxNeighborInfo->pcToken = pxEnrollmentMsg->pcToken;
+                }
+        }
 
         // Send an M_STOP_R back to the enroller
         if (!xRibdSendResponse(pxEnrRibObj->ucObjClass, pxEnrRibObj->ucObjName, pxEnrRibObj->ulObjInst,
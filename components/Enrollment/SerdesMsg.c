@@ -89,6 +89,7 @@ static enrollmentMessage_t * prvSerdesMsgDecodeEnrollment(rina_messages_enrollme
 {
     enrollmentMessage_t * pxMsg;
     pxMsg = pvPortMalloc(sizeof(*pxMsg));
+    memset(pxMsg, 0, sizeof(*pxMsg));
 
     if ( message.has_address )
     {
@@ -265,16 +266,34 @@ static rina_messages_Flow prvSerdesMsgEncodeFlow(flow_t *pxMsg)
     message.sourcePortId = pxMsg->xSourcePortId;
     message.sourceAddress = pxMsg->xSourceAddress;
 
+    /* Set by the destination IPCP in its answer. */
+    if (pxMsg->xDestinationPortId != -1)
+    {
+        message.destinationPortId = pxMsg->xDestinationPortId;
+        message.has_destinationPortId = true;
+    }
+    message.destinationAddress = pxMsg->xRemoteAddress;
+    message.has_destinationAddress = true;
+
+    message.connectionIds_count = 1;
     message.connectionIds->sourceCEPId = pxMsg->pxConnectionId->xSource;
     message.connectionIds->has_sourceCEPId = true;
     message.connectionIds->qosId = pxMsg->pxConnectionId->xQosId;
     message.connectionIds->has_qosId = true;
+    if (is_cep_id_ok(pxMsg->pxConnectionId->xDestination))
+    {
+        message.connectionIds->destinationCEPId = pxMsg->pxConnectionId->xDestination;
+        message.connectionIds->has_destinationCEPId = true;
+    }
 
     message.has_qosParameters = true;
     message.qosParameters.qosid = pxMsg->pxQosSpec->xQosId;
     message.qosParameters.has_qosid = true;
-    strcpy(message.qosParameters.name, pxMsg->pxQosSpec->pcQosName);
-    message.qosParameters.has_name = true;
+    if (pxMsg->pxQosSpec->pcQosName)
+    {
+        strcpy(message.qosParameters.name, pxMsg->pxQosSpec->pcQosName);
+        message.qosParameters.has_name = true;
+    }
     message.qosParameters.partialDelivery = pxMsg->pxQosSpec->pxFlowSpec->xPartialDelivery;
     message.qosParameters.has_partialDelivery = true;
     message.qosParameters.order = pxMsg->pxQosSpec->pxFlowSpec->xOrderedDelivery;
@@ -322,7 +341,94 @@ serObjectValue_t *pxSerdesMsgFlowEncode(flow_t *pxMsg)
         pxSerMsg->pvSerBuffer = pvBuffer;
         pxSerMsg->xSerLength = stream.bytes_written;
 
-        ESP_LOGE(TAG_ENROLLMENT, "Encoding Flow Message ok");
+        ESP_LOGI(TAG_ENROLLMENT, "Encoding Flow Message ok");
 
         return pxSerMsg;
-}
\ No newline at end of file
+}
+
+static name_t *prvSerdesMsgDecodeName(rina_messages_applicationProcessNamingInfo_t *pxMessage)
+{
+    name_t *pxName = pvPortMalloc(sizeof(*pxName));
+
+    pxName->pcProcessName = strdup(pxMessage->applicationProcessName);
+    pxName->pcProcessInstance = pxMessage->has_applicationProcessInstance ? strdup(pxMessage->applicationProcessInstance) : NULL;
+    pxName->pcEntityName = pxMessage->has_applicationEntityName ? strdup(pxMessage->applicationEntityName) : NULL;
+    pxName->pcEntityInstance = pxMessage->has_applicationEntityInstance ? strdup(pxMessage->applicationEntityInstance) : NULL;
+
+    return pxName;
+}
+
+static flow_t *prvSerdesMsgDecodeFlow(rina_messages_Flow message)
+{
+    flow_t *pxFlow = pvPortMalloc(sizeof(*pxFlow));
+    connectionId_t *pxConnectionId = pvPortMalloc(sizeof(*pxConnectionId));
+    qosSpec_t *pxQosSpec = pvPortMalloc(sizeof(*pxQosSpec));
+    struct flowSpec_t *pxFlowSpec = pvPortMalloc(sizeof(*pxFlowSpec));
+    dtpConfig_t *pxDtpConfig = pvPortMalloc(sizeof(*pxDtpConfig));
+    policy_t *pxDtpPolicySet = pvPortMalloc(sizeof(*pxDtpPolicySet));
+
+    memset(pxFlow, 0, sizeof(*pxFlow));
+    memset(pxFlowSpec, 0, sizeof(*pxFlowSpec));
+    memset(pxDtpConfig, 0, sizeof(*pxDtpConfig));
+    memset(pxDtpPolicySet, 0, sizeof(*pxDtpPolicySet));
+
+    pxFlow->pxSourceInfo = prvSerdesMsgDecodeName(&message.sourceNamingInfo);
+    pxFlow->pxDestInfo = prvSerdesMsgDecodeName(&message.destinationNamingInfo);
+
+    pxFlow->xSourcePortId = message.sourcePortId;
+    pxFlow->xDestinationPortId = message.has_destinationPortId ? (portId_t)message.destinationPortId : -1;
+    pxFlow->xSourceAddress = message.sourceAddress;
+    pxFlow->xRemoteAddress = message.has_destinationAddress ? message.destinationAddress : 0;
+    pxFlow->ulHopCount = message.has_hopCount ? message.hopCount : 0;
+
+    pxConnectionId->xSource = cep_id_bad();
+    pxConnectionId->xDestination = cep_id_bad();
+    pxConnectionId->xQosId = 0;
+    if (message.connectionIds_count > 0)
+    {
+        if (message.connectionIds->has_sourceCEPId)
+            pxConnectionId->xSource = message.connectionIds->sourceCEPId;
+        if (message.connectionIds->has_destinationCEPId)
+            pxConnectionId->xDestination = message.connectionIds->destinationCEPId;
+        if (message.connectionIds->has_qosId)
+            pxConnectionId->xQosId = message.connectionIds->qosId;
+    }
+    pxFlow->pxConnectionId = pxConnectionId;
+
+    pxQosSpec->xQosId = message.qosParameters.has_qosid ? message.qosParameters.qosid : pxConnectionId->xQosId;
+    pxQosSpec->pcQosName = message.qosParameters.has_name ? strdup(message.qosParameters.name) : NULL;
+    pxFlowSpec->xPartialDelivery = message.qosParameters.partialDelivery;
+    pxFlowSpec->xOrderedDelivery = message.qosParameters.order;
+    pxQosSpec->pxFlowSpec = pxFlowSpec;
+    pxFlow->pxQosSpec = pxQosSpec;
+
+    pxDtpConfig->xDtcpPresent = message.dtpConfig.dtcpPresent;
+    pxDtpConfig->xInitialATimer = message.dtpConfig.initialATimer;
+    pxDtpPolicySet->pcPolicyName = strdup(message.dtpConfig.dtppolicyset.policyName);
+    pxDtpPolicySet->pcPolicyVersion = strdup(message.dtpConfig.dtppolicyset.version);
+    pxDtpConfig->pxDtpPolicySet = pxDtpPolicySet;
+    pxFlow->pxDtpConfig = pxDtpConfig;
+
+    return pxFlow;
+}
+
+flow_t *pxSerdesMsgFlowDecode(uint8_t *pucBuffer, size_t xMessageLength)
+{
+    BaseType_t status;
+
+    /*Allocate space for the decode message data*/
+    rina_messages_Flow message = rina_messages_Flow_init_zero;
+
+    /*Create a stream that will read from the buffer*/
+    pb_istream_t stream = pb_istream_from_buffer((pb_byte_t *)pucBuffer, xMessageLength);
+
+    status = pb_decode(&stream, rina_messages_Flow_fields, &message);
+
+    if (!status)
+    {
+        ESP_LOGE(TAG_RINA, "Decoding failed: %s", PB_GET_ERROR(&stream));
+        return NULL;
+    }
+
+    return prvSerdesMsgDecodeFlow(message);
+}
@@ -80,6 +80,7 @@ void xEnrollmentInit(portId_t xPortId);
 BaseType_t xEnrollmentEnroller(struct ribObject_t *pxEnrRibObj, serObjectValue_t *pxObjValue, string_t pcRemoteApName,
                                string_t pcLocalApName, int invokeId, portId_t xN1Port);
 
+BaseType_t xEnrollmentHandleConnect(string_t pcRemoteApName, int invokeId, portId_t xN1Port);
 BaseType_t xEnrollmentHandleConnectR(string_t pcRemoteProcessName, portId_t xN1Port);
 BaseType_t xEnrollmentHandleStartR(string_t pcRemoteApName, serObjectValue_t *pxSerObjValue);
 BaseType_t xEnrollmentHandleStopR(string_t pcRemoteApName);
@@ -92,5 +93,6 @@ BaseType_t xEnrollmentHandleOperationalStart(struct ribObject_t * pxOperRibObj,
                  string_t pxLocalApName, int invokeId, portId_t xN1Port);
 
 address_t xEnrollmentGetNeighborAddress(string_t pcRemoteApName);
+neighborInfo_t *pxEnrollmentFindNeighbor(string_t pcRemoteApName);
 
 #endif /* ENROLLMENT_H_ */
@@ -10,6 +10,7 @@ serObjectValue_t *pxSerdesMsgNeighborEncode(neighborMessage_t *pxMsg);
 neighborMessage_t *pxserdesMsgDecodeNeighbor(uint8_t *pucBuffer, size_t xMessageLength);
 
 serObjectValue_t *pxSerdesMsgFlowEncode(flow_t *pxFlow);
+flow_t *pxSerdesMsgFlowDecode(uint8_t *pucBuffer, size_t xMessageLength);
 
 
 #endif /* SERDES_MSG_H_ */
\ No newline at end of file
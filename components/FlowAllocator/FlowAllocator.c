@@ -25,26 +25,94 @@
 #include "pidm.h"
 #include "RINA_API.h"
 #include "IPCP.h"
+#include "factoryIPCP.h"
+#include "IpcManager.h"
 
 #include "esp_log.h"
 
 /* Create_Request: handle the request send by other IPCP. Consults the local
  * directory Forwarding Table. It is to me, create a FAI*/
 
-BaseType_t xFlowAllocatorInit()
+static flowAllocator_t xFlowAllocator;
+
+BaseType_t xFlowAllocatorInit(pidm_t *pxPidm)
 {
-    flowAllocator_t *pxFlowAllocator;
-    pxFlowAllocator = pvPortMalloc(sizeof(*pxFlowAllocator));
+    xFlowAllocator.pxPidm = pxPidm;
 
     /* Create object in the Rib*/
     pxRibCreateObject("/fa/flows", 0, "Flow_Allocator", "Flow", FLOW_ALLOCATOR);
 
     /*Init List*/
-    vListInitialise(&pxFlowAllocator->xFlowAllocatorInstances);
+    vListInitialise(&xFlowAllocator.xFlowAllocatorInstances);
 
     return pdTRUE;
 }
 
+static flowAllocatorInstace_t *prvFlowAllocatorNewInstance(portId_t xPortId, flow_t *pxFlow,
+                                                           flowAllocateHandle_t *pxFlowRequest)
+{
+    flowAllocatorInstace_t *pxFlowAllocatorInstance;
+
+    pxFlowAllocatorInstance = pvPortMalloc(sizeof(*pxFlowAllocatorInstance));
+
+    if (!pxFlowAllocatorInstance)
+    {
+        ESP_LOGE(TAG_FA, "FAI was not allocated");
+        return NULL;
+    }
+
+    pxFlowAllocatorInstance->eFaiState = eFAI_PENDING;
+    pxFlowAllocatorInstance->xPortId = xPortId;
+    pxFlowAllocatorInstance->pxFlow = pxFlow;
+    pxFlowAllocatorInstance->pxFlowAllocateRequest = pxFlowRequest;
+
+    vListInitialiseItem(&pxFlowAllocatorInstance->xInstanceItem);
+    listSET_LIST_ITEM_OWNER(&pxFlowAllocatorInstance->xInstanceItem, pxFlowAllocatorInstance);
+    vListInsertEnd(&xFlowAllocator.xFlowAllocatorInstances, &pxFlowAllocatorInstance->xInstanceItem);
+
+    return pxFlowAllocatorInstance;
+}
+
+static flowAllocatorInstace_t *prvFlowAllocatorFindInstance(portId_t xPortId)
+{
+    ListItem_t *pxListItem;
+    ListItem_t const *pxListEnd;
+    flowAllocatorInstace_t *pxFlowAllocatorInstance;
+
+    pxListEnd = listGET_END_MARKER(&xFlowAllocator.xFlowAllocatorInstances);
+    pxListItem = listGET_HEAD_ENTRY(&xFlowAllocator.xFlowAllocatorInstances);
+
+    while (pxListItem != pxListEnd)
+    {
+        pxFlowAllocatorInstance = (flowAllocatorInstace_t *)listGET_LIST_ITEM_OWNER(pxListItem);
+
+        if (pxFlowAllocatorInstance->xPortId == xPortId)
+        {
+            return pxFlowAllocatorInstance;
+        }
+
+        pxListItem = listGET_NEXT(pxListItem);
+    }
+
+    return NULL;
+}
+
+static string_t prvFlowAllocatorStrdup(string_t pcString)
+{
+    return pcString ? strdup(pcString) : NULL;
+}
+
+static name_t *prvFlowAllocatorCopyName(name_t *pxName)
+{
+    name_t *pxCopy = pvPortMalloc(sizeof(*pxCopy));
+
+    pxCopy->pcProcessName = prvFlowAllocatorStrdup(pxName->pcProcessName);
+    pxCopy->pcProcessInstance = prvFlowAllocatorStrdup(pxName->pcProcessInstance);
+    pxCopy->pcEntityName = prvFlowAllocatorStrdup(pxName->pcEntityName);
+    pxCopy->pcEntityInstance = prvFlowAllocatorStrdup(pxName->pcEntityInstance);
+
+    return pxCopy;
+}
 
 static qosSpec_t *prvFlowAllocatorSelectQoSCube(void)
 {
@@ -54,6 +122,7 @@ static qosSpec_t *prvFlowAllocatorSelectQoSCube(void)
 
     pxQosSpec = pvPortMalloc(sizeof(*pxQosSpec));
     pxFlowSpec = pvPortMalloc(sizeof(*pxFlowSpec));
+    memset(pxFlowSpec, 0, sizeof(*pxFlowSpec));
 
     /* TODO: Found the most suitable QoScube for the pxFlowRequest->pxFspec
      * Now, it use a default cube to test */
@@ -77,9 +146,6 @@ static flow_t *prvFlowAllocatorNewFlow(flowAllocateHandle_t *pxFlowRequest)
    
     dtpConfig_t *pxDtpConfig;
     policy_t *pxDtpPolicySet;
-    struct dtcpConfig_t *pxDtcpConfig = NULL;
-
- 
 
 
     pxFlow = pvPortMalloc(sizeof(*pxFlow));
@@ -87,15 +153,19 @@ static flow_t *prvFlowAllocatorNewFlow(flowAllocateHandle_t *pxFlowRequest)
     pxDtpConfig = pvPortMalloc((sizeof(*pxDtpConfig)));
     pxDtpPolicySet = pvPortMalloc(sizeof(*pxDtpPolicySet));
 
-    
-    ESP_LOGI(TAG_FA,"DEst:%s",strdup(pxFlowRequest->pxRemote));
+    memset(pxFlow, 0, sizeof(*pxFlow));
+    memset(pxDtpConfig, 0, sizeof(*pxDtpConfig));
+    memset(pxDtpPolicySet, 0, sizeof(*pxDtpPolicySet));
 
-    pxFlow->pxSourceInfo = strdup(pxFlowRequest->pxLocal);
-    pxFlow->pxDestInfo = strdup(pxFlowRequest->pxRemote);
+    ESP_LOGI(TAG_FA,"DEst:%s", pxFlowRequest->pxRemote->pcProcessName);
+
+    pxFlow->pxSourceInfo = prvFlowAllocatorCopyName(pxFlowRequest->pxLocal);
+    pxFlow->pxDestInfo = prvFlowAllocatorCopyName(pxFlowRequest->pxRemote);
     pxFlow->ulHopCount = 3;
     pxFlow->ulMaxCreateFlowRetries = 1;
-    pxFlow->eState = eALLOCATION_IN_PROGRESS;
+    pxFlow->eState = eFA_ALLOCATION_IN_PROGRESS;
     pxFlow->xSourceAddress = LOCAL_ADDRESS;
+    pxFlow->xDestinationPortId = -1;
 
     /* Select QoS Cube based on the FlowSpec Required */
     pxFlow->pxQosSpec = prvFlowAllocatorSelectQoSCube();
@@ -123,72 +193,60 @@ static flow_t *prvFlowAllocatorNewFlow(flowAllocateHandle_t *pxFlowRequest)
  * if it is well-formed, create a new FlowAllocator-Instance*/
 BaseType_t xFlowAllocatorFlowRequest(ipcpInstance_t *pxNormalInstance, portId_t xPortId, flowAllocateHandle_t *pxFlowRequest)
 {
-    ESP_LOGE(TAG_FA, "xFlowAllocatorRequest");
+    ESP_LOGI(TAG_FA, "xFlowAllocatorRequest");
     
     flow_t *pxFlow;
     cepId_t xCepSourceId;
-    flowAllocatorInstace_t *pxFlowAllocatorInstance;
-
+    neighborInfo_t *pxNeighbor;
     connectionId_t *pxConnectionId;
+    serObjectValue_t *pxObjVal;
 
     /* Create a flow object and fill using the event FlowRequest */
     pxFlow = prvFlowAllocatorNewFlow(pxFlowRequest);
 
-    pxConnectionId = pvPortMalloc(sizeof(*pxConnectionId));
-
-
-    /* Create a FAI and fill the struct properly*/
-    pxFlowAllocatorInstance = pvPortMalloc(sizeof(*pxFlowAllocatorInstance));
-
-    if(!pxFlowAllocatorInstance)
-    {
-        ESP_LOGE(TAG_FA,"FAI was not allocated");
-        return pdFALSE;
-    }
-
-
-    pxFlowAllocatorInstance->eFaiState = eFAI_NONE;
-    pxFlowAllocatorInstance->xPortId = xPortId;
-
-     ESP_LOGE(TAG_FA, "GetNeighbor");
     /* Request to DFT the Next Hop, at the moment request to EnrollmmentTask */
-    pxFlow->xRemoteAddress = xEnrollmentGetNeighborAddress(pxFlow->pxDestInfo->pcProcessName);
-    
-    pxFlow->xSourcePortId = xPortId;
-
+    pxNeighbor = pxEnrollmentFindNeighbor(pxFlow->pxDestInfo->pcProcessName);
 
-    if (pxFlow->xRemoteAddress == -1)
+    if (pxNeighbor == NULL || pxNeighbor->eEnrollmentState != eENROLLED)
     {
         ESP_LOGE(TAG_FA, "Error to get Next Hop");
         return pdFALSE;
     }
 
+    pxFlow->xRemoteAddress = pxNeighbor->xNeighborAddress;
+    pxFlow->xSourcePortId = xPortId;
+
     /* Call EFCP to create an EFCP instance following the EFCP Config */
-    ESP_LOGE(TAG_FA, "Calling EFCP");
     xCepSourceId = pxNormalInstance->pxOps->connectionCreate(pxNormalInstance->pxData, xPortId,
                                                        LOCAL_ADDRESS, pxFlow->xRemoteAddress, pxFlow->pxQosSpec->xQosId,
                                                        pxFlow->pxDtpConfig, pxFlow->pxDtcpConfig);
-    if (xCepSourceId == -1)
+    if (!is_cep_id_ok(xCepSourceId))
     {
         ESP_LOGE(TAG_FA, "CepId was not create properly");
         return pdFALSE;
     }
 
     /* Fill the Flow connectionId */
+    pxConnectionId = pvPortMalloc(sizeof(*pxConnectionId));
     pxConnectionId->xSource = xCepSourceId;
+    pxConnectionId->xDestination = cep_id_bad();
     pxConnectionId->xQosId = pxFlow->pxQosSpec->xQosId;
 
     pxFlow->pxConnectionId = pxConnectionId;
 
+    /* Create a FAI, it wakes the application up once the remote end
+     * answers */
+    if (!prvFlowAllocatorNewInstance(xPortId, pxFlow, pxFlowRequest))
+    {
+        return pdFALSE;
+    }
+
     /* Send the flow message to the neighbor */
     //Serialize the pxFLow Struct into FlowMsg and Encode the FlowMsg as obj_value
-    ESP_LOGE(TAG_FA, "EncodingFLow");
-
-    serObjectValue_t *pxObjVal = pxSerdesMsgFlowEncode(pxFlow);
+    pxObjVal = pxSerdesMsgFlowEncode(pxFlow);
 
     //Send using the ribd_send_req M_Create
-    ESP_LOGE(TAG_FA, "SendingFlow");
-    if (!xRibdSendRequest("Flow_Allocator", "/fa/flows", -1, M_START, xPortId, pxObjVal))
+    if (!pxObjVal || !xRibdSendRequest("Flow", "/fa/flows", -1, M_CREATE, pxNeighbor->xN1Port, pxObjVal))
         {
                 ESP_LOGE(TAG_FA, "It was a problem to sen the request");
                 return pdFALSE;
@@ -196,4 +254,129 @@ BaseType_t xFlowAllocatorFlowRequest(ipcpInstance_t *pxNormalInstance, portId_t
 
     return pdTRUE;
 
-}
\ No newline at end of file
+}
+
+BaseType_t xFlowAllocatorHandleCreate(struct ribObject_t *pxRibObject, serObjectValue_t *pxObjValue, string_t pcRemoteApName,
+                                      string_t pcLocalApName, int invokeId, portId_t xN1Port)
+{
+    ipcpInstance_t *pxNormalInstance;
+    flow_t *pxFlow;
+    portId_t xPortId;
+    cepId_t xCepId = cep_id_bad();
+    int result = 1;
+    serObjectValue_t *pxResponseObjVal;
+
+    (void)pcRemoteApName;
+    (void)pcLocalApName;
+
+    if (!pxObjValue)
+    {
+        ESP_LOGE(TAG_FA, "M_CREATE without a flow");
+        return pdFALSE;
+    }
+
+    pxFlow = pxSerdesMsgFlowDecode(pxObjValue->pvSerBuffer, pxObjValue->xSerLength);
+    if (!pxFlow)
+    {
+        return pdFALSE;
+    }
+
+    pxNormalInstance = pxIpcManagerFindInstanceByType(eNormal);
+    xPortId = xPidmAllocate(xFlowAllocator.pxPidm);
+
+    /* The flow is for the local applications, bind it to them and answer
+     * with the CEP-id of this end. */
+    if (pxNormalInstance &&
+        pxNormalInstance->pxOps->flowPrebind(pxNormalInstance->pxData, pxRINA_UserInstance(), xPortId))
+    {
+        xCepId = pxNormalInstance->pxOps->connectionCreate(pxNormalInstance->pxData, xPortId,
+                                                           LOCAL_ADDRESS, pxFlow->xSourceAddress,
+                                                           pxFlow->pxQosSpec->xQosId,
+                                                           pxFlow->pxDtpConfig, NULL);
+    }
+
+    if (is_cep_id_ok(xCepId) &&
+        pxNormalInstance->pxOps->connectionUpdate(pxNormalInstance->pxData, xPortId, xCepId,
+                                                  pxFlow->pxConnectionId->xSource) &&
+        xRINA_FlowBound(xPortId, pdTRUE))
+    {
+        flowAllocatorInstace_t *pxFlowAllocatorInstance = prvFlowAllocatorNewInstance(xPortId, pxFlow, NULL);
+
+        if (pxFlowAllocatorInstance)
+        {
+            pxFlowAllocatorInstance->eFaiState = eFAI_ALLOCATED;
+        }
+        result = 0;
+        ESP_LOGI(TAG_FA, "Flow from %s allocated on port %d", pxFlow->pxSourceInfo->pcProcessName, xPortId);
+    }
+    else
+    {
+        ESP_LOGE(TAG_FA, "Flow from %s could not be allocated", pxFlow->pxSourceInfo->pcProcessName);
+    }
+
+    pxFlow->xDestinationPortId = xPortId;
+    pxFlow->xRemoteAddress = LOCAL_ADDRESS;
+    pxFlow->pxConnectionId->xDestination = xCepId;
+
+    pxResponseObjVal = pxSerdesMsgFlowEncode(pxFlow);
+
+    return xRibdSendResponse(pxRibObject->ucObjClass, pxRibObject->ucObjName, pxRibObject->ulObjInst,
+                             result, NULL, M_CREATE_R, invokeId, xN1Port, pxResponseObjVal);
+}
+
+BaseType_t xFlowAllocatorHandleCreateR(serObjectValue_t *pxSerObjValue, int result)
+{
+    ipcpInstance_t *pxNormalInstance;
+    flowAllocatorInstace_t *pxFlowAllocatorInstance;
+    flowAllocateHandle_t *pxFlowRequest;
+    flow_t *pxFlow;
+
+    if (!pxSerObjValue)
+    {
+        ESP_LOGE(TAG_FA, "M_CREATE_R without a flow");
+        return pdFALSE;
+    }
+
+    pxFlow = pxSerdesMsgFlowDecode(pxSerObjValue->pvSerBuffer, pxSerObjValue->xSerLength);
+    if (!pxFlow)
+    {
+        return pdFALSE;
+    }
+
+    pxFlowAllocatorInstance = prvFlowAllocatorFindInstance(pxFlow->xSourcePortId);
+    if (!pxFlowAllocatorInstance || pxFlowAllocatorInstance->eFaiState != eFAI_PENDING)
+    {
+        ESP_LOGE(TAG_FA, "No flow pending on port %d", (int)pxFlow->xSourcePortId);
+        return pdFALSE;
+    }
+
+    pxNormalInstance = pxIpcManagerFindInstanceByType(eNormal);
+    pxFlowRequest = pxFlowAllocatorInstance->pxFlowAllocateRequest;
+
+    if (result == 0 &&
+        pxNormalInstance->pxOps->connectionUpdate(pxNormalInstance->pxData, pxFlowAllocatorInstance->xPortId,
+                                                  pxFlowAllocatorInstance->pxFlow->pxConnectionId->xSource,
+                                                  pxFlow->pxConnectionId->xDestination) &&
+        xRINA_FlowBound(pxFlowAllocatorInstance->xPortId, pdFALSE))
+    {
+        pxFlowAllocatorInstance->eFaiState = eFAI_ALLOCATED;
+        pxFlowAllocatorInstance->pxFlow->pxConnectionId->xDestination = pxFlow->pxConnectionId->xDestination;
+        pxFlowAllocatorInstance->pxFlow->xDestinationPortId = pxFlow->xDestinationPortId;
+        pxFlowAllocatorInstance->pxFlow->eState = eFA_ALLOCATED;
+        pxFlowRequest->xPortId = pxFlowAllocatorInstance->xPortId;
+        ESP_LOGI(TAG_FA, "Flow allocated on port %d", pxFlowAllocatorInstance->xPortId);
+    }
+    else
+    {
+        pxFlowAllocatorInstance->eFaiState = eFAI_NONE;
+        pxFlowRequest->xPortId = -1;
+        ESP_LOGE(TAG_FA, "Flow on port %d was refused", pxFlowAllocatorInstance->xPortId);
+    }
+
+    /* The application owns the request again. */
+    pxFlowAllocatorInstance->pxFlowAllocateRequest = NULL;
+    pxFlowRequest->xEventBits |= (EventBits_t)eFLOW_BOUND;
+    xRINA_WeakUpUser(pxFlowRequest);
+
+    return pdTRUE;
+}
@@ -15,14 +15,16 @@
 
 #include "IPCP.h"
 #include "RINA_API.h"
+#include "Rib.h"
+#include "pidm.h"
 
 typedef enum
 {
-    eEMPTY,
-    eALLOCATION_IN_PROGRESS,
-    eALLOCATED,
-    eWAITING_2_MPL_BEFORE_TEARING_DOWN,
-    eDEALLOCATED,
+    eFA_EMPTY,
+    eFA_ALLOCATION_IN_PROGRESS,
+    eFA_ALLOCATED,
+    eFA_WAITING_2_MPL_BEFORE_TEARING_DOWN,
+    eFA_DEALLOCATED,
 
 }eFlowAllocationState_t;
 
@@ -45,6 +47,12 @@ typedef struct xFLOW_ALLOCATOR_INSTANCE
     /* State */
     eFaiState_t eFaiState;
 
+    /* Flow being allocated */
+    struct xFLOW_MESSAGE *pxFlow;
+
+    /* Request of the local application, NULL for a remote one */
+    flowAllocateHandle_t *pxFlowAllocateRequest;
+
 } flowAllocatorInstace_t;
 
 typedef struct xFLOW_ALLOCATOR
@@ -52,6 +60,9 @@ typedef struct xFLOW_ALLOCATOR
     /* List of FAI*/
     List_t xFlowAllocatorInstances;
 
+    /* Port Id manager, for the flows requested by remote applications */
+    pidm_t *pxPidm;
+
 } flowAllocator_t;
 
 typedef struct xQOS_SPEC
@@ -110,8 +121,20 @@ typedef struct xFLOW_MESSAGE
     /* Source Port Id */
     portId_t xSourcePortId;
 
+    /* Destination Port Id, -1 until the destination IPCP answers */
+    portId_t xDestinationPortId;
+
 }flow_t;
 
+BaseType_t xFlowAllocatorInit(pidm_t *pxPidm);
+
 BaseType_t xFlowAllocatorFlowRequest(ipcpInstance_t *pxNormalInstance, portId_t xPortId, flowAllocateHandle_t *pxFlowRequest);
 
+/* M_CREATE of a flow, sent by the IPCP of the source application. */
+BaseType_t xFlowAllocatorHandleCreate(struct ribObject_t *pxRibObject, serObjectValue_t *pxObjValue, string_t pcRemoteApName,
+                                      string_t pcLocalApName, int invokeId, portId_t xN1Port);
+
+/* M_CREATE_R of the flow, sent back by the IPCP of the destination one. */
+BaseType_t xFlowAllocatorHandleCreateR(serObjectValue_t *pxSerObjValue, int result);
+
 #endif
\ No newline at end of file
@@ -18,9 +18,14 @@
 #include "normalIPCP.h"
 #include "IpcManager.h"
 #include "RINA_API.h"
+#include "spscRing.h"
+#include "du.h"
+#include "Rmt.h"
 
 #include "Enrollment.h"
-#include "ESP_log.h"
+#include "FlowAllocator.h"
+#include "esp_log.h"
+#include "esp_timer.h"
 
 MACAddress_t xlocalMACAddress = {{0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
 
@@ -28,8 +33,27 @@ MACAddress_t xlocalMACAddress = {{0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
  * reference. */
 const MACAddress_t xBroadcastMACAddress = {{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
 
-/** @brief The queue used to pass events into the IPCP-task for processing. */
-QueueHandle_t xNetworkEventQueue = NULL;
+/** @brief An event waiting in one of the lanes of the IPCP-task. */
+typedef struct xIPCP_LANE_EVENT
+{
+    RINAStackEvent_t xEvent;
+    int64_t llQueuedUs;
+} IpcpLaneEvent_t;
+
+/** @brief The queues used to pass events into the IPCP-task for processing,
+ * one per eIpcpEventLane_t. Senders notify the task after queueing. */
+static QueueHandle_t xEventLanes[eIpcpLaneCount] = {NULL};
+
+/** @brief Times each lane with events waiting was passed over in a row. */
+static UBaseType_t uxLaneSkipped[eIpcpLaneCount] = {0};
+
+static IpcpEventLaneStats_t xLaneStats[eIpcpLaneCount];
+
+/** @brief When the IPCP task started to serve events, once the instances
+ * are created: the ones queued before are timed from there, not from when
+ * they were queued. */
+static int64_t llLanesServedFromUs = 0;
+static portMUX_TYPE xLaneStatsLock = portMUX_INITIALIZER_UNLOCKED;
 
 /** @brief Set to pdTRUE when the IPCP task is ready to start processing packets. */
 static BaseType_t xIPCPTaskInitialised = pdFALSE;
@@ -49,6 +73,34 @@ static volatile BaseType_t xNetworkDownEventPending = pdFALSE;
  * itself (in which case it is not ok to block). */
 static TaskHandle_t xIPCPTaskHandle = NULL;
 
+#if (IPCP_USE_PIPELINE != 0)
+/** @brief The RX and TX tasks of the pipeline, see IPCP_USE_PIPELINE. */
+static TaskHandle_t xIPCPRxTaskHandle = NULL;
+static TaskHandle_t xIPCPTxTaskHandle = NULL;
+
+/** @brief Events for the TX task: SDUs written by applications and frames
+ * to send. Several tasks post to it, so it is a queue and not a ring. */
+static QueueHandle_t xTxEventQueue = NULL;
+
+/** @brief Bursts of frames from the driver to the RX task. */
+static spscRing_t xRxRing;
+static void *pvRxRingSlots[IPCP_PIPELINE_RING_SIZE];
+
+/** @brief Frames the RX task leaves to the IPCP task: ARP and management
+ * PDUs. ulControlRxPending is set while an eNetworkRxEvent announcing them
+ * is queued, so one event covers many frames. */
+static spscRing_t xControlRing;
+static void *pvControlRingSlots[IPCP_PIPELINE_RING_SIZE];
+static uint32_t ulControlRxPending = 0;
+
+/** @brief Data-plane lock, see vIpcpDataPlaneLock(). Recursive, as the
+ * IPCP task takes it again from the paths it calls. */
+static SemaphoreHandle_t xDataPlaneMutex = NULL;
+
+/** @brief Waits on the data-plane lock, only changed by its holder. */
+static IpcpDataPlaneLockStats_t xDataPlaneLockStats;
+#endif
+
 /* List of Factories */
 // static factories_t *pxFactories;
 ipcManager_t *pxIpcManager;
@@ -63,8 +115,15 @@ static portINLINE DECL_CAST_PTR_FUNC_FOR_TYPE(NetworkBufferDescriptor_t)
     return (NetworkBufferDescriptor_t *)pvArgument;
 }
 
+/** @brief The timers of the IPCP task and of the connections. */
+static timerWheel_t xIpcpTimerWheel;
+
+/** @brief Tick the IPCP task sleeps until when nothing wakes it. Timers
+ * started earlier than this by other tasks wake it up. */
+static TickType_t xIpcpWakeTick = 0;
+
 /** @brief ARP timer, to check its table entries. */
-static IPCPTimer_t xARPTimer;
+static timerWheelTimer_t xARPTimer;
 
 void RINA_NetworkDown(void);
 
@@ -82,18 +141,10 @@ EthernetHeader_t *vCastPointerTo_EthernetPacket_t(const void *pvArgument);
  */
 static void prvIPCPTask(void *pvParameters);
 
-static BaseType_t prvIPCPTimerCheck(IPCPTimer_t *pxTimer);
-
 /*
- * Utility functions for the light weight IP timers.
+ * Called in the IPCP task when the ARP timer expires.
  */
-static void prvIPCPTimerStart(IPCPTimer_t *pxTimer,
-                              TickType_t xTime);
-
-static BaseType_t prvIPCPTimerCheck(IPCPTimer_t *pxTimer);
-
-static void prvIPCPTimerReload(IPCPTimer_t *pxTimer,
-                               TickType_t xTime);
+static void prvARPTimerExpired(void *pvArgument);
 
 /*
  * Returns pdTRUE if the IP task has been created and is initialised.  Otherwise
@@ -102,8 +153,7 @@ static void prvIPCPTimerReload(IPCPTimer_t *pxTimer,
 BaseType_t xIPCPIsNetworkTaskReady(void);
 
 /*
- * Checks the ARP, timers to see if any periodic or timeout
- * processing is required.
+ * Runs the callbacks of the timers that expired.
  */
 static void prvCheckNetworkTimers(void);
 
@@ -132,7 +182,42 @@ static void prvProcessEthernetPacket(NetworkBufferDescriptor_t *const pxNetworkB
  * The network card driver has received a packet.  In the case that it is part
  * of a linked packet chain, walk through it to handle every message.
  */
+#if (IPCP_USE_PIPELINE == 0)
 static void prvHandleEthernetPacket(NetworkBufferDescriptor_t *pxBuffer);
+#endif
+
+/*
+ * Create the event lanes, queue an event in the lane of its type and take
+ * the next event to process.
+ */
+static BaseType_t prvCreateEventLanes(void);
+static BaseType_t prvSendEventToLane(const RINAStackEvent_t *pxEvent, TickType_t uxTimeout);
+static BaseType_t prvReceiveEvent(RINAStackEvent_t *pxEvent);
+
+/*
+ * Strips the Ethernet header of a RINA frame and hands the PDU to the RMT.
+ */
+static void prvProcessRINAPacket(NetworkBufferDescriptor_t *const pxNetworkBuffer);
+
+/*
+ * Writes an SDU posted by RINA_flow_write() to its flow.
+ */
+static void prvProcessStackTxEvent(NetworkBufferDescriptor_t *pxNetworkBuffer);
+
+#if (IPCP_USE_PIPELINE != 0)
+/*
+ * The RX task runs the data PDUs received up to EFCP and leaves everything
+ * else to the IPCP task. The TX task writes the SDUs of the applications and
+ * hands the frames to the driver.
+ */
+static void prvIPCPRxTask(void *pvParameters);
+static void prvIPCPTxTask(void *pvParameters);
+
+static BaseType_t prvIsDataPdu(const NetworkBufferDescriptor_t *pxNetworkBuffer);
+static void prvPassToControl(NetworkBufferDescriptor_t *pxNetworkBuffer);
+static void prvProcessControlRing(void);
+static BaseType_t prvCreatePipeline(void);
+#endif
 
 /*----------------------------------------------------*/
 
@@ -144,8 +229,11 @@ BaseType_t xIPCPTaskReady(void)
 /**
  * @brief The IPCP task handles all requests from the user application and the
  *        network interface. It receives messages through a FreeRTOS queue called
- *        'xNetworkEventQueue'. prvIPTask() is the only task which has access to
- *        the data of the IPCP-stack, and so it has no need of using mutexes.
+ *        'xNetworkEventQueue'. Without IPCP_USE_PIPELINE prvIPTask() is the
+ *        only task which has access to the data of the IPCP-stack, and so it
+ *        has no need of using mutexes. With it, the data PDUs are run by the
+ *        RX and TX tasks and the data they share is guarded by
+ *        vIpcpDataPlaneLock().
  *
  * @param[in] pvParameters: Not used.
  */
@@ -165,6 +253,10 @@ static void prvIPCPTask(void *pvParameters)
         ESP_LOGE(TAG_IPCPMANAGER, "Error to initializing IPC Manager");
     }
 
+    /* Senders notify this task after queueing an event, and the first ones
+     * may come before the creating task has stored the handle. */
+    xIPCPTaskHandle = xTaskGetCurrentTaskHandle();
+
     /* Initialization is complete and events can now be processed. */
     xIPCPTaskInitialised = pdTRUE;
 
@@ -176,6 +268,8 @@ static void prvIPCPTask(void *pvParameters)
     // RINA_NetworkDown();
     vInitFactories();
 
+    llLanesServedFromUs = esp_timer_get_time();
+
     /* Loop, processing IP events. */
     for (;;)
     {
@@ -188,12 +282,18 @@ static void prvIPCPTask(void *pvParameters)
         /* Calculate the acceptable maximum sleep time. */
         xNextIPCPSleep = prvCalculateSleepTime();
 
-        /* Wait until there is something to do. If the following call exits
-         * due to a time out rather than a message being received, set a
-         * 'NoEvent' value. */
-        if (xQueueReceive(xNetworkEventQueue, (void *)&xReceivedEvent, xNextIPCPSleep) == pdFALSE)
+        /* Wait until there is something to do. If the wait ends due to a
+         * time out rather than an event being queued, set a 'NoEvent'
+         * value. */
+        if (prvReceiveEvent(&xReceivedEvent) == pdFALSE)
         {
-            xReceivedEvent.eEventType = eNoEvent;
+            vNetworkBufferMagazineIdle();
+            (void)ulTaskNotifyTake(pdTRUE, xNextIPCPSleep);
+
+            if (prvReceiveEvent(&xReceivedEvent) == pdFALSE)
+            {
+                xReceivedEvent.eEventType = eNoEvent;
+            }
         }
 
         switch (xReceivedEvent.eEventType)
@@ -208,11 +308,21 @@ static void prvIPCPTask(void *pvParameters)
 
         case eNetworkRxEvent:
 
+#if (IPCP_USE_PIPELINE != 0)
+            /* The RX task has left frames on the control ring. */
+            prvProcessControlRing();
+#else
             /* The network hardware driver has received a new packet.  A
              * pointer to the received buffer is located in the pvData member
              * of the received event structure. */
             prvHandleEthernetPacket(CAST_PTR_TO_TYPE_PTR(NetworkBufferDescriptor_t, xReceivedEvent.pvData));
 
+#if (USE_LINKED_RX_MESSAGES != 0)
+            /* Frames held back while the burst was processed are posted now. */
+            vNetworkInterfaceRxBurstDone();
+#endif
+#endif
+
             break;
 
         case eNetworkTxEvent:
@@ -220,13 +330,26 @@ static void prvIPCPTask(void *pvParameters)
         {
             NetworkBufferDescriptor_t *pxDescriptor = CAST_PTR_TO_TYPE_PTR(NetworkBufferDescriptor_t, xReceivedEvent.pvData);
 
-            /* Send a network packet. The ownership will  be transferred to
-             * the driver, which will release it after delivery. */
-
-            (void)xNetworkInterfaceOutput(pxDescriptor, pdTRUE);
+            /* Without a buffer the event asks to drain the TX ring of the
+             * interface. Otherwise send that network packet. The ownership
+             * will be transferred to the driver, which will release it after
+             * delivery. */
+            if (pxDescriptor == NULL)
+            {
+                vNetworkInterfaceTxDrain();
+            }
+            else
+            {
+                (void)xNetworkInterfaceOutput(pxDescriptor, pdTRUE);
+            }
         }
         break;
 
+        case eStackTxEvent:
+
+            prvProcessStackTxEvent(CAST_PTR_TO_TYPE_PTR(NetworkBufferDescriptor_t, xReceivedEvent.pvData));
+            break;
+
         case eShimEnrollEvent:
 
             // xShimWiFiCreate(pxFactory, (MACAddress_t *) xReceivedEvent.pvData );
@@ -257,6 +380,7 @@ static void prvIPCPTask(void *pvParameters)
             if (xIpcManagerCreateInstance(pxIpcManager->pxFactories, eFactoryNormal, pxIpcManager->pxIpcpIdm))
             {
                 ESP_LOGI(TAG_IPCPMANAGER, "Normal IPCP was created sucessfully");
+                (void)xFlowAllocatorInit(pxIpcManager->pxPidm);
             }
             else
             {
@@ -280,6 +404,8 @@ static void prvIPCPTask(void *pvParameters)
                 ESP_LOGI(TAG_IPCPMANAGER, "Shim WiFi was not created");
             }
 #endif
+            /* Bringing the shim up blocks this task until the link is up */
+            llLanesServedFromUs = esp_timer_get_time();
 #if SHIM_BLE_MODULE
             if (xIpcManagerCreate(pxIpcpFactoriesList, pxInstancesMap, eShimBLE))
             {
@@ -298,24 +424,37 @@ static void prvIPCPTask(void *pvParameters)
             ESP_LOGE(TAG_IPCPMANAGER, "Flow Allocate Received");
 
             xFlowAllocateRequest = (flowAllocateHandle_t *)(xReceivedEvent.pvData);
-            xFlowAllocateRequest->xEventBits |= (EventBits_t)eFLOW_BOUND;
-            //pxIpcManager->pxIpcpIdm;
 
-            xIpcpManagerAppFlowAllocateRequestHandle(pxIpcManager->pxPidm, xFlowAllocateRequest);
-            
-            ///xRINA_WeakUpUser(xFlowAllocateRequest);
+            /* On success the flow allocator wakes the user up when the
+             * remote end answers. */
+            if (xIpcpManagerAppFlowAllocateRequestHandle(pxIpcManager->pxPidm, xFlowAllocateRequest) == -1)
+            {
+                xFlowAllocateRequest->xPortId = -1;
+                xFlowAllocateRequest->xEventBits |= (EventBits_t)eFLOW_BOUND;
+                xRINA_WeakUpUser(xFlowAllocateRequest);
+            }
 
             break;
 
         case eSendMgmtEvent:
 
             /*Call to IpcManger mgmt handle */
+            vIpcpDataPlaneLock();
             xIpcManagerWriteMgmtHandler(eShimWiFi, xReceivedEvent.pvData);
+            vIpcpDataPlaneUnlock();
+
+            break;
+
+        case eRmtEgressEvent:
+
+            vIpcpDataPlaneLock();
+            vRmtEgress((rmt_t *)xReceivedEvent.pvData);
+            vIpcpDataPlaneUnlock();
 
             break;
 
         case eNoEvent:
-            /* xQueueReceive() returned because of a normal time-out. */
+            /* ulTaskNotifyTake() returned because of a normal time-out. */
             break;
 
         default:
@@ -323,6 +462,17 @@ static void prvIPCPTask(void *pvParameters)
             break;
         }
 
+#if (IPCP_USE_PIPELINE == 0)
+        /* Send the frames queued while handling the event. */
+        vNetworkInterfaceTxFlush();
+#else
+        /* Frames whose eNetworkRxEvent did not fit in the queue. */
+        if (uxSpscRingCount(&xControlRing) > 0)
+        {
+            prvProcessControlRing();
+        }
+#endif
+
         if (xNetworkDownEventPending != pdFALSE)
         {
             /* A network down event could not be posted to the network event
@@ -350,72 +500,53 @@ BaseType_t RINA_IPCPInit()
 
     /* This function should only be called once. */
     configASSERT(xIPCPIsNetworkTaskReady() == pdFALSE);
-    configASSERT(xNetworkEventQueue == NULL);
+    configASSERT(xEventLanes[eIpcpLaneControl] == NULL);
     configASSERT(xIPCPTaskHandle == NULL);
 
-    /* ESP32 is 32-bits platform, so this is not executed*/
-    if (sizeof(uintptr_t) == 8)
-    {
-        /* This is a 64-bit platform, make sure there is enough space in
-         * pucEthernetBuffer to store a pointer. */
-
-        configASSERT(BUFFER_PADDING >= 14);
-
-        /* But it must have this strange alignment: */
-        configASSERT((((BUFFER_PADDING) + 2) % 4) == 0);
-    }
+    /* The buffers never keep a back pointer to their descriptor in the
+     * padding, so 64-bit hosts need no extra BUFFER_PADDING. */
 
 /* Check if MTU is big enough. */
 
 /* Check structure packing is correct. */
 
-/* Attempt to create the queue used to communicate with the IPCP task. */
-#if (configSUPPORT_STATIC_ALLOCATION == 1)
-    {
-
-        static StaticQueue_t xNetworkEventStaticQueue;
-        static uint8_t ucNetworkEventQueueStorageArea[EVENT_QUEUE_LENGTH * sizeof(RINAStackEvent_t)];
-        xNetworkEventQueue = xQueueCreateStatic(EVENT_QUEUE_LENGTH, sizeof(RINAStackEvent_t), ucNetworkEventQueueStorageArea, &xNetworkEventStaticQueue);
-    }
-#else
-    {
-
-        xNetworkEventQueue = xQueueCreate(EVENT_QUEUE_LENGTH, sizeof(RINAStackEvent_t));
-        configASSERT(xNetworkEventQueue != NULL);
-    }
-#endif /* SUPPORT_STATIC_ALLOCATION */
+    vTimerWheelInit(&xIpcpTimerWheel, xTaskGetTickCount());
+    vTimerWheelTimerInit(&xARPTimer, prvARPTimerExpired, NULL);
 
-    if (xNetworkEventQueue != NULL)
+/* Attempt to create the queues used to communicate with the IPCP task. */
+    if (prvCreateEventLanes() == pdPASS)
     {
 
-#if (configQUEUE_REGISTRY_SIZE > 0)
-        {
-            /* A queue registry is normally used to assist a kernel aware
-             * debugger.  If one is in use then it will be helpful for the debugger
-             * to show information about the network event queue. */
-            vQueueAddToRegistry(xNetworkEventQueue, "NetEvnt");
-            ESP_LOGI(TAG_IPCPMANAGER, "Queue added to Registry: %d", configQUEUE_REGISTRY_SIZE);
-        }
-#endif /* QUEUE_REGISTRY_SIZE */
-
         if (xNetworkBuffersInitialise() == pdPASS)
         {
+            vRINA_FlowsInit();
 
 /*Init the IPCP Factories*/
 
+#if (IPCP_USE_PIPELINE != 0)
+            /* The RX and TX tasks wait for work until the IPCP task is
+             * ready, nothing is posted to them before. */
+            if (prvCreatePipeline() != pdPASS)
+            {
+                ESP_LOGE(TAG_IPCPMANAGER, "RINAInit: pipeline tasks could not be created\n");
+                return pdFALSE;
+            }
+#endif
+
 /* Create the task that processes Ethernet and stack events. */
 #if (configSUPPORT_STATIC_ALLOCATION == 1)
             {
 
                 static StaticTask_t xIPCPTaskBuffer;
                 static StackType_t xIPCPTaskStack[IPCP_TASK_STACK_SIZE_WORDS];
-                xIPCPTaskHandle = xTaskCreateStatic(prvIPCPTask,
-                                                    "IPCP-Task",
-                                                    IPCP_TASK_STACK_SIZE_WORDS,
-                                                    NULL,
-                                                    IPCP_TASK_PRIORITY,
-                                                    xIPCPTaskStack,
-                                                    &xIPCPTaskBuffer);
+                xIPCPTaskHandle = xTaskCreateStaticPinnedToCore(prvIPCPTask,
+                                                                "IPCP-Task",
+                                                                IPCP_TASK_STACK_SIZE_WORDS,
+                                                                NULL,
+                                                                IPCP_TASK_PRIORITY,
+                                                                xIPCPTaskStack,
+                                                                &xIPCPTaskBuffer,
+                                                                IPCP_TASK_CORE);
 
                 if (xIPCPTaskHandle != NULL)
                 {
@@ -426,12 +557,13 @@ BaseType_t RINA_IPCPInit()
 #else  /* if ( SUPPORT_STATIC_ALLOCATION == 1 ) */
             {
 
-                xReturn = xTaskCreate(prvIPCPTask,
-                                      "IPCP-task",
-                                      IPCP_TASK_STACK_SIZE_WORDS,
-                                      NULL,
-                                      IPCP_TASK_PRIORITY,
-                                      &(xIPCPTaskHandle));
+                xReturn = xTaskCreatePinnedToCore(prvIPCPTask,
+                                                  "IPCP-task",
+                                                  IPCP_TASK_STACK_SIZE_WORDS,
+                                                  NULL,
+                                                  IPCP_TASK_PRIORITY,
+                                                  &(xIPCPTaskHandle),
+                                                  IPCP_TASK_CORE);
             }
 #endif /* SUPPORT_STATIC_ALLOCATION */
         }
@@ -440,8 +572,11 @@ BaseType_t RINA_IPCPInit()
             ESP_LOGE(TAG_IPCPMANAGER, "RINAInit: xNetworkBuffersInitialise() failed\n");
 
             /* Clean up. */
-            vQueueDelete(xNetworkEventQueue);
-            xNetworkEventQueue = NULL;
+            for (UBaseType_t uxLane = 0; uxLane < eIpcpLaneCount; uxLane++)
+            {
+                vQueueDelete(xEventLanes[uxLane]);
+                xEventLanes[uxLane] = NULL;
+            }
         }
     }
     else
@@ -478,6 +613,72 @@ BaseType_t xIsCallingFromIPCPTask(void)
     return xReturn;
 }
 
+/**
+ * @brief Function to check whether the current context is the one that
+ *        hands frames to the driver, see vNetworkInterfaceTxDrain().
+ *
+ * @return pdTRUE for the TX task, or the IPCP-task when the stack is not
+ *         pipelined. Else pdFALSE.
+ */
+BaseType_t xIsCallingFromIPCPTxTask(void)
+{
+#if (IPCP_USE_PIPELINE != 0)
+    return (xTaskGetCurrentTaskHandle() == xIPCPTxTaskHandle) ? pdTRUE : pdFALSE;
+#else
+    return xIsCallingFromIPCPTask();
+#endif
+}
+
+/**
+ * @brief Take the data-plane lock. The RX and TX tasks hold it while a PDU
+ *        goes through the RMT and EFCP, and the IPCP-task while it changes
+ *        the flows, the connections or the N-1 ports they use. A received
+ *        and a sent PDU are never processed at the same time: the pipeline
+ *        keeps the IPCP task and the driver from waiting on the data path,
+ *        it does not run the two directions in parallel.
+ */
+void vIpcpDataPlaneLock(void)
+{
+#if (IPCP_USE_PIPELINE != 0)
+    int64_t llStartUs;
+    uint32_t ulWaitUs;
+
+    if (xDataPlaneMutex != NULL)
+    {
+        if (xSemaphoreTakeRecursive(xDataPlaneMutex, 0) == pdPASS)
+        {
+            xDataPlaneLockStats.ulTaken++;
+            return;
+        }
+
+        llStartUs = esp_timer_get_time();
+        (void)xSemaphoreTakeRecursive(xDataPlaneMutex, portMAX_DELAY);
+        ulWaitUs = (uint32_t)(esp_timer_get_time() - llStartUs);
+
+        xDataPlaneLockStats.ulTaken++;
+        xDataPlaneLockStats.ulWaited++;
+        xDataPlaneLockStats.ullWaitUs += ulWaitUs;
+        if (ulWaitUs > xDataPlaneLockStats.ulMaxWaitUs)
+        {
+            xDataPlaneLockStats.ulMaxWaitUs = ulWaitUs;
+        }
+    }
+#endif
+}
+
+void vIpcpDataPlaneUnlock(void)
+{
+#if (IPCP_USE_PIPELINE != 0)
+    if (xDataPlaneMutex != NULL)
+    {
+        BaseType_t xGiven = xSemaphoreGiveRecursive(xDataPlaneMutex);
+
+        configASSERT(xGiven == pdPASS);
+        (void)xGiven;
+    }
+#endif
+}
+
 /**
  * @brief Send an event to the IPCP task. It calls 'xSendEventStructToIPCPTask' internally.
  *
@@ -529,7 +730,35 @@ BaseType_t xSendEventStructToIPCPTask(const RINAStackEvent_t *pxEvent,
                 uxUseTimeout = (TickType_t)0;
             }
 
-            xReturn = xQueueSendToBack(xNetworkEventQueue, pxEvent, uxUseTimeout);
+#if (IPCP_USE_PIPELINE != 0)
+            /* Nor can the RX and TX tasks, they may hold the data-plane lock
+             * the other tasks wait for. */
+            if ((xTaskGetCurrentTaskHandle() == xIPCPRxTaskHandle) || (xIsCallingFromIPCPTxTask() == pdTRUE))
+            {
+                uxUseTimeout = (TickType_t)0;
+            }
+
+            if ((pxEvent->eEventType == eNetworkRxEvent) && (pxEvent->pvData != NULL))
+            {
+                /* Received frames go to the RX task. The driver posts from
+                 * one context at a time, so the ring has a single producer. */
+                xReturn = xSpscRingPush(&xRxRing, pxEvent->pvData) ? pdPASS : pdFAIL;
+
+                if (xReturn == pdPASS)
+                {
+                    (void)xTaskNotifyGive(xIPCPRxTaskHandle);
+                }
+            }
+            else if ((pxEvent->eEventType == eNetworkTxEvent) || (pxEvent->eEventType == eStackTxEvent) ||
+                     (pxEvent->eEventType == eRmtEgressEvent))
+            {
+                xReturn = xQueueSendToBack(xTxEventQueue, pxEvent, uxUseTimeout);
+            }
+            else
+#endif
+            {
+                xReturn = prvSendEventToLane(pxEvent, uxUseTimeout);
+            }
 
             if (xReturn == pdFAIL)
             {
@@ -548,7 +777,229 @@ BaseType_t xSendEventStructToIPCPTask(const RINAStackEvent_t *pxEvent,
     return xReturn;
 }
 
-void prvHandleEthernetPacket(NetworkBufferDescriptor_t *pxBuffer)
+/**
+ * @brief The lane an event is queued in. Without IPCP_USE_PIPELINE received
+ *        bursts mix data and management frames and go in the data lane.
+ */
+static eIpcpEventLane_t prvEventLane(eRINAEvent_t eEvent)
+{
+    switch (eEvent)
+    {
+    case eNetworkDownEvent:
+    case eShimEnrollEvent:
+    case eARPTimerEvent:
+    case eShimFlowAllocatedEvent:
+    case eStackFlowAllocateEvent:
+    case eStackAppRegistrationEvent:
+    case eFactoryInitEvent:
+    case eShimAppRegisteredEvent:
+        return eIpcpLaneControl;
+
+    case eSendMgmtEvent:
+        return eIpcpLaneManagement;
+
+    case eNetworkRxEvent:
+#if (IPCP_USE_PIPELINE != 0)
+        return eIpcpLaneManagement;
+#else
+        return eIpcpLaneData;
+#endif
+
+    default:
+        return eIpcpLaneData;
+    }
+}
+
+static BaseType_t prvCreateEventLanes(void)
+{
+    static const UBaseType_t uxLaneLength[eIpcpLaneCount] =
+        {IPCP_EVENT_LANE_CONTROL_LENGTH, IPCP_EVENT_LANE_MANAGEMENT_LENGTH, EVENT_QUEUE_LENGTH};
+    UBaseType_t uxLane;
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    static StaticQueue_t xLaneStaticQueue[eIpcpLaneCount];
+    static uint8_t ucControlStorageArea[IPCP_EVENT_LANE_CONTROL_LENGTH * sizeof(IpcpLaneEvent_t)];
+    static uint8_t ucManagementStorageArea[IPCP_EVENT_LANE_MANAGEMENT_LENGTH * sizeof(IpcpLaneEvent_t)];
+    static uint8_t ucDataStorageArea[EVENT_QUEUE_LENGTH * sizeof(IpcpLaneEvent_t)];
+    uint8_t *const pucStorageArea[eIpcpLaneCount] = {ucControlStorageArea, ucManagementStorageArea, ucDataStorageArea};
+
+    for (uxLane = 0; uxLane < eIpcpLaneCount; uxLane++)
+    {
+        xEventLanes[uxLane] = xQueueCreateStatic(uxLaneLength[uxLane], sizeof(IpcpLaneEvent_t),
+                                                 pucStorageArea[uxLane], &xLaneStaticQueue[uxLane]);
+    }
+#else
+    for (uxLane = 0; uxLane < eIpcpLaneCount; uxLane++)
+    {
+        xEventLanes[uxLane] = xQueueCreate(uxLaneLength[uxLane], sizeof(IpcpLaneEvent_t));
+    }
+#endif /* SUPPORT_STATIC_ALLOCATION */
+
+    for (uxLane = 0; uxLane < eIpcpLaneCount; uxLane++)
+    {
+        if (xEventLanes[uxLane] == NULL)
+        {
+            return pdFAIL;
+        }
+    }
+
+#if (configQUEUE_REGISTRY_SIZE > 0)
+    {
+        /* A queue registry is normally used to assist a kernel aware
+         * debugger.  If one is in use then it will be helpful for the debugger
+         * to show information about the network event queues. */
+        vQueueAddToRegistry(xEventLanes[eIpcpLaneControl], "NetEvntCtl");
+        vQueueAddToRegistry(xEventLanes[eIpcpLaneManagement], "NetEvntMgmt");
+        vQueueAddToRegistry(xEventLanes[eIpcpLaneData], "NetEvnt");
+        ESP_LOGI(TAG_IPCPMANAGER, "Queue added to Registry: %d", configQUEUE_REGISTRY_SIZE);
+    }
+#endif /* QUEUE_REGISTRY_SIZE */
+
+    return pdPASS;
+}
+
+static BaseType_t prvSendEventToLane(const RINAStackEvent_t *pxEvent, TickType_t uxTimeout)
+{
+    eIpcpEventLane_t eLane = prvEventLane(pxEvent->eEventType);
+    IpcpLaneEvent_t xItem;
+    UBaseType_t uxDepth;
+    BaseType_t xReturn;
+
+    xItem.xEvent = *pxEvent;
+    xItem.llQueuedUs = esp_timer_get_time();
+
+    xReturn = xQueueSendToBack(xEventLanes[eLane], &xItem, uxTimeout);
+
+    if (xReturn == pdPASS)
+    {
+        uxDepth = uxQueueMessagesWaiting(xEventLanes[eLane]);
+        (void)xTaskNotifyGive(xIPCPTaskHandle);
+    }
+
+    taskENTER_CRITICAL(&xLaneStatsLock);
+    if (xReturn == pdPASS)
+    {
+        if (uxDepth > xLaneStats[eLane].uxHighWater)
+        {
+            xLaneStats[eLane].uxHighWater = uxDepth;
+        }
+    }
+    else
+    {
+        xLaneStats[eLane].ulFull++;
+    }
+    taskEXIT_CRITICAL(&xLaneStatsLock);
+
+    return xReturn;
+}
+
+/**
+ * @brief Take the next event without blocking: from the highest lane that
+ *        has one, unless a lower lane has been passed over
+ *        IPCP_EVENT_LANE_GUARD times in a row.
+ *
+ * @return pdTRUE if an event was taken.
+ */
+static BaseType_t prvReceiveEvent(RINAStackEvent_t *pxEvent)
+{
+    IpcpLaneEvent_t xItem;
+    UBaseType_t uxLane;
+    UBaseType_t uxServed = eIpcpLaneCount;
+    BaseType_t xGuard = pdFALSE;
+    uint32_t ulDelayUs;
+
+    for (uxLane = eIpcpLaneCount - 1; uxLane > 0; uxLane--)
+    {
+        if ((uxLaneSkipped[uxLane] >= IPCP_EVENT_LANE_GUARD) &&
+            (xQueueReceive(xEventLanes[uxLane], &xItem, 0) == pdPASS))
+        {
+            uxServed = uxLane;
+            xGuard = pdTRUE;
+            break;
+        }
+    }
+
+    for (uxLane = 0; (uxServed == eIpcpLaneCount) && (uxLane < eIpcpLaneCount); uxLane++)
+    {
+        if (xQueueReceive(xEventLanes[uxLane], &xItem, 0) == pdPASS)
+        {
+            uxServed = uxLane;
+        }
+    }
+
+    if (uxServed == eIpcpLaneCount)
+    {
+        return pdFALSE;
+    }
+
+    /* Lanes below the one served that still have events were passed over. */
+    for (uxLane = 0; uxLane < eIpcpLaneCount; uxLane++)
+    {
+        if (uxLane == uxServed)
+        {
+            uxLaneSkipped[uxLane] = 0;
+        }
+        else if ((uxLane > uxServed) && (uxQueueMessagesWaiting(xEventLanes[uxLane]) > 0))
+        {
+            uxLaneSkipped[uxLane]++;
+        }
+    }
+
+    if (xItem.llQueuedUs < llLanesServedFromUs)
+    {
+        xItem.llQueuedUs = llLanesServedFromUs;
+    }
+
+    ulDelayUs = (uint32_t)(esp_timer_get_time() - xItem.llQueuedUs);
+
+    taskENTER_CRITICAL(&xLaneStatsLock);
+    {
+        IpcpEventLaneStats_t *pxStats = &xLaneStats[uxServed];
+
+        pxStats->ulEvents++;
+        pxStats->ullDelayUs += ulDelayUs;
+
+        if (ulDelayUs > pxStats->ulMaxDelayUs)
+        {
+            pxStats->ulMaxDelayUs = ulDelayUs;
+        }
+
+        if (xGuard != pdFALSE)
+        {
+            pxStats->ulGuardServed++;
+        }
+    }
+    taskEXIT_CRITICAL(&xLaneStatsLock);
+
+    *pxEvent = xItem.xEvent;
+
+    return pdTRUE;
+}
+
+void vIpcpGetDataPlaneLockStats(IpcpDataPlaneLockStats_t *pxStats)
+{
+#if (IPCP_USE_PIPELINE != 0)
+    if (xDataPlaneMutex != NULL)
+    {
+        /* Taken without vIpcpDataPlaneLock(), not to count this one. */
+        (void)xSemaphoreTakeRecursive(xDataPlaneMutex, portMAX_DELAY);
+        *pxStats = xDataPlaneLockStats;
+        (void)xSemaphoreGiveRecursive(xDataPlaneMutex);
+        return;
+    }
+#endif
+    memset(pxStats, 0, sizeof(*pxStats));
+}
+
+void vIpcpGetEventLaneStats(IpcpEventLaneStats_t pxStats[eIpcpLaneCount])
+{
+    taskENTER_CRITICAL(&xLaneStatsLock);
+    memcpy(pxStats, xLaneStats, sizeof(xLaneStats));
+    taskEXIT_CRITICAL(&xLaneStatsLock);
+}
+
+#if (IPCP_USE_PIPELINE == 0)
+static void prvHandleEthernetPacket(NetworkBufferDescriptor_t *pxBuffer)
 {
 
 #if (USE_LINKED_RX_MESSAGES == 0)
@@ -586,6 +1037,7 @@ void prvHandleEthernetPacket(NetworkBufferDescriptor_t *pxBuffer)
     }
 #endif /* USE_LINKED_RX_MESSAGES */
 }
+#endif /* IPCP_USE_PIPELINE == 0 */
 
 /*-----------------------------------------------------------*/
 
@@ -619,6 +1071,14 @@ void prvProcessEthernetPacket(NetworkBufferDescriptor_t *const pxNetworkBuffer)
                 /*Process the Packet ARP in case of REPLY -> eProcessBuffer, REQUEST -> eReturnEthernet to
                  * send to the destination a REPLY (It requires more processing tasks) */
                 eReturned = eARPProcessPacket(CAST_PTR_TO_TYPE_PTR(ARPPacket_t, pxNetworkBuffer->pucEthernetBuffer));
+
+                /* A request answered: the enrollment flow waiting for the
+                 * requester need not wait for a reply to its own request. */
+                if ((eReturned == eReturnEthernetFrame) &&
+                    !xIpcpManagerShimArpRequestHandle(pxIpcManager->pxFactories, eShimWiFi))
+                {
+                    ESP_LOGE(TAG_IPCPMANAGER, "Error during the Allocation Request at Shim");
+                }
             }
             else
             {
@@ -632,41 +1092,7 @@ void prvProcessEthernetPacket(NetworkBufferDescriptor_t *const pxNetworkBuffer)
 
             ESP_LOGI(TAG_IPCPMANAGER, "RINA Packet Received");
 
-            uint8_t *ptr;
-            size_t xlength;
-            NetworkBufferDescriptor_t *pxBuffer;
-
-            //removing Ethernet Header
-            xlength = pxNetworkBuffer->xDataLength - (size_t)14;
-
-
-            //ESP_LOGE(TAG_ARP, "Taking Buffer to copy the RINA PDU: ETH_P_RINA");
-            pxBuffer = pxGetNetworkBufferWithDescriptor(xlength, (TickType_t)0U);
-
-            if (pxBuffer != NULL)
-            {
-                //Copy into the newBuffer but just the RINA PDU, and not the Ethernet Header
-                ptr = (uint8_t *)pxNetworkBuffer->pucEthernetBuffer + 14;
-
-                (void)memcpy(pxBuffer->pucEthernetBuffer, ptr, xlength);
-
-                pxBuffer->xDataLength = xlength;
-
-                
-                //Release the buffer with the Ethernet header, it is not needed any more
-                //ESP_LOGE(TAG_ARP, "Releasing Buffer to copy the RINA PDU: ETH_P_RINA");
-                vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
-                
-                //must be void function
-                vIpcManagerRINAPackettHandler(pxBuffer);
- 
-            }
-            else{
-                ESP_LOGE(TAG_WIFI, "Failed to get buffer descriptor");
-	            eReturned = eReleaseBuffer;
-            }
-
-
+            prvProcessRINAPacket(pxNetworkBuffer);
 
             break;
 
@@ -687,10 +1113,10 @@ void prvProcessEthernetPacket(NetworkBufferDescriptor_t *const pxNetworkBuffer)
         /* The Ethernet frame will have been updated (maybe it was
          * an ARP request) and should be sent back to
          * its source. */
-        // vReturnEthernetFrame( pxNetworkBuffer, pdTRUE );
 
-        /* parameter pdTRUE: the buffer must be released once
-         * the frame has been transmitted */
+        /* Only the task draining the TX ring talks to the driver. The
+         * buffer is released once the frame has been transmitted. */
+        (void)xNetworkInterfaceEnqueue(pxNetworkBuffer);
         break;
 
     case eFrameConsumed:
@@ -738,6 +1164,244 @@ void prvProcessEthernetPacket(NetworkBufferDescriptor_t *const pxNetworkBuffer)
     
 }
 
+static void prvProcessRINAPacket(NetworkBufferDescriptor_t *const pxNetworkBuffer)
+{
+    //removing Ethernet Header in place, the same descriptor goes up
+    //to the RMT and the PDU bytes are never copied
+    (void)pucNetworkBufferPull(pxNetworkBuffer, sizeof(EthernetHeader_t));
+
+    //must be void function
+    vIpcpDataPlaneLock();
+    vIpcManagerRINAPackettHandler(pxNetworkBuffer);
+    vIpcpDataPlaneUnlock();
+}
+
+static void prvProcessStackTxEvent(NetworkBufferDescriptor_t *pxNetworkBuffer)
+{
+    struct du_t *pxDu;
+    portId_t xPortId;
+
+    if (pxNetworkBuffer == NULL)
+    {
+        return;
+    }
+
+    pxDu = pvPortMalloc(sizeof(*pxDu));
+
+    if (pxDu == NULL)
+    {
+        ESP_LOGE(TAG_IPCPMANAGER, "No memory for the SDU, dropped");
+        vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+        return;
+    }
+
+    pxDu->pxCfg = NULL;
+    pxDu->pxPci = NULL;
+    pxDu->pxNetworkBuffer = pxNetworkBuffer;
+
+    /* RINA_flow_write() stored the port in ulBoundPort. */
+    xPortId = (portId_t)pxNetworkBuffer->ulBoundPort;
+
+    /* The component that drops the SDU logs why */
+    vIpcpDataPlaneLock();
+    (void)xIpcManagerWriteDataHandler(xPortId, pxDu);
+    vIpcpDataPlaneUnlock();
+}
+
+/*-----------------------------------------------------------*/
+
+#if (IPCP_USE_PIPELINE != 0)
+
+static BaseType_t prvCreatePipeline(void)
+{
+    static StaticQueue_t xTxEventStaticQueue;
+    static uint8_t ucTxEventQueueStorageArea[EVENT_QUEUE_LENGTH * sizeof(RINAStackEvent_t)];
+
+    (void)xSpscRingInit(&xRxRing, pvRxRingSlots, IPCP_PIPELINE_RING_SIZE);
+    (void)xSpscRingInit(&xControlRing, pvControlRingSlots, IPCP_PIPELINE_RING_SIZE);
+
+    xTxEventQueue = xQueueCreateStatic(EVENT_QUEUE_LENGTH, sizeof(RINAStackEvent_t), ucTxEventQueueStorageArea, &xTxEventStaticQueue);
+    xDataPlaneMutex = xSemaphoreCreateRecursiveMutex();
+
+    if ((xTxEventQueue == NULL) || (xDataPlaneMutex == NULL))
+    {
+        return pdFAIL;
+    }
+
+    if (xTaskCreatePinnedToCore(prvIPCPRxTask, "IPCP-RX", IPCP_RX_TASK_STACK_SIZE_WORDS, NULL,
+                                IPCP_RX_TASK_PRIORITY, &xIPCPRxTaskHandle, IPCP_RX_TASK_CORE) != pdPASS)
+    {
+        return pdFAIL;
+    }
+
+    if (xTaskCreatePinnedToCore(prvIPCPTxTask, "IPCP-TX", IPCP_TX_TASK_STACK_SIZE_WORDS, NULL,
+                                IPCP_TX_TASK_PRIORITY, &xIPCPTxTaskHandle, IPCP_TX_TASK_CORE) != pdPASS)
+    {
+        return pdFAIL;
+    }
+
+    return pdPASS;
+}
+
+static BaseType_t prvIsDataPdu(const NetworkBufferDescriptor_t *pxNetworkBuffer)
+{
+    const EthernetHeader_t *pxEthernetHeader;
+    const pci_t *pxPci;
+
+    if (pxNetworkBuffer->xDataLength < (sizeof(EthernetHeader_t) + sizeof(pci_t)))
+    {
+        return pdFALSE;
+    }
+
+    pxEthernetHeader = vCastPointerTo_EthernetPacket_t(pxNetworkBuffer->pucEthernetBuffer);
+
+    if (FreeRTOS_ntohs(pxEthernetHeader->usFrameType) != ETH_P_RINA)
+    {
+        return pdFALSE;
+    }
+
+    pxPci = (const pci_t *)(pxNetworkBuffer->pucEthernetBuffer + sizeof(EthernetHeader_t));
+
+    return (pxPci->xType != PDU_TYPE_MGMT) ? pdTRUE : pdFALSE;
+}
+
+static void prvPassToControl(NetworkBufferDescriptor_t *pxNetworkBuffer)
+{
+    RINAStackEvent_t xRxEvent = {eNetworkRxEvent, NULL};
+
+    if (xSpscRingPush(&xControlRing, pxNetworkBuffer) == pdFALSE)
+    {
+        ESP_LOGE(TAG_IPCPMANAGER, "Control ring full, frame dropped");
+        vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+        return;
+    }
+
+    /* Straight to the IPCP task, the event router would send it back here.
+     * If the lane is full the frames wait for the next event. */
+    if (__atomic_exchange_n(&ulControlRxPending, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        if (prvSendEventToLane(&xRxEvent, 0) == pdFAIL)
+        {
+            __atomic_store_n(&ulControlRxPending, 0, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+static void prvProcessControlRing(void)
+{
+    NetworkBufferDescriptor_t *pxNetworkBuffer;
+
+    /* Cleared first: a frame pushed from now on posts a new event. */
+    __atomic_store_n(&ulControlRxPending, 0, __ATOMIC_RELEASE);
+
+    while ((pxNetworkBuffer = pvSpscRingPop(&xControlRing)) != NULL)
+    {
+        prvProcessEthernetPacket(pxNetworkBuffer);
+    }
+}
+
+static void prvIPCPRxTask(void *pvParameters)
+{
+    NetworkBufferDescriptor_t *pxBuffer;
+    NetworkBufferDescriptor_t *pxNextBuffer;
+
+    (void)pvParameters;
+
+    for (;;)
+    {
+        if (ulTaskNotifyTake(pdTRUE, 0) == 0)
+        {
+            /* Nothing pending, the buffers cached by this task are given
+             * back before it sleeps. */
+            vNetworkBufferMagazineIdle();
+            (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        while ((pxBuffer = pvSpscRingPop(&xRxRing)) != NULL)
+        {
+            do
+            {
+#if (USE_LINKED_RX_MESSAGES != 0)
+                pxNextBuffer = pxBuffer->pxNextBuffer;
+                pxBuffer->pxNextBuffer = NULL;
+#else
+                pxNextBuffer = NULL;
+#endif
+
+                if (prvIsDataPdu(pxBuffer) != pdFALSE)
+                {
+                    prvProcessRINAPacket(pxBuffer);
+                }
+                else
+                {
+                    prvPassToControl(pxBuffer);
+                }
+
+                pxBuffer = pxNextBuffer;
+            } while (pxBuffer != NULL);
+
+#if (USE_LINKED_RX_MESSAGES != 0)
+            /* Frames held back while the burst was processed are posted now. */
+            vNetworkInterfaceRxBurstDone();
+#endif
+        }
+    }
+}
+
+static void prvIPCPTxTask(void *pvParameters)
+{
+    RINAStackEvent_t xReceivedEvent;
+
+    (void)pvParameters;
+
+    for (;;)
+    {
+        if (xQueueReceive(xTxEventQueue, (void *)&xReceivedEvent, 0) == pdFALSE)
+        {
+            vNetworkBufferMagazineIdle();
+
+            if (xQueueReceive(xTxEventQueue, (void *)&xReceivedEvent, portMAX_DELAY) == pdFALSE)
+            {
+                continue;
+            }
+        }
+
+        switch (xReceivedEvent.eEventType)
+        {
+        case eStackTxEvent:
+            prvProcessStackTxEvent(CAST_PTR_TO_TYPE_PTR(NetworkBufferDescriptor_t, xReceivedEvent.pvData));
+            break;
+
+        case eNetworkTxEvent:
+            if (xReceivedEvent.pvData == NULL)
+            {
+                vNetworkInterfaceTxDrain();
+            }
+            else
+            {
+                (void)xNetworkInterfaceOutput(CAST_PTR_TO_TYPE_PTR(NetworkBufferDescriptor_t, xReceivedEvent.pvData), pdTRUE);
+            }
+            break;
+
+        case eRmtEgressEvent:
+            vIpcpDataPlaneLock();
+            vRmtEgress((rmt_t *)xReceivedEvent.pvData);
+            vIpcpDataPlaneUnlock();
+            break;
+
+        default:
+            break;
+        }
+
+        /* Send the frames queued while handling the event. */
+        vNetworkInterfaceTxFlush();
+    }
+}
+
+#endif /* IPCP_USE_PIPELINE */
+
+/*-----------------------------------------------------------*/
+
 eFrameProcessingResult_t eConsiderFrameForProcessing(const uint8_t *const pucEthernetBuffer)
 {
     eFrameProcessingResult_t eReturn = eReleaseBuffer;
@@ -763,46 +1427,80 @@ eFrameProcessingResult_t eConsiderFrameForProcessing(const uint8_t *const pucEth
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Calculate the maximum sleep time remaining. It will go through all
- *        timers to see which timer will expire first. That will be the amount
- *        of time to block in the next call to xQueueReceive().
+ * @brief Calculate the maximum sleep time remaining: the time until the
+ *        timer wheel must be advanced. That will be the amount of time to
+ *        block waiting for an event.
  *
- * @return The maximum sleep time or ipconfigMAX_IP_TASK_SLEEP_TIME,
+ * @return The maximum sleep time or MAX_IPCP_TASK_SLEEP_TIME,
  *         whichever is smaller.
  */
 static TickType_t prvCalculateSleepTime(void)
 {
+    TickType_t xNow = xTaskGetTickCount();
     TickType_t xMaximumSleepTime;
+    TickType_t xTimerSleepTime;
 
-    /* Start with the maximum sleep time, then check this against the remaining
-     * time in any other timers that are active. */
+    /* Start with the maximum sleep time, then check this against the time
+     * until the next timer. */
     xMaximumSleepTime = MAX_IPCP_TASK_SLEEP_TIME;
 
-    if (xARPTimer.bActive != pdFALSE_UNSIGNED)
+    xTimerSleepTime = xTimerWheelTicksToNext(&xIpcpTimerWheel, xNow);
+    if (xTimerSleepTime < xMaximumSleepTime)
     {
-        if (xARPTimer.ulRemainingTime < xMaximumSleepTime)
-        {
-            xMaximumSleepTime = xARPTimer.ulRemainingTime;
-        }
+        xMaximumSleepTime = xTimerSleepTime;
+    }
+
+    /* Publish the wake-up tick before looking at the wheel again: a timer
+     * started by another task before this store is seen here, one started
+     * after it sees the new tick and wakes the task if needed. */
+    __atomic_store_n(&xIpcpWakeTick, xNow + xMaximumSleepTime, __ATOMIC_SEQ_CST);
+
+    xTimerSleepTime = xTimerWheelTicksToNext(&xIpcpTimerWheel, xNow);
+    if (xTimerSleepTime < xMaximumSleepTime)
+    {
+        xMaximumSleepTime = xTimerSleepTime;
     }
 
     return xMaximumSleepTime;
 }
 
 /**
- * @brief Check the network timers (ARP/DTP) and if they are
- *        expired, send an event to the IPCP-Task.
+ * @brief Advance the timer wheel, which calls the callbacks of the timers
+ *        (ARP/DTP) that expired.
  */
 static void prvCheckNetworkTimers(void)
 {
-    /* Is it time for ARP processing? */
-    if (prvIPCPTimerCheck(&xARPTimer) != pdFALSE)
+    (void)uxTimerWheelAdvance(&xIpcpTimerWheel, xTaskGetTickCount());
+}
+
+static void prvARPTimerExpired(void *pvArgument)
+{
+    (void)pvArgument;
+
+    (void)xSendEventToIPCPTask(eARPTimerEvent);
+}
+
+void vIpcpTimerStart(timerWheelTimer_t *pxTimer, TickType_t xTicks)
+{
+    TickType_t xExpiry = xTaskGetTickCount() + xTicks;
+    TickType_t xWakeTick;
+
+    vTimerWheelStart(&xIpcpTimerWheel, pxTimer, xExpiry);
+
+    /* Restarts on every PDU move the timers later and wake nobody. */
+    xWakeTick = __atomic_load_n(&xIpcpWakeTick, __ATOMIC_SEQ_CST);
+    if (((TickType_t)(xExpiry - xWakeTick) > (portMAX_DELAY / 2U)) &&
+        (xIPCPTaskHandle != NULL) && (xIsCallingFromIPCPTask() == pdFALSE))
     {
-        ESP_LOGI(TAG_SHIM, "TEST");
-        (void)xSendEventToIPCPTask(eARPTimerEvent);
+        (void)xTaskNotifyGive(xIPCPTaskHandle);
     }
 }
 
+void vIpcpTimerStop(timerWheelTimer_t *pxTimer)
+{
+    vTimerWheelStop(&xIpcpTimerWheel, pxTimer);
+}
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -811,7 +1509,7 @@ static void prvCheckNetworkTimers(void)
 static void prvProcessNetworkDownEvent(void)
 {
     /* Stop the ARP timer while there is no network. */
-    xARPTimer.bActive = pdFALSE_UNSIGNED;
+    vIpcpTimerStop(&xARPTimer);
 
     /* Per the ARP Cache Validation section of https://tools.ietf.org/html/rfc1122,
      * treat network down as a "delivery problem" and flush the ARP cache for this
@@ -833,88 +1531,6 @@ static void prvProcessNetworkDownEvent(void)
     vTaskDelay(INITIALISATION_RETRY_DELAY);
 }
 /*-----------------------------------------------------------*/
-/**
- * @brief Check the IP timer to see whether an IP event should be processed or not.
- *
- * @param[in] pxTimer: Pointer to the IP timer.
- *
- * @return If the timer is expired then pdTRUE is returned. Else pdFALSE.
- */
-static BaseType_t prvIPCPTimerCheck(IPCPTimer_t *pxTimer)
-{
-    BaseType_t xReturn;
-
-    if (pxTimer->bActive == pdFALSE_UNSIGNED)
-    {
-        /* The timer is not enabled. */
-        xReturn = pdFALSE;
-    }
-    else
-    {
-        /* The timer might have set the bExpired flag already, if not, check the
-         * value of xTimeOut against ulRemainingTime. */
-        if (pxTimer->bExpired == pdFALSE_UNSIGNED)
-        {
-            if (xTaskCheckForTimeOut(&(pxTimer->xTimeOut), &(pxTimer->ulRemainingTime)) != pdFALSE)
-            {
-                pxTimer->bExpired = pdTRUE_UNSIGNED;
-            }
-        }
-
-        if (pxTimer->bExpired != pdFALSE_UNSIGNED)
-        {
-            prvIPCPTimerStart(pxTimer, pxTimer->ulReloadTime);
-            xReturn = pdTRUE;
-        }
-        else
-        {
-            xReturn = pdFALSE;
-        }
-    }
-
-    return xReturn;
-}
-
-/**
- * @brief Start an IP timer. The IP-task has its own implementation of a timer
- *        called 'IPTimer_t', which is based on the FreeRTOS 'TimeOut_t'.
- *
- * @param[in] pxTimer: Pointer to the IP timer. When zero, the timer is marked
- *                     as expired.
- * @param[in] xTime: Time to be loaded into the IP timer.
- */
-static void prvIPCPTimerStart(IPCPTimer_t *pxTimer,
-                              TickType_t xTime)
-{
-    vTaskSetTimeOutState(&pxTimer->xTimeOut);
-    pxTimer->ulRemainingTime = xTime;
-
-    if (xTime == (TickType_t)0)
-    {
-        pxTimer->bExpired = pdTRUE_UNSIGNED;
-    }
-    else
-    {
-        pxTimer->bExpired = pdFALSE_UNSIGNED;
-    }
-
-    pxTimer->bActive = pdTRUE_UNSIGNED;
-}
-/*-----------------------------------------------------------*/
-
-/**
- * @brief Sets the reload time of an IP timer and restarts it.
- *
- * @param[in] pxTimer: Pointer to the IP timer.
- * @param[in] xTime: Time to be reloaded into the IP timer.
- */
-static void prvIPCPTimerReload(IPCPTimer_t *pxTimer,
-                               TickType_t xTime)
-{
-    pxTimer->ulReloadTime = xTime;
-    prvIPCPTimerStart(pxTimer, xTime);
-}
-/*-----------------------------------------------------------*/
 /**
  * @brief Returns whether the IP task is ready.
  *
@@ -13,10 +13,10 @@
 #include <string.h>
 
 /* FreeRTOS includes. */
-#include "Freertos/FreeRTOS.h"
-#include "Freertos/task.h"
-#include "Freertos/queue.h"
-#include "Freertos/semphr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 #include "IPCP.h"
 #include "common.h"
@@ -30,12 +30,17 @@
 #include "Ribd.h"
 #include "du.h"
 #include "FlowAllocator.h"
+#include "ShimIPCP.h"
 
 #include "esp_log.h"
 
 /* Table to store instances created */
 static InstanceTableRow_t xInstanceTable[INSTANCES_IPCP_ENTRIES];
 
+/* Port of the N-1 flow the enrollment was requested on, that the shim
+ * answers for and receives the PDUs on. */
+static portId_t xEnrollmentFlowPortId = 1;
+
 
 /**
  * @brief Initialize a IPC Manager object. Create a Port Id Manager
@@ -138,7 +143,7 @@ ipcpInstance_t *pxIpcManagerFindInstanceById(ipcpInstanceId_t xIpcpId)
  * @return ipcpInstance_t* pointer to the ipcp instance.
  */
 
-static ipcpInstance_t *pxIpcManagerFindInstanceByType(ipcpInstanceType_t xType)
+ipcpInstance_t *pxIpcManagerFindInstanceByType(ipcpInstanceType_t xType)
 {
 
     BaseType_t x = 0;
@@ -238,6 +243,7 @@ BaseType_t xIcpManagerEnrollmentFlowRequest(factories_t *pxFactories, ipcpFactor
     pxInstanceTo = pxIpcManagerFindInstanceByType(xFactoryTypeTo);
 
     xPortID = xPidmAllocate(pxPidm);
+    xEnrollmentFlowPortId = xPortID;
 
     if (xNormalFlowAllocationRequest(pxInstanceFrom, pxInstanceTo, xPortID))
     {
@@ -259,9 +265,8 @@ BaseType_t xIpcpManagerShimAllocateResponseHandle(factories_t *pxFactories, ipcp
     pxNormalInstance = pxIpcManagerFindInstanceByType(eNormal);
 
     /*Searching in table for the flow - portId, which is wating for results*/
-    /*portId Hardcode for a while*/
 
-    if (pxShimInstance->pxOps->flowAllocateResponse(pxShimInstance->pxData, pxNormalInstance, 1))
+    if (pxShimInstance->pxOps->flowAllocateResponse(pxShimInstance->pxData, (struct ipcpInstance_t *)pxNormalInstance, xEnrollmentFlowPortId))
     {
         return pdTRUE;
     }
@@ -269,6 +274,24 @@ BaseType_t xIpcpManagerShimAllocateResponseHandle(factories_t *pxFactories, ipcp
     return pdFALSE;
 }
 
+BaseType_t xIpcpManagerShimArpRequestHandle(factories_t *pxFactories, ipcpFactoryType_t xShimType)
+{
+    ipcpInstance_t *pxShimInstance;
+    ipcpInstance_t *pxNormalInstance;
+
+    pxShimInstance = pxIpcManagerFindInstanceByType(xShimType);
+    pxNormalInstance = pxIpcManagerFindInstanceByType(eNormal);
+
+    if ((pxShimInstance == NULL) || (pxNormalInstance == NULL) ||
+        !xShimFlowIsPending(pxShimInstance->pxData, xEnrollmentFlowPortId))
+    {
+        return pdTRUE;
+    }
+
+    /* The requester is in the ARP cache now, as a reply would have put it */
+    return pxShimInstance->pxOps->flowAllocateResponse(pxShimInstance->pxData, (struct ipcpInstance_t *)pxNormalInstance, xEnrollmentFlowPortId);
+}
+
 /* Handle a Flow allocation request sended by the User throught the RINA API.
 * Return a the Flow xPortID that the RINA API is going to use to send data. */
 portId_t xIpcpManagerAppFlowAllocateRequestHandle(pidm_t *pxPidm, void *data)
@@ -277,23 +300,18 @@ portId_t xIpcpManagerAppFlowAllocateRequestHandle(pidm_t *pxPidm, void *data)
     ipcpInstance_t *pxNormalInstance;
     portId_t xPortId;
 
-    dtpConfig_t *pxDtpCfg;
-    struct dtcpConfig_t *pxDtcpCfg;
-
-    /* This shouldbe read from configRINA.h */
-    address_t xSource = 10;
-    address_t xDest = 3;
-    qosId_t xQosId = 1;
-
-    pxNormalInstance = pvPortMalloc(sizeof(*pxNormalInstance));
-    pxDtcpCfg = pvPortMalloc(sizeof(*pxDtcpCfg));
-    pxDtpCfg = pvPortMalloc(sizeof(*pxDtpCfg));
-
     pxNormalInstance = pxIpcManagerFindInstanceByType(eNormal);
 
-    xPortId = 55;
+    if (pxNormalInstance == NULL)
+    {
+        ESP_LOGE(TAG_IPCPMANAGER, "No normal IPCP to allocate the flow");
+        return -1;
+    }
+
+    xPortId = xPidmAllocate(pxPidm);
 
-    if (pxNormalInstance->pxOps->flowPrebind(pxNormalInstance->pxData, xPortId))
+    /* The SDUs of the port are enqueued to the applications. */
+    if (pxNormalInstance->pxOps->flowPrebind(pxNormalInstance->pxData, pxRINA_UserInstance(), xPortId))
     {
 
         //call to FlowAllocator.
@@ -301,10 +319,12 @@ portId_t xIpcpManagerAppFlowAllocateRequestHandle(pidm_t *pxPidm, void *data)
         {
             return xPortId;
         }
-        
-        
+
+        (void)pxNormalInstance->pxOps->flowUnbindingUserIpcp(pxNormalInstance->pxData, xPortId);
     }
 
+    (void)xPidmRelease(pxPidm, xPortId);
+
     return -1;
 }
 
@@ -315,7 +335,7 @@ BaseType_t xIpcpManagerPreBindFlow(factories_t *pxFactories, ipcpFactoryType_t x
 
     pxNormalInstance = pxIpcManagerFindInstanceByType(xNormalType);
 
-    if (pxNormalInstance->pxOps->flowPrebind(pxNormalInstance->pxData, 1))
+    if (pxNormalInstance->pxOps->flowPrebind(pxNormalInstance->pxData, NULL, 1))
     {
         return pdTRUE;
     }
@@ -346,6 +366,23 @@ BaseType_t xIpcManagerWriteMgmtHandler(ipcpFactoryType_t xType, void *pxData)
     
 }
 
+BaseType_t xIpcManagerWriteDataHandler(portId_t xPortId, struct du_t *pxDu)
+{
+    ipcpInstance_t *pxNormalInstance;
+
+    pxNormalInstance = pxIpcManagerFindInstanceByType(eNormal);
+
+    if (pxNormalInstance == NULL)
+    {
+        ESP_LOGE(TAG_IPCPMANAGER, "No normal IPCP to write the SDU");
+        xDuDestroy(pxDu);
+        return pdFALSE;
+    }
+
+    /* The normal IPCP takes the ownership of the DU. */
+    return pxNormalInstance->pxOps->duWrite(pxNormalInstance->pxData, xPortId, pxDu, pdFALSE);
+}
+
 void vIpcManagerRINAPackettHandler(NetworkBufferDescriptor_t * pxNetworkBuffer);
 void vIpcManagerRINAPackettHandler(NetworkBufferDescriptor_t * pxNetworkBuffer)
 {
@@ -358,21 +395,17 @@ void vIpcManagerRINAPackettHandler(NetworkBufferDescriptor_t * pxNetworkBuffer)
     }
     pxMessagePDU->pxNetworkBuffer = pxNetworkBuffer;
 
-    ipcpInstance_t *pxShimInstance;
     ipcpInstance_t *pxNormalInstance;
 
-    pxShimInstance = pvPortMalloc(sizeof(*pxShimInstance));
-    pxShimInstance = pxIpcManagerFindInstanceByType(eShimWiFi);//COuld come from other kind of Shim
-
-    pxNormalInstance = pvPortMalloc(sizeof(*pxNormalInstance));
     pxNormalInstance = pxIpcManagerFindInstanceByType(eNormal);
 
     ESP_LOGE(TAG_IPCPMANAGER,"The RINA packet is a managment packet");
 
-    if(!pxNormalInstance->pxOps->duEnqueue(pxNormalInstance->pxData,1,pxMessagePDU))
+    /* The RMT takes the ownership of the DU, and destroys it if it is
+     * dropped. The shim has a single flow, the one of the enrollment. */
+    if(!pxNormalInstance->pxOps->duEnqueue(pxNormalInstance->pxData,xEnrollmentFlowPortId,pxMessagePDU))
     {
         ESP_LOGI(TAG_IPCPMANAGER,"Drop frame because there is not enough memory space" );
-        xDuDestroy(pxMessagePDU);
     }
 
     
@@ -4,7 +4,7 @@
 #include "common.h"
 #include "configRINA.h"
 #include "configSensor.h"
-#include "cepIdm.h"
+#include "cepidm.h"
 
 #include "esp_log.h"
 #define BITS_PER_BYTE (8)
@@ -61,7 +61,7 @@ BaseType_t xCepIdmAllocated(cepIdm_t *pxInstance, cepId_t xCepId)
         while (pxListItem != pxListEnd)
         {
 
-                pos = (allocCepId_t *)listGET_LIST_ITEM_VALUE(pxListItem);
+                pos = (allocCepId_t *)listGET_LIST_ITEM_OWNER(pxListItem);
 
                 if (pos)
                 {
@@ -118,6 +118,8 @@ cepId_t xCepIdmAllocate(cepIdm_t *pxInstance)
                 return cep_id_bad();
 
         vListInitialiseItem(&pxNewPortId->xCepIdItem);
+        listSET_LIST_ITEM_OWNER(&(pxNewPortId->xCepIdItem), (void *)pxNewPortId);
+        listSET_LIST_ITEM_VALUE(&(pxNewPortId->xCepIdItem), pid);
         pxNewPortId->xCepId = pid;
         vListInsert( &pxInstance->xAllocatedCepIds,&pxNewPortId->xCepIdItem);
 
@@ -2,10 +2,10 @@
 #include <string.h>
 
 /* FreeRTOS includes. */
-#include "Freertos/FreeRTOS.h"
-#include "Freertos/task.h"
-#include "Freertos/queue.h"
-#include "Freertos/semphr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 #include "common.h"
 #include "factoryIPCP.h"
@@ -10,6 +10,7 @@
 #include "ARP826.h"
 #include "pci.h"
 #include "common.h"
+#include "timerWheel.h"
 
 
 /*-----------------------------------------------------------*/
@@ -44,10 +45,38 @@ typedef enum RINA_EVENTS
     eFactoryInitEvent,      /*11: The IPCP factories has been initialized. */
     eShimAppRegisteredEvent, /* 12: The Normal IPCP has been registered into the Shim*/
     eSendMgmtEvent, /* 13: Send Mgmt PDU */
+    eRmtEgressEvent, /* 14: An RMT has PDUs queued on N-1 ports that can be written */
 
 
 } eRINAEvent_t;
 
+/* Priority lanes of the IPCP task event queue, highest first. */
+typedef enum RINA_EVENT_LANES
+{
+	eIpcpLaneControl = 0,
+	eIpcpLaneManagement,
+	eIpcpLaneData,
+	eIpcpLaneCount
+} eIpcpEventLane_t;
+
+typedef struct xIPCP_EVENT_LANE_STATS
+{
+	uint32_t ulEvents;       /* Events taken by the IPCP task. */
+	uint32_t ulFull;         /* Events refused because the lane was full. */
+	uint32_t ulGuardServed;  /* Events taken early by the starvation guard. */
+	UBaseType_t uxHighWater; /* Most events waiting at once. */
+	uint32_t ulMaxDelayUs;   /* Longest time an event waited. */
+	uint64_t ullDelayUs;     /* Time all the events taken waited. */
+} IpcpEventLaneStats_t;
+
+typedef struct xIPCP_DATA_PLANE_LOCK_STATS
+{
+	uint32_t ulTaken;        /* Times the lock was taken, nested or not. */
+	uint32_t ulWaited;       /* Of those, times another task held it. */
+	uint32_t ulMaxWaitUs;    /* Longest wait for it. */
+	uint64_t ullWaitUs;      /* Time all the waits took. */
+} IpcpDataPlaneLockStats_t;
+
 /**
  * Structure for the information of the commands issued to the RINA task.
  */
@@ -80,6 +109,7 @@ typedef int32_t  portId_t;
 
 
 struct ipcpInstance_t;
+struct xIPCP_INSTANCE;
 struct ipcpInstanceData_t;
 struct du_t;
 
@@ -152,7 +182,7 @@ struct ipcpInstanceOps_t {
                                       struct dtcp_config *        dtcp_config*/);
 
         BaseType_t      (* flowPrebind)(struct ipcpInstanceData_t * pxData,
-                                  //struct ipcpInstance_t *   	pxUserIpcp,
+                                  struct xIPCP_INSTANCE *   	pxUserIpcp,
                                   portId_t                   xPortId);
 
         BaseType_t      (* flowBindingIpcp)(struct ipcpInstanceData_t * pxUserData,
@@ -180,11 +210,15 @@ struct ipcpInstanceOps_t {
                              portId_t                   xPortId,
                              struct du_t *                xDu);
 
-        BaseType_t (* pffAdd)(struct ipcpInstanceData_t * pxData
-			/*struct mod_pff_entry	  * pxEntry*/);
+        BaseType_t (* pffAdd)(struct ipcpInstanceData_t * pxData,
+                              address_t xAddress,
+                              qosId_t xQosId,
+                              const portId_t * pxPorts,
+                              size_t uxPorts);
 
-       BaseType_t (* pffRemove)(struct ipcpInstanceData_t * pxData
-    			/*struct mod_pff_entry	  * pxEntry*/);
+       BaseType_t (* pffRemove)(struct ipcpInstanceData_t * pxData,
+                                address_t xAddress,
+                                qosId_t xQosId);
 
         /*int (* pff_dump)(struct ipcp_instance_data * data,
                          struct list_head *          entries);
@@ -204,17 +238,17 @@ struct ipcpInstanceOps_t {
 
         const name_t * (* ipcpName)(struct ipcpInstanceData_t * pxData);
         const name_t * (* difName)(struct ipcpInstanceData_t * pxData);
-        /*ipc_process_id_t (* ipcp_id)(ipcpInstanceData_t * pxData);
+        /*ipc_process_id_t (* ipcp_id)(ipcpInstanceData_t * pxData);*/
 
-        int (* set_policy_set_param)(struct ipcp_instance_data * data,
-                                     const string_t * path,
-                                     const string_t * param_name,
-                                     const string_t * param_value);
-        int (* select_policy_set)(struct ipcp_instance_data * data,
-                                  const string_t * path,
-                                  const string_t * ps_name);
+        BaseType_t (* setPolicySetParam)(struct ipcpInstanceData_t * pxData,
+                                         const string_t pcPath,
+                                         const string_t pcParamName,
+                                         const string_t pcParamValue);
+        BaseType_t (* selectPolicySet)(struct ipcpInstanceData_t * pxData,
+                                       const string_t pcPath,
+                                       const string_t pcPsName);
 
-        int (* update_crypto_state)(struct ipcp_instance_data * data,
+        /*int (* update_crypto_state)(struct ipcp_instance_data * data,
         			    struct sdup_crypto_state * state,
         		            port_id_t 	   port_id);*/
 
@@ -255,19 +289,6 @@ typedef struct  xIPCP_INSTANCE {
         ListItem_t               xInstanceItem;
 }ipcpInstance_t;
 
-/**
- * The software timer struct for various IPCP functions
- */
-    typedef struct xIPCP_TIMER
-    {
-        uint32_t
-            bActive : 1,            /**< This timer is running and must be processed. */
-            bExpired : 1;           /**< Timer has expired and a task must be processed. */
-        TimeOut_t xTimeOut;         /**< The timeout value. */
-        TickType_t ulRemainingTime; /**< The amount of time remaining. */
-        TickType_t ulReloadTime;    /**< The value of reload time. */
-    } IPCPTimer_t;
-
 
 /*
  * Send the event eEvent to the IPCP task event queue, using a block time of
@@ -279,6 +300,15 @@ BaseType_t xSendEventToIPCPTask( eRINAEvent_t eEvent );
 /* Returns pdTRUE is this function is called from the IPCP-task */
 BaseType_t xIsCallingFromIPCPTask( void );
 
+/* Returns pdTRUE if called from the task that hands frames to the driver:
+ * the TX task when IPCP_USE_PIPELINE is set, else the IPCP-task. */
+BaseType_t xIsCallingFromIPCPTxTask( void );
+
+/* Serialises the RX, TX and IPCP tasks on the RMT, EFCP and flow state.
+ * May be nested by the same task. Does nothing without IPCP_USE_PIPELINE. */
+void vIpcpDataPlaneLock( void );
+void vIpcpDataPlaneUnlock( void );
+
 BaseType_t xSendEventStructToIPCPTask( const RINAStackEvent_t * pxEvent,
                                          TickType_t uxTimeout );
 
@@ -286,5 +316,18 @@ eFrameProcessingResult_t eConsiderFrameForProcessing( const uint8_t * const pucE
 
 BaseType_t RINA_IPCPInit( void );
 
+/* Copies how often the RX, TX and IPCP tasks waited for each other on the
+ * data-plane lock. */
+void vIpcpGetDataPlaneLockStats( IpcpDataPlaneLockStats_t * pxStats );
+
+/* Copies the statistics of the eIpcpLaneCount event lanes. */
+void vIpcpGetEventLaneStats( IpcpEventLaneStats_t pxStats[ eIpcpLaneCount ] );
+
+/* Timers of the IPCP task, on one timer wheel. They may be started and
+ * stopped from any task, the callbacks run in the IPCP task. Starting a
+ * running timer restarts it. */
+void vIpcpTimerStart( timerWheelTimer_t * pxTimer, TickType_t xTicks );
+void vIpcpTimerStop( timerWheelTimer_t * pxTimer );
+
 
 #endif
@@ -44,13 +44,19 @@ BaseType_t xIpcManagerCreateInstance(factories_t *pxFactories, ipcpFactoryType_t
 BaseType_t xIcpManagerEnrollmentFlowRequest(factories_t *pxFactories, ipcpFactoryType_t xFactoryTypeFrom,  ipcpFactoryType_t xFactoryTypeTo, pidm_t * pxPidm);
 
 BaseType_t xIpcpManagerShimAllocateResponseHandle(factories_t *pxFactories, ipcpFactoryType_t xShimType);
+
+/* An ARP request from the peer answers the request of the enrollment flow
+ * too, which the peer may have missed while it was coming up. */
+BaseType_t xIpcpManagerShimArpRequestHandle(factories_t *pxFactories, ipcpFactoryType_t xShimType);
 BaseType_t xIpcpManagerPreBindFlow(factories_t *pxFactories, ipcpFactoryType_t xNormalType);
 
 
-BaseType_t xIpcpManagerAppFlowAllocateRequestHandle(pidm_t * pxPidm, void * data);
+portId_t xIpcpManagerAppFlowAllocateRequestHandle(pidm_t * pxPidm, void * data);
 BaseType_t xIpcManagerWriteMgmtHandler(ipcpFactoryType_t xType, void *pxData);
+BaseType_t xIpcManagerWriteDataHandler(portId_t xPortId, struct du_t *pxDu);
 
 ipcpInstance_t *pxIpcManagerFindInstanceById(ipcpInstanceId_t xIpcpId);
+ipcpInstance_t *pxIpcManagerFindInstanceByType(ipcpInstanceType_t xType);
 void vIpcManagerRINAPackettHandler(NetworkBufferDescriptor_t * pxNetworkBuffer);
 
 
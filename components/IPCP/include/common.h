@@ -130,6 +130,13 @@ typedef struct xNETWORK_BUFFER
     size_t xDataLength;                        /**< Starts by holding the total Ethernet frame length, then the UDP/TCP payload length. */
     uint32_t ulPort;                           /**< Source or destination port, depending on usage scenario. */
     uint32_t ulBoundPort;                      /**< The N-1 port to transmite. */
+    uint8_t * pucBufferStart;                  /**< Start of the payload storage, pucEthernetBuffer moves within it as headers are pushed and pulled. */
+    size_t xBufferSize;                        /**< Size of the payload storage starting at pucBufferStart. */
+    struct xNETWORK_BUFFER * pxNextSegment;    /**< Next segment of a chained SDU, NULL for the last or only segment. */
+    struct xNETWORK_BUFFER_EXTERNAL * pxExternal; /**< Driver memory wrapped by pxNetworkBufferWrapFromISR(), NULL for pool storage. */
+#if ( USE_LINKED_RX_MESSAGES != 0 )
+    struct xNETWORK_BUFFER * pxNextBuffer;     /**< Next received frame of a burst handed to the IPCP task. */
+#endif
 
 } NetworkBufferDescriptor_t;
 typedef enum FRAMES_PROCESSING
@@ -9,6 +9,9 @@ BaseType_t xNormalFlowBinding(struct ipcpInstanceData_t *pxUserData,
                               portId_t xPid,
                               ipcpInstance_t *pxN1Ipcp);
 
+BaseType_t xNormalFlowUnbinding(struct ipcpInstanceData_t *pxUserData,
+                                portId_t xPid);
+
 cepId_t xNormalConnectionCreateRequest(struct ipcpInstanceData_t *pxData,
                                        portId_t xPortId,
                                        address_t xSource,
@@ -25,6 +28,7 @@ BaseType_t xNormalRegistering(ipcpInstance_t *pxInstanceFrom, ipcpInstance_t *px
 BaseType_t xNormalFlowAllocationRequest(struct ipcpInstance_t *pxInstanceFrom, struct ipcpInstance_t *pxInstanceTo, portId_t xShimPortId);
 
 BaseType_t xNormalFlowPrebind(struct ipcpInstanceData_t *pxData,
+                              ipcpInstance_t *pxUserIpcp,
                               portId_t xPortId);
 
 BaseType_t xNormalMgmtDuWrite(struct ipcpInstanceData_t *pxData, portId_t xPortId, struct du_t *pxDu);
@@ -32,6 +32,8 @@ pidm_t * pxPidmCreate( void );
 
 portId_t xPidmAllocate(pidm_t *pxInstance);
 
+BaseType_t xPidmRelease(pidm_t *pxInstance, portId_t id);
+
 
 
 #endif
\ No newline at end of file
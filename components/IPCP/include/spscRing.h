@@ -0,0 +1,43 @@
+#ifndef SPSC_RING_H__INCLUDED
+#define SPSC_RING_H__INCLUDED
+
+#include "freertos/FreeRTOS.h"
+
+/**
+*
+*        Single producer, single consumer ring:
+*       Passes pointers between two tasks without a lock. Only one task may
+*       push and only one task may pop; the indexes are published with
+*       release stores and read with acquire loads, so it also works between
+*       the two cores of the ESP32.
+*
+**/
+
+typedef struct xSPSC_RING
+{
+	void **ppvSlots;
+
+	/* Number of slots, a power of two. */
+	size_t uxSize;
+
+	/* Free running, written by the consumer only. */
+	size_t uxHead;
+
+	/* Free running, written by the producer only. */
+	size_t uxTail;
+
+} spscRing_t;
+
+/* ppvStorage holds uxSize pointers, uxSize must be a power of two. */
+BaseType_t xSpscRingInit(spscRing_t *pxRing, void **ppvStorage, size_t uxSize);
+
+/* Producer side. Returns pdFALSE if the ring is full. */
+BaseType_t xSpscRingPush(spscRing_t *pxRing, void *pvItem);
+
+/* Consumer side. Returns NULL if the ring is empty. */
+void *pvSpscRingPop(spscRing_t *pxRing);
+
+/* Either side, the result may be stale by the time it is used. */
+size_t uxSpscRingCount(const spscRing_t *pxRing);
+
+#endif
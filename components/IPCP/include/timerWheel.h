@@ -0,0 +1,80 @@
+#ifndef TIMER_WHEEL_H__INCLUDED
+#define TIMER_WHEEL_H__INCLUDED
+
+#include "freertos/FreeRTOS.h"
+
+/**
+*
+*        Hierarchical timer wheel:
+*       Keeps any number of timers in TIMER_WHEEL_LEVELS levels of
+*       TIMER_WHEEL_SLOTS slots, level 0 one tick per slot and each level above
+*       TIMER_WHEEL_SLOTS times coarser. Start, restart and stop unlink and link
+*       one node, whatever the number of timers; the timers of a coarse slot
+*       move down a level when the wheel reaches it. Time is in ticks and is
+*       given by the caller, the callbacks run in the task that advances the
+*       wheel.
+*
+**/
+
+#define TIMER_WHEEL_SLOT_BITS   ( 6 )
+#define TIMER_WHEEL_SLOTS       ( 1U << TIMER_WHEEL_SLOT_BITS )
+#define TIMER_WHEEL_LEVELS      ( 4 )
+
+/* Timers further out wait in the last level and are put back there until
+ * they come in range, about 4.6 hours of 1 ms ticks. */
+#define TIMER_WHEEL_RANGE       ( ( TickType_t ) 1U << ( TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS ) )
+
+typedef void ( *timerWheelCallback_t )( void *pvArgument );
+
+typedef struct xTIMER_WHEEL_TIMER
+{
+	struct xTIMER_WHEEL_TIMER *pxNext;
+
+	/* The pointer to this timer in its list, NULL when not running. */
+	struct xTIMER_WHEEL_TIMER **ppxPrev;
+
+	TickType_t xExpiry;
+	timerWheelCallback_t pxCallback;
+	void *pvArgument;
+
+} timerWheelTimer_t;
+
+typedef struct xTIMER_WHEEL
+{
+	timerWheelTimer_t *pxSlots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+
+	/* One bit per non-empty slot. */
+	uint64_t ullOccupied[TIMER_WHEEL_LEVELS];
+
+	/* The next tick to process. */
+	TickType_t xNow;
+
+	UBaseType_t uxRunning;
+	portMUX_TYPE xLock;
+
+} timerWheel_t;
+
+void vTimerWheelInit(timerWheel_t *pxWheel, TickType_t xNow);
+
+void vTimerWheelTimerInit(timerWheelTimer_t *pxTimer, timerWheelCallback_t pxCallback, void *pvArgument);
+
+/* Starts the timer to expire at the tick xExpiry, or restarts it if it is
+ * running. An expiry already passed fires at the next advance. */
+void vTimerWheelStart(timerWheel_t *pxWheel, timerWheelTimer_t *pxTimer, TickType_t xExpiry);
+
+/* The callback will not be called once this returns, unless the advancing
+ * task had already taken the timer out of the wheel to call it. */
+void vTimerWheelStop(timerWheel_t *pxWheel, timerWheelTimer_t *pxTimer);
+
+BaseType_t xTimerWheelIsRunning(const timerWheelTimer_t *pxTimer);
+
+/* Calls the callbacks of the timers expired at xNow or before. Returns the
+ * number of callbacks called. */
+UBaseType_t uxTimerWheelAdvance(timerWheel_t *pxWheel, TickType_t xNow);
+
+/* Ticks from xNow until the wheel must be advanced again, 0 if it is due
+ * and portMAX_DELAY if no timer is running. The wheel may have to move
+ * timers down a level before the first one expires. */
+TickType_t xTimerWheelTicksToNext(timerWheel_t *pxWheel, TickType_t xNow);
+
+#endif
@@ -1,11 +1,12 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* FreeRTOS includes. */
-#include "Freertos/FreeRTOS.h"
-#include "Freertos/task.h"
-#include "Freertos/queue.h"
-#include "Freertos/semphr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 #include "IPCP.h"
 #include "EFCP.h"
@@ -67,7 +68,7 @@ struct ipcpInstanceData_t
         struct efcpContainer_t *pxEfcpc;
 
         /* RMT asociated at the IPCP Instance */
-        struct rmt_t *pxRmt;
+        rmt_t *pxRmt;
 
         /* SDUP asociated at the IPCP Instance */
         //struct sdup *           sdup;
@@ -158,8 +159,6 @@ static struct normalFlow_t *prvNormalFindFlow(struct ipcpInstanceData_t *pxData,
         ListItem_t *pxListItem;
         ListItem_t const *pxListEnd;
 
-        pxFlow = pvPortMalloc(sizeof(*pxFlow));
-
         /* Find a way to iterate in the list and compare the addesss*/
         pxListEnd = listGET_END_MARKER(&pxData->xFlowsList);
         pxListItem = listGET_HEAD_ENTRY(&pxData->xFlowsList);
@@ -201,13 +200,8 @@ BaseType_t xNormalDuWrite(struct ipcpInstanceData_t *pxData,
                 return pdFALSE;
         }
 
-        if (xEfcpContainerWrite(pxData->pxEfcpc, pxFlow->xActive, pxDu))
-        {
-                ESP_LOGE(TAG_IPCPNORMAL, "Could not send sdu to EFCP Container");
-                return pdFALSE;
-        }
-
-        return pdTRUE;
+        /* EFCP and the RMT log why if the SDU is lost */
+        return xEfcpContainerWrite(pxData->pxEfcpc, pxFlow->xActive, pxDu);
 }
 
 /*static BaseType_t xNormalDeallocate(struct ipcpInstanceData * pxData)
@@ -230,7 +224,8 @@ BaseType_t xNormalDuWrite(struct ipcpInstanceData_t *pxData,
 
 
 BaseType_t xNormalFlowPrebind(struct ipcpInstanceData_t *pxData,
-                                     portId_t xPortId)
+                              ipcpInstance_t *pxUserIpcp,
+                              portId_t xPortId)
 {
    
 
@@ -250,16 +245,52 @@ BaseType_t xNormalFlowPrebind(struct ipcpInstanceData_t *pxData,
         }
 
         pxFlow->xPortId = xPortId;
+        pxFlow->xActive = cep_id_bad();
         pxFlow->eState = ePORT_STATE_PENDING;
-        /*KFA should be the user. Implement this when the KFA is implemented*/
-        //pxFlow->pxUserIpcp = kfa;
+        /* The SDUs received on the port are enqueued to it */
+        pxFlow->pxUserIpcp = pxUserIpcp;
 
         //ESP_LOGI(TAG_IPCPNORMAL, "Flow: %p portID: %d portState: %d", pxFlow, pxFlow->xPortId, pxFlow->eState);
         vListInitialiseItem(&(pxFlow->xFlowListItem));
         listSET_LIST_ITEM_OWNER(&(pxFlow->xFlowListItem), (void *)pxFlow);
+
+        /* The RX and TX tasks look flows up while they run PDUs. */
+        vIpcpDataPlaneLock();
         vListInsert(&(pxData->xFlowsList), &(pxFlow->xFlowListItem));
+        vIpcpDataPlaneUnlock();
+
+
+
+        return pdTRUE;
+}
+
+/**
+ * @brief Undo xNormalFlowPrebind() for a port whose flow could not be
+ * allocated, so the port id can be reused.
+ *
+ * @param pxData Normal IPCP in this case
+ * @param xPortId The PortId of the flow
+ * @return BaseType_t
+ */
+static BaseType_t xNormalFlowUnbindingUser(struct ipcpInstanceData_t *pxData,
+                                           portId_t xPortId)
+{
+        struct normalFlow_t *pxFlow;
+
+        vIpcpDataPlaneLock();
+        pxFlow = prvNormalFindFlow(pxData, xPortId);
+        if (pxFlow)
+        {
+                (void)uxListRemove(&(pxFlow->xFlowListItem));
+        }
+        vIpcpDataPlaneUnlock();
 
+        if (!pxFlow)
+        {
+                return pdFALSE;
+        }
 
+        vPortFree(pxFlow);
 
         return pdTRUE;
 }
@@ -277,7 +308,7 @@ cepId_t xNormalConnectionCreateRequest(struct ipcpInstanceData_t *pxData,
         struct cepIdsEntry_t *pxCepEntry;
         ipcpInstance_t *pxIpcp;
 
-      
+        vIpcpDataPlaneLock();
 
         xCepId = xEfcpConnectionCreate(pxData->pxEfcpc, xSource, xDest,
                                        xPortId, xQosId,
@@ -285,6 +316,7 @@ cepId_t xNormalConnectionCreateRequest(struct ipcpInstanceData_t *pxData,
                                        pxDtpCfg, pxDtcpCfg);
         if (!is_cep_id_ok(xCepId))
         {
+                vIpcpDataPlaneUnlock();
                 ESP_LOGE(TAG_IPCPNORMAL, "Failed EFCP connection creation");
                 return cep_id_bad();
         }
@@ -294,6 +326,7 @@ cepId_t xNormalConnectionCreateRequest(struct ipcpInstanceData_t *pxData,
         {
                 ESP_LOGE(TAG_IPCPNORMAL, "Could not create a cep_id entry, bailing out");
                 xEfcpConnectionDestroy(pxData->pxEfcpc, xCepId);
+                vIpcpDataPlaneUnlock();
                 return cep_id_bad();
         }
 
@@ -335,10 +368,48 @@ cepId_t xNormalConnectionCreateRequest(struct ipcpInstanceData_t *pxData,
         // pxFlow->eState = ePORTSTATEPENDING;
 
         //spin_unlock_bh(&data->lock);
+        vIpcpDataPlaneUnlock();
 
         return xCepId;
 }
 
+/**
+ * @brief Complete the connection of a flow with the CEP-id of the remote
+ * end, once the flow allocator knows it. The flow is then allocated, its
+ * SDUs can be written and the ones received go to its user.
+ *
+ * @param pxData Normal IPCP in this case
+ * @param xPortId Port of the flow
+ * @param xSrcId Local CEP-id of the connection
+ * @param xDstId Remote CEP-id of the connection
+ * @return BaseType_t
+ */
+static BaseType_t xNormalConnectionUpdate(struct ipcpInstanceData_t *pxData,
+                                          portId_t xPortId,
+                                          cepId_t xSrcId,
+                                          cepId_t xDstId)
+{
+        struct normalFlow_t *pxFlow;
+        BaseType_t xReturn = pdFALSE;
+
+        vIpcpDataPlaneLock();
+
+        pxFlow = prvNormalFindFlow(pxData, xPortId);
+        if (!pxFlow || pxFlow->xActive != xSrcId)
+        {
+                ESP_LOGE(TAG_IPCPNORMAL, "No connection %d on port %d", xSrcId, xPortId);
+        }
+        else if (xEfcpConnectionUpdate(pxData->pxEfcpc, pxFlow->pxUserIpcp, xSrcId, xDstId))
+        {
+                pxFlow->eState = ePORT_STATE_ALLOCATED;
+                xReturn = pdTRUE;
+        }
+
+        vIpcpDataPlaneUnlock();
+
+        return xReturn;
+}
+
 /**
  * @brief Flow binding the N-1 Instance and the Normal IPCP by the 
  * portId (N-1 port Id).
@@ -352,7 +423,199 @@ BaseType_t xNormalFlowBinding(struct ipcpInstanceData_t *pxUserData,
                               portId_t xPid,
                               ipcpInstance_t *pxN1Ipcp)
 {
-        return xRmtN1PortBind(pxUserData->pxRmt, xPid, pxN1Ipcp);
+        BaseType_t xReturn;
+
+        vIpcpDataPlaneLock();
+        xReturn = xRmtN1PortBind(pxUserData->pxRmt, xPid, pxN1Ipcp);
+        vIpcpDataPlaneUnlock();
+
+        return xReturn;
+}
+
+/**
+ * @brief Flow unbinding the N-1 Instance from the Normal IPCP when the
+ * N-1 flow is deallocated.
+ * 
+ * @param pxUserData Normal IPCP in this case
+ * @param xPid The PortId of the N-1 DIF
+ * @return BaseType_t 
+ */
+BaseType_t xNormalFlowUnbinding(struct ipcpInstanceData_t *pxUserData,
+                                portId_t xPid)
+{
+        BaseType_t xReturn;
+
+        vIpcpDataPlaneLock();
+        xReturn = xRmtN1PortUnbind(pxUserData->pxRmt, xPid);
+        vIpcpDataPlaneUnlock();
+
+        return xReturn;
+}
+
+/**
+ * @brief The N-1 IPCP can't take more PDUs from the port, the RMT queues
+ * them until it can.
+ * 
+ * @param pxData Normal IPCP in this case
+ * @param xId The PortId of the N-1 DIF
+ * @return BaseType_t 
+ */
+static BaseType_t xNormalDisableWrite(struct ipcpInstanceData_t *pxData, portId_t xId)
+{
+        BaseType_t xReturn;
+
+        vIpcpDataPlaneLock();
+        xReturn = xRmtDisableWrite(pxData->pxRmt, xId);
+        vIpcpDataPlaneUnlock();
+
+        return xReturn;
+}
+
+/**
+ * @brief The N-1 IPCP can take PDUs from the port again, the RMT egress
+ * worker sends what was queued.
+ * 
+ * @param pxData Normal IPCP in this case
+ * @param xId The PortId of the N-1 DIF
+ * @return BaseType_t 
+ */
+static BaseType_t xNormalEnableWrite(struct ipcpInstanceData_t *pxData, portId_t xId)
+{
+        BaseType_t xReturn;
+
+        vIpcpDataPlaneLock();
+        xReturn = xRmtEnableWrite(pxData->pxRmt, xId);
+        vIpcpDataPlaneUnlock();
+
+        return xReturn;
+}
+
+/**
+ * @brief Add a route to the PDU Forwarding Function of the RMT. The PFF
+ * is read without locks, so the data plane is not stopped.
+ * 
+ * @param pxData Normal IPCP in this case
+ * @param xAddress Destination address
+ * @param xQosId QoS Id of the route, PFF_QOS_ANY for any
+ * @param pxPorts The N-1 PortIds of the next hops
+ * @param uxPorts Number of next hops
+ * @return BaseType_t 
+ */
+static BaseType_t xNormalPffAdd(struct ipcpInstanceData_t *pxData,
+                                address_t xAddress,
+                                qosId_t xQosId,
+                                const portId_t *pxPorts,
+                                size_t uxPorts)
+{
+        return xPffAdd(pxData->pxRmt->pxPff, xAddress, xQosId, pxPorts, uxPorts);
+}
+
+static BaseType_t xNormalPffRemove(struct ipcpInstanceData_t *pxData,
+                                   address_t xAddress,
+                                   qosId_t xQosId)
+{
+        return xPffRemove(pxData->pxRmt->pxPff, xAddress, xQosId);
+}
+
+/**
+ * @brief Select the policy set of a component, only the RMT has them. The
+ * RMT one can only change while no N-1 flow is bound.
+ * 
+ * @param pxData Normal IPCP in this case
+ * @param pcPath Component, "rmt"
+ * @param pcPsName Policy set name
+ * @return BaseType_t 
+ */
+static BaseType_t xNormalSelectPolicySet(struct ipcpInstanceData_t *pxData,
+                                         const string_t pcPath,
+                                         const string_t pcPsName)
+{
+        BaseType_t xReturn;
+
+        if (!pcPath || strcmp(pcPath, "rmt"))
+        {
+                ESP_LOGE(TAG_IPCPNORMAL, "No policy sets at %s", pcPath ? pcPath : "(null)");
+                return pdFALSE;
+        }
+
+        vIpcpDataPlaneLock();
+        xReturn = xRmtSelectPolicySet(pxData->pxRmt, pcPsName);
+        vIpcpDataPlaneUnlock();
+
+        return xReturn;
+}
+
+/**
+ * @brief Set a parameter of the policy set of a component. The RMT takes
+ * "weight-<qos-id>", the weight of the qos-id for its scheduler, and
+ * "multipath", "hash" or "queue-depth", how it picks between next hops.
+ * 
+ * @param pxData Normal IPCP in this case
+ * @param pcPath Component, "rmt"
+ * @param pcParamName Parameter name
+ * @param pcParamValue Parameter value
+ * @return BaseType_t 
+ */
+static BaseType_t xNormalSetPolicySetParam(struct ipcpInstanceData_t *pxData,
+                                           const string_t pcPath,
+                                           const string_t pcParamName,
+                                           const string_t pcParamValue)
+{
+        unsigned long ulQosId, ulWeight;
+        eRmtMultipath_t eMultipath;
+        char *pcEnd;
+        BaseType_t xReturn;
+
+        if (!pcPath || strcmp(pcPath, "rmt") || !pcParamName || !pcParamValue)
+        {
+                ESP_LOGE(TAG_IPCPNORMAL, "Unknown policy set parameter");
+                return pdFALSE;
+        }
+
+        if (!strcmp(pcParamName, "multipath"))
+        {
+                if (!strcmp(pcParamValue, "hash"))
+                        eMultipath = eRMT_MULTIPATH_HASH;
+                else if (!strcmp(pcParamValue, "queue-depth"))
+                        eMultipath = eRMT_MULTIPATH_QUEUE_DEPTH;
+                else
+                {
+                        ESP_LOGE(TAG_IPCPNORMAL, "Wrong multipath %s", pcParamValue);
+                        return pdFALSE;
+                }
+
+                vIpcpDataPlaneLock();
+                xReturn = xRmtMultipathSet(pxData->pxRmt, eMultipath);
+                vIpcpDataPlaneUnlock();
+
+                return xReturn;
+        }
+
+        if (strncmp(pcParamName, "weight-", 7))
+        {
+                ESP_LOGE(TAG_IPCPNORMAL, "Unknown policy set parameter");
+                return pdFALSE;
+        }
+
+        ulQosId = strtoul(pcParamName + 7, &pcEnd, 10);
+        if (*pcEnd || pcEnd == pcParamName + 7 || ulQosId >= RMT_QOS_IDS)
+        {
+                ESP_LOGE(TAG_IPCPNORMAL, "Wrong qos-id in %s", pcParamName);
+                return pdFALSE;
+        }
+
+        ulWeight = strtoul(pcParamValue, &pcEnd, 10);
+        if (*pcEnd || ulWeight == 0 || ulWeight > UINT8_MAX)
+        {
+                ESP_LOGE(TAG_IPCPNORMAL, "Wrong weight %s", pcParamValue);
+                return pdFALSE;
+        }
+
+        vIpcpDataPlaneLock();
+        xReturn = xRmtQosWeightSet(pxData->pxRmt, (qosId_t)ulQosId, (uint8_t)ulWeight);
+        vIpcpDataPlaneUnlock();
+
+        return xReturn;
 }
 
 BaseType_t xNormalTest(ipcpInstance_t *pxNormalInstance, ipcpInstance_t *pxN1Ipcp)
@@ -461,11 +724,14 @@ static BaseType_t pvNormalAssignToDif(struct ipcpInstanceData_t *pxData, name_t
                 return pdFALSE;
         }*/
 
+        vIpcpDataPlaneLock();
         if (!xRmtAddressAdd(pxData->pxRmt, pxData->xAddress))
         {
+                vIpcpDataPlaneUnlock();
                 ESP_LOGE(TAG_IPCPNORMAL, "Could not set local Address to RMT");
                 return pdFALSE;
         }
+        vIpcpDataPlaneUnlock();
 /*
         if (rmt_config_set(data->rmt, rmt_config))
         {
@@ -499,13 +765,8 @@ static BaseType_t xNormalDuEnqueue(struct ipcpInstanceData_t * pxData,
                              portId_t                   xN1PortId,
                              struct du_t *                pxDu)
 {
-        if (!xRmtReceive(pxData->pxRmt, pxDu, xN1PortId ))
-         {
-                ESP_LOGE(TAG_IPCPNORMAL,"Could not enqueue SDU into the RMT");
-                return pdFALSE;
-        }
-
-        return pdTRUE;
+        /* The RMT has logged why if it could not take the PDU */
+        return xRmtReceive(pxData->pxRmt, pxDu, xN1PortId);
 }
 
 /**
@@ -548,7 +809,7 @@ BaseType_t xNormalMgmtDuWrite(struct ipcpInstanceData_t * pxData, portId_t xPort
         pxDu->pxPci->xFlags = 0;
         pxDu->pxPci->xType = PDU_TYPE_MGMT;
         pxDu->pxPci->xSequenceNumber = 0;
-        pxDu->pxPci->xPduLen = pxDu->pxNetworkBuffer->xDataLength;
+        pxDu->pxPci->xPduLen = xDuLen(pxDu);
         pxDu->pxPci->xSource = pxData->xAddress;
 
         //vPciPrint(pxDu->pxPci);
@@ -572,9 +833,9 @@ BaseType_t xNormalMgmtDuWrite(struct ipcpInstanceData_t * pxData, portId_t xPort
 }
 
 
-static BaseType_t xNormalMgmtDuPost(struct ipcpInstanceData * pxData,
+static BaseType_t xNormalMgmtDuPost(struct ipcpInstanceData_t * pxData,
                                portId_t                   xPortId,
-                               struct du *                 pxDu)
+                               struct du_t *               pxDu)
 {
 
 	if (!pxData) {
@@ -611,8 +872,8 @@ static struct ipcpInstanceOps_t xNormalInstanceOps = {
     .flowDeallocate = NULL,        //ok
     .flowPrebind = xNormalFlowPrebind,           //ok
     .flowBindingIpcp =  xNormalFlowBinding,       //ok
-    .flowUnbindingIpcp = NULL,     //ok
-    .flowUnbindingUserIpcp = NULL, //ok
+    .flowUnbindingIpcp = xNormalFlowUnbinding, //ok
+    .flowUnbindingUserIpcp = xNormalFlowUnbindingUser, //ok
     .nm1FlowStateChange = NULL,    //ok
 
     .applicationRegister = NULL,   //ok
@@ -622,7 +883,7 @@ static struct ipcpInstanceOps_t xNormalInstanceOps = {
     .updateDifConfig = NULL, //ok
 
     .connectionCreate = xNormalConnectionCreateRequest,        //ok
-    .connectionUpdate = NULL,        //ok
+    .connectionUpdate = xNormalConnectionUpdate, //ok
     .connectionDestroy = NULL,       //ok
     .connectionCreateArrived = NULL, // ok
     .connectionModify = NULL,        //ok
@@ -633,8 +894,8 @@ static struct ipcpInstanceOps_t xNormalInstanceOps = {
     .mgmtDuWrite = xNormalMgmtDuWrite, //ok
     .mgmtDuPost = xNormalMgmtDuPost,  //ok
 
-    .pffAdd = NULL,    //ok
-    .pffRemove = NULL, //ok
+    .pffAdd = xNormalPffAdd,       //ok
+    .pffRemove = xNormalPffRemove, //ok
     //.pff_dump                  = NULL,
     //.pff_flush                 = NULL,
     //.pff_modify		   		   = NULL,
@@ -645,11 +906,13 @@ static struct ipcpInstanceOps_t xNormalInstanceOps = {
     .difName = NULL,  //ok
     //.ipcp_id		  		   = NULL,
 
-    //.set_policy_set_param      = NULL,
-    //.select_policy_set         = NULL,
+    .setPolicySetParam = xNormalSetPolicySetParam, //ok
+    .selectPolicySet = xNormalSelectPolicySet,     //ok
     //.update_crypto_state	   = NULL,
     //.address_change            = NULL,
     //.dif_name		   		   = NULL,
+    .enableWrite = xNormalEnableWrite,   //ok
+    .disableWrite = xNormalDisableWrite, //ok
     .maxSduSize = NULL};
 
 
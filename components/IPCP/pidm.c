@@ -70,8 +70,6 @@ BaseType_t xPidmAllocated(pidm_t *pxInstance, portId_t xPortId)
         ListItem_t *pxListItem;
         ListItem_t const *pxListEnd;
 
-        pos = pvPortMalloc(sizeof(*pos));
-
         /* Find a way to iterate in the list and compare the addesss*/
 
         pxListEnd = listGET_END_MARKER(&pxInstance->xAllocatedPorts);
@@ -85,14 +83,12 @@ BaseType_t xPidmAllocated(pidm_t *pxInstance, portId_t xPortId)
                 if (pos->xPid == xPortId)
                 {
                         ESP_LOGI(TAG_IPCPMANAGER, "Port ID %p, #: %d", pos, pos->xPid);
-                        vPortFree(pos);
 
                         return pdTRUE;
                 }
 
                 pxListItem = listGET_NEXT(pxListItem);
         }
-        vPortFree(pos);
         return pdFALSE;
 
 }
@@ -156,7 +152,9 @@ portId_t xPidmAllocate(pidm_t *pxInstance)
 BaseType_t xPidmRelease(pidm_t *pxInstance,
                         portId_t id)
 {
-        allocPid_t *pos, *next;
+        allocPid_t *pos;
+        ListItem_t *pxListItem;
+        ListItem_t const *pxListEnd;
         int found = 0;
 
         if (!is_port_id_ok(id))
@@ -170,13 +168,23 @@ BaseType_t xPidmRelease(pidm_t *pxInstance,
                 return pdFALSE;
         }
 
-        /*list_for_each_entry_safe(pos, next, &instance->allocated_ports, list) {
-                if (pos->pid == id) {
-                	list_del(&pos->list);
-                	rkfree(pos);
+        pxListEnd = listGET_END_MARKER(&pxInstance->xAllocatedPorts);
+        pxListItem = listGET_HEAD_ENTRY(&pxInstance->xAllocatedPorts);
+
+        while (pxListItem != pxListEnd)
+        {
+                pos = (allocPid_t *)listGET_LIST_ITEM_OWNER(pxListItem);
+
+                if (pos->xPid == id)
+                {
+                        (void)uxListRemove(&(pos->xPortIdItem));
+                        vPortFree(pos);
                         found = 1;
+                        break;
                 }
-        }*/
+
+                pxListItem = listGET_NEXT(pxListItem);
+        }
 
         if (!found)
         {
@@ -0,0 +1,61 @@
+#include "freertos/FreeRTOS.h"
+
+#include "spscRing.h"
+
+BaseType_t xSpscRingInit(spscRing_t *pxRing, void **ppvStorage, size_t uxSize)
+{
+        if ((pxRing == NULL) || (ppvStorage == NULL) || (uxSize == 0) || ((uxSize & (uxSize - 1)) != 0))
+        {
+                return pdFALSE;
+        }
+
+        pxRing->ppvSlots = ppvStorage;
+        pxRing->uxSize = uxSize;
+        pxRing->uxHead = 0;
+        pxRing->uxTail = 0;
+
+        return pdTRUE;
+}
+
+BaseType_t xSpscRingPush(spscRing_t *pxRing, void *pvItem)
+{
+        size_t uxTail = pxRing->uxTail;
+        size_t uxHead = __atomic_load_n(&pxRing->uxHead, __ATOMIC_ACQUIRE);
+
+        if ((uxTail - uxHead) == pxRing->uxSize)
+        {
+                return pdFALSE;
+        }
+
+        pxRing->ppvSlots[uxTail & (pxRing->uxSize - 1)] = pvItem;
+
+        /* The slot is written before the consumer can see it. */
+        __atomic_store_n(&pxRing->uxTail, uxTail + 1, __ATOMIC_RELEASE);
+
+        return pdTRUE;
+}
+
+void *pvSpscRingPop(spscRing_t *pxRing)
+{
+        size_t uxHead = pxRing->uxHead;
+        size_t uxTail = __atomic_load_n(&pxRing->uxTail, __ATOMIC_ACQUIRE);
+        void *pvItem;
+
+        if (uxHead == uxTail)
+        {
+                return NULL;
+        }
+
+        pvItem = pxRing->ppvSlots[uxHead & (pxRing->uxSize - 1)];
+
+        /* The slot is read before the producer can reuse it. */
+        __atomic_store_n(&pxRing->uxHead, uxHead + 1, __ATOMIC_RELEASE);
+
+        return pvItem;
+}
+
+size_t uxSpscRingCount(const spscRing_t *pxRing)
+{
+        return __atomic_load_n(&pxRing->uxTail, __ATOMIC_ACQUIRE) -
+               __atomic_load_n(&pxRing->uxHead, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,282 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "timerWheel.h"
+
+#define TIMER_WHEEL_SLOT_MASK   ( TIMER_WHEEL_SLOTS - 1U )
+
+/* Differences of ticks above this are expiries already passed. */
+#define TIMER_WHEEL_PASSED      ( portMAX_DELAY / 2U )
+
+/* Offset from uxFrom of the first non-empty slot, going round, or
+ * TIMER_WHEEL_SLOTS if they are all empty. */
+static UBaseType_t prvFirstSlotFrom(uint64_t ullOccupied, UBaseType_t uxFrom)
+{
+        if (ullOccupied == 0)
+        {
+                return TIMER_WHEEL_SLOTS;
+        }
+
+        if (uxFrom != 0)
+        {
+                ullOccupied = (ullOccupied >> uxFrom) | (ullOccupied << (TIMER_WHEEL_SLOTS - uxFrom));
+        }
+
+        return (UBaseType_t)__builtin_ctzll(ullOccupied);
+}
+
+static void prvLink(timerWheel_t *pxWheel, timerWheelTimer_t *pxTimer)
+{
+        TickType_t xWhen = pxTimer->xExpiry;
+        TickType_t xDelta = xWhen - pxWheel->xNow;
+        UBaseType_t uxLevel = 0;
+        UBaseType_t uxSlot;
+        timerWheelTimer_t **ppxHead;
+
+        if (xDelta > TIMER_WHEEL_PASSED)
+        {
+                xWhen = pxWheel->xNow;
+                xDelta = 0;
+        }
+        else if (xDelta >= TIMER_WHEEL_RANGE)
+        {
+                /* Comes back here each time the last level gets to it. */
+                xWhen = pxWheel->xNow + TIMER_WHEEL_RANGE - 1;
+                xDelta = TIMER_WHEEL_RANGE - 1;
+        }
+
+        while (xDelta >= ((TickType_t)1U << (TIMER_WHEEL_SLOT_BITS * (uxLevel + 1))))
+        {
+                uxLevel++;
+        }
+
+        uxSlot = (xWhen >> (TIMER_WHEEL_SLOT_BITS * uxLevel)) & TIMER_WHEEL_SLOT_MASK;
+        ppxHead = &pxWheel->pxSlots[uxLevel][uxSlot];
+
+        pxTimer->pxNext = *ppxHead;
+        if (pxTimer->pxNext != NULL)
+        {
+                pxTimer->pxNext->ppxPrev = &pxTimer->pxNext;
+        }
+        pxTimer->ppxPrev = ppxHead;
+        *ppxHead = pxTimer;
+
+        pxWheel->ullOccupied[uxLevel] |= (uint64_t)1U << uxSlot;
+}
+
+static void prvUnlink(timerWheel_t *pxWheel, timerWheelTimer_t *pxTimer)
+{
+        timerWheelTimer_t **ppxPrev = pxTimer->ppxPrev;
+        timerWheelTimer_t **ppxFirstSlot = &pxWheel->pxSlots[0][0];
+        size_t uxIndex;
+
+        *ppxPrev = pxTimer->pxNext;
+        if (pxTimer->pxNext != NULL)
+        {
+                pxTimer->pxNext->ppxPrev = ppxPrev;
+        }
+
+        pxTimer->pxNext = NULL;
+        pxTimer->ppxPrev = NULL;
+
+        /* Timers being expired are on a list of their own, not in a slot. */
+        if ((*ppxPrev == NULL) && (ppxPrev >= ppxFirstSlot) &&
+            (ppxPrev < ppxFirstSlot + (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS)))
+        {
+                uxIndex = (size_t)(ppxPrev - ppxFirstSlot);
+                pxWheel->ullOccupied[uxIndex / TIMER_WHEEL_SLOTS] &= ~((uint64_t)1U << (uxIndex % TIMER_WHEEL_SLOTS));
+        }
+}
+
+/* Moves the timers of a slot down to the levels below. */
+static void prvCascade(timerWheel_t *pxWheel, UBaseType_t uxLevel, UBaseType_t uxSlot)
+{
+        timerWheelTimer_t *pxTimer = pxWheel->pxSlots[uxLevel][uxSlot];
+        timerWheelTimer_t *pxNext;
+
+        pxWheel->pxSlots[uxLevel][uxSlot] = NULL;
+        pxWheel->ullOccupied[uxLevel] &= ~((uint64_t)1U << uxSlot);
+
+        while (pxTimer != NULL)
+        {
+                pxNext = pxTimer->pxNext;
+                prvLink(pxWheel, pxTimer);
+                pxTimer = pxNext;
+        }
+}
+
+/* The first tick from xNow on where a slot expires or cascades. Level 0 is
+ * exact, the levels above give the tick their slot moves down. */
+static TickType_t prvNextTick(const timerWheel_t *pxWheel)
+{
+        TickType_t xNow = pxWheel->xNow;
+        TickType_t xBest = portMAX_DELAY;
+        TickType_t xFirst, xTick;
+        UBaseType_t uxLevel, uxShift, uxOffset;
+
+        uxOffset = prvFirstSlotFrom(pxWheel->ullOccupied[0], xNow & TIMER_WHEEL_SLOT_MASK);
+        if (uxOffset < TIMER_WHEEL_SLOTS)
+        {
+                xBest = uxOffset;
+        }
+
+        for (uxLevel = 1; uxLevel < TIMER_WHEEL_LEVELS; uxLevel++)
+        {
+                uxShift = TIMER_WHEEL_SLOT_BITS * uxLevel;
+
+                /* The first slot of this level not cascaded yet. */
+                xFirst = (xNow >> uxShift) + (((xNow & (((TickType_t)1U << uxShift) - 1)) != 0) ? 1 : 0);
+
+                uxOffset = prvFirstSlotFrom(pxWheel->ullOccupied[uxLevel], xFirst & TIMER_WHEEL_SLOT_MASK);
+                if (uxOffset < TIMER_WHEEL_SLOTS)
+                {
+                        xTick = ((xFirst + uxOffset) << uxShift) - xNow;
+                        if (xTick < xBest)
+                        {
+                                xBest = xTick;
+                        }
+                }
+        }
+
+        return xNow + xBest;
+}
+
+void vTimerWheelInit(timerWheel_t *pxWheel, TickType_t xNow)
+{
+        memset(pxWheel, 0, sizeof(*pxWheel));
+        pxWheel->xNow = xNow;
+        portMUX_INITIALIZE(&pxWheel->xLock);
+}
+
+void vTimerWheelTimerInit(timerWheelTimer_t *pxTimer, timerWheelCallback_t pxCallback, void *pvArgument)
+{
+        pxTimer->pxNext = NULL;
+        pxTimer->ppxPrev = NULL;
+        pxTimer->xExpiry = 0;
+        pxTimer->pxCallback = pxCallback;
+        pxTimer->pvArgument = pvArgument;
+}
+
+void vTimerWheelStart(timerWheel_t *pxWheel, timerWheelTimer_t *pxTimer, TickType_t xExpiry)
+{
+        taskENTER_CRITICAL(&pxWheel->xLock);
+
+        if (pxTimer->ppxPrev != NULL)
+        {
+                prvUnlink(pxWheel, pxTimer);
+        }
+        else
+        {
+                pxWheel->uxRunning++;
+        }
+
+        pxTimer->xExpiry = xExpiry;
+        prvLink(pxWheel, pxTimer);
+
+        taskEXIT_CRITICAL(&pxWheel->xLock);
+}
+
+void vTimerWheelStop(timerWheel_t *pxWheel, timerWheelTimer_t *pxTimer)
+{
+        taskENTER_CRITICAL(&pxWheel->xLock);
+
+        if (pxTimer->ppxPrev != NULL)
+        {
+                prvUnlink(pxWheel, pxTimer);
+                pxWheel->uxRunning--;
+        }
+
+        taskEXIT_CRITICAL(&pxWheel->xLock);
+}
+
+BaseType_t xTimerWheelIsRunning(const timerWheelTimer_t *pxTimer)
+{
+        return (pxTimer->ppxPrev != NULL) ? pdTRUE : pdFALSE;
+}
+
+UBaseType_t uxTimerWheelAdvance(timerWheel_t *pxWheel, TickType_t xNow)
+{
+        timerWheelTimer_t *pxExpired;
+        timerWheelTimer_t *pxTimer;
+        UBaseType_t uxLevel, uxShift, uxSlot;
+        UBaseType_t uxFired = 0;
+        TickType_t xNext;
+
+        taskENTER_CRITICAL(&pxWheel->xLock);
+
+        while ((xNow - pxWheel->xNow) <= TIMER_WHEEL_PASSED)
+        {
+                /* Skip the ticks with nothing to do. */
+                xNext = (pxWheel->uxRunning > 0) ? prvNextTick(pxWheel) : xNow + 1;
+                if ((xNext - pxWheel->xNow) > (xNow - pxWheel->xNow))
+                {
+                        pxWheel->xNow = xNow + 1;
+                        break;
+                }
+                pxWheel->xNow = xNext;
+
+                for (uxLevel = 1; uxLevel < TIMER_WHEEL_LEVELS; uxLevel++)
+                {
+                        uxShift = TIMER_WHEEL_SLOT_BITS * uxLevel;
+
+                        if ((pxWheel->xNow & (((TickType_t)1U << uxShift) - 1)) != 0)
+                        {
+                                break;
+                        }
+
+                        prvCascade(pxWheel, uxLevel, (pxWheel->xNow >> uxShift) & TIMER_WHEEL_SLOT_MASK);
+                }
+
+                uxSlot = pxWheel->xNow & TIMER_WHEEL_SLOT_MASK;
+                pxExpired = pxWheel->pxSlots[0][uxSlot];
+                pxWheel->pxSlots[0][uxSlot] = NULL;
+                pxWheel->ullOccupied[0] &= ~((uint64_t)1U << uxSlot);
+                if (pxExpired != NULL)
+                {
+                        pxExpired->ppxPrev = &pxExpired;
+                }
+
+                /* Timers restarted by their callback go to the next tick. */
+                pxWheel->xNow++;
+
+                /* One at a time, the callbacks may stop or restart the timers
+                 * still on the list. */
+                while (pxExpired != NULL)
+                {
+                        pxTimer = pxExpired;
+                        prvUnlink(pxWheel, pxTimer);
+                        pxWheel->uxRunning--;
+
+                        taskEXIT_CRITICAL(&pxWheel->xLock);
+                        pxTimer->pxCallback(pxTimer->pvArgument);
+                        uxFired++;
+                        taskENTER_CRITICAL(&pxWheel->xLock);
+                }
+        }
+
+        taskEXIT_CRITICAL(&pxWheel->xLock);
+
+        return uxFired;
+}
+
+TickType_t xTimerWheelTicksToNext(timerWheel_t *pxWheel, TickType_t xNow)
+{
+        TickType_t xTicks = portMAX_DELAY;
+
+        taskENTER_CRITICAL(&pxWheel->xLock);
+
+        if (pxWheel->uxRunning > 0)
+        {
+                xTicks = prvNextTick(pxWheel) - xNow;
+                if (xTicks > TIMER_WHEEL_PASSED)
+                {
+                        xTicks = 0;
+                }
+        }
+
+        taskEXIT_CRITICAL(&pxWheel->xLock);
+
+        return xTicks;
+}
@@ -27,6 +27,7 @@
 #include "esp_event.h"
 #include "esp_system.h"
 #include "esp_event_base.h"
+#include "esp_timer.h"
 #include "netif/wlanif.h"
 #include "esp_private/wifi.h"
 
@@ -55,6 +56,58 @@ static int s_retry_num = 0;
 
 BaseType_t event_loop_inited = pdFALSE;
 
+/* Contiguous copy of a chained frame for the driver. Only the task that
+ * drains the TX ring (see xIsCallingFromIPCPTxTask()) transmits, so a single
+ * buffer is enough. */
+static uint8_t ucTxGatherBuffer[MTU + sizeof(EthernetHeader_t)];
+
+/* Frames queued by xNetworkInterfaceEnqueue() for the IPCP task, or the TX
+ * task of the pipeline. A drain event is pending from the first frame queued
+ * by another task until that task finds the ring empty, so a burst of frames
+ * costs a single event. Frames it queues itself need no event, they are
+ * flushed at the end of the event being processed. */
+static NetworkBufferDescriptor_t *pxTxRing[NETWORK_INTERFACE_TX_RING];
+static int64_t llTxRingQueuedUs[NETWORK_INTERFACE_TX_RING];
+static UBaseType_t uxTxRingHead = 0;
+static UBaseType_t uxTxRingCount = 0;
+static BaseType_t xTxDrainPending = pdFALSE;
+static portMUX_TYPE xTxRingLock = portMUX_INITIALIZER_UNLOCKED;
+static NetworkInterfaceTxStats_t xTxStats;
+static volatile BaseType_t xTxDirect = NETWORK_INTERFACE_TX_DIRECT;
+static BaseType_t xTxStopped = pdFALSE;
+static void (*pxTxResumeHook)(void *pvArgument) = NULL;
+static void *pvTxResumeArgument = NULL;
+
+static BaseType_t prvTxPostDrain(void);
+static void prvTxSendBatch(NetworkBufferDescriptor_t **ppxBatch, UBaseType_t uxCount);
+
+/* Received frames are wrapped in the driver buffer instead of copied. */
+static volatile BaseType_t xRxZeroCopy = NETWORK_INTERFACE_RX_ZERO_COPY;
+
+#if (USE_LINKED_RX_MESSAGES != 0)
+/* Frames received but not yet handed to the IPCP task, chained through
+ * pxNextBuffer, and the number of bursts the task has not finished yet. */
+static NetworkBufferDescriptor_t *pxRxBurstHead = NULL;
+static NetworkBufferDescriptor_t *pxRxBurstTail = NULL;
+static UBaseType_t uxRxBurstLength = 0;
+static UBaseType_t uxRxBurstsInFlight = 0;
+static portMUX_TYPE xRxBurstLock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Posting is serialised so bursts reach the IPCP task in order. */
+static SemaphoreHandle_t xRxPostMutex = NULL;
+static esp_timer_handle_t xRxHoldTimer = NULL;
+
+static volatile UBaseType_t uxRxBurst = NETWORK_INTERFACE_RX_BURST;
+static volatile uint32_t ulRxHoldUs = NETWORK_INTERFACE_RX_HOLD_US;
+/* Set by a flush that found another one posting, for that one to run again. */
+static BaseType_t xRxFlushAgain = pdFALSE;
+
+static BaseType_t prvRxBurstAppend(NetworkBufferDescriptor_t *pxNetworkBuffer);
+static BaseType_t prvRxBurstFlush(void);
+static BaseType_t prvRxBurstPost(void);
+static void prvRxHoldTimerCallback(void *pvArgument);
+#endif
+
 esp_err_t xNetworkInterfaceInput(void *buffer, uint16_t len, void *eb);
 
 //NetworkBufferDescriptor_t * pxNetworkBuffer;
@@ -106,6 +159,25 @@ BaseType_t xNetworkInterfaceInitialise(const MACAddress_t *pxPhyDev)
 	ESP_LOGI(TAG_WIFI, "%s", __func__);
 	 uint8_t ucMACAddress[ MAC_ADDRESS_LENGTH_BYTES ];
 
+#if (USE_LINKED_RX_MESSAGES != 0)
+	if (xRxPostMutex == NULL)
+	{
+		const esp_timer_create_args_t xHoldTimerArgs = {
+			.callback = prvRxHoldTimerCallback,
+			.arg = NULL,
+			.dispatch_method = ESP_TIMER_TASK,
+			.name = "rx_hold"};
+
+		xRxPostMutex = xSemaphoreCreateMutex();
+
+		if ((xRxPostMutex == NULL) || (esp_timer_create(&xHoldTimerArgs, &xRxHoldTimer) != ESP_OK))
+		{
+			ESP_LOGE(TAG_WIFI, "Failed to create the RX burst timer");
+			return pdFALSE;
+		}
+	}
+#endif
+
 	esp_efuse_mac_get_default(ucMACAddress);
 	vARPUpdateMACAddress(ucMACAddress, pxPhyDev); 
 	return pdTRUE;
@@ -242,6 +314,8 @@ BaseType_t xNetworkInterfaceOutput(NetworkBufferDescriptor_t *const pxNetworkBuf
 	}
 
 	esp_err_t ret;
+	uint8_t *pucFrame = pxNetworkBuffer->pucEthernetBuffer;
+	size_t uxFrameLength = pxNetworkBuffer->xDataLength;
 
 	if (xInterfaceState == INTERFACE_DOWN)
 	{
@@ -250,12 +324,19 @@ BaseType_t xNetworkInterfaceOutput(NetworkBufferDescriptor_t *const pxNetworkBuf
 	}
 	else
 	{
+		/* The driver takes one contiguous frame, so a chained frame is
+		 * gathered here and only here. */
+		if (pxNetworkBuffer->pxNextSegment != NULL)
+		{
+			pucFrame = ucTxGatherBuffer;
+			uxFrameLength = uxNetworkBufferGather(pxNetworkBuffer, ucTxGatherBuffer, sizeof(ucTxGatherBuffer));
+		}
 
-		ret = esp_wifi_internal_tx(ESP_IF_WIFI_STA, pxNetworkBuffer->pucEthernetBuffer, pxNetworkBuffer->xDataLength);
+		ret = esp_wifi_internal_tx(ESP_IF_WIFI_STA, pucFrame, uxFrameLength);
 
 		if (ret != ESP_OK)
 		{
-			ESP_LOGE(TAG_WIFI, "Failed to tx buffer %p, len %d, err %d", pxNetworkBuffer->pucEthernetBuffer, pxNetworkBuffer->xDataLength, ret);
+			ESP_LOGE(TAG_WIFI, "Failed to tx buffer %p, len %d, err %d", pucFrame, uxFrameLength, ret);
 		}
 		else
 		{
@@ -272,6 +353,281 @@ BaseType_t xNetworkInterfaceOutput(NetworkBufferDescriptor_t *const pxNetworkBuf
 	return ret == ESP_OK ? pdTRUE : pdFALSE;
 }
 
+/* Wakes the IPCP task to drain the ring. On failure the pending flag is
+ * cleared, so the frames left in the ring are picked up by the next
+ * xNetworkInterfaceEnqueue(). */
+static BaseType_t prvTxPostDrain(void)
+{
+	RINAStackEvent_t xTxEvent = {eNetworkTxEvent, NULL};
+
+	BaseType_t xPosted = xSendEventStructToIPCPTask(&xTxEvent, 0);
+
+	taskENTER_CRITICAL(&xTxRingLock);
+	if (xPosted == pdPASS)
+	{
+		xTxStats.ulDrainEvents++;
+	}
+	else
+	{
+		xTxDrainPending = pdFALSE;
+	}
+	taskEXIT_CRITICAL(&xTxRingLock);
+
+	return (xPosted == pdPASS) ? pdTRUE : pdFALSE;
+}
+
+/* Queues as many of the frames as fit, under one critical section. Sets
+ * *pxPost if the IPCP task has to be woken to drain them. */
+static UBaseType_t prvTxRingPut(NetworkBufferDescriptor_t **ppxBuffers, UBaseType_t uxCount,
+								BaseType_t xDirect, int64_t llNowUs, BaseType_t *pxPost)
+{
+	UBaseType_t uxQueued = 0;
+	UBaseType_t uxTail;
+
+	taskENTER_CRITICAL(&xTxRingLock);
+	{
+		while ((uxQueued < uxCount) && (uxTxRingCount < NETWORK_INTERFACE_TX_RING))
+		{
+			uxTail = (uxTxRingHead + uxTxRingCount) % NETWORK_INTERFACE_TX_RING;
+
+			pxTxRing[uxTail] = ppxBuffers[uxQueued++];
+			llTxRingQueuedUs[uxTail] = llNowUs;
+			uxTxRingCount++;
+		}
+
+		xTxStats.ulQueued += uxQueued;
+
+		if ((uxQueued > 0) && (xDirect == pdFALSE) && (xTxDrainPending == pdFALSE))
+		{
+			xTxDrainPending = pdTRUE;
+			*pxPost = pdTRUE;
+		}
+	}
+	taskEXIT_CRITICAL(&xTxRingLock);
+
+	return uxQueued;
+}
+
+UBaseType_t uxNetworkInterfaceEnqueueBatch(NetworkBufferDescriptor_t **ppxBuffers, UBaseType_t uxCount)
+{
+	BaseType_t xPost = pdFALSE;
+	BaseType_t xDirect = (xTxDirect != pdFALSE) ? xIsCallingFromIPCPTxTask() : pdFALSE;
+	int64_t llNowUs = esp_timer_get_time();
+	UBaseType_t uxQueued;
+	UBaseType_t x;
+
+	uxQueued = prvTxRingPut(ppxBuffers, uxCount, xDirect, llNowUs, &xPost);
+
+	/* The IPCP task makes room by sending what is queued rather than drop
+	 * its own frames. */
+	if ((uxQueued < uxCount) && (xDirect != pdFALSE))
+	{
+		vNetworkInterfaceTxDrain();
+		uxQueued += prvTxRingPut(&ppxBuffers[uxQueued], uxCount - uxQueued, xDirect, llNowUs, &xPost);
+	}
+
+	if (uxQueued < uxCount)
+	{
+		taskENTER_CRITICAL(&xTxRingLock);
+		xTxStats.ulRingFull += uxCount - uxQueued;
+		taskEXIT_CRITICAL(&xTxRingLock);
+
+		ESP_LOGE(TAG_WIFI, "TX ring full, dropping %u frames", (unsigned)(uxCount - uxQueued));
+
+		for (x = uxQueued; x < uxCount; x++)
+		{
+			vReleaseNetworkBufferAndDescriptor(ppxBuffers[x]);
+		}
+	}
+
+	if (xPost != pdFALSE)
+	{
+		(void)prvTxPostDrain();
+	}
+
+	return uxQueued;
+}
+
+BaseType_t xNetworkInterfaceEnqueue(NetworkBufferDescriptor_t *pxNetworkBuffer)
+{
+	return (uxNetworkInterfaceEnqueueBatch(&pxNetworkBuffer, 1) == 1) ? pdTRUE : pdFALSE;
+}
+
+/* Hands a batch to the driver in order and releases it. On the host port,
+ * which has a batch hook, contiguous frames go to the backend together and
+ * a chained frame is gathered and sent on its own; the ESP32 driver takes
+ * one frame per esp_wifi_internal_tx() call. */
+static void prvTxSendBatch(NetworkBufferDescriptor_t **ppxBatch, UBaseType_t uxCount)
+{
+	UBaseType_t x;
+
+#ifdef HOST_WIFI_TX_BATCH_HOOK
+	HostWifiTxFrame_t xFrames[NETWORK_INTERFACE_TX_BURST];
+	size_t uxFrames = 0;
+
+	for (x = 0; x <= uxCount; x++)
+	{
+		BaseType_t xChained = (x < uxCount) && (ppxBatch[x]->pxNextSegment != NULL);
+
+		if ((uxFrames > 0) && ((x == uxCount) || (xChained != pdFALSE)))
+		{
+			xTxStats.ulDriverCalls++;
+
+			if ((xInterfaceState == INTERFACE_DOWN) ||
+				(uxHostWifiTxBatch(ESP_IF_WIFI_STA, xFrames, uxFrames) != uxFrames))
+			{
+				ESP_LOGE(TAG_WIFI, "Failed to tx a batch of %d frames", (int)uxFrames);
+			}
+
+			uxFrames = 0;
+		}
+
+		if (x == uxCount)
+		{
+			break;
+		}
+
+		if (xChained != pdFALSE)
+		{
+			xTxStats.ulDriverCalls++;
+			(void)xNetworkInterfaceOutput(ppxBatch[x], pdFALSE);
+		}
+		else
+		{
+			xFrames[uxFrames].pvBuffer = ppxBatch[x]->pucEthernetBuffer;
+			xFrames[uxFrames].usLength = (uint16_t)ppxBatch[x]->xDataLength;
+			uxFrames++;
+		}
+	}
+
+	for (x = 0; x < uxCount; x++)
+	{
+		vReleaseNetworkBufferAndDescriptor(ppxBatch[x]);
+	}
+#else
+	for (x = 0; x < uxCount; x++)
+	{
+		xTxStats.ulDriverCalls++;
+		(void)xNetworkInterfaceOutput(ppxBatch[x], pdTRUE);
+	}
+#endif /* HOST_WIFI_TX_BATCH_HOOK */
+}
+
+void vNetworkInterfaceTxDrain(void)
+{
+	NetworkBufferDescriptor_t *pxBatch[NETWORK_INTERFACE_TX_BURST];
+	UBaseType_t uxCount;
+	UBaseType_t uxBudget = NETWORK_INTERFACE_TX_RING;
+	BaseType_t xMore;
+	BaseType_t xResume;
+	int64_t llNowUs;
+	uint32_t ulDelayUs;
+
+	for (;;)
+	{
+		uxCount = 0;
+		llNowUs = esp_timer_get_time();
+
+		taskENTER_CRITICAL(&xTxRingLock);
+		{
+			while ((uxTxRingCount > 0) && (uxCount < NETWORK_INTERFACE_TX_BURST) && (uxBudget > 0))
+			{
+				ulDelayUs = (uint32_t)(llNowUs - llTxRingQueuedUs[uxTxRingHead]);
+				xTxStats.ullDelayUs += ulDelayUs;
+
+				if (ulDelayUs > xTxStats.ulMaxDelayUs)
+				{
+					xTxStats.ulMaxDelayUs = ulDelayUs;
+				}
+
+				pxBatch[uxCount++] = pxTxRing[uxTxRingHead];
+				uxTxRingHead = (uxTxRingHead + 1) % NETWORK_INTERFACE_TX_RING;
+				uxTxRingCount--;
+				uxBudget--;
+			}
+
+			xMore = (uxTxRingCount > 0) ? pdTRUE : pdFALSE;
+
+			if ((uxCount == 0) && (xMore == pdFALSE))
+			{
+				xTxDrainPending = pdFALSE;
+			}
+		}
+		taskEXIT_CRITICAL(&xTxRingLock);
+
+		if (uxCount == 0)
+		{
+			break;
+		}
+
+		prvTxSendBatch(pxBatch, uxCount);
+	}
+
+	taskENTER_CRITICAL(&xTxRingLock);
+	xResume = ((xTxStopped != pdFALSE) && (uxTxRingCount <= NETWORK_INTERFACE_TX_LOW_WATER)) ? pdTRUE : pdFALSE;
+	if (xResume != pdFALSE)
+	{
+		xTxStopped = pdFALSE;
+	}
+	taskEXIT_CRITICAL(&xTxRingLock);
+
+	if ((xResume != pdFALSE) && (pxTxResumeHook != NULL))
+	{
+		pxTxResumeHook(pvTxResumeArgument);
+	}
+
+	/* A sender that kept the ring busy for a whole ring worth of frames gets
+	 * the rest drained by a new event, after the other events queued. */
+	if (xMore != pdFALSE)
+	{
+		(void)prvTxPostDrain();
+	}
+}
+
+void vNetworkInterfaceTxFlush(void)
+{
+	if (uxTxRingCount > 0)
+	{
+		vNetworkInterfaceTxDrain();
+	}
+}
+
+BaseType_t xNetworkInterfaceTxStop(void)
+{
+	BaseType_t xStop;
+
+	taskENTER_CRITICAL(&xTxRingLock);
+	xStop = (uxTxRingCount >= NETWORK_INTERFACE_TX_HIGH_WATER) ? pdTRUE : pdFALSE;
+	if ((xStop != pdFALSE) && (xTxStopped == pdFALSE))
+	{
+		xTxStopped = pdTRUE;
+		xTxStats.ulStops++;
+	}
+	taskEXIT_CRITICAL(&xTxRingLock);
+
+	return xStop;
+}
+
+void vNetworkInterfaceSetTxResumeHook(void (*pxHook)(void *pvArgument), void *pvArgument)
+{
+	taskENTER_CRITICAL(&xTxRingLock);
+	pxTxResumeHook = pxHook;
+	pvTxResumeArgument = pvArgument;
+	taskEXIT_CRITICAL(&xTxRingLock);
+}
+
+void vNetworkInterfaceSetTxDirect(BaseType_t xDirect)
+{
+	xTxDirect = (xDirect != pdFALSE) ? pdTRUE : pdFALSE;
+}
+
+void vNetworkInterfaceGetTxStats(NetworkInterfaceTxStats_t *pxStats)
+{
+	taskENTER_CRITICAL(&xTxRingLock);
+	*pxStats = xTxStats;
+	taskEXIT_CRITICAL(&xTxRingLock);
+}
+
 BaseType_t xNetworkInterfaceDisconnect(void)
 {
 
@@ -288,7 +644,6 @@ esp_err_t xNetworkInterfaceInput(void *buffer, uint16_t len, void *eb)
 {
 	NetworkBufferDescriptor_t *pxNetworkBuffer;
 	RINAStackEvent_t xRxEvent = {eNetworkRxEvent, NULL};
-	const TickType_t xDescriptorWaitTime = pdMS_TO_TICKS(250);
 
 	if (eConsiderFrameForProcessing(buffer) != eProcessBuffer)
 	{
@@ -297,38 +652,236 @@ esp_err_t xNetworkInterfaceInput(void *buffer, uint16_t len, void *eb)
 		return ESP_OK;
 	}
 
-	pxNetworkBuffer = pxGetNetworkBufferWithDescriptor(len, xDescriptorWaitTime);
-	//ESP_LOGE(TAG_WIFI,"xNetworkInterfaceInput Taking buffer to copy wifidriver buffer");
+	/* Called from the driver: never block, take a buffer from the reserved
+	 * pool or drop the frame (counted by the buffer management). */
+	if (xRxZeroCopy != pdFALSE)
+	{
+		/* The driver buffer goes back to the driver when the stack releases
+		 * the network buffer. */
+		pxNetworkBuffer = pxNetworkBufferWrapFromISR((uint8_t *)buffer, len,
+													 esp_wifi_internal_free_rx_buffer, eb);
+	}
+	else
+	{
+		pxNetworkBuffer = pxNetworkBufferGetFromISR(len);
+
+		if (pxNetworkBuffer != NULL)
+		{
+			/* Set the packet size, in case a larger buffer was returned. */
+			pxNetworkBuffer->xDataLength = len;
+
+			/* Copy the packet data. */
+			memcpy(pxNetworkBuffer->pucEthernetBuffer, buffer, len);
+			esp_wifi_internal_free_rx_buffer(eb);
+		}
+	}
 
 	if (pxNetworkBuffer != NULL)
 	{
+#if (USE_LINKED_RX_MESSAGES != 0)
+		(void)xRxEvent;
 
-		/* Set the packet size, in case a larger buffer was returned. */
-		pxNetworkBuffer->xDataLength = len;
-
-		/* Copy the packet data. */
-		memcpy(pxNetworkBuffer->pucEthernetBuffer, buffer, len);
+		if (prvRxBurstAppend(pxNetworkBuffer) == pdFAIL)
+		{
+			ESP_LOGE(TAG_WIFI, "Failed to enqueue packet to network stack %p, len %d", buffer, len);
+			return ESP_FAIL;
+		}
+#else
 		xRxEvent.pvData = (void *)pxNetworkBuffer;
 
-		if (xSendEventStructToIPCPTask(&xRxEvent, xDescriptorWaitTime) == pdFAIL)
+		if (xSendEventStructToIPCPTask(&xRxEvent, 0) == pdFAIL)
 		{
 			ESP_LOGE(TAG_WIFI, "Failed to enqueue packet to network stack %p, len %d", buffer, len);
 			vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
 			return ESP_FAIL;
 		}
+#endif
 
-		esp_wifi_internal_free_rx_buffer(eb);
 		return ESP_OK;
 	}
 
 	else
 	{
-		ESP_LOGE(TAG_WIFI, "Failed to get buffer descriptor");
-		vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+		ESP_LOGD(TAG_WIFI, "No ISR buffer available, frame dropped");
+		esp_wifi_internal_free_rx_buffer(eb);
 		return ESP_FAIL;
 	}
 }
 
+void vNetworkInterfaceSetRxZeroCopy(BaseType_t xZeroCopy)
+{
+	xRxZeroCopy = (xZeroCopy != pdFALSE) ? pdTRUE : pdFALSE;
+}
+
+#if (USE_LINKED_RX_MESSAGES != 0)
+
+void vNetworkInterfaceSetRxBurst(UBaseType_t uxBurst, uint32_t ulHoldUs)
+{
+	uxRxBurst = (uxBurst > 0) ? uxBurst : 1;
+	ulRxHoldUs = ulHoldUs;
+}
+
+/* Chains a received frame and hands the burst over when the IPCP task is
+ * idle or the burst is complete. Returns pdFAIL if the burst the frame
+ * ended up in could not be posted, in which case it has been released. */
+static BaseType_t prvRxBurstAppend(NetworkBufferDescriptor_t *pxNetworkBuffer)
+{
+	BaseType_t xPost;
+	BaseType_t xFirst;
+
+	pxNetworkBuffer->pxNextBuffer = NULL;
+
+	taskENTER_CRITICAL(&xRxBurstLock);
+	{
+		if (pxRxBurstTail == NULL)
+		{
+			pxRxBurstHead = pxNetworkBuffer;
+		}
+		else
+		{
+			pxRxBurstTail->pxNextBuffer = pxNetworkBuffer;
+		}
+
+		pxRxBurstTail = pxNetworkBuffer;
+		uxRxBurstLength++;
+
+		xFirst = (uxRxBurstLength == 1) ? pdTRUE : pdFALSE;
+		xPost = ((uxRxBurstsInFlight == 0) || (uxRxBurstLength >= uxRxBurst) || (ulRxHoldUs == 0)) ? pdTRUE : pdFALSE;
+	}
+	taskEXIT_CRITICAL(&xRxBurstLock);
+
+	if (xPost != pdFALSE)
+	{
+		return prvRxBurstFlush();
+	}
+
+	if (xFirst != pdFALSE)
+	{
+		/* Fails harmlessly if a concurrent flush already armed it for a
+		 * newer burst. */
+		(void)esp_timer_start_once(xRxHoldTimer, ulRxHoldUs);
+	}
+
+	return pdPASS;
+}
+
+/* Posts the pending burst, if any, to the IPCP task as one event. Never
+ * blocks: if another flush is posting, the burst is left to it. */
+static BaseType_t prvRxBurstFlush(void)
+{
+	BaseType_t xReturn;
+
+	if (xSemaphoreTake(xRxPostMutex, 0) != pdPASS)
+	{
+		__atomic_store_n(&xRxFlushAgain, pdTRUE, __ATOMIC_SEQ_CST);
+
+		/* The holder may have looked at the flag before it was set. */
+		if (xSemaphoreTake(xRxPostMutex, 0) != pdPASS)
+		{
+			return pdPASS;
+		}
+	}
+
+	for (;;)
+	{
+		__atomic_store_n(&xRxFlushAgain, pdFALSE, __ATOMIC_SEQ_CST);
+
+		xReturn = prvRxBurstPost();
+
+		(void)xSemaphoreGive(xRxPostMutex);
+
+		if ((__atomic_load_n(&xRxFlushAgain, __ATOMIC_SEQ_CST) == pdFALSE) ||
+			(xSemaphoreTake(xRxPostMutex, 0) != pdPASS))
+		{
+			break;
+		}
+	}
+
+	return xReturn;
+}
+
+/* Called with xRxPostMutex held, so bursts are posted in order. */
+static BaseType_t prvRxBurstPost(void)
+{
+	RINAStackEvent_t xRxEvent = {eNetworkRxEvent, NULL};
+	NetworkBufferDescriptor_t *pxBurst;
+	NetworkBufferDescriptor_t *pxNext;
+	BaseType_t xReturn = pdPASS;
+
+	/* Disarm first: a frame chained after the take below starts a new
+	 * burst and arms the timer again. */
+	(void)esp_timer_stop(xRxHoldTimer);
+
+	taskENTER_CRITICAL(&xRxBurstLock);
+	{
+		pxBurst = pxRxBurstHead;
+		pxRxBurstHead = NULL;
+		pxRxBurstTail = NULL;
+		uxRxBurstLength = 0;
+
+		if (pxBurst != NULL)
+		{
+			uxRxBurstsInFlight++;
+		}
+	}
+	taskEXIT_CRITICAL(&xRxBurstLock);
+
+	if (pxBurst != NULL)
+	{
+		xRxEvent.pvData = (void *)pxBurst;
+
+		if (xSendEventStructToIPCPTask(&xRxEvent, 0) == pdFAIL)
+		{
+			taskENTER_CRITICAL(&xRxBurstLock);
+			uxRxBurstsInFlight--;
+			taskEXIT_CRITICAL(&xRxBurstLock);
+
+			while (pxBurst != NULL)
+			{
+				pxNext = pxBurst->pxNextBuffer;
+				pxBurst->pxNextBuffer = NULL;
+				vReleaseNetworkBufferAndDescriptor(pxBurst);
+				pxBurst = pxNext;
+			}
+
+			xReturn = pdFAIL;
+		}
+	}
+
+	return xReturn;
+}
+
+static void prvRxHoldTimerCallback(void *pvArgument)
+{
+	(void)pvArgument;
+	(void)prvRxBurstFlush();
+}
+
+void vNetworkInterfaceRxBurstDone(void)
+{
+	BaseType_t xPending;
+
+	taskENTER_CRITICAL(&xRxBurstLock);
+	{
+		if (uxRxBurstsInFlight > 0)
+		{
+			uxRxBurstsInFlight--;
+		}
+
+		xPending = ((uxRxBurstsInFlight == 0) && (pxRxBurstHead != NULL)) ? pdTRUE : pdFALSE;
+	}
+	taskEXIT_CRITICAL(&xRxBurstLock);
+
+	/* The task is about to go idle: the frames held for a fuller burst need
+	 * not wait any longer. */
+	if (xPending != pdFALSE)
+	{
+		(void)prvRxBurstFlush();
+	}
+}
+
+#endif /* USE_LINKED_RX_MESSAGES */
+
 void vNetworkNotifyIFDown()
 {
 	RINAStackEvent_t xRxEvent = {eNetworkDownEvent, NULL};
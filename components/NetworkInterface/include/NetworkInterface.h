@@ -23,6 +23,63 @@ extern "C"
     BaseType_t xNetworkInterfaceDisconnect(void);
     esp_err_t xNetworkInterfaceInput(void *buffer, uint16_t len, void *eb);
 
+    /* Queue a frame for the IPCP task (the TX task with IPCP_USE_PIPELINE)
+     * to send, see NETWORK_INTERFACE_TX_RING. Never blocks. The buffer is owned by the interface from here on; it is
+     * released at once, and pdFALSE returned, if the ring is full. */
+    BaseType_t xNetworkInterfaceEnqueue(NetworkBufferDescriptor_t *pxNetworkBuffer);
+
+    /* Same for uxCount frames, with one critical section and at most one
+     * wake-up of the IPCP task for the whole batch. Returns the frames
+     * queued; the others have been released. */
+    UBaseType_t uxNetworkInterfaceEnqueueBatch(NetworkBufferDescriptor_t **ppxBuffers, UBaseType_t uxCount);
+
+    /* Called by the IPCP task on an eNetworkTxEvent without a buffer. */
+    void vNetworkInterfaceTxDrain(void);
+
+    /* Called by the IPCP task after every event, sends the frames it queued
+     * itself while handling the event. */
+    void vNetworkInterfaceTxFlush(void);
+
+    /* Called by a writer after xNetworkInterfaceEnqueue(). Returns pdTRUE if
+     * the ring has reached NETWORK_INTERFACE_TX_HIGH_WATER and the writer
+     * should stop, the resume hook is then called once the ring is drained
+     * down to NETWORK_INTERFACE_TX_LOW_WATER. */
+    BaseType_t xNetworkInterfaceTxStop(void);
+
+    /* The function called, from the context draining the ring, when the
+     * writers stopped by xNetworkInterfaceTxStop() can write again. */
+    void vNetworkInterfaceSetTxResumeHook(void (*pxHook)(void *pvArgument), void *pvArgument);
+
+    /* Change NETWORK_INTERFACE_TX_DIRECT at run time. */
+    void vNetworkInterfaceSetTxDirect(BaseType_t xDirect);
+
+    typedef struct xNETWORK_INTERFACE_TX_STATS
+    {
+        uint32_t ulQueued;      /* Frames accepted by xNetworkInterfaceEnqueue(). */
+        uint32_t ulRingFull;    /* Frames dropped because the ring was full. */
+        uint32_t ulDrainEvents; /* eNetworkTxEvent posted to drain the ring. */
+        uint32_t ulDriverCalls; /* Transmit calls into the driver. */
+        uint32_t ulStops;       /* Times the writers were asked to stop. */
+        uint32_t ulMaxDelayUs;  /* Longest time a frame waited in the ring. */
+        uint64_t ullDelayUs;    /* Time all the frames sent waited in the ring. */
+    } NetworkInterfaceTxStats_t;
+
+    void vNetworkInterfaceGetTxStats(NetworkInterfaceTxStats_t *pxStats);
+
+    /* Select how received frames reach the stack: copied into a pool buffer
+     * (pdFALSE) or wrapped in place in the driver buffer (pdTRUE). The
+     * default is NETWORK_INTERFACE_RX_ZERO_COPY. */
+    void vNetworkInterfaceSetRxZeroCopy(BaseType_t xZeroCopy);
+
+#if (USE_LINKED_RX_MESSAGES != 0)
+    /* Change NETWORK_INTERFACE_RX_BURST and NETWORK_INTERFACE_RX_HOLD_US at
+     * run time. A hold time of 0 posts every frame on its own. */
+    void vNetworkInterfaceSetRxBurst(UBaseType_t uxBurst, uint32_t ulHoldUs);
+
+    /* Called by the IPCP task once it has processed a burst. */
+    void vNetworkInterfaceRxBurstDone(void);
+#endif
+
     /* The following function is defined only when BufferAllocation_1.c is linked in the project. */
     void vNetworkInterfaceAllocateRAMToBuffers(NetworkBufferDescriptor_t pxNetworkBuffers[NUM_NETWORK_BUFFER_DESCRIPTORS]);
 
@@ -15,12 +15,121 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
 
 #include "BufferManagement.h"
 #include "configSensor.h"
 #include "common.h"
 #include "esp_log.h"
 #include "RINA_API.h"
+#include "IPCP.h"
+#include "du.h"
+
+/* Ports bound to the applications, with the SDUs received on them. */
+typedef struct xRINA_FLOW
+{
+    portId_t xPortId;
+    QueueHandle_t xRxQueue;
+} rinaFlow_t;
+
+static rinaFlow_t xRinaFlows[RINA_FLOWS_MAX];
+
+/* Ports allocated by remote applications, waiting for RINA_flow_accept(). */
+static QueueHandle_t xAcceptQueue = NULL;
+
+static BaseType_t prvRINA_DuEnqueue(struct ipcpInstanceData_t *pxData, portId_t xPortId, struct du_t *pxDu);
+
+static struct ipcpInstanceOps_t xRinaUserOps = {
+    .duEnqueue = prvRINA_DuEnqueue,
+};
+
+/* The applications as seen by the normal IPCP: the user of the ports they
+ * allocate or accept. */
+static ipcpInstance_t xRinaUserInstance = {
+    .pxData = NULL,
+    .pxOps = &xRinaUserOps,
+};
+
+static rinaFlow_t *prvRINA_FindFlow(portId_t xPortId)
+{
+    UBaseType_t x;
+
+    for (x = 0; x < RINA_FLOWS_MAX; x++)
+    {
+        if (xRinaFlows[x].xRxQueue != NULL && xRinaFlows[x].xPortId == xPortId)
+        {
+            return &xRinaFlows[x];
+        }
+    }
+
+    return NULL;
+}
+
+/* Called by the RX path, it must not block: the SDU is dropped when the
+ * application does not keep up. */
+static BaseType_t prvRINA_DuEnqueue(struct ipcpInstanceData_t *pxData, portId_t xPortId, struct du_t *pxDu)
+{
+    rinaFlow_t *pxFlow;
+
+    (void)pxData;
+
+    pxFlow = prvRINA_FindFlow(xPortId);
+
+    if (pxFlow == NULL || xQueueSendToBack(pxFlow->xRxQueue, &pxDu->pxNetworkBuffer, 0) != pdPASS)
+    {
+        ESP_LOGW(TAG_RINA, "Dropping SDU for port %d", xPortId);
+        xDuDestroy(pxDu);
+        return pdFALSE;
+    }
+
+    /* The buffer now belongs to the queue. */
+    pxDu->pxNetworkBuffer = NULL;
+    xDuDestroy(pxDu);
+
+    return pdTRUE;
+}
+
+ipcpInstance_t *pxRINA_UserInstance(void)
+{
+    return &xRinaUserInstance;
+}
+
+void vRINA_FlowsInit(void)
+{
+    if (xAcceptQueue == NULL)
+    {
+        xAcceptQueue = xQueueCreate(RINA_FLOWS_MAX, sizeof(portId_t));
+    }
+}
+
+BaseType_t xRINA_FlowBound(portId_t xPortId, BaseType_t xIncoming)
+{
+    UBaseType_t x;
+
+    for (x = 0; x < RINA_FLOWS_MAX; x++)
+    {
+        if (xRinaFlows[x].xRxQueue == NULL)
+        {
+            xRinaFlows[x].xPortId = xPortId;
+            xRinaFlows[x].xRxQueue = xQueueCreate(RINA_FLOW_RX_QUEUE_LENGTH, sizeof(NetworkBufferDescriptor_t *));
+            break;
+        }
+    }
+
+    if (x == RINA_FLOWS_MAX || xRinaFlows[x].xRxQueue == NULL)
+    {
+        ESP_LOGE(TAG_RINA, "No room to bind port %d", xPortId);
+        return pdFALSE;
+    }
+
+    if (xIncoming && xQueueSendToBack(xAcceptQueue, &xPortId, 0) != pdPASS)
+    {
+        ESP_LOGE(TAG_RINA, "Nobody accepts port %d", xPortId);
+        return pdFALSE;
+    }
+
+    return pdTRUE;
+}
 
 struct appRegistration_t *RINA_application_register(string_t pcNameDif, string_t pcLocalApp, uint8_t Flags);
 
@@ -81,23 +190,25 @@ struct appRegistration_t *RINA_application_register(string_t pcNameDif, string_t
 
 void xRINA_WeakUpUser(flowAllocateHandle_t *pxFlowAllocateResponse)
 {
+    EventBits_t xEventBits;
 
     if (!pxFlowAllocateResponse)
     {
         ESP_LOGE(TAG_RINA, "No Bits set");
+        return;
     }
 
-    if ((pxFlowAllocateResponse->xEventGroup != NULL) && (pxFlowAllocateResponse->xEventBits != 0U))
+    /* The user may go on as soon as the bits are set. */
+    xEventBits = pxFlowAllocateResponse->xEventBits;
+    pxFlowAllocateResponse->xEventBits = 0U;
+
+    if ((pxFlowAllocateResponse->xEventGroup != NULL) && (xEventBits != 0U))
     {
-        (void)xEventGroupSetBits(pxFlowAllocateResponse->xEventGroup, pxFlowAllocateResponse->xEventBits);
+        (void)xEventGroupSetBits(pxFlowAllocateResponse->xEventGroup, xEventBits);
     }
-
-    pxFlowAllocateResponse->xEventBits = 0U;
 }
 
-void RINA_flow_alloc(string_t pcNameDIF, string_t pcLocalApp, string_t pcRemoteApp, struct rinaFlowSpec_t *xFlowSpec, uint8_t Flags);
-
-void RINA_flow_alloc(string_t pcNameDIF, string_t pcLocalApp, string_t pcRemoteApp, struct rinaFlowSpec_t *xFlowSpec, uint8_t Flags)
+portId_t RINA_flow_alloc(string_t pcNameDIF, string_t pcLocalApp, string_t pcRemoteApp, struct rinaFlowSpec_t *xFlowSpec, uint8_t Flags)
 {
     portId_t xPortId; /* PortId to return to the user*/
     RINAStackEvent_t xStackFlowAllocateEvent = {eStackFlowAllocateEvent, NULL};
@@ -125,7 +236,7 @@ void RINA_flow_alloc(string_t pcNameDIF, string_t pcLocalApp, string_t pcRemoteA
     {
         vPortFree(pxFlowAllocateRequest);
         vPortFree(pxFlowSpecTmp);
-        //return -1;
+        return -1;
     }
     else
     {
@@ -171,12 +282,15 @@ void RINA_flow_alloc(string_t pcNameDIF, string_t pcLocalApp, string_t pcRemoteA
         }*/
 
         pxRemoteName = pvPortMalloc(sizeof(*pxRemoteName));
+        memset(pxRemoteName, 0, sizeof(*pxRemoteName));
         pxRemoteName->pcProcessName = strdup(pcRemoteApp);
 
         pxLocalName = pvPortMalloc(sizeof(*pxLocalName));
+        memset(pxLocalName, 0, sizeof(*pxLocalName));
         pxLocalName->pcProcessName = strdup(pcLocalApp);
 
         pxDIFName = pvPortMalloc(sizeof(*pxDIFName));
+        memset(pxDIFName, 0, sizeof(*pxDIFName));
         pxDIFName->pcProcessName = strdup(pcNameDIF);
 
 
@@ -230,38 +344,67 @@ void RINA_flow_alloc(string_t pcNameDIF, string_t pcLocalApp, string_t pcRemoteA
             if (xSendEventStructToIPCPTask(&xStackFlowAllocateEvent, (TickType_t)0U) == pdFAIL)
             {
                 ESP_LOGE(TAG_RINA, "IPCP Task not working properly");
-                //return -1;
+                return -1;
             }
-            #if 0
             else
             {
-                /* The IP-task will set the 'eFLOW_BOUND' bit when it has done its
-             * job. */
-
-              (void)xEventGroupWaitBits(pxFlowAllocateRequest->xEventGroup, (EventBits_t)eFLOW_BOUND, pdTRUE /*xClearOnExit*/, pdFALSE /*xWaitAllBits*/, portMAX_DELAY);
-
-               ESP_LOGE(TAG_RINA, "TEST OK:%d",pxFlowAllocateRequest->xPortId);
+                /* The IPCP task sets the 'eFLOW_BOUND' bit when the flow
+                 * allocator is done, with xPortId -1 if it failed. */
+                (void)xEventGroupWaitBits(pxFlowAllocateRequest->xEventGroup, (EventBits_t)eFLOW_BOUND, pdTRUE /*xClearOnExit*/, pdFALSE /*xWaitAllBits*/, portMAX_DELAY);
 
-                /*Check if the flow was bound*/
-                /* if (!socketSOCKET_IS_BOUND(pxSocket))
-                {
-                    xReturn = -pdFREERTOS_ERRNO_EINVAL;
-                }*/
-              return pxFlowAllocateRequest->xPortId;
+                return pxFlowAllocateRequest->xPortId;
             }
-            #endif
-           // return pxFlowAllocateRequest->xPortId;
         }
     }
 
-    //return -1;
+    return -1;
+}
+
+portId_t RINA_flow_accept(struct appRegistration_t *xAppRegistration, string_t pcRemoteApp, struct rinaFlowSpec_t *xFlowSpec, uint8_t Flags)
+{
+    portId_t xPortId;
+
+    (void)xAppRegistration;
+    (void)pcRemoteApp;
+    (void)xFlowSpec;
+    (void)Flags;
+
+    if (xAcceptQueue == NULL || xQueueReceive(xAcceptQueue, &xPortId, portMAX_DELAY) != pdPASS)
+    {
+        return -1;
+    }
+
+    return xPortId;
+}
+
+BaseType_t RINA_flow_read(portId_t xPortId, void *pvBuffer, size_t uxBufferLength)
+{
+    NetworkBufferDescriptor_t *pxNetworkBuffer;
+    rinaFlow_t *pxFlow;
+    size_t uxLength;
+
+    pxFlow = prvRINA_FindFlow(xPortId);
+
+    if (pxFlow == NULL)
+    {
+        return -1;
+    }
+
+    if (xQueueReceive(pxFlow->xRxQueue, &pxNetworkBuffer, FLOW_DEFAULT_RECEIVE_BLOCK_TIME) != pdPASS)
+    {
+        return 0;
+    }
+
+    uxLength = uxNetworkBufferGather(pxNetworkBuffer, (uint8_t *)pvBuffer, uxBufferLength);
+    vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+
+    return (BaseType_t)uxLength;
 }
 
 BaseType_t RINA_flow_write(portId_t xPortId, void *pvBuffer, size_t uxTotalDataLength);
 BaseType_t RINA_flow_write(portId_t xPortId, void *pvBuffer, size_t uxTotalDataLength)
 {
     NetworkBufferDescriptor_t *pxNetworkBuffer;
-    void *pvCopyDest;
     TimeOut_t xTimeOut;
     TickType_t xTicksToWait;
     RINAStackEvent_t xStackTxEvent = {eStackTxEvent, NULL};
@@ -277,12 +420,13 @@ BaseType_t RINA_flow_write(portId_t xPortId, void *pvBuffer, size_t uxTotalDataL
 
         vTaskSetTimeOutState(&xTimeOut);
 
-        pxNetworkBuffer = pxGetNetworkBufferWithDescriptor(uxTotalDataLength, xTicksToWait); //sizeof length DataUser packet.
+        /* The SDU is chained over several smaller buffers when no single
+         * buffer large enough is free. */
+        pxNetworkBuffer = pxGetNetworkBufferChain(uxTotalDataLength, xTicksToWait); //sizeof length DataUser packet.
 
         if (pxNetworkBuffer != NULL)
         {
-            pvCopyDest = (void *)&pxNetworkBuffer->pucEthernetBuffer;
-            (void)memcpy(pvCopyDest, pvBuffer, uxTotalDataLength);
+            (void)uxNetworkBufferScatter(pxNetworkBuffer, (const uint8_t *)pvBuffer, uxTotalDataLength);
 
             if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdTRUE)
             {
@@ -293,9 +437,8 @@ BaseType_t RINA_flow_write(portId_t xPortId, void *pvBuffer, size_t uxTotalDataL
 
         if (pxNetworkBuffer != NULL)
         {
-            /*Fill the pxNetworkBuffer descriptor properly*/
-            pxNetworkBuffer->xDataLength = uxTotalDataLength;
-
+            /* The port the SDU is written to travels with the buffer. */
+            pxNetworkBuffer->ulBoundPort = xPortId;
             xStackTxEvent.pvData = pxNetworkBuffer;
 
             if (xSendEventStructToIPCPTask(&xStackTxEvent, xTicksToWait) == pdPASS)
@@ -2,10 +2,10 @@
 #include <string.h>
 
 /* FreeRTOS includes. */
-#include "Freertos/FreeRTOS.h"
-#include "Freertos/task.h"
-#include "Freertos/queue.h"
-#include "Freertos/semphr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 #include "IPCP.h"
 #include "common.h"
@@ -17,6 +17,7 @@
 #include "Ribd.h"
 #include "configSensor.h"
 #include "Rib.h"
+#include "FlowAllocator.h"
 
 #include "esp_log.h"
 
@@ -46,9 +47,11 @@ struct ribObject_t *pxRibFindObject(string_t ucRibObjectName)
 
     BaseType_t x = 0;
     struct ribObject_t *pxRibObject;
-    pxRibObject = pvPortMalloc(sizeof(*pxRibObject));
-
 
+    if (ucRibObjectName == NULL)
+    {
+        return NULL;
+    }
 
         for (x = 0; x < RIB_TABLE_SIZE; x++)
 
@@ -77,7 +80,10 @@ struct ribObject_t *pxRibCreateObject(string_t ucObjName, long ulObjInst,
     struct ribObject_t *pxObj = pvPortMalloc(sizeof(*pxObj));
     struct ribObjOps_t *pxObjOps = pvPortMalloc(sizeof(*pxObjOps));
 
+    memset(pxObjOps, 0, sizeof(*pxObjOps));
+
     pxObj->ucObjName = ucObjName;
+    pxObj->ucObjClass = ucObjClass;
     pxObj->ulObjInst = ulObjInst;
     pxObj->ucDisplayableValue = ucDisplayableValue;
 
@@ -92,7 +98,7 @@ struct ribObject_t *pxRibCreateObject(string_t ucObjName, long ulObjInst,
         break;
 
     case FLOW_ALLOCATOR:
-        //M_create
+        pxObj->pxObjOps->create = xFlowAllocatorHandleCreate;
         //M_Delete
         //M_write
 
@@ -2,10 +2,10 @@
 #include <string.h>
 
 /* FreeRTOS includes. */
-#include "Freertos/FreeRTOS.h"
-#include "Freertos/task.h"
-#include "Freertos/queue.h"
-#include "Freertos/semphr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 #include "IPCP.h"
 #include "common.h"
@@ -18,6 +18,7 @@
 #include "configSensor.h"
 #include "Rib.h"
 #include "RINA_API.h"
+#include "FlowAllocator.h"
 
 #include "esp_log.h"
 
@@ -96,7 +97,6 @@ struct ribCallbackOps_t *pxRibdFindPendingResponseHandler(int32_t invokeID)
 
     BaseType_t x = 0;
     struct ribCallbackOps_t *pxCb;
-    pxCb = pvPortMalloc(sizeof(*pxCb));
 
     for (x = 0; x < RESPONSE_HANDLER_TABLE_SIZE; x++)
 
@@ -110,6 +110,9 @@ struct ribCallbackOps_t *pxRibdFindPendingResponseHandler(int32_t invokeID)
                 pxCb = xPendingResponseHandlersTable[x].pxCallbackHandler;
                 ESP_LOGI(TAG_IPCPMANAGER, "Cb Handler founded '%p'", pxCb);
 
+                /* A request gets a single response. */
+                xPendingResponseHandlersTable[x].xValid = pdFALSE;
+
                 return pxCb;
                 break;
             }
@@ -191,6 +194,13 @@ messageCdap_t *prvRibdFillDecodeMessage(rina_messages_CDAPMessage message)
 
     pxMessageCdap = pvPortMalloc(sizeof(*pxMessageCdap));
 
+    /* Fields missing from the message must read as NULL. */
+    memset(pxMessageCdap, 0, sizeof(*pxMessageCdap));
+    memset(pxDestinationInfo, 0, sizeof(*pxDestinationInfo));
+    memset(pxSourceInfo, 0, sizeof(*pxSourceInfo));
+    memset(pxAuthPolicy, 0, sizeof(*pxAuthPolicy));
+    pxMessageCdap->objInst = -1;
+
     pxMessageCdap->pxDestinationInfo = pxDestinationInfo;
     pxMessageCdap->pxSourceInfo = pxSourceInfo;
     pxMessageCdap->pxAuthPolicy = pxAuthPolicy;
@@ -470,7 +480,6 @@ appConnection_t *pxRibdFindAppConnection(portId_t xPortId)
 
     BaseType_t x = 0;
     appConnection_t *pxAppConnection;
-    pxAppConnection = pvPortMalloc(sizeof(*pxAppConnection));
 
     for (x = 0; x < APP_CONNECTION_TABLE_SIZE; x++)
 
@@ -492,6 +501,12 @@ appConnection_t *pxRibdFindAppConnection(portId_t xPortId)
 
 void vRibdPrintCdapMessage(messageCdap_t *pxDecodeCdap);
 
+/* Names decoded from a CDAP message may lack any of their parts. */
+static string_t prvRibdStrdup(string_t pcString)
+{
+    return pcString ? strdup(pcString) : NULL;
+}
+
 appConnection_t *prvRibCreateConnection(name_t *pxSource, name_t *pxDestInfo)
 
 {
@@ -503,14 +518,14 @@ appConnection_t *prvRibCreateConnection(name_t *pxSource, name_t *pxDestInfo)
     pxAppConnectionTmp->pxSourceInfo = pxSourceInfo;
 
     pxAppConnectionTmp->uCdapVersion = 0x01;
-    pxAppConnectionTmp->pxSourceInfo->pcEntityInstance = strdup(pxSource->pcEntityInstance);
-    pxAppConnectionTmp->pxSourceInfo->pcEntityName = strdup(pxSource->pcEntityName);
-    pxAppConnectionTmp->pxSourceInfo->pcProcessInstance = strdup(pxSource->pcProcessInstance);
-    pxAppConnectionTmp->pxSourceInfo->pcEntityInstance = strdup(pxSource->pcProcessName);
-    pxAppConnectionTmp->pxDestinationInfo->pcEntityInstance = strdup(pxDestInfo->pcEntityInstance);
-    pxAppConnectionTmp->pxDestinationInfo->pcEntityName = strdup(pxDestInfo->pcEntityName);
-    pxAppConnectionTmp->pxDestinationInfo->pcProcessInstance = strdup(pxDestInfo->pcProcessInstance);
-    pxAppConnectionTmp->pxDestinationInfo->pcEntityInstance = strdup(pxDestInfo->pcProcessName);
+    pxAppConnectionTmp->pxSourceInfo->pcEntityInstance = prvRibdStrdup(pxSource->pcEntityInstance);
+    pxAppConnectionTmp->pxSourceInfo->pcEntityName = prvRibdStrdup(pxSource->pcEntityName);
+    pxAppConnectionTmp->pxSourceInfo->pcProcessInstance = prvRibdStrdup(pxSource->pcProcessInstance);
+    pxAppConnectionTmp->pxSourceInfo->pcProcessName = prvRibdStrdup(pxSource->pcProcessName);
+    pxAppConnectionTmp->pxDestinationInfo->pcEntityInstance = prvRibdStrdup(pxDestInfo->pcEntityInstance);
+    pxAppConnectionTmp->pxDestinationInfo->pcEntityName = prvRibdStrdup(pxDestInfo->pcEntityName);
+    pxAppConnectionTmp->pxDestinationInfo->pcProcessInstance = prvRibdStrdup(pxDestInfo->pcProcessInstance);
+    pxAppConnectionTmp->pxDestinationInfo->pcProcessName = prvRibdStrdup(pxDestInfo->pcProcessName);
     pxAppConnectionTmp->xStatus = eCONNECTION_IN_PROGRESS;
     pxAppConnectionTmp->uRibVersion = 0x01;
 
@@ -742,17 +757,29 @@ BaseType_t vRibHandleMessage(messageCdap_t *pxDecodeCdap, portId_t xN1FlowPortId
         /*If App Connection is not registered, create a new one*/
         if (pxAppConnectionTmp == NULL)
         {
-            /*Check that the OpCode is a M_Connect*/
-            if (pxDecodeCdap->eOpCode != M_CONNECT)
-            {
-                ESP_LOGE(TAG_RIB, "Error wrong opCode in cdap PDU");
-                vPortFree(pxDecodeCdap);
-            }
+            name_t xLocalName = {
+                .pcProcessName = NORMAL_PROCESS_NAME,
+                .pcProcessInstance = NORMAL_PROCESS_INSTANCE,
+                .pcEntityName = MANAGEMENT_AE,
+                .pcEntityInstance = NORMAL_ENTITY_INSTANCE,
+            };
+
+            pxAppConnectionTmp = prvRibCreateConnection(&xLocalName, pxDecodeCdap->pxSourceInfo);
+            vRibdAddAppConnectionEntry(pxAppConnectionTmp, xN1FlowPortId);
+        }
 
-            // TODO: Create Connection and add into the table
-            // Call to the xEnrollmentHandleConnect
+        if (pxAppConnectionTmp->pxDestinationInfo->pcProcessName == NULL)
+        {
+            ESP_LOGE(TAG_RIB, "M_CONNECT without a source process name");
+            return pdFALSE;
         }
 
+        pxAppConnectionTmp->xStatus = eCONNECTED;
+
+        /*Call to Enrollment Handle Connect, it answers the M_CONNECT*/
+        xEnrollmentHandleConnect(pxAppConnectionTmp->pxDestinationInfo->pcProcessName,
+                                 pxDecodeCdap->invokeID, xN1FlowPortId);
+
         break;
 
     case M_CONNECT_R:
@@ -761,7 +788,7 @@ BaseType_t vRibHandleMessage(messageCdap_t *pxDecodeCdap, portId_t xN1FlowPortId
          * 2. Call to the Enrollment Handle ConnectR
          */
         /* Check if the current AppConnection status is in progress */
-        if (pxAppConnectionTmp->xStatus != eCONNECTION_IN_PROGRESS)
+        if (pxAppConnectionTmp == NULL || pxAppConnectionTmp->xStatus != eCONNECTION_IN_PROGRESS)
         {
             ESP_LOGE(TAG_RIB, "Invalid AppConnection State");
             return pdTRUE;
@@ -797,15 +824,48 @@ BaseType_t vRibHandleMessage(messageCdap_t *pxDecodeCdap, portId_t xN1FlowPortId
         break;
 
     case M_CREATE:
-        /* Calling the Create function of the enrollment object to create a Neighbor object and
-         * add into the RibObject table
+        /* An object that creates its own instances, as the flows of the
+         * flow allocator, handles the request. Otherwise the Create function
+         * of the enrollment object creates a Neighbor object and add into
+         * the RibObject table
          */
+        if (pxRibObject != NULL && pxRibObject->pxObjOps->create != NULL)
+        {
+            if (pxAppConnectionTmp == NULL)
+            {
+                ESP_LOGE(TAG_RIB, "M_CREATE without an application connection");
+                return pdFALSE;
+            }
+
+            pxRibObject->pxObjOps->create(pxRibObject, pxDecodeCdap->pxObjValue, pxAppConnectionTmp->pxDestinationInfo->pcProcessName,
+                                          pxAppConnectionTmp->pxSourceInfo->pcProcessName, pxDecodeCdap->invokeID, xN1FlowPortId);
+            break;
+        }
 
         pxRibCreateObject(pxDecodeCdap->pcObjName, pxDecodeCdap->objInst, pxDecodeCdap->pcObjName, pxDecodeCdap->pcObjClass, ENROLLMENT);
         break;
 
+    case M_CREATE_R:
+        /* Looking for a pending request */
+        pxCallback = pxRibdFindPendingResponseHandler(pxDecodeCdap->invokeID);
+
+        if (pxCallback == NULL || pxCallback->create_response == NULL)
+        {
+            ESP_LOGE(TAG_RIB, "No pending request for invoke id %d", pxDecodeCdap->invokeID);
+            return pdFALSE;
+        }
+
+        pxCallback->create_response(pxDecodeCdap->pxObjValue, pxDecodeCdap->result);
+
+        break;
+
     case M_STOP:
         configASSERT(pxRibObject != NULL);
+        if (pxAppConnectionTmp == NULL || pxRibObject->pxObjOps->stop == NULL)
+        {
+            ESP_LOGE(TAG_RIB, "M_STOP cannot be handled");
+            return pdFALSE;
+        }
         pxRibObject->pxObjOps->stop(pxRibObject, pxDecodeCdap->pxObjValue, pxAppConnectionTmp->pxDestinationInfo->pcProcessName,
                                     pxAppConnectionTmp->pxSourceInfo->pcProcessName, pxDecodeCdap->invokeID, xN1FlowPortId);
         break;
@@ -814,6 +874,11 @@ BaseType_t vRibHandleMessage(messageCdap_t *pxDecodeCdap, portId_t xN1FlowPortId
 
         configASSERT(pxRibObject != NULL);
         configASSERT(pxDecodeCdap->pxObjValue != NULL);
+        if (pxAppConnectionTmp == NULL || pxRibObject->pxObjOps->start == NULL)
+        {
+            ESP_LOGE(TAG_RIB, "M_START cannot be handled");
+            return pdFALSE;
+        }
         pxRibObject->pxObjOps->start(pxRibObject, pxDecodeCdap->pxObjValue, pxAppConnectionTmp->pxDestinationInfo->pcProcessName,
                                      pxAppConnectionTmp->pxSourceInfo->pcProcessName, pxDecodeCdap->invokeID, xN1FlowPortId);
         break;
@@ -822,6 +887,12 @@ BaseType_t vRibHandleMessage(messageCdap_t *pxDecodeCdap, portId_t xN1FlowPortId
         /* Looking for a pending request */
         pxCallback = pxRibdFindPendingResponseHandler(pxDecodeCdap->invokeID);
 
+        if (pxCallback == NULL || pxCallback->start_response == NULL || pxAppConnectionTmp == NULL)
+        {
+            ESP_LOGE(TAG_RIB, "No pending request for invoke id %d", pxDecodeCdap->invokeID);
+            return pdFALSE;
+        }
+
         pxCallback->start_response(pxAppConnectionTmp->pxDestinationInfo->pcProcessName, pxDecodeCdap->pxObjValue);
 
         break;
@@ -829,6 +900,12 @@ BaseType_t vRibHandleMessage(messageCdap_t *pxDecodeCdap, portId_t xN1FlowPortId
         /* Looking for a pending request */
         pxCallback = pxRibdFindPendingResponseHandler(pxDecodeCdap->invokeID);
 
+        if (pxCallback == NULL || pxCallback->stop_response == NULL || pxAppConnectionTmp == NULL)
+        {
+            ESP_LOGE(TAG_RIB, "No pending request for invoke id %d", pxDecodeCdap->invokeID);
+            return pdFALSE;
+        }
+
         pxCallback->stop_response(pxAppConnectionTmp->pxDestinationInfo->pcProcessName);
 
         break;
@@ -849,7 +926,7 @@ BaseType_t vRibHandleMessage(messageCdap_t *pxDecodeCdap, portId_t xN1FlowPortId
 
             pxDIFName->pcProcessName = "irati";
             pxLocalName->pcProcessName = "Test";
-            pxRemoteName->pcProcessName = "ar1.mobile";
+            pxRemoteName->pcProcessName = REMOTE_ADDRESS_AP_NAME;
             pxFlowAllocateRequest->pxDifName = pxDIFName;
             pxFlowAllocateRequest->pxLocal = pxLocalName;
             pxFlowAllocateRequest->pxRemote = pxRemoteName;
@@ -886,15 +963,19 @@ BaseType_t xRibdSendResponse(string_t pcObjClass, string_t pcObjName, long objIn
     {
 
     case M_START_R:
+    case M_CREATE_R:
         pxMsgCdap = prvRibdFillEnrollMsgStart(pcObjClass, pcObjName, objInst, eOpCode, pxObjVal,
                                               result, pcResultReason, invokeId);
+        break;
+
     case M_STOP_R:
         pxMsgCdap = prvRibdFillEnrollMsgStop(pcObjClass, pcObjName, objInst, eOpCode, pxObjVal,
                                              result, pcResultReason, invokeId);
         break;
 
     default:
-        break;
+        ESP_LOGE(TAG_RIB, "Can't send response with mesg type %s", opcodeNamesTable[eOpCode]);
+        return pdFALSE;
     }
 
     /* Generate and Encode Message M_CONNECT*/
@@ -912,6 +993,43 @@ BaseType_t xRibdSendResponse(string_t pcObjClass, string_t pcObjName, long objIn
     return pdTRUE;
 }
 
+BaseType_t xRibdSendConnectResponse(int invokeId, portId_t xN1Port)
+{
+    appConnection_t *pxAppConnection;
+    messageCdap_t *pxMsgCdap;
+    NetworkBufferDescriptor_t *pxNetworkBuffer;
+
+    pxAppConnection = pxRibdFindAppConnection(xN1Port);
+    if (pxAppConnection == NULL)
+    {
+        ESP_LOGE(TAG_RIB, "No application connection on port %d", xN1Port);
+        return pdFALSE;
+    }
+
+    pxMsgCdap = prvRibMessageCdapInit();
+
+    /* Names are swapped: the enrollee learns the name of this IPCP. */
+    pxMsgCdap->eOpCode = M_CONNECT_R;
+    pxMsgCdap->invokeID = invokeId;
+    pxMsgCdap->pxSourceInfo->pcProcessName = pxAppConnection->pxSourceInfo->pcProcessName;
+    pxMsgCdap->pxSourceInfo->pcProcessInstance = pxAppConnection->pxSourceInfo->pcProcessInstance;
+    pxMsgCdap->pxDestinationInfo->pcProcessName = pxAppConnection->pxDestinationInfo->pcProcessName;
+    pxMsgCdap->pxDestinationInfo->pcProcessInstance = pxAppConnection->pxDestinationInfo->pcProcessInstance;
+
+    pxNetworkBuffer = prvRibdEncodeCDAP(pxMsgCdap);
+
+    if (!pxNetworkBuffer)
+    {
+        ESP_LOGE(TAG_RINA, "Error encoding CDAP message");
+        return pdFALSE;
+    }
+
+    /*Sent to the IPCP task*/
+    vRibdSentCdapMsg(pxNetworkBuffer, xN1Port);
+
+    return pdTRUE;
+}
+
 BaseType_t xRibdSendRequest(string_t pcObjClass, string_t pcObjName, long objInst,
                             opCode_t eOpCode, portId_t xN1flowPortId, serObjectValue_t *pxObjVal)
 {
@@ -927,6 +1045,7 @@ BaseType_t xRibdSendRequest(string_t pcObjClass, string_t pcObjName, long objIns
         break;
 
     case M_STOP:
+    case M_CREATE:
         pxMsgCdap = prvRibdFillEnrollMsg(pcObjClass, pcObjName, objInst, eOpCode, pxObjVal);
 
         break;
@@ -960,6 +1079,8 @@ struct ribCallbackOps_t *pxRibdCreateCdapCallback(opCode_t xOpCode, int invoke_i
 {
     struct ribCallbackOps_t *pxCallback = pvPortMalloc(sizeof(*pxCallback));
 
+    memset(pxCallback, 0, sizeof(*pxCallback));
+
     switch (xOpCode)
     {
     case M_START:
@@ -972,7 +1093,7 @@ struct ribCallbackOps_t *pxRibdCreateCdapCallback(opCode_t xOpCode, int invoke_i
 
     case M_CREATE:
         /*FLow Allocator*/
-
+        pxCallback->create_response = xFlowAllocatorHandleCreateR;
         break;
 
     default:
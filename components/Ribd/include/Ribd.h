@@ -110,6 +110,9 @@ BaseType_t xRibdProcessLayerManagementPDU(struct ipcpInstanceData_t *pxData, por
 BaseType_t xRibdSendRequest(string_t pcObjClass, string_t pcObjName, long objInst,
                             opCode_t eMsgType, portId_t n1_port, serObjectValue_t *pxObjVal);
 
+/* M_CONNECT_R over the application connection of xN1Port. */
+BaseType_t xRibdSendConnectResponse(int invokeId, portId_t xN1Port);
+
 BaseType_t xRibdSendResponse(string_t pcObjClass, string_t pcObjName, long objInst,
                              int result, string_t pcResultReason,
                              opCode_t eOpCode, int invokeId, portId_t xN1Port,
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 
 /* FreeRTOS includes. */
 #include "freertos/FreeRTOS.h"
@@ -13,11 +14,11 @@
 #include "du.h"
 #include "IPCP.h"
 #include "pci.h"
+#include "rmtPs.h"
+#include "BufferManagement.h"
 //#include "EFCP.h"
 
-/** @brief RMT Array PortId Created.
- *  */
-static portTableEntry_t xPortIdTable[ 2 ];
+#define N1PMAP_BUCKET(xId)	((UBaseType_t)(xId) & (RMT_N1_PORT_MAP_BUCKETS - 1))
 
 
 pci_t * vCastPointerTo_pci_t(void * pvArgument);
@@ -27,7 +28,7 @@ BaseType_t xRmtReceive ( rmt_t * pxRmt, struct du_t * pxDu, portId_t xFrom );
 
 
 /* @brief Called when a SDU arrived into the RMT from the EFCP Container*/
-static int xRmtN1PortWriteDu(rmt_t * pxRmt, rmtN1Port_t * pxN1Port, struct du_t * pxDu);
+static BaseType_t xRmtN1PortWriteDu(rmt_t * pxRmt, rmtN1Port_t * pxN1Port, struct du_t * pxDu);
 
 /* @brief Create an N-1 Port in the RMT Component*/
 static rmtN1Port_t * pxRmtN1PortCreate(portId_t xId, ipcpInstance_t * pxN1Ipcp);
@@ -49,9 +50,12 @@ static rmtN1Port_t * pxRmtN1PortCreate(portId_t xId, ipcpInstance_t * pxN1Ipcp)
 	pxTmp->eState   = eN1_PORT_STATE_ENABLED;
 
 
+	pxTmp->pvRmtPsQueues = NULL;
+	pxTmp->pxNextInBucket = NULL;
 	pxTmp->uxBusy = pdFALSE;
 	pxTmp->xStats.plen = 0;
 	pxTmp->xStats.dropPdus = 0;
+	pxTmp->xStats.ecnPdus = 0;
 	pxTmp->xStats.errPdus = 0;
 	pxTmp->xStats.txPdus = 0;
 	pxTmp->xStats.txBytes = 0;
@@ -65,7 +69,96 @@ static rmtN1Port_t * pxRmtN1PortCreate(portId_t xId, ipcpInstance_t * pxN1Ipcp)
 	return pxTmp;
 }
 
-/* @brief Bind the N-1 Port with the RMT. SDUP and RMT Policies are not considered.�
+static void vRmtN1PortDestroy(rmt_t * pxRmt, rmtN1Port_t * pxN1Port)
+{
+	pxRmt->pxPs->rmtQDestroyPolicy(pxRmt, pxN1Port);
+
+	ESP_LOGI(TAG_RMT, "N-1 port %pK destroyed (port-id = %d)", pxN1Port, pxN1Port->xPortId);
+
+	vPortFree(pxN1Port);
+}
+
+/* @brief Create the map of the N-1 ports bound to the RMT */
+static n1pmap_t * pxN1pmapCreate(void)
+{
+	n1pmap_t * pxMap;
+	UBaseType_t uxBucket;
+
+	pxMap = pvPortMalloc(sizeof(*pxMap));
+	if (!pxMap)
+		return NULL;
+
+	for (uxBucket = 0; uxBucket < RMT_N1_PORT_MAP_BUCKETS; uxBucket++)
+		pxMap->pxBuckets[uxBucket] = NULL;
+
+	pxMap->pxDefault = NULL;
+	pxMap->uxPorts = 0;
+
+	return pxMap;
+}
+
+/* @brief Find the N-1 port bound with the port-id, NULL if there is none */
+static rmtN1Port_t * pxN1pmapFind(n1pmap_t * pxMap, portId_t xId)
+{
+	rmtN1Port_t * pxN1Port;
+
+	for (pxN1Port = pxMap->pxBuckets[N1PMAP_BUCKET(xId)];
+	     pxN1Port != NULL;
+	     pxN1Port = pxN1Port->pxNextInBucket)
+	{
+		if (pxN1Port->xPortId == xId)
+			return pxN1Port;
+	}
+
+	return NULL;
+}
+
+static void vN1pmapAdd(n1pmap_t * pxMap, rmtN1Port_t * pxN1Port)
+{
+	rmtN1Port_t ** ppxBucket = &pxMap->pxBuckets[N1PMAP_BUCKET(pxN1Port->xPortId)];
+
+	pxN1Port->pxNextInBucket = *ppxBucket;
+	*ppxBucket = pxN1Port;
+	pxMap->uxPorts++;
+
+	if (!pxMap->pxDefault)
+		pxMap->pxDefault = pxN1Port;
+}
+
+/* @brief Take the N-1 port bound with the port-id out of the map */
+static rmtN1Port_t * pxN1pmapRemove(n1pmap_t * pxMap, portId_t xId)
+{
+	rmtN1Port_t ** ppxLink;
+	rmtN1Port_t * pxN1Port;
+	UBaseType_t uxBucket;
+
+	for (ppxLink = &pxMap->pxBuckets[N1PMAP_BUCKET(xId)];
+	     *ppxLink != NULL;
+	     ppxLink = &(*ppxLink)->pxNextInBucket)
+	{
+		if ((*ppxLink)->xPortId == xId)
+			break;
+	}
+
+	pxN1Port = *ppxLink;
+	if (!pxN1Port)
+		return NULL;
+
+	*ppxLink = pxN1Port->pxNextInBucket;
+	pxN1Port->pxNextInBucket = NULL;
+	pxMap->uxPorts--;
+
+	/* Any port left takes over as the default one */
+	if (pxMap->pxDefault == pxN1Port) {
+		pxMap->pxDefault = NULL;
+		for (uxBucket = 0; uxBucket < RMT_N1_PORT_MAP_BUCKETS && !pxMap->pxDefault; uxBucket++)
+			pxMap->pxDefault = pxMap->pxBuckets[uxBucket];
+	}
+
+	return pxN1Port;
+}
+
+/* @brief Bind the N-1 Port with the RMT. SDUP is not considered.
  * It is called from the IPCP normal when a Flow is required to be bounded. From the
  * IPCP normal is send the RMT instance, the portId from the Shim, and Shim Instance */
 BaseType_t xRmtN1PortBind(rmt_t * pxRmtInstance, portId_t xId, ipcpInstance_t * pxN1Ipcp);
@@ -91,8 +184,8 @@ BaseType_t xRmtN1PortBind(rmt_t * pxRmtInstance, portId_t xId, ipcpInstance_t *
 		return pdFALSE;
 	}
 
-	if (!pxRmtInstance->pxN1Port) {
-		ESP_LOGE(TAG_RMT,"This RMT has already an N-1 Port binded ");
+	if (pxN1pmapFind(pxRmtInstance->pxN1Ports, xId)) {
+		ESP_LOGE(TAG_RMT,"This RMT has already an N-1 Port binded to port-id %d", xId);
 		return pdFALSE;
 	}
 
@@ -100,26 +193,14 @@ BaseType_t xRmtN1PortBind(rmt_t * pxRmtInstance, portId_t xId, ipcpInstance_t *
 	if (!pxTmp)
 		return pdFALSE;
 
-	/*
-	if (!ps || !ps->rmt_q_create_policy) {
-		rcu_read_unlock();
-		LOG_ERR("No PS in the RMT, can't bind");
-		n1_port_destroy(tmp);
-		return -1;
+	pxTmp->pvRmtPsQueues = pxRmtInstance->pxPs->rmtQCreatePolicy(pxRmtInstance, pxTmp);
+	if (!pxTmp->pvRmtPsQueues) {
+		ESP_LOGE(TAG_RMT,"Cannot create structs for scheduling policy");
+		vRmtN1PortDestroy(pxRmtInstance, pxTmp);
+		return pdFALSE;
 	}
 
-	tmp->rmt_ps_queues = ps->rmt_q_create_policy(ps, tmp);
-	rcu_read_unlock();
-
-	if (!tmp->rmt_ps_queues) {
-		LOG_ERR("Cannot create structs for scheduling policy");
-		n1_port_destroy(tmp);
-		return -1;
-	}*/
-
-	/*No added to the Hash Table because we've assumed there is only a flow in the shim DIF
-	 * Instead, it is aggregate to the PortIdArray with an unique member.*/
-	xPortIdTable[0].pxPortN1 = pxTmp;
+	vN1pmapAdd(pxRmtInstance->pxN1Ports, pxTmp);
 
 	ESP_LOGI(TAG_RMT,"Added send queue to rmt instance %pK for port-id %d",pxRmtInstance, xId);
 
@@ -130,70 +211,82 @@ BaseType_t xRmtN1PortBind(rmt_t * pxRmtInstance, portId_t xId, ipcpInstance_t *
 
 }
 
-/* @brief Add an Address into the RMT list. This list is useful when the
- * packet arrived and need to know whether it is for us or not. */
-
-
-BaseType_t xRmtAddressAdd(rmt_t * pxInstance, address_t xAddress)
+/* @brief Unbind the N-1 Port from the RMT when the flow in the N-1 DIF is
+ * deallocated. The PDUs queued on the port are dropped. */
+BaseType_t xRmtN1PortUnbind(rmt_t * pxRmtInstance, portId_t xId)
 {
-	rmtAddress_t * pxRmtAddr;
+	rmtN1Port_t * pxN1Port;
 
-	if (!pxInstance) {
+	if (!pxRmtInstance) {
 		ESP_LOGE(TAG_RMT,"Bogus instance passed");
 		return pdFALSE;
 	}
 
-	pxRmtAddr = pvPortMalloc(sizeof(*pxRmtAddr));
-	if (!pxRmtAddr)
+	pxN1Port = pxN1pmapRemove(pxRmtInstance->pxN1Ports, xId);
+	if (!pxN1Port) {
+		ESP_LOGE(TAG_RMT,"No N-1 port binded to port-id %d", xId);
 		return pdFALSE;
+	}
 
-	pxRmtAddr->xAddress = xAddress;
-
-	ESP_LOGE(TAG_RMT, "Adding and Address into the RMT list:%d", pxRmtAddr->xAddress);
-
-	vListInitialiseItem( &(pxRmtAddr->xAddressListItem) );
-	vListInsert(&pxInstance->xAddresses,&(pxRmtAddr->xAddressListItem));
+	vRmtN1PortDestroy(pxRmtInstance, pxN1Port);
 
 	return pdTRUE;
 }
 
-/* @brief Check if the Address defined in the PDU is stored in
- * the address list in the RMT.*/
-BaseType_t  xRmtPduIsAddressedToMe(rmt_t * pxRmt, address_t xAddress);
-
-BaseType_t  xRmtPduIsAddressedToMe(rmt_t * pxRmt, address_t xAddress)
+BaseType_t xRmtSelectPolicySet(rmt_t * pxRmtInstance, const char * pcName)
 {
+	const rmtPs_t * pxPs;
 
-	rmtAddress_t * pxAddr;
+	if (!pxRmtInstance) {
+		ESP_LOGE(TAG_RMT,"Bogus instance passed");
+		return pdFALSE;
+	}
 
-	ListItem_t * pxListItem, * pxNext;
-	ListItem_t  const * pxListEnd;
+	pxPs = pxRmtPsFind(pcName);
+	if (!pxPs) {
+		ESP_LOGE(TAG_RMT,"No RMT policy set called %s", pcName ? pcName : "(null)");
+		return pdFALSE;
+	}
 
-	pxAddr = pvPortMalloc(sizeof(*pxAddr));
+	/* The queues of the bound ports belong to the current one */
+	if (pxRmtInstance->pxN1Ports->uxPorts > 0 && pxPs != pxRmtInstance->pxPs) {
+		ESP_LOGE(TAG_RMT,"Cannot change the policy set with N-1 ports bound");
+		return pdFALSE;
+	}
 
-	/* Find a way to iterate in the list and compare the addesss*/
-	pxListEnd = listGET_END_MARKER( &pxRmt->xAddresses );
-	pxListItem = listGET_HEAD_ENTRY( &pxRmt->xAddresses );
+	pxRmtInstance->pxPs = pxPs;
 
+	ESP_LOGI(TAG_RMT,"Policy set %s selected", pxPs->pcName);
 
+	return pdTRUE;
+}
 
-	while ( pxListItem != pxListEnd )
-	{
-		
-		pxAddr = (rmtAddress_t *)listGET_LIST_ITEM_VALUE( pxListItem );
-		//ESP_LOGE(TAG_RMT, "Address to evalute: %d", pxAddr->xAddress);
-		if (pxAddr->xAddress == xAddress )
-		{
-			ESP_LOGI(TAG_RMT, "Address to me founded!");
-			return pdTRUE;
-		}
-		pxListItem = listGET_NEXT( pxListItem );;
+BaseType_t xRmtQosWeightSet(rmt_t * pxRmtInstance, qosId_t xQosId, uint8_t ucWeight)
+{
+	if (!pxRmtInstance || ucWeight == 0) {
+		ESP_LOGE(TAG_RMT,"Bogus input parameters");
+		return pdFALSE;
 	}
 
+	pxRmtInstance->ucWeights[xQosId] = ucWeight;
+
+	return pdTRUE;
+}
+
+/* @brief Add an Address into the RMT addresses. They are useful when the
+ * packet arrived and need to know whether it is for us or not. */
+BaseType_t xRmtAddressAdd(rmt_t * pxInstance, address_t xAddress)
+{
+	if (!pxInstance) {
+		ESP_LOGE(TAG_RMT,"Bogus instance passed");
+		return pdFALSE;
+	}
 
-	return pdFALSE;
+	ESP_LOGI(TAG_RMT, "Adding and Address into the RMT:%d", xAddress);
 
+	pxInstance->ulAddresses[xAddress / 32] |= (uint32_t)1U << (xAddress % 32);
 
+	return pdTRUE;
 }
 
 static BaseType_t xRmtProcessMgmtPdu(rmt_t * pxRmt, portId_t xPortId, struct du_t * pxDu);
@@ -253,7 +346,7 @@ static BaseType_t xRmtProcessDtPdu(rmt_t * pxRmt, portId_t xPortId, struct du_t
 		return pdFALSE;
 	}
 
-	if (xEfcpContainerReceive(pxRmt->pxEfcpc, xCepTmp, pxDu)) {
+	if (!xEfcpContainerReceive(pxRmt->pxEfcpc, xCepTmp, pxDu)) {
 		ESP_LOGE(TAG_RMT,"EFCP container problems");
 		return pdFALSE;
 	}
@@ -264,6 +357,45 @@ static BaseType_t xRmtProcessDtPdu(rmt_t * pxRmt, portId_t xPortId, struct du_t
 }
 
 
+static BaseType_t xRmtSendNextHops(rmt_t * pxRmtInstance, struct du_t * pxDu,
+				   const portId_t * pxNextHops, size_t uxNextHops);
+
+/* @brief Relay a decapsulated PDU that is not for this IPCP. The PCI has
+ * no hop count, so a PDU is never sent back out of the port it came in
+ * from: two neighbours routing a destination to each other would bounce
+ * it forever. */
+static BaseType_t xRmtForward(rmt_t * pxRmt, struct du_t * pxDu, portId_t xFrom)
+{
+	portId_t xNextHops[ PFF_MAX_NEXT_HOPS ];
+	size_t uxNextHops;
+	size_t i, j;
+
+	uxNextHops = uxPffNextHops(pxRmt->pxPff, pxDu->pxPci->xDestination,
+				   pxDu->pxPci->connectionId_t.xQosId, xNextHops, PFF_MAX_NEXT_HOPS);
+
+	for (i = 0, j = 0; i < uxNextHops; i++) {
+		if (xNextHops[i] != xFrom)
+			xNextHops[j++] = xNextHops[i];
+	}
+	uxNextHops = j;
+
+	if (uxNextHops == 0) {
+		ESP_LOGI(TAG_RMT, "PDU is not for me and there is no NHOP for it "
+			 "other than port-id %d", xFrom);
+		xDuDestroy(pxDu);
+		return pdFALSE;
+	}
+
+	/* The PCI is still in the headroom where it was received */
+	if (!pucNetworkBufferPush(pxDu->pxNetworkBuffer, sizeof(pci_t))) {
+		ESP_LOGE(TAG_RMT, "Could not put the PCI back to relay the PDU");
+		xDuDestroy(pxDu);
+		return pdFALSE;
+	}
+
+	return xRmtSendNextHops(pxRmt, pxDu, xNextHops, uxNextHops);
+}
+
 BaseType_t xRmtReceive (rmt_t * pxRmt, struct du_t * pxDu, portId_t xFrom)
 {
 
@@ -287,10 +419,10 @@ BaseType_t xRmtReceive (rmt_t * pxRmt, struct du_t * pxDu, portId_t xFrom)
 		return pdFALSE;
 	}
 
-	uxBytes = pxDu->pxNetworkBuffer->xDataLength;
+	uxBytes = xDuLen(pxDu);
 	pxDu->pxCfg = pxRmt->pxEfcpc->pxConfig;
 
-	pxN1Port = xPortIdTable[0].pxPortN1;
+	pxN1Port = pxN1pmapFind(pxRmt->pxN1Ports, xFrom);
 	if (!pxN1Port)
 	{
 		ESP_LOGE(TAG_RMT,"Could not retrieve N-1 port for the received PDU...");
@@ -340,7 +472,7 @@ BaseType_t xRmtReceive (rmt_t * pxRmt, struct du_t * pxDu, portId_t xFrom)
 	
 
 	/* pdu is for me */
-	if (xRmtPduIsAddressedToMe(pxRmt, xDstAddr))
+	if (xRmtAddressIsLocal(pxRmt, xDstAddr))
 	{
 		/* pdu is for me */
 		switch (xPduType)
@@ -372,16 +504,14 @@ BaseType_t xRmtReceive (rmt_t * pxRmt, struct du_t * pxDu, portId_t xFrom)
 		}
 
 	}
-	/* pdu is not for me. Then release buffer and destroy anything.
-	 * A forwarding to next hop will be consider in other version. */
+	/* pdu is not for me. Relay it to the next hops the PFF has for it,
+	 * or drop it if there is none. */
 	else
 	{
 		if (!xDstAddr)
 			return xRmtProcessMgmtPdu(pxRmt, xFrom, pxDu);
-		else{
-			ESP_LOGI(TAG_RMT, "PDU is not for me");
-			return pdFALSE;
-		}
+		else
+			return xRmtForward(pxRmt, pxDu, xFrom);
 
 	}
 }
@@ -394,76 +524,158 @@ static BaseType_t xRmtN1PortWriteDu(rmt_t * pxRmt,
 {
 	
 	BaseType_t ret;
-	ssize_t bytes = pxDu->pxNetworkBuffer->xDataLength;
 
 	ESP_LOGI(TAG_RMT,"Gonna send SDU to port-id %d", pxN1Port->xPortId);
 	ret = pxN1Port->pxN1Ipcp->pxOps->duWrite(pxN1Port->pxN1Ipcp->pxData,pxN1Port->xPortId, pxDu, false);
 	ESP_LOGI(TAG_RMT,"xRmtN1PortWriteDu ret:%d",ret);
 
-	if (!ret)
+	/* The N-1 IPCP owns the PDU even when it fails to write it. When it
+	 * can't take more it disables the port first, and the next PDUs wait
+	 * in the queues of the policy set. */
+	if (!ret) {
+		pxN1Port->xStats.dropPdus++;
 		return pdFALSE;
+	}
 
-	if (ret == pdFALSE) {
-		//n1_port_lock(n1_port);
-		if (pxN1Port->pxPendingDu)
-		{
-			ESP_LOGE(TAG_RMT,"Already a pending SDU present for port %d",
-					pxN1Port->xPortId);
-			xDuDestroy(pxN1Port->pxPendingDu);
-			pxN1Port->xStats.plen--;
+	return pdTRUE;
+}
+
+/* @brief Post an eRmtEgressEvent, unless one is waiting already */
+static void vRmtEgressSchedule(rmt_t * pxRmtInstance)
+{
+	RINAStackEvent_t xEvent = {eRmtEgressEvent, pxRmtInstance};
+
+	if (pxRmtInstance->xEgressPending)
+		return;
+
+	/* Set before posting: the worker may run, and clear it, before
+	 * xSendEventStructToIPCPTask returns. If it can't be posted now the
+	 * next PDU queued tries again. */
+	pxRmtInstance->xEgressPending = pdTRUE;
+	if (xSendEventStructToIPCPTask(&xEvent, 0) != pdPASS) {
+		pxRmtInstance->xEgressPending = pdFALSE;
+		ESP_LOGE(TAG_RMT,"Could not schedule the egress worker");
+	}
+}
+
+/* @brief Write up to uxBudget PDUs queued on the N-1 port, in the order the
+ * scheduler of the policy set gives them, while the port is enabled. */
+static void vRmtN1PortDrain(rmt_t * pxRmtInstance, rmtN1Port_t * pxN1Port, UBaseType_t uxBudget)
+{
+	struct du_t * pxDu;
+	size_t uxBytes;
+
+	/* Already writing further up the stack */
+	if (pxN1Port->uxBusy)
+		return;
+
+	pxN1Port->uxBusy = pdTRUE;
+
+	while (uxBudget-- > 0 && pxN1Port->eState != eN1_PORT_STATE_DISABLED) {
+		pxDu = pxRmtInstance->pxPs->rmtDequeuePolicy(pxRmtInstance, pxN1Port);
+		if (!pxDu)
+			break;
+
+		pxN1Port->xStats.plen--;
+
+		/* Marked by the AQM on its way out of this IPCP: the DTP that
+		 * sent it is here and slows down. */
+		if ((pxDu->pxPci->xFlags & PDU_FLAGS_EXPLICIT_CONGESTION) &&
+		    xRmtAddressIsLocal(pxRmtInstance, pxDu->pxPci->xSource))
+			vEfcpContainerCongestion(pxRmtInstance->pxEfcpc,
+						 pxDu->pxPci->connectionId_t.xSource);
+
+		uxBytes = xDuLen(pxDu);
+		if (xRmtN1PortWriteDu(pxRmtInstance, pxN1Port, pxDu)) {
+			stats_inc(tx, pxN1Port, uxBytes);
 		}
+	}
 
-		pxN1Port->pxPendingDu = pxDu;
-		pxN1Port->xStats.plen++;
-		ESP_LOGI(TAG_RMT,"xRmtN1PortWriteDu:Pending");
+	pxN1Port->uxBusy = pdFALSE;
+}
+
+void vRmtEgress(rmt_t * pxRmtInstance)
+{
+	rmtN1Port_t * pxN1Port;
+	UBaseType_t uxBucket;
+	BaseType_t xMore = pdFALSE;
 
-		if (pxN1Port->eState == eN1_PORT_STATE_DO_NOT_DISABLE)
+	pxRmtInstance->xEgressPending = pdFALSE;
+
+	for (uxBucket = 0; uxBucket < RMT_N1_PORT_MAP_BUCKETS; uxBucket++) {
+		for (pxN1Port = pxRmtInstance->pxN1Ports->pxBuckets[uxBucket];
+		     pxN1Port != NULL;
+		     pxN1Port = pxN1Port->pxNextInBucket)
 		{
-			pxN1Port->eState = eN1_PORT_STATE_ENABLED;
-			//tasklet_hi_schedule(&rmt->egress_tasklet);
-		} else
-			pxN1Port->eState = eN1_PORT_STATE_DISABLED;
+			if (!pxN1Port->xStats.plen)
+				continue;
+
+			vRmtN1PortDrain(pxRmtInstance, pxN1Port, RMT_EGRESS_BATCH);
 
-		//n1_port_unlock(n1_port);
+			if (pxN1Port->xStats.plen && pxN1Port->eState != eN1_PORT_STATE_DISABLED)
+				xMore = pdTRUE;
+		}
 	}
 
-	return pdTRUE;
+	/* The rest after the other events waiting */
+	if (xMore)
+		vRmtEgressSchedule(pxRmtInstance);
 }
 
-
-BaseType_t xRmtSendPortId(rmt_t * pxRmtInstance,
-		     portId_t xPortId,
-		     struct du_t * pxDu)
+BaseType_t xRmtDisableWrite(rmt_t * pxRmtInstance, portId_t xPortId)
 {
+	rmtN1Port_t * pxN1Port;
 
-	ESP_LOGI(TAG_RMT,"xRmtSendPortId");
+	if (!pxRmtInstance) {
+		ESP_LOGE(TAG_RMT,"Bogus instance passed");
+		return pdFALSE;
+	}
+
+	pxN1Port = pxN1pmapFind(pxRmtInstance->pxN1Ports, xPortId);
+	if (!pxN1Port) {
+		ESP_LOGE(TAG_RMT,"Could not find the N-1 port %d", xPortId);
+		return pdFALSE;
+	}
+
+	if (pxN1Port->eState == eN1_PORT_STATE_ENABLED)
+		pxN1Port->eState = eN1_PORT_STATE_DISABLED;
+
+	return pdTRUE;
+}
 
+BaseType_t xRmtEnableWrite(rmt_t * pxRmtInstance, portId_t xPortId)
+{
 	rmtN1Port_t * pxN1Port;
-	//rmtPs_t *ps;//???
-	int cases;
-	BaseType_t ret;
-	BaseType_t xMustEnqueue;
 
-	
-	/*ps = container_of(rcu_dereference(instance->base.ps),
-	  		  struct rmt_ps, base);
-
-	if (!ps || !ps->rmt_enqueue_policy) {
-		rcu_read_unlock();
-		LOG_ERR("PS or enqueue policy null, dropping pdu");
-		du_destroy(du);
-		return -1;
-	}*/
-	pxN1Port = xPortIdTable[0].pxPortN1;
-	//pxN1Port = n1pmap_find(instance, id);
+	if (!pxRmtInstance) {
+		ESP_LOGE(TAG_RMT,"Bogus instance passed");
+		return pdFALSE;
+	}
+
+	pxN1Port = pxN1pmapFind(pxRmtInstance->pxN1Ports, xPortId);
 	if (!pxN1Port) {
-		
-		ESP_LOGE(TAG_RMT,"Could not find the N-1 port");
-		xDuDestroy(pxDu);
+		ESP_LOGE(TAG_RMT,"Could not find the N-1 port %d", xPortId);
 		return pdFALSE;
 	}
 
-	//n1_port_lock(n1_port);
+	if (pxN1Port->eState == eN1_PORT_STATE_DISABLED)
+		pxN1Port->eState = eN1_PORT_STATE_ENABLED;
+
+	if (pxN1Port->xStats.plen)
+		vRmtEgressSchedule(pxRmtInstance);
+
+	return pdTRUE;
+}
+
+
+static BaseType_t xRmtSendN1Port(rmt_t * pxRmtInstance,
+				 rmtN1Port_t * pxN1Port,
+				 struct du_t * pxDu)
+{
+	int cases;
+	BaseType_t ret;
+	BaseType_t xMustEnqueue;
+	size_t uxBytes;
 
 	xMustEnqueue = pdFALSE;
 	if (pxN1Port->xStats.plen 				||
@@ -472,27 +684,26 @@ BaseType_t xRmtSendPortId(rmt_t * pxRmtInstance,
 		xMustEnqueue = pdTRUE;
 	}
 
-	//ret = ps->rmt_enqueue_policy(ps, n1_port, du, must_enqueue);
-	cases = 0; //Send Default policy, change later.
-	//rcu_read_unlock();
+	cases = pxRmtInstance->pxPs->rmtEnqueuePolicy(pxRmtInstance, pxN1Port, pxDu, xMustEnqueue);
+
 	switch (cases) {
-	#if 0
 	case RMT_PS_ENQ_SCHED:
-		n1_port->stats.plen++;
-		tasklet_hi_schedule(&instance->egress_tasklet);
-		ret = 0;
+		pxN1Port->xStats.plen++;
+		if (pxN1Port->eState != eN1_PORT_STATE_DISABLED)
+			vRmtEgressSchedule(pxRmtInstance);
+		ret = pdTRUE;
 		break;
 	case RMT_PS_ENQ_DROP:
-		n1_port->stats.drop_pdus++;
-		LOG_ERR("PDU dropped while enqueing");
-		ret = 0;
+		pxN1Port->xStats.dropPdus++;
+		ESP_LOGW(TAG_RMT,"Queue full on port-id %d, PDU dropped (%u so far)",
+			 pxN1Port->xPortId, (unsigned)pxN1Port->xStats.dropPdus);
+		ret = pdFALSE;
 		break;
 	case RMT_PS_ENQ_ERR:
-		n1_port->stats.err_pdus++;
-		LOG_ERR("Some error occurred while enqueuing PDU");
-		ret = 0;
+		pxN1Port->xStats.errPdus++;
+		ESP_LOGE(TAG_RMT,"Some error occurred while enqueuing PDU");
+		ret = pdFALSE;
 		break;
-	#endif
 	case RMT_PS_ENQ_SEND:
 		if (xMustEnqueue) {
 			ESP_LOGE(TAG_RMT,"Wrong behaviour of the policy");
@@ -505,79 +716,179 @@ BaseType_t xRmtSendPortId(rmt_t * pxRmtInstance,
 
 		pxN1Port->uxBusy = pdTRUE;
 		
-		
-		//n1_port_unlock(n1_port);
 		ESP_LOGI(TAG_RMT,"PDU ready to be sent, no need to enqueue");
+		uxBytes = xDuLen(pxDu);
 		ret = xRmtN1PortWriteDu(pxRmtInstance, pxN1Port, pxDu);
-		/*FIXME LB: This is just horrible, needs to be rethinked */
-		//N1_port_lock(n1_port);
 		pxN1Port->uxBusy = pdFALSE;
-		if (cases >= 0) 
-		{
-			stats_inc(tx, pxN1Port, ret);
-			ret = pdTRUE;
+		if (ret) {
+			stats_inc(tx, pxN1Port, uxBytes);
 		}
+
+		ret = pdTRUE;
 		break;
 	default:
 		ESP_LOGE(TAG_RMT,"rmt_enqueu_policy returned wrong value");
+		ret = pdFALSE;
 		break;
-		ret = pdTRUE;
 	}
 
-	//n1_port_unlock(n1_port);
-	//n1pmap_release(instance, n1_port);
 	return ret;
 }
 
-
-BaseType_t xRmtSend(rmt_t * pxRmtInstance,
-	     struct du_t * pxDu)
+BaseType_t xRmtSendPortId(rmt_t * pxRmtInstance,
+		     portId_t xPortId,
+		     struct du_t * pxDu)
 {
-	int i;
+	rmtN1Port_t * pxN1Port;
 
-	if (!pxRmtInstance || !pxDu || !xPciIsOk(pxDu->pxPci)) {
-		ESP_LOGE(TAG_RMT,"Bogus input parameters passed");
+	ESP_LOGI(TAG_RMT,"xRmtSendPortId");
+
+	pxN1Port = pxN1pmapFind(pxRmtInstance->pxN1Ports, xPortId);
+	if (!pxN1Port) {
+		
+		ESP_LOGE(TAG_RMT,"Could not find the N-1 port %d", xPortId);
 		xDuDestroy(pxDu);
 		return pdFALSE;
 	}
 
-#if 0
-	if (pff_nhop(instance->pff, &du->pci,
-		     &(instance->cache.pids),
-		     &(instance->cache.count))) {
-		LOG_ERR("Cannot get the NHOP for this PDU (saddr: %u daddr: %u type: %u)",
-				pci_source(&du->pci), pci_destination(&du->pci),
-				pci_type(&du->pci));
+	return xRmtSendN1Port(pxRmtInstance, pxN1Port, pxDu);
+}
+
+/* Jenkins one-at-a-time over the connection of the PDU: all the PDUs of
+ * a connection hash the same. */
+static uint32_t ulRmtConnectionHash(const pci_t * pxPci)
+{
+	const uint8_t ucKey[] = {
+		pxPci->xSource,
+		pxPci->xDestination,
+		pxPci->connectionId_t.xQosId,
+		pxPci->connectionId_t.xSource,
+		pxPci->connectionId_t.xDestination,
+	};
+	uint32_t ulHash = 0;
+	size_t i;
+
+	for (i = 0; i < sizeof(ucKey); i++) {
+		ulHash += ucKey[i];
+		ulHash += ulHash << 10;
+		ulHash ^= ulHash >> 6;
+	}
+	ulHash += ulHash << 3;
+	ulHash ^= ulHash >> 11;
+	ulHash += ulHash << 15;
+
+	return ulHash;
+}
+
+/* Score of a next hop for a connection, murmur3 finalizer */
+static uint32_t ulRmtNextHopScore(uint32_t ulConnection, portId_t xPortId)
+{
+	uint32_t ulScore = ulConnection ^ ((uint32_t)xPortId * 0x9E3779B9U);
+
+	ulScore ^= ulScore >> 16;
+	ulScore *= 0x85EBCA6BU;
+	ulScore ^= ulScore >> 13;
+	ulScore *= 0xC2B2AE35U;
+	ulScore ^= ulScore >> 16;
+
+	return ulScore;
+}
+
+/* @brief The next hop with the highest score for the connection of the
+ * PDU (rendezvous hashing). A connection stays on one N-1 port, and only
+ * the connections of a port that goes or comes move. By queue depth, the
+ * score is divided by the PDUs queued on the port plus one: the
+ * connections move off the ports that build up a queue, and may see
+ * their PDUs reordered when they do. */
+static rmtN1Port_t * pxRmtSelectNextHop(rmt_t * pxRmtInstance, const pci_t * pxPci,
+					const portId_t * pxNextHops, size_t uxNextHops)
+{
+	rmtN1Port_t * pxBest = NULL;
+	rmtN1Port_t * pxN1Port;
+	uint32_t ulConnection;
+	uint32_t ulScore, ulBestScore = 0;
+	size_t i;
+
+	ulConnection = ulRmtConnectionHash(pxPci);
+
+	for (i = 0; i < uxNextHops; i++) {
+		pxN1Port = pxN1pmapFind(pxRmtInstance->pxN1Ports, pxNextHops[i]);
+		if (!pxN1Port)
+			continue;
+
+		ulScore = ulRmtNextHopScore(ulConnection, pxNextHops[i]);
+		if (pxRmtInstance->eMultipath == eRMT_MULTIPATH_QUEUE_DEPTH)
+			ulScore /= pxN1Port->xStats.plen + 1;
+
+		if (!pxBest || ulScore > ulBestScore) {
+			pxBest = pxN1Port;
+			ulBestScore = ulScore;
+		}
+	}
+
+	return pxBest;
+}
 
-		du_destroy(du); 
-		return -1;
+BaseType_t xRmtMultipathSet(rmt_t * pxRmtInstance, eRmtMultipath_t eMultipath)
+{
+	if (!pxRmtInstance ||
+	    (eMultipath != eRMT_MULTIPATH_HASH && eMultipath != eRMT_MULTIPATH_QUEUE_DEPTH)) {
+		ESP_LOGE(TAG_RMT,"Bogus input parameters");
+		return pdFALSE;
 	}
 
-	if (pxRmtInstance. instance->cache.count == 0) {
-		ESP_LOGI(TAG_RMT, "No NHOP for this PDU ...");
+	pxRmtInstance->eMultipath = eMultipath;
+
+	return pdTRUE;
+}
+
+
+/* @brief Send the PDU out of one of its next hops */
+static BaseType_t xRmtSendNextHops(rmt_t * pxRmtInstance, struct du_t * pxDu,
+				   const portId_t * pxNextHops, size_t uxNextHops)
+{
+	rmtN1Port_t * pxN1Port;
+
+	pxN1Port = pxRmtSelectNextHop(pxRmtInstance, pxDu->pxPci, pxNextHops, uxNextHops);
+	if (!pxN1Port) {
+		ESP_LOGE(TAG_RMT,"None of the next hops is an N-1 port");
 		xDuDestroy(pxDu);
 		return pdFALSE;
 	}
 
-	for (i = 0; i < instance->cache.count; i++) {
-		portId_t   pid;
-		struct du_t * pxDuTmp;
+	/* xRmtSendN1Port() has counted and logged the PDU if it failed */
+	return xRmtSendN1Port(pxRmtInstance, pxN1Port, pxDu);
+}
 
-		pid = instance->cache.pids[i];
+BaseType_t xRmtSend(rmt_t * pxRmtInstance,
+	     struct du_t * pxDu)
+{
+	rmtN1Port_t * pxN1Port;
+	portId_t xNextHops[ PFF_MAX_NEXT_HOPS ];
+	size_t uxNextHops;
 
-		if (i == instance->cache.count-1)
-			pxDuTmp = pxDu;
-		else
-			pxDuTmp = du_dup(pxDu);
+	if (!pxRmtInstance || !pxDu || !xPciIsOk(pxDu->pxPci)) {
+		ESP_LOGE(TAG_RMT,"Bogus input parameters passed");
+		xDuDestroy(pxDu);
+		return pdFALSE;
+	}
 
-		if (rmt_send_port_id(instance, pid, pxDuTmp))
-			ESP_LOGE("Failed to send a PDU to port-id %d", pid);
+	uxNextHops = uxPffNextHops(pxRmtInstance->pxPff, pxDu->pxPci->xDestination,
+				   pxDu->pxPci->connectionId_t.xQosId, xNextHops, PFF_MAX_NEXT_HOPS);
+	if (uxNextHops == 0) {
+		/* Until routing fills the PFF, the neighbour of the first N-1
+		 * flow is the next hop of every destination without a route */
+		pxN1Port = pxRmtInstance->pxN1Ports->pxDefault;
+		if (!pxN1Port) {
+			ESP_LOGI(TAG_RMT, "No NHOP for this PDU ...");
+			xDuDestroy(pxDu);
+			return pdFALSE;
+		}
+		xNextHops[0] = pxN1Port->xPortId;
+		uxNextHops = 1;
 	}
-	#endif
 
-	if (xRmtSendPortId(pxRmtInstance, pxRmtInstance->pxN1Port->xPortId, pxDu))
-			ESP_LOGE(TAG_RMT,"Failed to send a PDU to port-id %d", pxRmtInstance->pxN1Port->xPortId);
-	return pdTRUE;
+	return xRmtSendNextHops(pxRmtInstance, pxDu, xNextHops, uxNextHops);
 }
 
 
@@ -590,7 +901,6 @@ pci_t * vCastPointerTo_pci_t(void * pvArgument)
 rmt_t * pxRmtCreate(struct efcpContainer_t * pxEfcpc, ipcpInstance_t *pxInstance)
 {
 	rmt_t * pxRmtTmp;
-	rmtN1Port_t * pxPortN1[2];
 
 	if (!pxEfcpc) {
 		ESP_LOGE(TAG_RMT,"Bogus input parameters");
@@ -601,21 +911,33 @@ rmt_t * pxRmtCreate(struct efcpContainer_t * pxEfcpc, ipcpInstance_t *pxInstance
 	if (!pxRmtTmp)
 		return NULL;
 
-	vListInitialise(&pxRmtTmp->xAddresses);
+	memset(pxRmtTmp->ulAddresses, 0, sizeof(pxRmtTmp->ulAddresses));
+	memset(pxRmtTmp->ucWeights, RMT_QOS_WEIGHT_DEFAULT, sizeof(pxRmtTmp->ucWeights));
+
+	pxRmtTmp->pxPs = pxRmtPsFind(RMT_POLICY_SET);
+	if (!pxRmtTmp->pxPs) {
+		ESP_LOGE(TAG_RMT,"No RMT policy set called %s", RMT_POLICY_SET);
+		vPortFree(pxRmtTmp);
+		return NULL;
+	}
 
 	pxRmtTmp->pxParent = pxInstance;
 	pxRmtTmp->pxEfcpc = pxEfcpc;
+	pxRmtTmp->xEgressPending = pdFALSE;
+	pxRmtTmp->eMultipath = RMT_MULTIPATH_QUEUE_DEPTH ? eRMT_MULTIPATH_QUEUE_DEPTH : eRMT_MULTIPATH_HASH;
 
-	/*tmp->pff = pff_create(&tmp->robj, tmp->parent);
-	if (!tmp->pff) {
-		rmt_destroy(tmp);
+	pxRmtTmp->pxPff = pxPffCreate();
+	if (!pxRmtTmp->pxPff) {
+		ESP_LOGE(TAG_RMT,"Failed to create the PFF");
+		vPortFree(pxRmtTmp);
 		return NULL;
-	}*/
-	pxRmtTmp->pxN1Port = pxPortN1;
-	//tmp->n1_ports = n1pmap_create(&tmp->robj);
-	if (!pxRmtTmp->pxN1Port) {
+	}
+	pxRmtTmp->pxN1Ports = pxN1pmapCreate();
+	if (!pxRmtTmp->pxN1Ports) {
 		ESP_LOGI(TAG_RMT,"Failed to create N-1 ports map");
 		//rmt_destroy(tmp);
+		vPffDestroy(pxRmtTmp->pxPff);
+		vPortFree(pxRmtTmp);
 		return NULL;
 	}
 
@@ -623,11 +945,7 @@ rmt_t * pxRmtCreate(struct efcpContainer_t * pxEfcpc, ipcpInstance_t *pxInstance
 		LOG_ERR("Failed to init pff cache");
 		rmt_destroy(tmp);
 		return NULL;
-	}
-
-	tasklet_init(&tmp->egress_tasklet,
-		     send_worker,
-		     (unsigned long) tmp);*/
+	}*/
 
 	ESP_LOGI(TAG_RMT,"Instance %pK initialized successfully", pxRmtTmp);
 	return pxRmtTmp;
@@ -50,12 +50,17 @@ BaseType_t xDuDecap(struct du_t * pxDu)
 	pduType_t xType;
 	pci_t * pxPciTmp;
 	size_t uxPciLen;
-	NetworkBufferDescriptor_t * pxNewBuffer;
-	uint8_t * pucPtr;
-	size_t xBufferSize;
-	   
 
-	/* Extract PCI from buffer*/
+	uxPciLen = sizeof(pci_t);
+
+	if (pxDu->pxNetworkBuffer->xDataLength < uxPciLen)
+	{
+		ESP_LOGE(TAG_DTP, "Could not decap DU. Too short for a PCI");
+		return pdTRUE;
+	}
+
+	/* The PCI is parsed where it was received. It stays in the buffer
+	 * storage, now as headroom, so pxPci remains valid for the du lifetime. */
 	pxPciTmp = vCastPointerTo_pci_t(pxDu->pxNetworkBuffer->pucEthernetBuffer);
 
    // vPciPrint(pxPciTmp);
@@ -66,51 +71,27 @@ BaseType_t xDuDecap(struct du_t * pxDu)
 		return pdTRUE;
 	}
 
-	uxPciLen = (size_t )(14); /* PCI defined static for this initial stage = 14Bytes*/
-
-	xBufferSize = pxDu->pxNetworkBuffer->xDataLength - uxPciLen;
-
-	
-	//ESP_LOGE(TAG_ARP, "Taking Buffer to copy the SDU from the RINA PDU: DuDecap");
-	pxNewBuffer = pxGetNetworkBufferWithDescriptor( xBufferSize, ( TickType_t ) 0U );
-	if(pxNewBuffer == NULL)
-	{ 	
-		ESP_LOGE(TAG_DTP,"NO buffer was allocated to do the Decap");
-		return pdFALSE;
-	}
-	pxNewBuffer->xDataLength = xBufferSize;
-
-	pucPtr = (uint8_t *)pxPciTmp + 14;
-
-	memcpy(pxNewBuffer->pucEthernetBuffer, pucPtr,xBufferSize);
-
+	pxDu->pxPci = pxPciTmp;
 
-	pxDu->pxPci->ucVersion = pxPciTmp->ucVersion;
-	pxDu->pxPci->xSource = pxPciTmp->xSource;
-	pxDu->pxPci->xDestination = pxPciTmp->xDestination;
-	pxDu->pxPci->xFlags = pxPciTmp->xFlags;
-	pxDu->pxPci->xPduLen = pxPciTmp->xPduLen;
-	pxDu->pxPci->xSequenceNumber = pxPciTmp->xSequenceNumber;
-	pxDu->pxPci->xType = pxPciTmp->xType;
-	pxDu->pxPci->connectionId_t = pxPciTmp->connectionId_t;
-
-	//ESP_LOGE(TAG_DTP, "Releasing Buffer after copy the SDU from the RINA PDU:DuDcap");
-	vReleaseNetworkBufferAndDescriptor(pxDu->pxNetworkBuffer);
-	pxDu->pxNetworkBuffer = pxNewBuffer;
+	/* Move the payload start past the PCI, no copy is needed. */
+	(void)pucNetworkBufferPull(pxDu->pxNetworkBuffer, uxPciLen);
 
 	return pdFALSE;
 }
 
 ssize_t xDuDataLen(const struct du_t * pxDu)
 {
-	if (pxDu->pxPci->xPduLen != pxDu->pxNetworkBuffer->xDataLength) /* up direction */
-		return pxDu->pxNetworkBuffer->xDataLength;
-	return (pxDu->pxNetworkBuffer->xDataLength - pxDu->pxPci->xPduLen); /* down direction */
+	size_t uxLen = xDuLen(pxDu);
+
+	if (pxDu->pxPci->xPduLen != uxLen) /* up direction */
+		return uxLen;
+	return (uxLen - pxDu->pxPci->xPduLen); /* down direction */
 }
 
+/* Length of the whole PDU, summed over the segments of a chained buffer. */
 size_t xDuLen(const struct du_t * pxDu)
 {
-	return pxDu->pxNetworkBuffer->xDataLength;
+	return uxNetworkBufferChainLength(pxDu->pxNetworkBuffer);
 }
 
 BaseType_t xDuEncap(struct du_t * pxDu, pduType_t xType)
@@ -122,10 +103,18 @@ BaseType_t xDuEncap(struct du_t * pxDu, pduType_t xType)
 	pci_t * pxPciTmp;
 	
 
-	uxPciLen = (size_t )(14); /* PCI defined static for this initial stage = 16Bytes*/
+	uxPciLen = sizeof(pci_t);
+
+	/* Prepend the PCI in place when the buffer was allocated with headroom. */
+	pxPciTmp = vCastPointerTo_pci_t(pucNetworkBufferPush(pxDu->pxNetworkBuffer, uxPciLen));
+	if (pxPciTmp)
+	{
+		pxDu->pxPci = pxPciTmp;
+		return pdTRUE;
+	}
 	
 	/* New Size = Data Size more the PCI size defined by default. */
-	xBufferSize = pxDu->pxNetworkBuffer->xDataLength + uxPciLen;
+	xBufferSize = xDuLen(pxDu) + uxPciLen;
 
 
 	//ESP_LOGE(TAG_DTP, "Taking Buffer to encap PDU");
@@ -137,10 +126,9 @@ BaseType_t xDuEncap(struct du_t * pxDu, pduType_t xType)
 		return pdFALSE;
 	}
 
-	pucDataPtr = (uint8_t *)(pxNewBuffer->pucEthernetBuffer + 14);
+	pucDataPtr = (uint8_t *)(pxNewBuffer->pucEthernetBuffer + uxPciLen);
 
-	memcpy(pucDataPtr, pxDu->pxNetworkBuffer->pucEthernetBuffer,
-		pxDu->pxNetworkBuffer->xDataLength);
+	(void)uxNetworkBufferGather(pxDu->pxNetworkBuffer, pucDataPtr, xBufferSize - uxPciLen);
 
 	//ESP_LOGE(TAG_DTP, "Releasing Buffer after encap PDU");
 	vReleaseNetworkBufferAndDescriptor(pxDu->pxNetworkBuffer);
@@ -162,4 +150,62 @@ BaseType_t xDuEncap(struct du_t * pxDu, pduType_t xType)
 BaseType_t xDuIsOk(const struct du_t * pxDu)
 {
 	return (pxDu && pxDu->pxNetworkBuffer ? pdTRUE : pdFALSE);
-}
\ No newline at end of file
+}
+
+struct du_t * pxDuClone(struct du_t * pxDu)
+{
+	struct du_t * pxDuTmp;
+
+	if (!xDuIsOk(pxDu))
+		return NULL;
+
+	pxDuTmp = pvPortMalloc(sizeof(*pxDuTmp));
+	if (!pxDuTmp)
+	{
+		ESP_LOGE(TAG_DTP, "Failed to allocate the du clone");
+		return NULL;
+	}
+
+	/* The payload is shared, only the metadata is copied. pxPci keeps
+	 * pointing into the shared storage. */
+	pxDuTmp->pxNetworkBuffer = pxNetworkBufferClone(pxDu->pxNetworkBuffer, (TickType_t)0U);
+	if (!pxDuTmp->pxNetworkBuffer)
+	{
+		ESP_LOGE(TAG_DTP, "No descriptor available to clone the du");
+		vPortFree(pxDuTmp);
+		return NULL;
+	}
+
+	pxDuTmp->pxCfg = pxDu->pxCfg;
+	pxDuTmp->pxPci = pxDu->pxPci;
+
+	return pxDuTmp;
+}
+
+BaseType_t xDuMakeWritable(struct du_t * pxDu)
+{
+	NetworkBufferDescriptor_t * pxNetworkBuffer = pxDu->pxNetworkBuffer;
+	uint8_t * pucOldStart = pxNetworkBuffer->pucBufferStart;
+	BaseType_t xPciInBuffer;
+	size_t uxPciOffset = 0;
+
+	if (!xNetworkBufferIsShared(pxNetworkBuffer))
+		return pdTRUE;
+
+	xPciInBuffer = ((uint8_t *)pxDu->pxPci >= pucOldStart &&
+			(uint8_t *)pxDu->pxPci < pucOldStart + pxNetworkBuffer->xBufferSize);
+	if (xPciInBuffer)
+		uxPciOffset = (uint8_t *)pxDu->pxPci - pucOldStart;
+
+	if (!xNetworkBufferMakeWritable(pxNetworkBuffer))
+	{
+		ESP_LOGE(TAG_DTP, "Could not unshare du buffer");
+		return pdFALSE;
+	}
+
+	/* The PCI was copied at the same offset in the new storage. */
+	if (xPciInBuffer)
+		pxDu->pxPci = vCastPointerTo_pci_t(pxNetworkBuffer->pucBufferStart + uxPciOffset);
+
+	return pdTRUE;
+}
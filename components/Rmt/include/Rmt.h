@@ -0,0 +1,161 @@
+
+#ifndef COMPONENTS_RMT_INCLUDE_RMT_H_
+#define COMPONENTS_RMT_INCLUDE_RMT_H_
+
+
+#include "configSensor.h"
+#include "IPCP.h"
+
+#include "EFCP.h"
+#include "efcpStructures.h"
+#include "du.h"
+#include "pff.h"
+
+#define TAG_RMT "[RMT]"
+
+/* qosId_t is 8 bits, the RMT has a weight for every qos-id */
+#define RMT_QOS_IDS		(1U << (8 * sizeof(qosId_t)))
+
+/* rmt_enqueue_policy return values */
+#define RMT_PS_ENQ_SEND  0	/* PDU can be transmitted by the RMT */
+#define RMT_PS_ENQ_SCHED 1	/* PDU enqueued and RMT needs to schedule */
+#define RMT_PS_ENQ_ERR   2	/* Error */
+#define RMT_PS_ENQ_DROP  3	/* PDU dropped due to queue full occupation */
+
+#define stats_inc(name, n1_port, bytes)					\
+        n1_port->xStats.name##Pdus++;					\
+	n1_port->xStats.name##Bytes += (unsigned int) bytes;		\
+
+typedef enum FLOW_STATE {
+	eN1_PORT_STATE_ENABLED = 0,
+	eN1_PORT_STATE_DISABLED,
+	eN1_PORT_STATE_DO_NOT_DISABLE,
+	eN1_PORT_STATE_DEALLOCATED,
+}eFlowState_t;
+
+/* How the RMT picks one of the next hops the PFF gives for a PDU */
+typedef enum RMT_MULTIPATH {
+	eRMT_MULTIPATH_HASH = 0,		/* By connection, each stays in order */
+	eRMT_MULTIPATH_QUEUE_DEPTH,		/* Also away from the longest queues */
+}eRmtMultipath_t;
+
+typedef struct xN1_PORT_STATS {
+	unsigned int plen; /* port len, all pdus enqueued in PS queue/s */
+	unsigned int dropPdus;
+	unsigned int ecnPdus; /* marked by the AQM of the queues */
+	unsigned int errPdus;
+	unsigned int txPdus;
+	unsigned int txBytes;
+	unsigned int rxPdus;
+	unsigned int rxBytes;
+}n1PortStats_t;
+
+
+
+typedef struct xRMT_N1_PORT {
+
+	/* Is it required?
+	 spinlock_t		lock;*/
+
+	/*Port Id from Shim*/
+	portId_t			xPortId;
+
+	/* Shim Instance*/
+	ipcpInstance_t	* 	pxN1Ipcp;
+
+	/* State of the Port*/
+	eFlowState_t		eState;
+
+	/*N1 Port Statistics */
+	n1PortStats_t		xStats;
+
+	/* If the Port is Busy or not*/
+	BaseType_t			uxBusy;
+
+	/* Queues of the RMT policy set */
+	void * 	 			pvRmtPsQueues;
+
+	/* Next port in the same bucket of the N-1 port map */
+	struct xRMT_N1_PORT * pxNextInBucket;
+
+}rmtN1Port_t;
+
+/* N-1 ports bound to the RMT, hashed by port-id */
+typedef struct xRMT_N1_PORT_MAP {
+	rmtN1Port_t *	pxBuckets[ RMT_N1_PORT_MAP_BUCKETS ];
+
+	/* Port used while there is no forwarding table, the first bound */
+	rmtN1Port_t *	pxDefault;
+
+	UBaseType_t		uxPorts;
+
+}n1pmap_t;
+
+
+typedef struct xRMT
+{
+	/* Addresses of the IPCP, one bit per address_t value */
+	uint32_t      					ulAddresses[ PFF_ADDRESSES / 32 ];
+
+	/* IPCP Instances Parent*/
+	ipcpInstance_t * 				pxParent;
+
+	/* EFCP Container associated with */
+	struct efcpContainer_t * 		pxEfcpc;
+
+	/* N-1 ports, by port-id */
+	n1pmap_t * 						pxN1Ports;
+
+	/* PDU Forwarding Function */
+	pff_t * 						pxPff;
+
+	/* Policy set queueing and scheduling the PDUs of the N-1 ports */
+	const struct xRMT_PS * 			pxPs;
+
+	/* Weight of each qos-id for the scheduler of the policy set */
+	uint8_t							ucWeights[ RMT_QOS_IDS ];
+
+	/* Choice between the next hops of a PDU */
+	eRmtMultipath_t					eMultipath;
+
+	/* An eRmtEgressEvent is posted and not run yet */
+	BaseType_t						xEgressPending;
+
+	struct rmt_Config_t * 			pxRmtCfg;
+
+}rmt_t;
+
+
+pci_t * vCastPointerTo_pci_t(void * pvArgument);
+BaseType_t xRmtSend(rmt_t * pxRmtInstance,struct du_t * pxDu);
+rmt_t * pxRmtCreate( struct efcpContainer_t * pxEfcpc, ipcpInstance_t *pxInstance);
+BaseType_t xRmtN1PortBind(rmt_t * pxRmtInstance, portId_t xId, ipcpInstance_t * pxN1Ipcp);
+BaseType_t xRmtN1PortUnbind(rmt_t * pxRmtInstance, portId_t xId);
+BaseType_t xRmtSendPortId(rmt_t * pxRmtInstance,
+		     portId_t xPortId,
+		     struct du_t * pxDu);
+
+BaseType_t xRmtReceive ( rmt_t * pxRmt, struct du_t * pxDu, portId_t xFrom );
+BaseType_t xRmtAddressAdd(rmt_t * pxInstance, address_t xAddress);
+
+/* Check if the address is one of the addresses of the RMT */
+static inline BaseType_t xRmtAddressIsLocal(const rmt_t * pxRmt, address_t xAddress)
+{
+	return (pxRmt->ulAddresses[xAddress / 32] >> (xAddress % 32)) & 1U ? pdTRUE : pdFALSE;
+}
+
+/* Change the policy set, only while no N-1 port is bound */
+BaseType_t xRmtSelectPolicySet(rmt_t * pxRmtInstance, const char * pcName);
+BaseType_t xRmtQosWeightSet(rmt_t * pxRmtInstance, qosId_t xQosId, uint8_t ucWeight);
+BaseType_t xRmtMultipathSet(rmt_t * pxRmtInstance, eRmtMultipath_t eMultipath);
+
+/* Called by the N-1 IPCP when it can't take more PDUs from the port, and
+ * when it can again. */
+BaseType_t xRmtDisableWrite(rmt_t * pxRmtInstance, portId_t xPortId);
+BaseType_t xRmtEnableWrite(rmt_t * pxRmtInstance, portId_t xPortId);
+
+/* Egress worker, run on an eRmtEgressEvent */
+void vRmtEgress(rmt_t * pxRmtInstance);
+
+#endif /* COMPONENTS_RMT_INCLUDE_DU_H_ */
+
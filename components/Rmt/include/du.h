@@ -31,5 +31,11 @@ BaseType_t xDuEncap(struct du_t * pxDu, pduType_t xType);
 
 BaseType_t xDuIsOk(const struct du_t * pxDu);
 
+/* Clone a du sharing its payload, only the du_t is copied. */
+struct du_t * pxDuClone(struct du_t * pxDu);
+
+/* Copy-on-write: give the du a private buffer before modifying it in place. */
+BaseType_t xDuMakeWritable(struct du_t * pxDu);
+
 #endif /* COMPONENTS_RMT_INCLUDE_DU_H_ */
 
@@ -0,0 +1,72 @@
+/*
+ * pff.h
+ *
+ * PDU Forwarding Function: the N-1 ports a PDU goes out of, by destination
+ * address and qos-id.
+ */
+
+#ifndef COMPONENTS_RMT_INCLUDE_PFF_H_
+#define COMPONENTS_RMT_INCLUDE_PFF_H_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "configSensor.h"
+#include "common.h"
+#include "IPCP.h"
+
+#define TAG_PFF "[PFF]"
+
+/* address_t is 8 bits, the table has a slot for every address */
+#define PFF_ADDRESSES		(1U << (8 * sizeof(address_t)))
+
+/* qos-id of the routes used for any qos-id without a route of its own */
+#define PFF_QOS_ANY			((qosId_t)QOS_ID_WRONG)
+
+typedef struct xPFF_ROUTE {
+	qosId_t			xQosId;
+	UBaseType_t		uxPorts;
+	portId_t		xPorts[ PFF_MAX_NEXT_HOPS ];
+}pffRoute_t;
+
+/* Routes to one destination address. Never modified once in a table, an
+ * update replaces it. */
+typedef struct xPFF_ENTRY {
+	UBaseType_t		uxRoutes;
+	pffRoute_t		xRoutes[];
+}pffEntry_t;
+
+typedef struct xPFF_TABLE {
+	pffEntry_t *	pxEntries[ PFF_ADDRESSES ];
+}pffTable_t;
+
+typedef struct xPFF {
+	/* Read without a lock, swapped whole on each update */
+	pffTable_t *		pxTable;
+
+	/* Lookups in progress per generation, an update moves the new ones to
+	 * the other generation and frees the replaced table once the count of
+	 * the previous one drops to 0 */
+	uint32_t			ulReaders[2];
+	uint32_t			ulGeneration;
+
+	/* Serialises the updates */
+	SemaphoreHandle_t	xWriteLock;
+}pff_t;
+
+pff_t * pxPffCreate(void);
+void vPffDestroy(pff_t * pxPff);
+
+/* Set the next hops of the PDUs to xAddress with qos-id xQosId, or with any
+ * qos-id without a route of its own if xQosId is PFF_QOS_ANY. */
+BaseType_t xPffAdd(pff_t * pxPff, address_t xAddress, qosId_t xQosId,
+		   const portId_t * pxPorts, size_t uxPorts);
+BaseType_t xPffRemove(pff_t * pxPff, address_t xAddress, qosId_t xQosId);
+void vPffFlush(pff_t * pxPff);
+
+/* Copy up to uxMax next hops of a PDU into pxPorts, without taking a lock.
+ * Returns how many there are, 0 if the PDU has no route. */
+size_t uxPffNextHops(pff_t * pxPff, address_t xAddress, qosId_t xQosId,
+		     portId_t * pxPorts, size_t uxMax);
+
+#endif /* COMPONENTS_RMT_INCLUDE_PFF_H_ */
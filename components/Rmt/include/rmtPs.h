@@ -0,0 +1,43 @@
+/*
+ * rmtPs.h
+ *
+ * RMT policy sets: how the PDUs wait in the queues of an N-1 port and in
+ * which order they leave them.
+ */
+
+#ifndef COMPONENTS_RMT_INCLUDE_RMTPS_H_
+#define COMPONENTS_RMT_INCLUDE_RMTPS_H_
+
+#include "Rmt.h"
+
+#define TAG_RMT_PS "[RMT_PS]"
+
+/* Policy set names, for xRmtSelectPolicySet() */
+#define RMT_PS_DEFAULT			"default"			/* One FIFO for all the qos-ids */
+#define RMT_PS_STRICT_PRIORITY	"strict-priority"	/* Highest weight, then lowest qos-id first */
+#define RMT_PS_DRR				"drr"				/* Deficit round robin */
+#define RMT_PS_WFQ				"wfq"				/* Weighted fair queueing */
+
+typedef struct xRMT_PS {
+	const char *	pcName;
+
+	/* Queues of a new N-1 port, kept in its pvRmtPsQueues */
+	void * (* rmtQCreatePolicy)(rmt_t * pxRmt, rmtN1Port_t * pxN1Port);
+
+	/* Free the queues of the N-1 port and the PDUs still in them */
+	void (* rmtQDestroyPolicy)(rmt_t * pxRmt, rmtN1Port_t * pxN1Port);
+
+	/* Returns RMT_PS_ENQ_SEND if the PDU can be written right away, and
+	 * never when xMustEnqueue is set. The PDU is destroyed on
+	 * RMT_PS_ENQ_DROP and RMT_PS_ENQ_ERR. */
+	int (* rmtEnqueuePolicy)(rmt_t * pxRmt, rmtN1Port_t * pxN1Port,
+				 struct du_t * pxDu, BaseType_t xMustEnqueue);
+
+	/* The PDU the scheduler sends next, NULL if the queues are empty */
+	struct du_t * (* rmtDequeuePolicy)(rmt_t * pxRmt, rmtN1Port_t * pxN1Port);
+}rmtPs_t;
+
+/* The policy set called pcName, NULL if there is none */
+const rmtPs_t * pxRmtPsFind(const char * pcName);
+
+#endif /* COMPONENTS_RMT_INCLUDE_RMTPS_H_ */
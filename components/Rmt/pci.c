@@ -17,7 +17,7 @@
 #include "esp_log.h"
 
 #include "Rmt.h"
-#include "ConfigSensor.h"
+#include "configSensor.h"
 #include "common.h"
 #include "du.h"
 
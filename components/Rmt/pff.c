@@ -0,0 +1,281 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+
+#include "pff.h"
+
+/* The lookups count themselves in the reader counter of the current
+ * generation before they load the table and leave once they have copied
+ * the ports out. An update builds a new table, publishes it, moves the
+ * lookups that start from then on to the other generation and waits for
+ * the counter of the previous one to drop to 0: any lookup still in the
+ * old table has then finished, and the old table and the entry it replaced
+ * can be freed. New lookups do not hold the wait up. */
+
+static const pffTable_t * pxPffReadLock(pff_t * pxPff, uint32_t * pulGeneration)
+{
+	uint32_t ulGeneration;
+
+	/* Counted in a generation an update has already left, the lookup
+	 * could be missed by the next one: count again in the new one. */
+	for (;;) {
+		ulGeneration = __atomic_load_n(&pxPff->ulGeneration, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch(&pxPff->ulReaders[ulGeneration], 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&pxPff->ulGeneration, __ATOMIC_SEQ_CST) == ulGeneration)
+			break;
+		__atomic_sub_fetch(&pxPff->ulReaders[ulGeneration], 1, __ATOMIC_RELEASE);
+	}
+
+	*pulGeneration = ulGeneration;
+
+	return __atomic_load_n(&pxPff->pxTable, __ATOMIC_SEQ_CST);
+}
+
+static void vPffReadUnlock(pff_t * pxPff, uint32_t ulGeneration)
+{
+	__atomic_sub_fetch(&pxPff->ulReaders[ulGeneration], 1, __ATOMIC_RELEASE);
+}
+
+/* Publish pxNew and wait until no lookup can be in the table it replaces */
+static pffTable_t * pxPffSwap(pff_t * pxPff, pffTable_t * pxNew)
+{
+	pffTable_t * pxOld;
+	uint32_t ulGeneration;
+
+	pxOld = __atomic_exchange_n(&pxPff->pxTable, pxNew, __ATOMIC_SEQ_CST);
+
+	ulGeneration = __atomic_load_n(&pxPff->ulGeneration, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&pxPff->ulGeneration, ulGeneration ^ 1, __ATOMIC_SEQ_CST);
+
+	while (__atomic_load_n(&pxPff->ulReaders[ulGeneration], __ATOMIC_SEQ_CST) != 0)
+		vTaskDelay(1);
+
+	return pxOld;
+}
+
+static const pffRoute_t * pxPffEntryRoute(const pffEntry_t * pxEntry, qosId_t xQosId)
+{
+	const pffRoute_t * pxAny = NULL;
+	UBaseType_t uxRoute;
+
+	for (uxRoute = 0; uxRoute < pxEntry->uxRoutes; uxRoute++) {
+		if (pxEntry->xRoutes[uxRoute].xQosId == xQosId)
+			return &pxEntry->xRoutes[uxRoute];
+		if (pxEntry->xRoutes[uxRoute].xQosId == PFF_QOS_ANY)
+			pxAny = &pxEntry->xRoutes[uxRoute];
+	}
+
+	return pxAny;
+}
+
+/* Copy pxOld without the route of xQosId, with room for uxExtra more */
+static pffEntry_t * pxPffEntryCopy(const pffEntry_t * pxOld, qosId_t xQosId, UBaseType_t uxExtra)
+{
+	pffEntry_t * pxEntry;
+	UBaseType_t uxRoutes = pxOld ? pxOld->uxRoutes : 0;
+	UBaseType_t uxRoute;
+
+	pxEntry = pvPortMalloc(sizeof(*pxEntry) + (uxRoutes + uxExtra) * sizeof(pffRoute_t));
+	if (!pxEntry)
+		return NULL;
+
+	pxEntry->uxRoutes = 0;
+	for (uxRoute = 0; uxRoute < uxRoutes; uxRoute++) {
+		if (pxOld->xRoutes[uxRoute].xQosId != xQosId)
+			pxEntry->xRoutes[pxEntry->uxRoutes++] = pxOld->xRoutes[uxRoute];
+	}
+
+	return pxEntry;
+}
+
+/* Replace the entry of xAddress, NULL to remove it */
+static BaseType_t xPffUpdate(pff_t * pxPff, address_t xAddress, pffEntry_t * pxEntry)
+{
+	pffTable_t * pxNew, * pxOld;
+	pffEntry_t * pxReplaced;
+
+	pxNew = pvPortMalloc(sizeof(*pxNew));
+	if (!pxNew) {
+		vPortFree(pxEntry);
+		return pdFALSE;
+	}
+
+	memcpy(pxNew, pxPff->pxTable, sizeof(*pxNew));
+	pxReplaced = pxNew->pxEntries[xAddress];
+	pxNew->pxEntries[xAddress] = pxEntry;
+
+	pxOld = pxPffSwap(pxPff, pxNew);
+
+	vPortFree(pxReplaced);
+	vPortFree(pxOld);
+
+	return pdTRUE;
+}
+
+pff_t * pxPffCreate(void)
+{
+	pff_t * pxPff;
+
+	pxPff = pvPortMalloc(sizeof(*pxPff));
+	if (!pxPff)
+		return NULL;
+
+	pxPff->pxTable = pvPortMalloc(sizeof(*pxPff->pxTable));
+	pxPff->xWriteLock = xSemaphoreCreateMutex();
+	if (!pxPff->pxTable || !pxPff->xWriteLock) {
+		ESP_LOGE(TAG_PFF, "Failed to create the PFF");
+		if (pxPff->xWriteLock)
+			vSemaphoreDelete(pxPff->xWriteLock);
+		vPortFree(pxPff->pxTable);
+		vPortFree(pxPff);
+		return NULL;
+	}
+
+	memset(pxPff->pxTable, 0, sizeof(*pxPff->pxTable));
+	pxPff->ulReaders[0] = 0;
+	pxPff->ulReaders[1] = 0;
+	pxPff->ulGeneration = 0;
+
+	ESP_LOGI(TAG_PFF, "Instance %pK initialized successfully", pxPff);
+
+	return pxPff;
+}
+
+void vPffDestroy(pff_t * pxPff)
+{
+	if (!pxPff)
+		return;
+
+	vPffFlush(pxPff);
+	vSemaphoreDelete(pxPff->xWriteLock);
+	vPortFree(pxPff->pxTable);
+	vPortFree(pxPff);
+}
+
+BaseType_t xPffAdd(pff_t * pxPff, address_t xAddress, qosId_t xQosId,
+		   const portId_t * pxPorts, size_t uxPorts)
+{
+	pffEntry_t * pxEntry;
+	pffRoute_t * pxRoute;
+	BaseType_t xReturn;
+
+	if (!pxPff || !pxPorts || uxPorts == 0 || uxPorts > PFF_MAX_NEXT_HOPS) {
+		ESP_LOGE(TAG_PFF, "Bogus input parameters");
+		return pdFALSE;
+	}
+
+	xSemaphoreTake(pxPff->xWriteLock, portMAX_DELAY);
+
+	pxEntry = pxPffEntryCopy(pxPff->pxTable->pxEntries[xAddress], xQosId, 1);
+	if (!pxEntry) {
+		xSemaphoreGive(pxPff->xWriteLock);
+		return pdFALSE;
+	}
+
+	pxRoute = &pxEntry->xRoutes[pxEntry->uxRoutes++];
+	pxRoute->xQosId = xQosId;
+	pxRoute->uxPorts = uxPorts;
+	memcpy(pxRoute->xPorts, pxPorts, uxPorts * sizeof(portId_t));
+
+	xReturn = xPffUpdate(pxPff, xAddress, pxEntry);
+
+	xSemaphoreGive(pxPff->xWriteLock);
+
+	ESP_LOGI(TAG_PFF, "Added %u next hops to address %u qos-id %u",
+		 (unsigned)uxPorts, xAddress, xQosId);
+
+	return xReturn;
+}
+
+BaseType_t xPffRemove(pff_t * pxPff, address_t xAddress, qosId_t xQosId)
+{
+	const pffEntry_t * pxOld;
+	pffEntry_t * pxEntry;
+	BaseType_t xReturn;
+
+	if (!pxPff) {
+		ESP_LOGE(TAG_PFF, "Bogus instance passed");
+		return pdFALSE;
+	}
+
+	xSemaphoreTake(pxPff->xWriteLock, portMAX_DELAY);
+
+	pxOld = pxPff->pxTable->pxEntries[xAddress];
+	pxEntry = pxPffEntryCopy(pxOld, xQosId, 0);
+	if (!pxEntry) {
+		xSemaphoreGive(pxPff->xWriteLock);
+		return pdFALSE;
+	}
+
+	if (!pxOld || pxEntry->uxRoutes == pxOld->uxRoutes) {
+		xSemaphoreGive(pxPff->xWriteLock);
+		ESP_LOGE(TAG_PFF, "No route to address %u qos-id %u", xAddress, xQosId);
+		vPortFree(pxEntry);
+		return pdFALSE;
+	}
+
+	if (pxEntry->uxRoutes == 0) {
+		vPortFree(pxEntry);
+		pxEntry = NULL;
+	}
+
+	xReturn = xPffUpdate(pxPff, xAddress, pxEntry);
+
+	xSemaphoreGive(pxPff->xWriteLock);
+
+	return xReturn;
+}
+
+void vPffFlush(pff_t * pxPff)
+{
+	pffTable_t * pxNew, * pxOld;
+	UBaseType_t uxAddress;
+
+	if (!pxPff)
+		return;
+
+	pxNew = pvPortMalloc(sizeof(*pxNew));
+	if (!pxNew) {
+		ESP_LOGE(TAG_PFF, "Failed to flush the PFF");
+		return;
+	}
+	memset(pxNew, 0, sizeof(*pxNew));
+
+	xSemaphoreTake(pxPff->xWriteLock, portMAX_DELAY);
+
+	pxOld = pxPffSwap(pxPff, pxNew);
+	for (uxAddress = 0; uxAddress < PFF_ADDRESSES; uxAddress++)
+		vPortFree(pxOld->pxEntries[uxAddress]);
+	vPortFree(pxOld);
+
+	xSemaphoreGive(pxPff->xWriteLock);
+}
+
+size_t uxPffNextHops(pff_t * pxPff, address_t xAddress, qosId_t xQosId,
+		     portId_t * pxPorts, size_t uxMax)
+{
+	const pffTable_t * pxTable;
+	const pffEntry_t * pxEntry;
+	const pffRoute_t * pxRoute = NULL;
+	size_t uxPorts = 0;
+	uint32_t ulGeneration;
+
+	pxTable = pxPffReadLock(pxPff, &ulGeneration);
+
+	pxEntry = pxTable->pxEntries[xAddress];
+	if (pxEntry)
+		pxRoute = pxPffEntryRoute(pxEntry, xQosId);
+
+	if (pxRoute) {
+		uxPorts = pxRoute->uxPorts < uxMax ? pxRoute->uxPorts : uxMax;
+		memcpy(pxPorts, pxRoute->xPorts, uxPorts * sizeof(portId_t));
+	}
+
+	vPffReadUnlock(pxPff, ulGeneration);
+
+	return uxPorts;
+}
@@ -0,0 +1,484 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "Rmt.h"
+#include "rmtPs.h"
+#include "du.h"
+
+/* Fixed point of the WFQ virtual times, keeps the small weights apart */
+#define RMT_WFQ_SHIFT		( 8 )
+
+/* Virtual times wrap, a is later than b if less than half way round */
+#define RMT_WFQ_AFTER(a, b)	((int32_t)((a) - (b)) > 0)
+
+/* AQM times are in us and wrap too, has now reached t */
+#define RMT_AQM_REACHED(now, t)	((int32_t)((now) - (t)) >= 0)
+
+/* The PDUs of one qos-id waiting on an N-1 port, oldest first */
+typedef struct xRMT_QUEUE {
+	/* qos-id of the PDUs, only meaningful while uxCount > 0 */
+	qosId_t			xQosId;
+	UBaseType_t		uxHead;
+	UBaseType_t		uxCount;
+	struct du_t *	pxDus[ RMT_QUEUE_LENGTH ];
+
+	/* WFQ: virtual finish time of each PDU */
+	uint32_t		ulFinish[ RMT_QUEUE_LENGTH ];
+
+	/* DRR: bytes the queue can still send in this round */
+	uint32_t		ulDeficit;
+
+	/* AQM: when each PDU was queued, in us */
+	uint32_t		ulEnqueuedUs[ RMT_QUEUE_LENGTH ];
+
+	/* AQM: when the PDUs will have waited too long for an interval (0
+	 * while they don't), and while marking, the next mark and how many
+	 * were made */
+	uint32_t		ulFirstAboveUs;
+	BaseType_t		xMarking;
+	uint32_t		ulMarkNextUs;
+	uint32_t		ulMarks;
+}rmtQueue_t;
+
+/* pvRmtPsQueues of an N-1 port. A queue is taken by a qos-id when its
+ * first PDU waits and given back once it is empty, so up to
+ * RMT_QOS_QUEUES qos-ids can be backlogged on the port at once. */
+typedef struct xRMT_PS_QUEUES {
+	rmtQueue_t		xQueues[ RMT_QOS_QUEUES ];
+
+	/* DRR: queue served, and whether it got its quantum for this round */
+	UBaseType_t		uxCurrent;
+	BaseType_t		xQuantumGiven;
+
+	/* WFQ: finish time of the last PDU sent */
+	uint32_t		ulVirtualTime;
+}rmtPsQueues_t;
+
+static void * pvRmtPsQCreate(rmt_t * pxRmt, rmtN1Port_t * pxN1Port)
+{
+	rmtPsQueues_t * pxQueues;
+
+	(void)pxRmt;
+
+	pxQueues = pvPortMalloc(sizeof(*pxQueues));
+	if (!pxQueues) {
+		ESP_LOGE(TAG_RMT_PS, "No memory for the queues of port-id %d", pxN1Port->xPortId);
+		return NULL;
+	}
+
+	memset(pxQueues, 0, sizeof(*pxQueues));
+
+	return pxQueues;
+}
+
+static void vRmtPsQDestroy(rmt_t * pxRmt, rmtN1Port_t * pxN1Port)
+{
+	rmtPsQueues_t * pxQueues = pxN1Port->pvRmtPsQueues;
+	rmtQueue_t * pxQueue;
+	UBaseType_t uxQueue;
+
+	(void)pxRmt;
+
+	if (!pxQueues)
+		return;
+
+	for (uxQueue = 0; uxQueue < RMT_QOS_QUEUES; uxQueue++) {
+		pxQueue = &pxQueues->xQueues[uxQueue];
+		while (pxQueue->uxCount > 0) {
+			xDuDestroy(pxQueue->pxDus[pxQueue->uxHead]);
+			pxQueue->uxHead = (pxQueue->uxHead + 1) % RMT_QUEUE_LENGTH;
+			pxQueue->uxCount--;
+		}
+	}
+
+	vPortFree(pxQueues);
+	pxN1Port->pvRmtPsQueues = NULL;
+}
+
+/* The queue of xQosId, or a free one for it, NULL if all are taken */
+static rmtQueue_t * pxRmtPsQueueFor(rmtPsQueues_t * pxQueues, qosId_t xQosId)
+{
+	rmtQueue_t * pxFree = NULL;
+	UBaseType_t uxQueue;
+
+	for (uxQueue = 0; uxQueue < RMT_QOS_QUEUES; uxQueue++) {
+		if (pxQueues->xQueues[uxQueue].uxCount == 0) {
+			if (!pxFree)
+				pxFree = &pxQueues->xQueues[uxQueue];
+		} else if (pxQueues->xQueues[uxQueue].xQosId == xQosId) {
+			return &pxQueues->xQueues[uxQueue];
+		}
+	}
+
+	/* The AQM starts over for another qos-id */
+	if (pxFree && pxFree->xQosId != xQosId) {
+		pxFree->xQosId = xQosId;
+		pxFree->ulFirstAboveUs = 0;
+		pxFree->xMarking = pdFALSE;
+		pxFree->ulMarks = 0;
+	}
+
+	return pxFree;
+}
+
+/* Put the PDU at the tail of pxQueue, returns the slot it took. A full
+ * queue drops it, the RMT counts and logs the drop. */
+static int xRmtPsQueuePush(rmtQueue_t * pxQueue, struct du_t * pxDu,
+			   UBaseType_t * puxSlot)
+{
+	UBaseType_t uxSlot;
+
+	if (!pxQueue || pxQueue->uxCount == RMT_QUEUE_LENGTH) {
+		xDuDestroy(pxDu);
+		return RMT_PS_ENQ_DROP;
+	}
+
+	uxSlot = (pxQueue->uxHead + pxQueue->uxCount) % RMT_QUEUE_LENGTH;
+	pxQueue->pxDus[uxSlot] = pxDu;
+	pxQueue->ulEnqueuedUs[uxSlot] = (uint32_t)esp_timer_get_time();
+	pxQueue->uxCount++;
+
+	if (puxSlot)
+		*puxSlot = uxSlot;
+
+	return RMT_PS_ENQ_SCHED;
+}
+
+#if ( RMT_AQM_TARGET_US > 0 )
+
+static uint32_t ulRmtPsSqrt(uint32_t ulValue)
+{
+	uint32_t ulRoot = 0;
+	uint32_t ulBit = 1UL << 30;
+
+	while (ulBit > ulValue)
+		ulBit >>= 2;
+
+	while (ulBit) {
+		if (ulValue >= ulRoot + ulBit) {
+			ulValue -= ulRoot + ulBit;
+			ulRoot = (ulRoot >> 1) + ulBit;
+		} else {
+			ulRoot >>= 1;
+		}
+		ulBit >>= 2;
+	}
+
+	return ulRoot;
+}
+
+/* The next mark, interval / sqrt(marks) after the last one. The root is
+ * taken in 8 bits of fixed point, the integer one alone is too coarse. */
+static uint32_t ulRmtPsAqmNext(uint32_t ulFromUs, uint32_t ulMarks)
+{
+	if (ulMarks > 0xFFFF)
+		ulMarks = 0xFFFF;
+
+	return ulFromUs + ((uint32_t)RMT_AQM_INTERVAL_US << 8) / ulRmtPsSqrt(ulMarks << 16);
+}
+
+/* CoDel, marking where it would drop: pdTRUE if the PDU leaving after
+ * waiting ulSojournUs must be marked. */
+static BaseType_t xRmtPsAqmCheck(rmtQueue_t * pxQueue, uint32_t ulNowUs, uint32_t ulSojournUs)
+{
+	BaseType_t xAbove = pdFALSE;
+
+	/* Under the target, or the last PDU: the queue drains by itself */
+	if (ulSojournUs < RMT_AQM_TARGET_US || pxQueue->uxCount == 0)
+		pxQueue->ulFirstAboveUs = 0;
+	else if (pxQueue->ulFirstAboveUs == 0)
+		pxQueue->ulFirstAboveUs = (ulNowUs + RMT_AQM_INTERVAL_US) | 1;
+	else if (RMT_AQM_REACHED(ulNowUs, pxQueue->ulFirstAboveUs))
+		xAbove = pdTRUE;
+
+	if (pxQueue->xMarking) {
+		if (!xAbove) {
+			pxQueue->xMarking = pdFALSE;
+			return pdFALSE;
+		}
+
+		if (!RMT_AQM_REACHED(ulNowUs, pxQueue->ulMarkNextUs))
+			return pdFALSE;
+
+		pxQueue->ulMarks++;
+		pxQueue->ulMarkNextUs = ulRmtPsAqmNext(pxQueue->ulMarkNextUs, pxQueue->ulMarks);
+
+		return pdTRUE;
+	}
+
+	if (!xAbove)
+		return pdFALSE;
+
+	/* Back soon after the last time: go on near the rate it had */
+	pxQueue->xMarking = pdTRUE;
+	if (pxQueue->ulMarks > 2 &&
+	    ulNowUs - pxQueue->ulMarkNextUs < 16 * RMT_AQM_INTERVAL_US)
+		pxQueue->ulMarks -= 2;
+	else
+		pxQueue->ulMarks = 1;
+	pxQueue->ulMarkNextUs = ulRmtPsAqmNext(ulNowUs, pxQueue->ulMarks);
+
+	return pdTRUE;
+}
+
+/* Only the data PDUs are marked, their DTP is the one that can slow down */
+static void vRmtPsAqmMark(rmtN1Port_t * pxN1Port, struct du_t * pxDu)
+{
+	if (pxDu->pxPci->xType != PDU_TYPE_DT)
+		return;
+
+	if (!xDuMakeWritable(pxDu))
+		return;
+
+	pxDu->pxPci->xFlags |= PDU_FLAGS_EXPLICIT_CONGESTION;
+	pxN1Port->xStats.ecnPdus++;
+}
+
+#endif
+
+static struct du_t * pxRmtPsQueuePop(rmtN1Port_t * pxN1Port, rmtQueue_t * pxQueue)
+{
+	struct du_t * pxDu = pxQueue->pxDus[pxQueue->uxHead];
+#if ( RMT_AQM_TARGET_US > 0 )
+	uint32_t ulNowUs = (uint32_t)esp_timer_get_time();
+	uint32_t ulSojournUs = ulNowUs - pxQueue->ulEnqueuedUs[pxQueue->uxHead];
+#endif
+
+	pxQueue->pxDus[pxQueue->uxHead] = NULL;
+	pxQueue->uxHead = (pxQueue->uxHead + 1) % RMT_QUEUE_LENGTH;
+	pxQueue->uxCount--;
+
+#if ( RMT_AQM_TARGET_US > 0 )
+	if (xRmtPsAqmCheck(pxQueue, ulNowUs, ulSojournUs))
+		vRmtPsAqmMark(pxN1Port, pxDu);
+#endif
+
+	return pxDu;
+}
+
+static qosId_t xRmtPsDuQosId(const struct du_t * pxDu)
+{
+	return pxDu->pxPci->connectionId_t.xQosId;
+}
+
+/* default: a single FIFO, the PDUs leave in the order they came */
+
+static int xRmtPsFifoEnqueue(rmt_t * pxRmt, rmtN1Port_t * pxN1Port,
+			     struct du_t * pxDu, BaseType_t xMustEnqueue)
+{
+	rmtPsQueues_t * pxQueues = pxN1Port->pvRmtPsQueues;
+
+	(void)pxRmt;
+
+	if (!xMustEnqueue)
+		return RMT_PS_ENQ_SEND;
+
+	return xRmtPsQueuePush(&pxQueues->xQueues[0], pxDu, NULL);
+}
+
+static struct du_t * pxRmtPsFifoDequeue(rmt_t * pxRmt, rmtN1Port_t * pxN1Port)
+{
+	rmtPsQueues_t * pxQueues = pxN1Port->pvRmtPsQueues;
+
+	(void)pxRmt;
+
+	if (pxQueues->xQueues[0].uxCount == 0)
+		return NULL;
+
+	return pxRmtPsQueuePop(pxN1Port, &pxQueues->xQueues[0]);
+}
+
+/* A queue for each backlogged qos-id, shared by the schedulers below */
+
+static int xRmtPsQosEnqueue(rmt_t * pxRmt, rmtN1Port_t * pxN1Port,
+			    struct du_t * pxDu, BaseType_t xMustEnqueue)
+{
+	rmtPsQueues_t * pxQueues = pxN1Port->pvRmtPsQueues;
+
+	(void)pxRmt;
+
+	if (!xMustEnqueue)
+		return RMT_PS_ENQ_SEND;
+
+	return xRmtPsQueuePush(pxRmtPsQueueFor(pxQueues, xRmtPsDuQosId(pxDu)), pxDu, NULL);
+}
+
+/* strict-priority: the queue of the highest weight, the lowest qos-id
+ * between equal weights. Lower ones wait as long as it has PDUs. */
+
+static struct du_t * pxRmtPsPrioDequeue(rmt_t * pxRmt, rmtN1Port_t * pxN1Port)
+{
+	rmtPsQueues_t * pxQueues = pxN1Port->pvRmtPsQueues;
+	rmtQueue_t * pxBest = NULL;
+	rmtQueue_t * pxQueue;
+	UBaseType_t uxQueue;
+
+	for (uxQueue = 0; uxQueue < RMT_QOS_QUEUES; uxQueue++) {
+		pxQueue = &pxQueues->xQueues[uxQueue];
+		if (pxQueue->uxCount == 0)
+			continue;
+
+		if (!pxBest ||
+		    pxRmt->ucWeights[pxQueue->xQosId] > pxRmt->ucWeights[pxBest->xQosId] ||
+		    (pxRmt->ucWeights[pxQueue->xQosId] == pxRmt->ucWeights[pxBest->xQosId] &&
+		     pxQueue->xQosId < pxBest->xQosId))
+			pxBest = pxQueue;
+	}
+
+	return pxBest ? pxRmtPsQueuePop(pxN1Port, pxBest) : NULL;
+}
+
+/* drr: the queues take turns, each sending up to weight * RMT_DRR_QUANTUM
+ * bytes per round plus what it could not use of the last one. */
+
+static struct du_t * pxRmtPsDrrDequeue(rmt_t * pxRmt, rmtN1Port_t * pxN1Port)
+{
+	rmtPsQueues_t * pxQueues = pxN1Port->pvRmtPsQueues;
+	rmtQueue_t * pxQueue;
+	UBaseType_t uxQueue;
+	uint32_t ulBytes;
+
+	for (uxQueue = 0; uxQueue < RMT_QOS_QUEUES; uxQueue++) {
+		if (pxQueues->xQueues[uxQueue].uxCount > 0)
+			break;
+	}
+	if (uxQueue == RMT_QOS_QUEUES)
+		return NULL;
+
+	for (;;) {
+		pxQueue = &pxQueues->xQueues[pxQueues->uxCurrent];
+
+		if (pxQueue->uxCount > 0) {
+			if (!pxQueues->xQuantumGiven) {
+				pxQueue->ulDeficit += (uint32_t)pxRmt->ucWeights[pxQueue->xQosId] * RMT_DRR_QUANTUM;
+				pxQueues->xQuantumGiven = pdTRUE;
+			}
+
+			ulBytes = (uint32_t)xDuLen(pxQueue->pxDus[pxQueue->uxHead]);
+			if (ulBytes <= pxQueue->ulDeficit) {
+				pxQueue->ulDeficit -= ulBytes;
+				if (pxQueue->uxCount == 1) {
+					/* An idle queue keeps no credit */
+					pxQueue->ulDeficit = 0;
+					pxQueues->uxCurrent = (pxQueues->uxCurrent + 1) % RMT_QOS_QUEUES;
+					pxQueues->xQuantumGiven = pdFALSE;
+				}
+				return pxRmtPsQueuePop(pxN1Port, pxQueue);
+			}
+		}
+
+		pxQueues->uxCurrent = (pxQueues->uxCurrent + 1) % RMT_QOS_QUEUES;
+		pxQueues->xQuantumGiven = pdFALSE;
+	}
+}
+
+/* wfq: self-clocked fair queueing. Each PDU is stamped with the virtual
+ * time it would finish at if the link were shared by weight, and the
+ * earliest stamp goes first. */
+
+static int xRmtPsWfqEnqueue(rmt_t * pxRmt, rmtN1Port_t * pxN1Port,
+			    struct du_t * pxDu, BaseType_t xMustEnqueue)
+{
+	rmtPsQueues_t * pxQueues = pxN1Port->pvRmtPsQueues;
+	rmtQueue_t * pxQueue;
+	UBaseType_t uxSlot;
+	uint32_t ulStart;
+	int xReturn;
+
+	if (!xMustEnqueue)
+		return RMT_PS_ENQ_SEND;
+
+	pxQueue = pxRmtPsQueueFor(pxQueues, xRmtPsDuQosId(pxDu));
+
+	/* Starts when the one before it in the queue finishes, or now */
+	ulStart = pxQueues->ulVirtualTime;
+	if (pxQueue && pxQueue->uxCount > 0) {
+		uxSlot = (pxQueue->uxHead + pxQueue->uxCount - 1) % RMT_QUEUE_LENGTH;
+		if (RMT_WFQ_AFTER(pxQueue->ulFinish[uxSlot], ulStart))
+			ulStart = pxQueue->ulFinish[uxSlot];
+	}
+
+	xReturn = xRmtPsQueuePush(pxQueue, pxDu, &uxSlot);
+	if (xReturn == RMT_PS_ENQ_SCHED)
+		pxQueue->ulFinish[uxSlot] = ulStart +
+			((uint32_t)xDuLen(pxDu) << RMT_WFQ_SHIFT) / pxRmt->ucWeights[pxQueue->xQosId];
+
+	return xReturn;
+}
+
+static struct du_t * pxRmtPsWfqDequeue(rmt_t * pxRmt, rmtN1Port_t * pxN1Port)
+{
+	rmtPsQueues_t * pxQueues = pxN1Port->pvRmtPsQueues;
+	rmtQueue_t * pxBest = NULL;
+	rmtQueue_t * pxQueue;
+	UBaseType_t uxQueue;
+
+	(void)pxRmt;
+
+	for (uxQueue = 0; uxQueue < RMT_QOS_QUEUES; uxQueue++) {
+		pxQueue = &pxQueues->xQueues[uxQueue];
+		if (pxQueue->uxCount == 0)
+			continue;
+
+		if (!pxBest || RMT_WFQ_AFTER(pxBest->ulFinish[pxBest->uxHead],
+					     pxQueue->ulFinish[pxQueue->uxHead]))
+			pxBest = pxQueue;
+	}
+
+	if (!pxBest)
+		return NULL;
+
+	pxQueues->ulVirtualTime = pxBest->ulFinish[pxBest->uxHead];
+
+	return pxRmtPsQueuePop(pxN1Port, pxBest);
+}
+
+static const rmtPs_t xRmtPolicySets[] = {
+	{
+		.pcName = RMT_PS_DEFAULT,
+		.rmtQCreatePolicy = pvRmtPsQCreate,
+		.rmtQDestroyPolicy = vRmtPsQDestroy,
+		.rmtEnqueuePolicy = xRmtPsFifoEnqueue,
+		.rmtDequeuePolicy = pxRmtPsFifoDequeue,
+	},
+	{
+		.pcName = RMT_PS_STRICT_PRIORITY,
+		.rmtQCreatePolicy = pvRmtPsQCreate,
+		.rmtQDestroyPolicy = vRmtPsQDestroy,
+		.rmtEnqueuePolicy = xRmtPsQosEnqueue,
+		.rmtDequeuePolicy = pxRmtPsPrioDequeue,
+	},
+	{
+		.pcName = RMT_PS_DRR,
+		.rmtQCreatePolicy = pvRmtPsQCreate,
+		.rmtQDestroyPolicy = vRmtPsQDestroy,
+		.rmtEnqueuePolicy = xRmtPsQosEnqueue,
+		.rmtDequeuePolicy = pxRmtPsDrrDequeue,
+	},
+	{
+		.pcName = RMT_PS_WFQ,
+		.rmtQCreatePolicy = pvRmtPsQCreate,
+		.rmtQDestroyPolicy = vRmtPsQDestroy,
+		.rmtEnqueuePolicy = xRmtPsWfqEnqueue,
+		.rmtDequeuePolicy = pxRmtPsWfqDequeue,
+	},
+};
+
+const rmtPs_t * pxRmtPsFind(const char * pcName)
+{
+	UBaseType_t uxPs;
+
+	if (!pcName)
+		return NULL;
+
+	for (uxPs = 0; uxPs < sizeof(xRmtPolicySets) / sizeof(xRmtPolicySets[0]); uxPs++) {
+		if (!strcmp(xRmtPolicySets[uxPs].pcName, pcName))
+			return &xRmtPolicySets[uxPs];
+	}
+
+	return NULL;
+}
@@ -2,10 +2,10 @@
 #include <string.h>
 
 /* FreeRTOS includes. */
-#include "Freertos/FreeRTOS.h"
-#include "Freertos/task.h"
-#include "Freertos/queue.h"
-#include "Freertos/semphr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 #include "ShimIPCP.h"
 #include "factoryIPCP.h"
@@ -34,6 +34,9 @@ struct ipcpInstanceData_t
 	MACAddress_t *pxPhyDev;
 	struct flowSpec_t *pxFspec;
 
+	/* Source of the frames sent, made from pxPhyDev on the first write. */
+	gha_t *pxSrcHa;
+
 	/* The IPC Process using the shim-WiFi */
 	name_t *pxAppName;
 	name_t *pxDafName;
@@ -77,6 +80,12 @@ static BaseType_t prvShimFlowDestroy(struct ipcpInstanceData_t *xData, shimFlow_
 /* @brief Unbind and Destroy a Flow*/
 static BaseType_t prvShimUnbindDestroyFlow(struct ipcpInstanceData_t *xData, shimFlow_t *xFlow);
 
+/* @brief Tell the IPCPs using the allocated flows whether they can write */
+static void prvShimFlowsWritable(struct ipcpInstanceData_t *pxData, BaseType_t xWritable);
+
+/* @brief Called by the network interface once its TX ring has room again */
+static void prvShimTxResume(void *pvArgument);
+
 /** @brief  Concatenate the Information Application Name into a Complete Address
  * (ProcessName-ProcessInstance-EntityName-EntityInstance).
  * */
@@ -168,6 +177,7 @@ BaseType_t xShimEnrollToDIF(const MACAddress_t *pxPhyDev)
 BaseType_t xShimFlowDeallocate(struct ipcpInstanceData_t *xData, portId_t xId)
 {
 	shimFlow_t *xFlow;
+	BaseType_t xReturn;
 
 	if (!xData)
 	{
@@ -188,7 +198,12 @@ BaseType_t xShimFlowDeallocate(struct ipcpInstanceData_t *xData, portId_t xId)
 		return pdFALSE;
 	}
 
-	return prvShimUnbindDestroyFlow(xData, xFlow);
+	/* The TX task may be writing on the flow. */
+	vIpcpDataPlaneLock();
+	xReturn = prvShimUnbindDestroyFlow(xData, xFlow);
+	vIpcpDataPlaneUnlock();
+
+	return xReturn;
 }
 
 /*-------------------------------------------*/
@@ -260,6 +275,7 @@ BaseType_t xShimFlowAllocateRequest(portId_t xPortId,
 		pxFlow->ePortIdState = ePENDING;
 		pxFlow->pxDestPa = pxShimNameToGPA(pxDestinationInfo);
 		pxFlow->pxUserIpcp = pxUserIpcp;
+		vListInitialiseItem(&pxFlow->xFlowItem);
 
 		if (!xShimIsGPAOK(pxFlow->pxDestPa))
 		{
@@ -272,15 +288,20 @@ BaseType_t xShimFlowAllocateRequest(portId_t xPortId,
 		// Register the flow in a list or in the Flow allocator
 
 		ESP_LOGI(TAG_SHIM, "Created Flow: %p, portID: %d, portState: %d", pxFlow, pxFlow->xPortId, pxFlow->ePortIdState);
-		vListInitialiseItem(&pxFlow->xFlowItem);
 		listSET_LIST_ITEM_OWNER(&(pxFlow->xFlowItem), pxFlow);
+
+		/* The TX task looks flows up while it writes SDUs. */
+		vIpcpDataPlaneLock();
 		vListInsert(&pxData->xFlowsList, &pxFlow->xFlowItem);
+		vIpcpDataPlaneUnlock();
 
 		pxFlow->pxSduQueue = prvShimCreateQueue();
 		if (!pxFlow->pxSduQueue)
 		{
 			ESP_LOGE(TAG_SHIM, "Destination protocol address is not ok");
+			vIpcpDataPlaneLock();
 			prvShimUnbindDestroyFlow(pxData, pxFlow);
+			vIpcpDataPlaneUnlock();
 			return pdFALSE;
 		}
 
@@ -288,7 +309,9 @@ BaseType_t xShimFlowAllocateRequest(portId_t xPortId,
 
 		if (!xARPResolveGPA(pxFlow->pxDestPa, pxData->pxAppHandle->pxPa, pxData->pxAppHandle->pxHa))
 		{
+			vIpcpDataPlaneLock();
 			prvShimUnbindDestroyFlow(pxData, pxFlow);
+			vIpcpDataPlaneUnlock();
 			return pdFALSE;
 		}
 	}
@@ -379,11 +402,13 @@ BaseType_t xShimFlowAllocateResponse(struct ipcpInstanceData_t *pxShimInstanceDa
 	}
 
 	// spin_lock(&data->lock);
+	vIpcpDataPlaneLock();
 	pxFlow->ePortIdState = eALLOCATED;
 	pxFlow->xPortId = xPortId;
 	pxFlow->pxUserIpcp = pxUserIpcp;
 	
 	pxFlow->pxDestHa = pxARPLookupGHA(pxFlow->pxDestPa);
+	vIpcpDataPlaneUnlock();
 
 	/*
 	ESP_LOGE(TAG_SHIM, "Printing GHA founded:");
@@ -399,6 +424,18 @@ BaseType_t xShimFlowAllocateResponse(struct ipcpInstanceData_t *pxShimInstanceDa
 	return pdTRUE;
 }
 
+BaseType_t xShimFlowIsPending(struct ipcpInstanceData_t *pxShimInstanceData, portId_t xPortId)
+{
+	shimFlow_t *pxFlow;
+
+	if (!pxShimInstanceData || !IS_PORT_ID_OK(xPortId))
+		return pdFALSE;
+
+	pxFlow = prvShimFindFlowByPortId(pxShimInstanceData, xPortId);
+
+	return (pxFlow && pxFlow->ePortIdState == ePENDING) ? pdTRUE : pdFALSE;
+}
+
 /*-------------------------------------------*/
 /* @brief Primitive invoked before all other functions:
  * - Transform the naming-info structure into a single string (application-name)
@@ -727,7 +764,11 @@ string_t pcShimNameToString(const name_t *xNameInfo)
 	if (!xNameInfo)
 		return NULL;
 
-	pcNameInfoConcatenated = pvPortMalloc(strlen(xNameInfo->pcProcessName) + strlen(xNameInfo->pcProcessInstance) + 3 + strlen(xNameInfo->pcEntityName) + strlen(xNameInfo->pcEntityInstance));
+	/* Three delimiters and the terminator. */
+	pcNameInfoConcatenated = pvPortMalloc(strlen(xNameInfo->pcProcessName) + strlen(xNameInfo->pcProcessInstance) + 4 + strlen(xNameInfo->pcEntityName) + strlen(xNameInfo->pcEntityInstance));
+
+	if (!pcNameInfoConcatenated)
+		return NULL;
 
 	strcpy(pcNameInfoConcatenated, xNameInfo->pcProcessName);
 	strcat(pcNameInfoConcatenated, DELIMITER);
@@ -737,12 +778,6 @@ string_t pcShimNameToString(const name_t *xNameInfo)
 	strcat(pcNameInfoConcatenated, DELIMITER);
 	strcat(pcNameInfoConcatenated, xNameInfo->pcEntityInstance);
 
-	if (!pcNameInfoConcatenated)
-	{
-		vPortFree(pcNameInfoConcatenated);
-		return NULL;
-	}
-
 	//ESP_LOGI(TAG_SHIM, "Concatenated: %s", pcNameInfoConcatenated);
 
 	return pcNameInfoConcatenated;
@@ -756,8 +791,6 @@ static shimFlow_t *prvShimFindFlowByPortId(struct ipcpInstanceData_t *pxData, po
 	ListItem_t *pxListItem;
 	ListItem_t const *pxListEnd;
 
-	pxFlow = pvPortMalloc(sizeof(*pxFlow));
-
 	/* Find a way to iterate in the list and compare the addesss*/
 	pxListEnd = listGET_END_MARKER(&pxData->xFlowsList);
 	pxListItem = listGET_HEAD_ENTRY(&pxData->xFlowsList);
@@ -792,8 +825,6 @@ static shimFlow_t *prvShimFindFlow(struct ipcpInstanceData_t *pxData)
 	ListItem_t *pxListItem;
 	ListItem_t const *pxListEnd;
 
-	pxFlow = pvPortMalloc(sizeof(*pxFlow));
-
 	/* Find a way to iterate in the list and compare the addesss*/
 	pxListEnd = listGET_END_MARKER(&pxData->xFlowsList);
 	pxListItem = listGET_HEAD_ENTRY(&pxData->xFlowsList);
@@ -801,7 +832,7 @@ static shimFlow_t *prvShimFindFlow(struct ipcpInstanceData_t *pxData)
 	while (pxListItem != pxListEnd)
 	{
 
-		pxFlow = (shimFlow_t *)listGET_LIST_ITEM_VALUE(pxListItem);
+		pxFlow = (shimFlow_t *)listGET_LIST_ITEM_OWNER(pxListItem);
 
 		if (pxFlow)
 		{
@@ -958,14 +989,12 @@ static BaseType_t prvShimUnbindDestroyFlow(struct ipcpInstanceData_t *xData,
 										   shimFlow_t *xFlow)
 {
 
-	/*
-	if (flow->user_ipcp) {
-		ASSERT(flow->user_ipcp->ops);
-		flow->user_ipcp->ops->
-		flow_unbinding_ipcp(flow->user_ipcp->data,
-				flow->port_id);
-	}*/
-	// Check this
+	/* Only allocated flows were bound by the user IPCP */
+	if (xFlow->ePortIdState == eALLOCATED && xFlow->pxUserIpcp->pxOps->flowUnbindingIpcp)
+	{
+		xFlow->pxUserIpcp->pxOps->flowUnbindingIpcp(xFlow->pxUserIpcp->pxData,
+													xFlow->xPortId);
+	}
 	ESP_LOGI(TAG_SHIM, "Shim-WiFi unbinded port: %u", xFlow->xPortId);
 	if (prvShimFlowDestroy(xData, xFlow))
 	{
@@ -979,7 +1008,14 @@ static BaseType_t prvShimUnbindDestroyFlow(struct ipcpInstanceData_t *xData,
 static BaseType_t prvShimFlowDestroy(struct ipcpInstanceData_t *xData, shimFlow_t *xFlow)
 {
 
-	/* FIXME: Complete what to do with xData*/
+	/* The TX task goes through the flows while it writes SDUs. */
+	if (listIS_CONTAINED_WITHIN(&xData->xFlowsList, &xFlow->xFlowItem))
+	{
+		vIpcpDataPlaneLock();
+		(void)uxListRemove(&xFlow->xFlowItem);
+		vIpcpDataPlaneUnlock();
+	}
+
 	if (xFlow->pxDestPa)
 		vShimGPADestroy(xFlow->pxDestPa);
 	if (xFlow->pxDestHa)
@@ -1002,9 +1038,6 @@ BaseType_t xShimSDUWrite(struct ipcpInstanceData_t *pxData, portId_t xId, struct
 	gha_t *pxDestHw;
 	size_t uxHeadLen, uxLength;
 
-	RINAStackEvent_t xTxEvent = {eNetworkTxEvent, NULL};
-	const TickType_t xDescriptorWaitTime = pdMS_TO_TICKS(250);
-
 	unsigned char *pucArpPtr;
 
 	ESP_LOGI(TAG_SHIM, "Entered the sdu-write");
@@ -1016,7 +1049,7 @@ BaseType_t xShimSDUWrite(struct ipcpInstanceData_t *pxData, portId_t xId, struct
 	}
 
 	uxHeadLen = sizeof(EthernetHeader_t); // Header length Ethernet
-	uxLength = pxDu->pxNetworkBuffer->xDataLength; // total length PDU
+	uxLength = xDuLen(pxDu); // total length PDU, over all its segments
 
 	if (unlikely(uxLength > MTU))
 	{
@@ -1042,8 +1075,14 @@ BaseType_t xShimSDUWrite(struct ipcpInstanceData_t *pxData, portId_t xId, struct
 		return pdFALSE;
 	}
 
-	ESP_LOGI(TAG_SHIM, "SDUWrite: creating source GHA");
-	pxSrcHw = pxShimCreateGHA(MAC_ADDR_802_3, pxData->pxPhyDev);
+	/* The device address is only known once the shim is enrolled */
+	if (!pxData->pxSrcHa)
+	{
+		ESP_LOGI(TAG_SHIM, "SDUWrite: creating source GHA");
+		pxData->pxSrcHa = pxShimCreateGHA(MAC_ADDR_802_3, pxData->pxPhyDev);
+	}
+
+	pxSrcHw = pxData->pxSrcHa;
 	if (!pxSrcHw)
 	{
 		ESP_LOGE(TAG_SHIM, "Failed to get source HW addr");
@@ -1064,30 +1103,43 @@ BaseType_t xShimSDUWrite(struct ipcpInstanceData_t *pxData, portId_t xId, struct
 	}
 
 	ESP_LOGI(TAG_SHIM, "SDUWrite: Encapsulating packet into Ethernet Frame");
-	/* Get a Network Buffer with size total ethernet + PDU size*/
 
-	pxNetworkBuffer = pxGetNetworkBufferWithDescriptor(uxHeadLen + uxLength, (TickType_t)0U);
+	/* Prepend the Ethernet header in place if the PDU buffer has headroom
+	 * left, and send that same buffer. A chained PDU stays chained down to
+	 * the driver. */
+	pxEthernetHeader = (EthernetHeader_t *)pucNetworkBufferPush(pxDu->pxNetworkBuffer, uxHeadLen);
 
-	if (pxNetworkBuffer == NULL)
+	if (pxEthernetHeader != NULL)
 	{
-		ESP_LOGE(TAG_SHIM, "pxNetworkBuffer is null");
-		xDuDestroy(pxDu);
-		return pdFALSE;
+		pxNetworkBuffer = pxDu->pxNetworkBuffer;
+		pxDu->pxNetworkBuffer = NULL;
 	}
+	else
+	{
+		/* Get a Network Buffer with size total ethernet + PDU size*/
+		pxNetworkBuffer = pxGetNetworkBufferWithDescriptor(uxHeadLen + uxLength, (TickType_t)0U);
 
-	pxEthernetHeader = CAST_CONST_PTR_TO_CONST_TYPE_PTR(EthernetHeader_t, pxNetworkBuffer->pucEthernetBuffer);
+		if (pxNetworkBuffer == NULL)
+		{
+			ESP_LOGE(TAG_SHIM, "pxNetworkBuffer is null");
+			xDuDestroy(pxDu);
+			return pdFALSE;
+		}
 
-	pxEthernetHeader->usFrameType = FreeRTOS_htons(ETH_P_RINA);
+		pxEthernetHeader = CAST_CONST_PTR_TO_CONST_TYPE_PTR(EthernetHeader_t, pxNetworkBuffer->pucEthernetBuffer);
 
-	memcpy(pxEthernetHeader->xSourceAddress.ucBytes, pxSrcHw->xAddress.ucBytes, sizeof(pxSrcHw->xAddress));
-	memcpy(pxEthernetHeader->xDestinationAddress.ucBytes, pxDestHw->xAddress.ucBytes, sizeof(pxDestHw->xAddress));
+		/*Copy from the buffer PDU to the buffer Ethernet*/
+		pucArpPtr = (unsigned char *)(pxEthernetHeader + 1);
 
-	/*Copy from the buffer PDU to the buffer Ethernet*/
-	pucArpPtr = (unsigned char *)(pxEthernetHeader + 1);
+		(void)uxNetworkBufferGather(pxDu->pxNetworkBuffer, pucArpPtr, uxLength);
 
-	memcpy(pucArpPtr, pxDu->pxNetworkBuffer->pucEthernetBuffer, uxLength);
+		pxNetworkBuffer->xDataLength = uxHeadLen + uxLength;
+	}
 
-	pxNetworkBuffer->xDataLength = uxHeadLen + uxLength;
+	pxEthernetHeader->usFrameType = FreeRTOS_htons(ETH_P_RINA);
+
+	memcpy(pxEthernetHeader->xSourceAddress.ucBytes, pxSrcHw->xAddress.ucBytes, sizeof(pxSrcHw->xAddress));
+	memcpy(pxEthernetHeader->xDestinationAddress.ucBytes, pxDestHw->xAddress.ucBytes, sizeof(pxDestHw->xAddress));
 
 	/* Generate an event to sent or send from here*/
 	/* Destroy pxDU no need anymore the stackbuffer*/
@@ -1098,22 +1150,65 @@ BaseType_t xShimSDUWrite(struct ipcpInstanceData_t *pxData, portId_t xId, struct
 
 	/* ReleaseBuffer, no need anymore that why pdTRUE here */
 
-	xTxEvent.pvData = (void *)pxNetworkBuffer;
-
-		if (xSendEventStructToIPCPTask(&xTxEvent, xDescriptorWaitTime) == pdFAIL)
-		{
-			ESP_LOGE(TAG_WIFI, "Failed to enqueue packet to network stack %p, len %d", pxNetworkBuffer,pxNetworkBuffer->xDataLength);
-			vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
-			return ESP_FAIL;
-		}
+	/* Queue the frame on the interface TX ring, the IPCP task sends all the
+	 * frames queued in one go. A full ring drops the frame rather than
+	 * blocking the writer. */
+	if (xNetworkInterfaceEnqueue(pxNetworkBuffer) == pdFALSE)
+	{
+		ESP_LOGE(TAG_SHIM, "Failed to enqueue packet to network stack");
+		return pdFALSE;
+	}
 
-		ESP_LOGE(TAG_SHIM, "Data sent to the IPCP TAsk");
+	/* The flows share the ring, they all stop until it drains. */
+	if (xNetworkInterfaceTxStop() && !pxData->ucTxBusy)
+	{
+		pxData->ucTxBusy = 1;
+		prvShimFlowsWritable(pxData, pdFALSE);
+	}
 
-	
+	ESP_LOGI(TAG_SHIM, "Data queued for the IPCP Task");
 
 	return pdTRUE;
 }
 
+static void prvShimFlowsWritable(struct ipcpInstanceData_t *pxData, BaseType_t xWritable)
+{
+	shimFlow_t *pxFlow;
+	struct ipcpInstanceOps_t *pxOps;
+
+	ListItem_t *pxListItem;
+	ListItem_t const *pxListEnd;
+
+	pxListEnd = listGET_END_MARKER(&pxData->xFlowsList);
+	pxListItem = listGET_HEAD_ENTRY(&pxData->xFlowsList);
+
+	while (pxListItem != pxListEnd)
+	{
+		pxFlow = (shimFlow_t *)listGET_LIST_ITEM_OWNER(pxListItem);
+		pxListItem = listGET_NEXT(pxListItem);
+
+		if (!pxFlow || pxFlow->ePortIdState != eALLOCATED)
+			continue;
+
+		pxOps = pxFlow->pxUserIpcp->pxOps;
+
+		if (xWritable && pxOps->enableWrite)
+			pxOps->enableWrite(pxFlow->pxUserIpcp->pxData, pxFlow->xPortId);
+		else if (!xWritable && pxOps->disableWrite)
+			pxOps->disableWrite(pxFlow->pxUserIpcp->pxData, pxFlow->xPortId);
+	}
+}
+
+static void prvShimTxResume(void *pvArgument)
+{
+	struct ipcpInstanceData_t *pxData = (struct ipcpInstanceData_t *)pvArgument;
+
+	vIpcpDataPlaneLock();
+	pxData->ucTxBusy = 0;
+	prvShimFlowsWritable(pxData, pdTRUE);
+	vIpcpDataPlaneUnlock();
+}
+
 static struct ipcpInstanceOps_t xShimWifiOps = {
 	.flowAllocateRequest = xShimFlowAllocateRequest,   // ok
 	.flowAllocateResponse = xShimFlowAllocateResponse, // ok
@@ -1154,11 +1249,13 @@ static struct ipcpInstanceOps_t xShimWifiOps = {
 	.difName = NULL,  // ok
 	//.ipcp_id		  		   = NULL,
 
-	//.set_policy_set_param      = NULL,
-	//.select_policy_set         = NULL,
+	.setPolicySetParam = NULL, // ok
+	.selectPolicySet = NULL,   // ok
 	//.update_crypto_state	   = NULL,
 	//.address_change            = NULL,
 	//.dif_name		   		   = NULL,
+	.enableWrite = NULL,  // ok
+	.disableWrite = NULL, // ok
 	.maxSduSize = NULL};
 
 /************* CREATED, DESTROY, INIT, CLEAN SHIM IPCP ******/
@@ -1208,6 +1305,7 @@ ipcpInstance_t *pxShimWiFiCreate(struct ipcpFactoryData_t *pxFactoryData, ipcPro
 	pxInst->pxData->pxName = pxName;
 	pxInst->pxData->xId = xIpcpId;
 	pxInst->pxData->pxPhyDev = pxPhyDev;
+	pxInst->pxData->pxSrcHa = NULL;
 
 	pxInst->pxData->pcIntefaceName = pcIntefaceName;
 
@@ -1230,6 +1328,10 @@ ipcpInstance_t *pxShimWiFiCreate(struct ipcpFactoryData_t *pxFactoryData, ipcPro
 	/*Initialialise flows list*/
 	vListInitialise(&(pxInst->pxData->xFlowsList));
 
+	/* Writes stop while the TX ring of the interface is nearly full */
+	pxInst->pxData->ucTxBusy = 0;
+	vNetworkInterfaceSetTxResumeHook(prvShimTxResume, pxInst->pxData);
+
 	/*Initialialise instance item and add to the pxFactory*/
 	vListInitialiseItem(&(pxInst->pxData->xInstanceListItem));
 	listSET_LIST_ITEM_OWNER(&(pxInst->pxData->xInstanceListItem), pxInst);
@@ -85,6 +85,9 @@ BaseType_t xShimFlowAllocateRequest(portId_t xId,
 
 BaseType_t xShimFlowAllocateResponse(struct ipcpInstanceData_t *pxShimInstanceData, ipcpInstance_t *pxUserIpcp, portId_t xPortId);
 
+/* pdTRUE while the flow of xPortId waits for the address of its peer. */
+BaseType_t xShimFlowIsPending(struct ipcpInstanceData_t *pxShimInstanceData, portId_t xPortId);
+
 
 /*-------------------------------------------*/
 /* FlowDeallocate.
@@ -4,7 +4,9 @@
 /************* SHIM WIFI CONFIGURATION ***********/
 	#define SHIM_WIFI_MODULE					( 1 ) //Zero if not shim WiFi modules is required.
 
+	#ifndef SHIM_PROCESS_NAME
 	#define SHIM_PROCESS_NAME     					"wlan0.ue"
+	#endif
 	#define SHIM_PROCESS_INSTANCE      				"1"
 	#define SHIM_ENTITY_NAME     					""
 	#define SHIM_ENTITY_INSTANCE      				""
@@ -21,7 +23,9 @@
 
 /*********** NORMAL CONFIGURATION ****************/
 
+	#ifndef NORMAL_PROCESS_NAME
 	#define NORMAL_PROCESS_NAME     					"ue1.mobile"
+	#endif
 	#define NORMAL_PROCESS_INSTANCE      				"1"
 	#define NORMAL_ENTITY_NAME     						""
 	#define NORMAL_ENTITY_INSTANCE      				""
@@ -29,15 +33,31 @@
 
 	#define NORMAL_DIF_NAME  							"mobile.DIF"
 
+	/* The IPCP waits for its neighbors to enroll to it (the access
+	 * router) instead of enrolling to them. */
+	#ifndef NORMAL_ENROLLER
+	#define NORMAL_ENROLLER							( 0 )
+	#endif
+
 	/*********** NORMAL IPCP CONFIGURATION ****************/
 	/**** Known IPCProcess Address *****/
+	/* The names and addresses can be overridden from the build, the host
+	 * simulator builds the stack once per side of the link. */
+	#ifndef LOCAL_ADDRESS
 	#define LOCAL_ADDRESS							( 1 )
+	#endif
 	#define LOCAL_ADDRESS_AP_INSTANCE				"1"
+	#ifndef LOCAL_ADDRESS_AP_NAME
 	#define LOCAL_ADDRESS_AP_NAME					"ue1.mobile"
+	#endif
 
+	#ifndef REMOTE_ADDRESS
 	#define REMOTE_ADDRESS							( 3 )
+	#endif
 	#define REMOTE_ADDRESS_AP_INSTANCE				"1"
+	#ifndef REMOTE_ADDRESS_AP_NAME
 	#define REMOTE_ADDRESS_AP_NAME					"ar1.mobile"
+	#endif
 
 	/**** QoS CUBES ****/
 	#define QoS_CUBE_NAME 							"unreliable"
@@ -51,6 +71,11 @@
 	#define DTP_POLICY_SET_VERSION					"0"
 
 	#define DTP_INITIAL_A_TIMER						( 300 )
+
+	/* Maximum PDU lifetime (MPL) in ms. A DTP sender starts a new data run
+	 * after 3 (MPL + R + A) without sending, a receiver expects one after
+	 * 2 (MPL + R + A) without receiving; R is 0 without DTCP. */
+	#define DTP_MAX_PDU_LIFETIME					( 1000 )
 	#define DTP_DTCP_PRESENT						pdFALSE
 		
 #endif
@@ -50,6 +50,50 @@
     /*TAG for Debugging*/
 	#define TAG_WIFI							"[NetInterface]"
 
+	/* Received frames stay in the Wi-Fi driver buffer, wrapped by a network
+	 * buffer, instead of being copied into the pool. The driver buffer is only
+	 * given back when the stack releases the frame, so the driver may run out
+	 * of receive buffers sooner. Can be changed at run time with
+	 * vNetworkInterfaceSetRxZeroCopy(). Off by default: with the host
+	 * stand-in (rinasense_rxbench) it takes 2-3 times longer per frame than
+	 * copying, as the frames hold the few receive slots of the driver, so
+	 * enable it only where it measures faster on the target. */
+	#ifndef NETWORK_INTERFACE_RX_ZERO_COPY
+	#define NETWORK_INTERFACE_RX_ZERO_COPY		( 0 )
+	#endif
+
+	/* Frames to send are queued on a ring of NETWORK_INTERFACE_TX_RING
+	 * entries and the IPCP task is woken once to drain everything queued,
+	 * up to NETWORK_INTERFACE_TX_BURST frames at a time. The host port takes
+	 * them in one backend call, the ESP32 driver one frame per call. A frame
+	 * that finds the ring full is dropped instead of blocking the sender.
+	 * Writers with several frames at hand queue them with
+	 * uxNetworkInterfaceEnqueueBatch(). */
+	#ifndef NETWORK_INTERFACE_TX_RING
+	#define NETWORK_INTERFACE_TX_RING			( 16 )
+	#endif
+	#ifndef NETWORK_INTERFACE_TX_BURST
+	#define NETWORK_INTERFACE_TX_BURST			( 8 )
+	#endif
+
+	/* Writers are asked to stop once NETWORK_INTERFACE_TX_HIGH_WATER frames
+	 * are queued, and to resume when the ring is drained down to
+	 * NETWORK_INTERFACE_TX_LOW_WATER. The PDUs wait in the RMT queues
+	 * meanwhile, where they can be scheduled, instead of in the ring. */
+	#ifndef NETWORK_INTERFACE_TX_HIGH_WATER
+	#define NETWORK_INTERFACE_TX_HIGH_WATER		( NETWORK_INTERFACE_TX_RING * 3 / 4 )
+	#endif
+	#ifndef NETWORK_INTERFACE_TX_LOW_WATER
+	#define NETWORK_INTERFACE_TX_LOW_WATER		( NETWORK_INTERFACE_TX_RING / 4 )
+	#endif
+
+	/* Frames queued by the IPCP task itself, while it handles an event, are
+	 * sent at the end of that event instead of going through an
+	 * eNetworkTxEvent posted to its own queue. */
+	#ifndef NETWORK_INTERFACE_TX_DIRECT
+	#define NETWORK_INTERFACE_TX_DIRECT			( 1 )
+	#endif
+
 		//Delimiter for Encode name
 	#define DELIMITER 								"/"
 
@@ -59,10 +103,71 @@
 	#define NUM_NETWORK_BUFFER_DESCRIPTORS 		( 20 )
 	#define TAG_NETBUFFER						"[NetBuffer]"
 
+	/* Received frames are chained through pxNextBuffer and handed to the
+	 * IPCP task in bursts, one event per burst. A frame that finds the IPCP
+	 * task idle is passed on at once; while the task is busy, frames are
+	 * held until NETWORK_INTERFACE_RX_BURST of them are chained or the first
+	 * one has waited NETWORK_INTERFACE_RX_HOLD_US. A burst is bounded by the
+	 * NUM_NETWORK_BUFFER_ISR_DESCRIPTORS buffers the driver can hold. Off by
+	 * default: bursts save IPCP task events but the host rinasense_rxbench
+	 * takes fewer frames per second with a burst of 8 than with 1. */
+	#ifndef USE_LINKED_RX_MESSAGES
 	#define USE_LINKED_RX_MESSAGES				( 0 )
+	#endif
+	#ifndef NETWORK_INTERFACE_RX_BURST
+	#define NETWORK_INTERFACE_RX_BURST			( 8 )
+	#endif
+	#ifndef NETWORK_INTERFACE_RX_HOLD_US
+	#define NETWORK_INTERFACE_RX_HOLD_US		( 500 )
+	#endif
 	#define BUFFER_PADDING    					( 0 )
 	#define MTU									( 1500 )
 
+	/* Bytes left free in front of every new buffer so the PCI and the
+	 * Ethernet header can be pushed in place instead of copying the SDU. */
+	#define BUFFER_HEADROOM						( 32 )
+
+	/* Payload storage is carved at start-up into size classes so that taking
+	 * and releasing a buffer never touches the heap. A request is served from
+	 * the smallest class that fits and spills into a larger class when the
+	 * smaller one is exhausted. Slot sizes must be a multiple of sizeof(size_t). */
+	#define NETWORK_BUFFER_SMALL_SIZE			( 256 )
+	#define NETWORK_BUFFER_SMALL_COUNT			( 12 )
+	#define NETWORK_BUFFER_LARGE_SIZE			( 1536 + BUFFER_HEADROOM )
+	#define NETWORK_BUFFER_LARGE_COUNT			( NUM_NETWORK_BUFFER_DESCRIPTORS )
+
+	/* Buffers reserved for pxNetworkBufferGetFromISR(), so driver receive
+	 * callbacks never wait for buffers held by tasks. Each one owns a slot of
+	 * NETWORK_BUFFER_LARGE_SIZE bytes. */
+	#ifndef NUM_NETWORK_BUFFER_ISR_DESCRIPTORS
+	#define NUM_NETWORK_BUFFER_ISR_DESCRIPTORS	( 8 )
+	#endif
+
+	/* Driver receive buffers that can be wrapped at once by
+	 * pxNetworkBufferWrapFromISR(), including the ones still referenced by
+	 * clones after their ISR descriptor was released. */
+	#define NUM_NETWORK_BUFFER_EXTERNAL			( NUM_NETWORK_BUFFER_ISR_DESCRIPTORS * 2 )
+
+	/* Free descriptors cached per core, so that getting and releasing a
+	 * buffer usually takes neither the global lock nor the semaphore. 0
+	 * disables the magazines. The host build keeps one magazine per thread
+	 * instead, see vNetworkBufferMagazineFlush(). */
+	#define NETWORK_BUFFER_MAGAZINE_SIZE		( 4 )
+	#ifndef NETWORK_BUFFER_MAGAZINE_PER_THREAD
+	#define NETWORK_BUFFER_MAGAZINE_PER_THREAD	( 0 )
+	#endif
+
+	/* Free descriptors left in the global list at or below which the
+	 * magazines stop caching and hand their descriptors back. */
+	#ifndef NETWORK_BUFFER_MAGAZINE_LOW_WATER
+	#define NETWORK_BUFFER_MAGAZINE_LOW_WATER	( NETWORK_BUFFER_MAGAZINE_SIZE )
+	#endif
+
+	/* Builds vNetworkBufferBenchmark(). */
+	#ifndef NETWORK_BUFFER_BENCHMARK
+	#define NETWORK_BUFFER_BENCHMARK			( 0 )
+	#endif
+
 
 /*********   Configure ARP Parameters  ************/
 
@@ -89,6 +194,18 @@
  * 5 greater than the total number of network buffers. */
     #define EVENT_QUEUE_LENGTH          ( NUM_NETWORK_BUFFER_DESCRIPTORS + 5 )
 
+	/* The IPCP task takes its events from three lanes, served in order:
+	 * control (network down, enrollment, flow allocation, timers),
+	 * management (management PDUs to send and received ARP and management
+	 * frames) and data (EVENT_QUEUE_LENGTH entries). A lower lane with events
+	 * waiting is served after being passed over IPCP_EVENT_LANE_GUARD times
+	 * in a row, so data is never starved. */
+	#define IPCP_EVENT_LANE_CONTROL_LENGTH		( 8 )
+	#define IPCP_EVENT_LANE_MANAGEMENT_LENGTH	( 16 )
+	#ifndef IPCP_EVENT_LANE_GUARD
+	#define IPCP_EVENT_LANE_GUARD				( 4 )
+	#endif
+
 	/** @brief Maximum time the IPCP task is allowed to remain in the Blocked state.*/
  	#define MAX_IPCP_TASK_SLEEP_TIME    ( pdMS_TO_TICKS( 10000UL ) )
 
@@ -110,12 +227,115 @@
 
 	#define IPCP_TASK_STACK_SIZE_WORDS           ( configMINIMAL_STACK_SIZE * 5 )
 
+	/* The IPCP work is pipelined over three tasks: an RX task takes the
+	 * received frames and runs the data PDUs up through the RMT and EFCP, a
+	 * TX task runs the SDUs written by applications down through EFCP, the
+	 * RMT and the shim and hands the frames to the driver, and the IPCP task
+	 * keeps ARP, the RIB daemon, enrollment and flow allocation. RX and TX
+	 * share the data-plane lock over the RMT and EFCP, so they take turns
+	 * rather than run in parallel: the gain is that the driver and the
+	 * control events no longer wait for the data path. rinasim reports
+	 * how often they waited on each other. Set to 0 to run everything in
+	 * the IPCP task on small devices. */
+	#ifndef IPCP_USE_PIPELINE
+	#define IPCP_USE_PIPELINE                    ( 1 )
+	#endif
+
+	/* Frame bursts from the driver to the RX task and frames from the RX
+	 * task to the IPCP task. A power of two. */
+	#define IPCP_PIPELINE_RING_SIZE              ( 16 )
+
+	#define IPCP_RX_TASK_PRIORITY                ( configMAX_PRIORITIES - 2 )
+	#define IPCP_TX_TASK_PRIORITY                ( configMAX_PRIORITIES - 2 )
+	#define IPCP_RX_TASK_STACK_SIZE_WORDS        ( configMINIMAL_STACK_SIZE * 4 )
+	#define IPCP_TX_TASK_STACK_SIZE_WORDS        ( configMINIMAL_STACK_SIZE * 4 )
+
+	/* Core each task is pinned to, tskNO_AFFINITY to let the scheduler
+	 * choose. The Wi-Fi driver runs on core 0 of the ESP32. */
+	#ifndef IPCP_TASK_CORE
+	#define IPCP_TASK_CORE                       ( tskNO_AFFINITY )
+	#endif
+	#ifndef IPCP_RX_TASK_CORE
+	#define IPCP_RX_TASK_CORE                    ( tskNO_AFFINITY )
+	#endif
+	#ifndef IPCP_TX_TASK_CORE
+	#define IPCP_TX_TASK_CORE                    ( tskNO_AFFINITY )
+	#endif
+
 
 
 /*********   Configure Shim Parameters  ************/
 	/*TAG for Debugging*/
 	#define TAG_SHIM 							"[SHIM_WIFI]"
 
+/*********   Configure RMT Parameters **************/
+
+	/* Buckets of the N-1 port map of the RMT, keyed by port-id. Any number
+	 * of N-1 flows can be bound, a bucket for each keeps the lookups O(1).
+	 * A power of two. */
+	#ifndef RMT_N1_PORT_MAP_BUCKETS
+	#define RMT_N1_PORT_MAP_BUCKETS				( 16 )
+	#endif
+
+	/* Most N-1 ports the PFF gives for a destination address and qos-id. */
+	#ifndef PFF_MAX_NEXT_HOPS
+	#define PFF_MAX_NEXT_HOPS					( 4 )
+	#endif
+
+	/* The PFF can give several next hops, the RMT sends each connection
+	 * out of one of them. With 1 it also moves the connections off the
+	 * N-1 ports with long queues, which reorders their PDUs when it does. */
+	#ifndef RMT_MULTIPATH_QUEUE_DEPTH
+	#define RMT_MULTIPATH_QUEUE_DEPTH			( 0 )
+	#endif
+
+	/* Policy set scheduling the PDUs queued on the N-1 ports: "default"
+	 * (FIFO), "strict-priority", "drr" or "wfq". */
+	#ifndef RMT_POLICY_SET
+	#define RMT_POLICY_SET						"default"
+	#endif
+
+	/* qos-ids that can have PDUs queued on an N-1 port at once, and the
+	 * PDUs each of them can queue before the next ones are dropped. */
+	#ifndef RMT_QOS_QUEUES
+	#define RMT_QOS_QUEUES						( 4 )
+	#endif
+
+	#ifndef RMT_QUEUE_LENGTH
+	#define RMT_QUEUE_LENGTH					( 16 )
+	#endif
+
+	/* Weight of the qos-ids not given one: the precedence under
+	 * strict-priority, the share of the link under drr and wfq. At equal
+	 * weights strict-priority sends the lowest qos-id first, so with none
+	 * set it is qos-id 0, then 1, and so on. */
+	#ifndef RMT_QOS_WEIGHT_DEFAULT
+	#define RMT_QOS_WEIGHT_DEFAULT				( 1 )
+	#endif
+
+	/* Bytes a drr queue may send per round and unit of weight. */
+	#ifndef RMT_DRR_QUANTUM
+	#define RMT_DRR_QUANTUM						( 1500 )
+	#endif
+
+	/* AQM of the RMT queues, CoDel on the time the PDUs wait: once they
+	 * have waited more than the target for a whole interval, the data PDUs
+	 * leave with the ECN flag set, closer together the longer it lasts.
+	 * Both in us, a target of 0 turns it off. */
+	#ifndef RMT_AQM_TARGET_US
+	#define RMT_AQM_TARGET_US					( 5000 )
+	#endif
+
+	#ifndef RMT_AQM_INTERVAL_US
+	#define RMT_AQM_INTERVAL_US					( 100000 )
+	#endif
+
+	/* PDUs the RMT egress worker writes to an N-1 port per run before it
+	 * lets the other events of its task through. */
+	#ifndef RMT_EGRESS_BATCH
+	#define RMT_EGRESS_BATCH					( 8 )
+	#endif
+
 /*********   Configure EFCP PArameters **************/
 
 	#define EFCP_IMAP_ENTRIES     				( 5 )
@@ -123,6 +343,38 @@
 
 	#define MAX_SDU_SIZE						( 1000 )
 
+	/* A DTP sender whose PDUs the RMT marks with ECN halves the PDUs it
+	 * sent in the last time unit (in ms), then grows the rate by
+	 * 1/DTP_RATE_GROWTH of itself (plus one) per unit until it is back
+	 * to the rate it was cut from and no longer paced. The PDUs over the
+	 * rate wait for the next units in a queue of DTP_CWQ_LENGTH.
+	 * Only marks made by this node's own RMT cut the rate: there is no
+	 * DTCP to carry a mark back, so a relay's marks end at the receiving
+	 * DTP, which only counts them (ecn_pdus). */
+	#ifndef DTP_RATE_TIME_UNIT
+	#define DTP_RATE_TIME_UNIT					( 100 )
+	#endif
+
+	#ifndef DTP_RATE_MIN
+	#define DTP_RATE_MIN						( 1 )
+	#endif
+
+	#ifndef DTP_RATE_GROWTH
+	#define DTP_RATE_GROWTH						( 4 )
+	#endif
+
+	#ifndef DTP_CWQ_LENGTH
+	#define DTP_CWQ_LENGTH						( 16 )
+	#endif
+
+	/* Without DTCP nothing is retransmitted, so a DTP receiver delivers
+	 * a PDU past a gap and moves its window edge. A PDU that arrives
+	 * late, up to DTP_REORDER_WINDOW (at most 32) sequence numbers
+	 * behind the edge, is still delivered once; older ones are dropped. */
+	#ifndef DTP_REORDER_WINDOW
+	#define DTP_REORDER_WINDOW					( 32 )
+	#endif
+
 	#define TAG_RINA 							"[RINA_API]"
 
 
@@ -130,6 +382,16 @@
 	#define FLOW_DEFAULT_RECEIVE_BLOCK_TIME 	portMAX_DELAY
 	#define FLOW_DEFAULT_SEND_BLOCK_TIME 		portMAX_DELAY
 
+	/* Flows the applications can have bound at once, and SDUs each one
+	 * holds until the application reads them. */
+	#ifndef RINA_FLOWS_MAX
+	#define RINA_FLOWS_MAX						( 4 )
+	#endif
+
+	#ifndef RINA_FLOW_RX_QUEUE_LENGTH
+	#define RINA_FLOW_RX_QUEUE_LENGTH			( 64 )
+	#endif
+
 	#define INSTANCES_IPCP_ENTRIES				( 5 )
 
 
@@ -0,0 +1,41 @@
+/*
+ * bufbench.c
+ *
+ * Runs vNetworkBufferBenchmark() on the host:
+ *     rinasense_bufbench [producers] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "common.h"
+#include "BufferManagement.h"
+
+int main( int argc, char ** argv )
+{
+    UBaseType_t uxProducers = 4U;
+    uint32_t ulIterations = 1000000UL;
+
+    if( argc > 1 )
+    {
+        uxProducers = ( UBaseType_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    if( argc > 2 )
+    {
+        ulIterations = ( uint32_t ) strtoul( argv[ 2 ], NULL, 10 );
+    }
+
+    if( xNetworkBuffersInitialise() != pdTRUE )
+    {
+        fprintf( stderr, "xNetworkBuffersInitialise failed\n" );
+        return EXIT_FAILURE;
+    }
+
+    vNetworkBufferBenchmark( uxProducers, ulIterations );
+
+    return EXIT_SUCCESS;
+}
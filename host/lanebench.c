@@ -0,0 +1,159 @@
+/*
+ * lanebench.c
+ *
+ * Keeps the data lane of the IPCP task full while a probe posts one control
+ * event per millisecond, then reports how long the events of each lane
+ * waited for the IPCP task:
+ *     rinasense_lanebench [seconds]
+ *
+ * The events used have no handler in the IPCP task, so the numbers are
+ * those of the event lanes alone.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "configSensor.h"
+#include "ARP826.h"
+#include "IPCP.h"
+#include "NetworkInterface.h"
+
+#include "HostNetworkBackend.h"
+
+static volatile BaseType_t xFlooding = pdTRUE;
+
+static BaseType_t prvTransmit( void * pvContext,
+                               const uint8_t * pucFrame,
+                               size_t uxLength )
+{
+    ( void ) pvContext;
+    ( void ) pucFrame;
+    ( void ) uxLength;
+
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+static const HostNetworkBackend_t xDiscardBackend =
+{
+    .pcName          = "discard",
+    .xStart          = NULL,
+    .xTransmit       = prvTransmit,
+    .uxTransmitBatch = NULL,
+    .pvContext       = NULL
+};
+
+/* Waits for the station to come up and the IPCP task to take frames. */
+static BaseType_t prvWaitForStack( void )
+{
+    uint8_t ucFrame[ 64 ] = { 0 };
+    UBaseType_t uxTries;
+
+    ucFrame[ 12 ] = ( uint8_t ) ( ETH_P_ARP >> 8 );
+    ucFrame[ 13 ] = ( uint8_t ) ( ETH_P_ARP & 0xff );
+
+    for( uxTries = 0U; uxTries < 100U; uxTries++ )
+    {
+        if( xHostNetworkBackendReceive( ucFrame, sizeof( ucFrame ) ) == pdTRUE )
+        {
+            return pdTRUE;
+        }
+
+        vTaskDelay( pdMS_TO_TICKS( 100U ) );
+    }
+
+    return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+/* Posts data lane events as fast as the lane takes them. */
+static void prvFloodTask( void * pvParameters )
+{
+    static const RINAStackEvent_t xDataEvent = { eEFCPTimerEvent, NULL };
+
+    ( void ) pvParameters;
+
+    while( xFlooding != pdFALSE )
+    {
+        if( xSendEventStructToIPCPTask( &xDataEvent, 0 ) == pdFAIL )
+        {
+            sched_yield();
+        }
+    }
+
+    vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc, char ** argv )
+{
+    static const RINAStackEvent_t xControlEvent = { eARPTimerEvent, NULL };
+    static const char * const pcLane[ eIpcpLaneCount ] = { "control", "management", "data" };
+    IpcpEventLaneStats_t xBefore[ eIpcpLaneCount ], xAfter[ eIpcpLaneCount ];
+    uint32_t ulSeconds = 2UL;
+    uint32_t ulEvents;
+    TickType_t xTick;
+    size_t uxLane;
+
+    if( argc > 1 )
+    {
+        ulSeconds = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    setvbuf( stdout, NULL, _IOLBF, 0 );
+    esp_log_level_set( "*", ESP_LOG_NONE );
+
+    vHostNetworkBackendSet( &xDiscardBackend );
+
+    if( ( RINA_IPCPInit() != pdTRUE ) || ( prvWaitForStack() != pdTRUE ) )
+    {
+        fprintf( stderr, "the stack did not come up\n" );
+        return EXIT_FAILURE;
+    }
+
+    vIpcpGetEventLaneStats( xBefore );
+
+    if( xTaskCreate( prvFloodTask, "flood", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL ) != pdPASS )
+    {
+        fprintf( stderr, "the flood task could not be created\n" );
+        return EXIT_FAILURE;
+    }
+
+    for( xTick = 0; xTick < pdMS_TO_TICKS( ulSeconds * 1000UL ); xTick++ )
+    {
+        ( void ) xSendEventStructToIPCPTask( &xControlEvent, 0 );
+        vTaskDelay( 1 );
+    }
+
+    xFlooding = pdFALSE;
+    vTaskDelay( pdMS_TO_TICKS( 100U ) );
+    vIpcpGetEventLaneStats( xAfter );
+
+    printf( "lane guard %u, data lane %u entries\n",
+            ( unsigned ) IPCP_EVENT_LANE_GUARD, ( unsigned ) EVENT_QUEUE_LENGTH );
+
+    for( uxLane = 0U; uxLane < eIpcpLaneCount; uxLane++ )
+    {
+        ulEvents = xAfter[ uxLane ].ulEvents - xBefore[ uxLane ].ulEvents;
+
+        if( ulEvents == 0U )
+        {
+            continue;
+        }
+
+        printf( "%-10s %9u events (guard %u), depth max %2u, waited avg %8.1f us max %6u us\n",
+                pcLane[ uxLane ], ( unsigned ) ulEvents,
+                ( unsigned ) ( xAfter[ uxLane ].ulGuardServed - xBefore[ uxLane ].ulGuardServed ),
+                ( unsigned ) xAfter[ uxLane ].uxHighWater,
+                ( double ) ( xAfter[ uxLane ].ullDelayUs - xBefore[ uxLane ].ullDelayUs ) / ( double ) ulEvents,
+                ( unsigned ) xAfter[ uxLane ].ulMaxDelayUs );
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+/*
+ * main.c
+ *
+ * Host counterpart of main/main.c: starts the stack over the null network
+ * backend and keeps it running for the given number of seconds (default 10).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "configRINA.h"
+#include "IPCP.h"
+#include "RINA_API.h"
+
+#include "HostNetworkBackend.h"
+
+int main( int argc, char ** argv )
+{
+    HostNetworkBackendStats_t xStats;
+    unsigned long ulSeconds = 10UL;
+
+    if( argc > 1 )
+    {
+        ulSeconds = strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    /* Keep the log readable when it is piped and the process aborts. */
+    setvbuf( stdout, NULL, _IOLBF, 0 );
+
+    vHostNetworkBackendSet( NULL );
+
+    if( RINA_IPCPInit() != pdTRUE )
+    {
+        fprintf( stderr, "RINA_IPCPInit failed\n" );
+        return EXIT_FAILURE;
+    }
+
+    vTaskDelay( pdMS_TO_TICKS( ulSeconds * 1000UL ) );
+
+    vHostNetworkBackendGetStats( &xStats );
+    printf( "frames tx %u (dropped %u) rx %u (dropped %u)\n",
+            ( unsigned ) xStats.ulTxFrames, ( unsigned ) xStats.ulTxDropped,
+            ( unsigned ) xStats.ulRxFrames, ( unsigned ) xStats.ulRxDropped );
+
+    return EXIT_SUCCESS;
+}
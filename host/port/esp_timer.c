@@ -0,0 +1,218 @@
+/*
+ * esp_timer.c
+ *
+ * Host stand-in for the ESP-IDF high resolution timer. Armed timers are kept
+ * in a list sorted by deadline; a dispatch thread, started with the first
+ * timer, sleeps until the earliest one expires and runs its callback without
+ * the lock held, so callbacks may start and stop timers themselves.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_timer.h"
+
+struct esp_timer
+{
+    esp_timer_cb_t pxCallback;
+    void * pvArgument;
+    int64_t llDeadlineUs;
+    BaseType_t xArmed;
+    struct esp_timer * pxNext;
+};
+
+static pthread_mutex_t xTimerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xTimerChanged;
+static pthread_once_t xTimerOnce = PTHREAD_ONCE_INIT;
+static struct esp_timer * pxArmedTimers = NULL;
+
+static void prvTimerStart( void );
+static void * prvTimerThread( void * pvArgument );
+static void prvTimerUnlink( struct esp_timer * pxTimer );
+
+/*-----------------------------------------------------------*/
+
+int64_t esp_timer_get_time( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( int64_t ) xNow.tv_sec * 1000000LL ) + ( ( int64_t ) xNow.tv_nsec / 1000LL );
+}
+/*-----------------------------------------------------------*/
+
+static void prvTimerStart( void )
+{
+    pthread_condattr_t xAttr;
+    pthread_t xThread;
+
+    pthread_condattr_init( &xAttr );
+    pthread_condattr_setclock( &xAttr, CLOCK_MONOTONIC );
+    pthread_cond_init( &xTimerChanged, &xAttr );
+    pthread_condattr_destroy( &xAttr );
+
+    configASSERT( pthread_create( &xThread, NULL, prvTimerThread, NULL ) == 0 );
+    pthread_detach( xThread );
+}
+/*-----------------------------------------------------------*/
+
+/* Must be called with xTimerLock held. */
+static void prvTimerUnlink( struct esp_timer * pxTimer )
+{
+    struct esp_timer ** ppxLink = &pxArmedTimers;
+
+    while( *ppxLink != NULL )
+    {
+        if( *ppxLink == pxTimer )
+        {
+            *ppxLink = pxTimer->pxNext;
+            break;
+        }
+
+        ppxLink = &( ( *ppxLink )->pxNext );
+    }
+
+    pxTimer->pxNext = NULL;
+    pxTimer->xArmed = pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+static void * prvTimerThread( void * pvArgument )
+{
+    struct esp_timer * pxTimer;
+    struct timespec xDeadline;
+    esp_timer_cb_t pxCallback;
+    void * pvCallbackArgument;
+
+    ( void ) pvArgument;
+
+    pthread_mutex_lock( &xTimerLock );
+
+    for( ; ; )
+    {
+        pxTimer = pxArmedTimers;
+
+        if( pxTimer == NULL )
+        {
+            pthread_cond_wait( &xTimerChanged, &xTimerLock );
+            continue;
+        }
+
+        if( pxTimer->llDeadlineUs > esp_timer_get_time() )
+        {
+            xDeadline.tv_sec = ( time_t ) ( pxTimer->llDeadlineUs / 1000000LL );
+            xDeadline.tv_nsec = ( long ) ( pxTimer->llDeadlineUs % 1000000LL ) * 1000L;
+            ( void ) pthread_cond_timedwait( &xTimerChanged, &xTimerLock, &xDeadline );
+            continue;
+        }
+
+        prvTimerUnlink( pxTimer );
+        pxCallback = pxTimer->pxCallback;
+        pvCallbackArgument = pxTimer->pvArgument;
+
+        pthread_mutex_unlock( &xTimerLock );
+        pxCallback( pvCallbackArgument );
+        pthread_mutex_lock( &xTimerLock );
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_timer_create( const esp_timer_create_args_t * create_args,
+                            esp_timer_handle_t * out_handle )
+{
+    struct esp_timer * pxTimer;
+
+    if( ( create_args == NULL ) || ( create_args->callback == NULL ) || ( out_handle == NULL ) )
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_once( &xTimerOnce, prvTimerStart );
+
+    pxTimer = calloc( 1, sizeof( *pxTimer ) );
+
+    if( pxTimer == NULL )
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    pxTimer->pxCallback = create_args->callback;
+    pxTimer->pvArgument = create_args->arg;
+    *out_handle = pxTimer;
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_timer_start_once( esp_timer_handle_t timer,
+                                uint64_t timeout_us )
+{
+    struct esp_timer ** ppxLink = &pxArmedTimers;
+    esp_err_t xReturn = ESP_OK;
+
+    pthread_mutex_lock( &xTimerLock );
+
+    if( timer->xArmed != pdFALSE )
+    {
+        xReturn = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        timer->llDeadlineUs = esp_timer_get_time() + ( int64_t ) timeout_us;
+        timer->xArmed = pdTRUE;
+
+        while( ( *ppxLink != NULL ) && ( ( *ppxLink )->llDeadlineUs <= timer->llDeadlineUs ) )
+        {
+            ppxLink = &( ( *ppxLink )->pxNext );
+        }
+
+        timer->pxNext = *ppxLink;
+        *ppxLink = timer;
+
+        pthread_cond_signal( &xTimerChanged );
+    }
+
+    pthread_mutex_unlock( &xTimerLock );
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_timer_stop( esp_timer_handle_t timer )
+{
+    esp_err_t xReturn = ESP_OK;
+
+    pthread_mutex_lock( &xTimerLock );
+
+    if( timer->xArmed == pdFALSE )
+    {
+        xReturn = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        prvTimerUnlink( timer );
+    }
+
+    pthread_mutex_unlock( &xTimerLock );
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_timer_delete( esp_timer_handle_t timer )
+{
+    if( timer->xArmed != pdFALSE )
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    free( timer );
+
+    return ESP_OK;
+}
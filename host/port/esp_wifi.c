@@ -0,0 +1,513 @@
+/*
+ * esp_wifi.c
+ *
+ * Host stand-in for the ESP-IDF Wi-Fi driver, default event loop and the
+ * few system calls used by the network interface. The station associates as
+ * soon as it is started and its data path is connected to the selected
+ * HostNetworkBackend_t. Like the real driver, received frames are stored in
+ * a fixed ring of receive slots that the stack holds until it calls
+ * esp_wifi_internal_free_rx_buffer().
+ */
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_private/wifi.h"
+#include "nvs_flash.h"
+
+#include "HostNetworkBackend.h"
+
+#define TAG_HOST_WIFI               "[HostWiFi]"
+#define HOST_EVENT_HANDLERS         ( 8 )
+
+/* Receive slots, the counterpart of the driver's dynamic RX buffers. */
+#ifndef HOST_WIFI_RX_SLOTS
+    #define HOST_WIFI_RX_SLOTS      ( 32 )
+#endif
+#define HOST_WIFI_RX_SLOT_SIZE      ( 1600 )
+
+/* Frames handed to the backend per uxTransmitBatch call at most. */
+#define HOST_WIFI_TX_BATCH          ( 32 )
+
+typedef struct xHOST_EVENT_HANDLER
+{
+    esp_event_base_t xBase;
+    int32_t lEventId;
+    esp_event_handler_t pxHandler;
+    void * pvArgument;
+} HostEventHandler_t;
+
+ESP_EVENT_DEFINE_BASE( WIFI_EVENT );
+
+static const uint8_t * prvMacAddress( void );
+static uint8_t * prvRxSlotTake( void );
+static BaseType_t prvNullTransmit( void * pvContext,
+                                   const uint8_t * pucFrame,
+                                   size_t uxLength );
+
+/* Drops every frame. */
+static const HostNetworkBackend_t xNullBackend =
+{
+    .pcName          = "null",
+    .xStart          = NULL,
+    .xTransmit       = prvNullTransmit,
+    .uxTransmitBatch = NULL,
+    .pvContext       = NULL
+};
+
+static const HostNetworkBackend_t * pxBackend = &xNullBackend;
+static HostEventHandler_t xEventHandlers[ HOST_EVENT_HANDLERS ];
+static portMUX_TYPE xEventLock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Locally administered, so it never clashes with a real interface. */
+static const uint8_t ucDefaultMacAddress[ 6 ] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static volatile esp_log_level_t xLogLevel = ESP_LOG_VERBOSE;
+static volatile BaseType_t xStationStarted = pdFALSE;
+static volatile wifi_rxcb_t pxRxCallback = NULL;
+static HostNetworkBackendStats_t xStats;
+
+static uint8_t ucRxSlots[ HOST_WIFI_RX_SLOTS ][ HOST_WIFI_RX_SLOT_SIZE ] __attribute__( ( aligned( 8 ) ) );
+static uint8_t * pucFreeRxSlots[ HOST_WIFI_RX_SLOTS ];
+static UBaseType_t uxFreeRxSlots = HOST_WIFI_RX_SLOTS;
+static BaseType_t xRxSlotsInitialised = pdFALSE;
+static portMUX_TYPE xRxSlotLock = portMUX_INITIALIZER_UNLOCKED;
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvNullTransmit( void * pvContext,
+                                   const uint8_t * pucFrame,
+                                   size_t uxLength )
+{
+    ( void ) pvContext;
+    ( void ) pucFrame;
+    ( void ) uxLength;
+
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+static const uint8_t * prvMacAddress( void )
+{
+    static const uint8_t ucZero[ 6 ] = { 0 };
+
+    if( memcmp( pxBackend->ucMacAddress, ucZero, sizeof( ucZero ) ) == 0 )
+    {
+        return ucDefaultMacAddress;
+    }
+
+    return pxBackend->ucMacAddress;
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t * prvRxSlotTake( void )
+{
+    uint8_t * pucSlot = NULL;
+    UBaseType_t uxIndex;
+    UBaseType_t uxInUse;
+
+    taskENTER_CRITICAL( &xRxSlotLock );
+    {
+        if( xRxSlotsInitialised == pdFALSE )
+        {
+            for( uxIndex = 0U; uxIndex < HOST_WIFI_RX_SLOTS; uxIndex++ )
+            {
+                pucFreeRxSlots[ uxIndex ] = ucRxSlots[ uxIndex ];
+            }
+
+            xRxSlotsInitialised = pdTRUE;
+        }
+
+        if( uxFreeRxSlots > 0U )
+        {
+            pucSlot = pucFreeRxSlots[ --uxFreeRxSlots ];
+            uxInUse = HOST_WIFI_RX_SLOTS - uxFreeRxSlots;
+
+            if( uxInUse > xStats.ulRxSlotsMaxInUse )
+            {
+                xStats.ulRxSlotsMaxInUse = ( uint32_t ) uxInUse;
+            }
+        }
+    }
+    taskEXIT_CRITICAL( &xRxSlotLock );
+
+    return pucSlot;
+}
+/*-----------------------------------------------------------*/
+
+void vHostNetworkBackendSet( const HostNetworkBackend_t * pxNewBackend )
+{
+    pxBackend = ( pxNewBackend != NULL ) ? pxNewBackend : &xNullBackend;
+    ESP_LOGI( TAG_HOST_WIFI, "Network backend: %s", pxBackend->pcName );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xHostNetworkBackendReceive( const uint8_t * pucFrame,
+                                       size_t uxLength )
+{
+    wifi_rxcb_t pxCallback = pxRxCallback;
+    uint8_t * pucSlot = NULL;
+
+    if( ( xStationStarted == pdFALSE ) || ( pxCallback == NULL ) || ( uxLength > HOST_WIFI_RX_SLOT_SIZE ) )
+    {
+        __atomic_fetch_add( &( xStats.ulRxDropped ), 1U, __ATOMIC_RELAXED );
+        return pdFALSE;
+    }
+
+    /* The copy into the slot stands for the DMA of the real driver. The
+     * stack gives the slot back with esp_wifi_internal_free_rx_buffer(). */
+    pucSlot = prvRxSlotTake();
+
+    if( pucSlot == NULL )
+    {
+        __atomic_fetch_add( &( xStats.ulRxNoSlot ), 1U, __ATOMIC_RELAXED );
+        __atomic_fetch_add( &( xStats.ulRxDropped ), 1U, __ATOMIC_RELAXED );
+        return pdFALSE;
+    }
+
+    memcpy( pucSlot, pucFrame, uxLength );
+    __atomic_fetch_add( &( xStats.ulRxFrames ), 1U, __ATOMIC_RELAXED );
+
+    return ( pxCallback( pucSlot, ( uint16_t ) uxLength, pucSlot ) == ESP_OK ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vHostNetworkBackendGetStats( HostNetworkBackendStats_t * pxStatsOut )
+{
+    pxStatsOut->ulTxFrames = __atomic_load_n( &( xStats.ulTxFrames ), __ATOMIC_RELAXED );
+    pxStatsOut->ulTxDropped = __atomic_load_n( &( xStats.ulTxDropped ), __ATOMIC_RELAXED );
+    pxStatsOut->ulTxCalls = __atomic_load_n( &( xStats.ulTxCalls ), __ATOMIC_RELAXED );
+    pxStatsOut->ulRxFrames = __atomic_load_n( &( xStats.ulRxFrames ), __ATOMIC_RELAXED );
+    pxStatsOut->ulRxDropped = __atomic_load_n( &( xStats.ulRxDropped ), __ATOMIC_RELAXED );
+    pxStatsOut->ulRxNoSlot = __atomic_load_n( &( xStats.ulRxNoSlot ), __ATOMIC_RELAXED );
+
+    taskENTER_CRITICAL( &xRxSlotLock );
+    pxStatsOut->ulRxSlotsMaxInUse = xStats.ulRxSlotsMaxInUse;
+    taskEXIT_CRITICAL( &xRxSlotLock );
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_event_loop_create_default( void )
+{
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_event_handler_instance_register( esp_event_base_t event_base,
+                                               int32_t event_id,
+                                               esp_event_handler_t event_handler,
+                                               void * event_handler_arg,
+                                               esp_event_handler_instance_t * instance )
+{
+    esp_err_t xReturn = ESP_ERR_NO_MEM;
+    UBaseType_t uxIndex;
+
+    taskENTER_CRITICAL( &xEventLock );
+    {
+        for( uxIndex = 0U; uxIndex < HOST_EVENT_HANDLERS; uxIndex++ )
+        {
+            if( xEventHandlers[ uxIndex ].pxHandler == NULL )
+            {
+                xEventHandlers[ uxIndex ].xBase = event_base;
+                xEventHandlers[ uxIndex ].lEventId = event_id;
+                xEventHandlers[ uxIndex ].pxHandler = event_handler;
+                xEventHandlers[ uxIndex ].pvArgument = event_handler_arg;
+
+                if( instance != NULL )
+                {
+                    *instance = &( xEventHandlers[ uxIndex ] );
+                }
+
+                xReturn = ESP_OK;
+                break;
+            }
+        }
+    }
+    taskEXIT_CRITICAL( &xEventLock );
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_event_handler_instance_unregister( esp_event_base_t event_base,
+                                                 int32_t event_id,
+                                                 esp_event_handler_instance_t instance )
+{
+    HostEventHandler_t * pxEntry = instance;
+
+    ( void ) event_base;
+    ( void ) event_id;
+
+    if( pxEntry == NULL )
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL( &xEventLock );
+    {
+        memset( pxEntry, 0, sizeof( *pxEntry ) );
+    }
+    taskEXIT_CRITICAL( &xEventLock );
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_event_post( esp_event_base_t event_base,
+                          int32_t event_id,
+                          void * event_data,
+                          size_t event_data_size,
+                          TickType_t ticks_to_wait )
+{
+    HostEventHandler_t xHandler;
+    UBaseType_t uxIndex;
+
+    ( void ) event_data_size;
+    ( void ) ticks_to_wait;
+
+    /* Handlers run without the lock held, they may post events themselves. */
+    for( uxIndex = 0U; uxIndex < HOST_EVENT_HANDLERS; uxIndex++ )
+    {
+        taskENTER_CRITICAL( &xEventLock );
+        xHandler = xEventHandlers[ uxIndex ];
+        taskEXIT_CRITICAL( &xEventLock );
+
+        if( ( xHandler.pxHandler != NULL ) &&
+            ( strcmp( xHandler.xBase, event_base ) == 0 ) &&
+            ( ( xHandler.lEventId == ESP_EVENT_ANY_ID ) || ( xHandler.lEventId == event_id ) ) )
+        {
+            xHandler.pxHandler( xHandler.pvArgument, event_base, event_id, event_data );
+        }
+    }
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_wifi_init( const wifi_init_config_t * config )
+{
+    ( void ) config;
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_wifi_deinit( void )
+{
+    pxRxCallback = NULL;
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_wifi_set_mode( wifi_mode_t mode )
+{
+    return ( mode == WIFI_MODE_STA ) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_wifi_set_config( wifi_interface_t interface,
+                               wifi_config_t * conf )
+{
+    ( void ) interface;
+    ( void ) conf;
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_wifi_start( void )
+{
+    if( ( pxBackend->xStart != NULL ) &&
+        ( pxBackend->xStart( pxBackend->pvContext ) == pdFALSE ) )
+    {
+        ESP_LOGE( TAG_HOST_WIFI, "Backend %s failed to start", pxBackend->pcName );
+        return ESP_FAIL;
+    }
+
+    xStationStarted = pdTRUE;
+
+    return esp_event_post( WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0U, portMAX_DELAY );
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_wifi_stop( void )
+{
+    xStationStarted = pdFALSE;
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_wifi_connect( void )
+{
+    /* There is no access point to look for. */
+    return esp_event_post( WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, NULL, 0U, portMAX_DELAY );
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_wifi_disconnect( void )
+{
+    return esp_event_post( WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, NULL, 0U, portMAX_DELAY );
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_wifi_get_mac( wifi_interface_t ifx,
+                            uint8_t mac[ 6 ] )
+{
+    ( void ) ifx;
+    memcpy( mac, prvMacAddress(), 6U );
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+int esp_wifi_internal_tx( wifi_interface_t ifx,
+                          void * buffer,
+                          uint16_t len )
+{
+    ( void ) ifx;
+
+    __atomic_fetch_add( &( xStats.ulTxCalls ), 1U, __ATOMIC_RELAXED );
+
+    if( ( xStationStarted == pdFALSE ) ||
+        ( pxBackend->xTransmit( pxBackend->pvContext, buffer, len ) == pdFALSE ) )
+    {
+        __atomic_fetch_add( &( xStats.ulTxDropped ), 1U, __ATOMIC_RELAXED );
+        return ESP_FAIL;
+    }
+
+    __atomic_fetch_add( &( xStats.ulTxFrames ), 1U, __ATOMIC_RELAXED );
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+size_t uxHostWifiTxBatch( wifi_interface_t ifx,
+                          const HostWifiTxFrame_t * pxFrames,
+                          size_t uxCount )
+{
+    HostNetworkFrame_t xFrames[ HOST_WIFI_TX_BATCH ];
+    size_t uxAccepted = 0U, uxDone, uxChunk, x;
+
+    ( void ) ifx;
+
+    if( xStationStarted == pdFALSE )
+    {
+        __atomic_fetch_add( &( xStats.ulTxDropped ), ( uint32_t ) uxCount, __ATOMIC_RELAXED );
+        return 0U;
+    }
+
+    if( pxBackend->uxTransmitBatch == NULL )
+    {
+        for( x = 0U; x < uxCount; x++ )
+        {
+            if( esp_wifi_internal_tx( ifx, pxFrames[ x ].pvBuffer, pxFrames[ x ].usLength ) == ESP_OK )
+            {
+                uxAccepted++;
+            }
+        }
+
+        return uxAccepted;
+    }
+
+    for( uxDone = 0U; uxDone < uxCount; uxDone += uxChunk )
+    {
+        uxChunk = uxCount - uxDone;
+
+        if( uxChunk > HOST_WIFI_TX_BATCH )
+        {
+            uxChunk = HOST_WIFI_TX_BATCH;
+        }
+
+        for( x = 0U; x < uxChunk; x++ )
+        {
+            xFrames[ x ].pucFrame = pxFrames[ uxDone + x ].pvBuffer;
+            xFrames[ x ].uxLength = pxFrames[ uxDone + x ].usLength;
+        }
+
+        __atomic_fetch_add( &( xStats.ulTxCalls ), 1U, __ATOMIC_RELAXED );
+        uxAccepted += pxBackend->uxTransmitBatch( pxBackend->pvContext, xFrames, uxChunk );
+    }
+
+    __atomic_fetch_add( &( xStats.ulTxFrames ), ( uint32_t ) uxAccepted, __ATOMIC_RELAXED );
+    __atomic_fetch_add( &( xStats.ulTxDropped ), ( uint32_t ) ( uxCount - uxAccepted ), __ATOMIC_RELAXED );
+
+    return uxAccepted;
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_wifi_internal_reg_rxcb( wifi_interface_t ifx,
+                                      wifi_rxcb_t fn )
+{
+    ( void ) ifx;
+    pxRxCallback = fn;
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+void esp_wifi_internal_free_rx_buffer( void * buffer )
+{
+    uint8_t * pucSlot = buffer;
+
+    configASSERT( ( pucSlot >= ucRxSlots[ 0 ] ) && ( pucSlot < ucRxSlots[ HOST_WIFI_RX_SLOTS ] ) );
+    configASSERT( ( ( size_t ) ( pucSlot - ucRxSlots[ 0 ] ) % HOST_WIFI_RX_SLOT_SIZE ) == 0U );
+
+    taskENTER_CRITICAL( &xRxSlotLock );
+    {
+        configASSERT( uxFreeRxSlots < HOST_WIFI_RX_SLOTS );
+        pucFreeRxSlots[ uxFreeRxSlots++ ] = pucSlot;
+    }
+    taskEXIT_CRITICAL( &xRxSlotLock );
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t esp_efuse_mac_get_default( uint8_t * mac )
+{
+    memcpy( mac, prvMacAddress(), 6U );
+
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+void esp_restart( void )
+{
+    exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+esp_err_t nvs_flash_init( void )
+{
+    return ESP_OK;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t esp_log_timestamp( void )
+{
+    return ( uint32_t ) xTaskGetTickCount();
+}
+/*-----------------------------------------------------------*/
+
+void esp_log_level_set( const char * tag,
+                        esp_log_level_t level )
+{
+    if( strcmp( tag, "*" ) == 0 )
+    {
+        xLogLevel = level;
+    }
+}
+/*-----------------------------------------------------------*/
+
+esp_log_level_t esp_log_level_get( const char * tag )
+{
+    ( void ) tag;
+
+    return xLogLevel;
+}
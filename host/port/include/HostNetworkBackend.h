@@ -0,0 +1,81 @@
+/*
+ * HostNetworkBackend.h
+ *
+ * Pluggable network for the host build. The Wi-Fi driver stand-in hands
+ * every transmitted frame to the selected backend, and the backend delivers
+ * received frames with xHostNetworkBackendReceive(). A backend that drops
+ * everything is selected by default.
+ */
+
+#ifndef HOST_NETWORK_BACKEND_H
+#define HOST_NETWORK_BACKEND_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xHOST_NETWORK_FRAME
+{
+    const uint8_t * pucFrame;
+    size_t uxLength;
+} HostNetworkFrame_t;
+
+typedef struct xHOST_NETWORK_BACKEND
+{
+    const char * pcName;
+
+    /* MAC address of the interface. All zeroes keeps the default one. */
+    uint8_t ucMacAddress[ 6 ];
+
+    /* Called when the station starts, may be NULL. */
+    BaseType_t ( * xStart )( void * pvContext );
+
+    /* Called for every transmitted frame. The frame is only valid during the
+     * call. Returns pdFALSE if the frame was not accepted. */
+    BaseType_t ( * xTransmit )( void * pvContext,
+                                const uint8_t * pucFrame,
+                                size_t uxLength );
+
+    /* Called instead of xTransmit for a batch of frames when not NULL, like
+     * sendmmsg(). Returns the number of frames accepted. */
+    size_t ( * uxTransmitBatch )( void * pvContext,
+                                  const HostNetworkFrame_t * pxFrames,
+                                  size_t uxCount );
+
+    void * pvContext;
+} HostNetworkBackend_t;
+
+/* Select the backend. Must be called before the stack is initialised;
+ * pxBackend must stay valid while the stack runs. NULL selects the default
+ * backend. */
+void vHostNetworkBackendSet( const HostNetworkBackend_t * pxBackend );
+
+/* Deliver a frame received by the backend to the stack, as the Wi-Fi driver
+ * would from its receive callback. The frame is copied into a free receive
+ * slot of the driver, which the stack either copies again or keeps until the
+ * frame is released (see NETWORK_INTERFACE_RX_ZERO_COPY). Returns pdFALSE if
+ * the interface is not up, no slot is free or the stack refused the frame. */
+BaseType_t xHostNetworkBackendReceive( const uint8_t * pucFrame,
+                                       size_t uxLength );
+
+/* Frames handed to and from the backend since start-up. */
+typedef struct xHOST_NETWORK_BACKEND_STATS
+{
+    uint32_t ulTxFrames;
+    uint32_t ulTxDropped;
+    uint32_t ulTxCalls;             /* Transmit calls into the backend. */
+    uint32_t ulRxFrames;
+    uint32_t ulRxDropped;
+    uint32_t ulRxNoSlot;            /* Dropped for lack of a receive slot. */
+    uint32_t ulRxSlotsMaxInUse;     /* High-water mark of the receive slots. */
+} HostNetworkBackendStats_t;
+
+void vHostNetworkBackendGetStats( HostNetworkBackendStats_t * pxStats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_NETWORK_BACKEND_H */
@@ -0,0 +1,29 @@
+/*
+ * esp_event.h
+ *
+ * Host stand-in for the ESP-IDF default event loop. Events are delivered
+ * synchronously, from the task that posts them.
+ */
+
+#ifndef HOST_ESP_EVENT_H
+#define HOST_ESP_EVENT_H
+
+#include "freertos/FreeRTOS.h"
+#include "esp_event_base.h"
+
+esp_err_t esp_event_loop_create_default( void );
+esp_err_t esp_event_handler_instance_register( esp_event_base_t event_base,
+                                               int32_t event_id,
+                                               esp_event_handler_t event_handler,
+                                               void * event_handler_arg,
+                                               esp_event_handler_instance_t * instance );
+esp_err_t esp_event_handler_instance_unregister( esp_event_base_t event_base,
+                                                 int32_t event_id,
+                                                 esp_event_handler_instance_t instance );
+esp_err_t esp_event_post( esp_event_base_t event_base,
+                          int32_t event_id,
+                          void * event_data,
+                          size_t event_data_size,
+                          TickType_t ticks_to_wait );
+
+#endif /* HOST_ESP_EVENT_H */
@@ -0,0 +1,23 @@
+/*
+ * esp_event_base.h
+ *
+ * Host stand-in for the ESP-IDF event base declarations.
+ */
+
+#ifndef HOST_ESP_EVENT_BASE_H
+#define HOST_ESP_EVENT_BASE_H
+
+#include <stdint.h>
+
+typedef const char * esp_event_base_t;
+typedef void * esp_event_handler_instance_t;
+typedef void (* esp_event_handler_t)( void * event_handler_arg,
+                                      esp_event_base_t event_base,
+                                      int32_t event_id,
+                                      void * event_data );
+
+#define ESP_EVENT_DECLARE_BASE( id )    extern esp_event_base_t const id
+#define ESP_EVENT_DEFINE_BASE( id )     esp_event_base_t const id = #id
+#define ESP_EVENT_ANY_ID                ( -1 )
+
+#endif /* HOST_ESP_EVENT_BASE_H */
@@ -0,0 +1,56 @@
+/*
+ * esp_log.h
+ *
+ * Host stand-in for the ESP-IDF logging macros. Messages go to stdout with
+ * the millisecond tick in front, as on the device console. The level is
+ * chosen at build time with LOG_LOCAL_LEVEL (default: info) and can be
+ * lowered at run time with esp_log_level_set(). HOST_LOG_PREFIX is printed
+ * in front of the tag, which tells apart several stacks in one process.
+ */
+
+#ifndef HOST_ESP_LOG_H
+#define HOST_ESP_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+#ifndef LOG_LOCAL_LEVEL
+    #define LOG_LOCAL_LEVEL    ESP_LOG_INFO
+#endif
+
+#ifndef HOST_LOG_PREFIX
+    #define HOST_LOG_PREFIX    ""
+#endif
+
+uint32_t esp_log_timestamp( void );
+
+/* Only the "*" tag is supported, it sets the level of every tag. */
+void esp_log_level_set( const char * tag,
+                        esp_log_level_t level );
+esp_log_level_t esp_log_level_get( const char * tag );
+
+#define ESP_LOG_LEVEL( level, letter, tag, format, ... )                                   \
+    do {                                                                                   \
+        if( ( LOG_LOCAL_LEVEL >= ( level ) ) && ( esp_log_level_get( tag ) >= ( level ) ) ) \
+        {                                                                                  \
+            printf( letter " (%u) " HOST_LOG_PREFIX "%s: " format "\n", ( unsigned ) esp_log_timestamp(), tag, ##__VA_ARGS__ ); \
+        }                                                                                  \
+    } while( 0 )
+
+#define ESP_LOGE( tag, format, ... )    ESP_LOG_LEVEL( ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__ )
+#define ESP_LOGW( tag, format, ... )    ESP_LOG_LEVEL( ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__ )
+#define ESP_LOGI( tag, format, ... )    ESP_LOG_LEVEL( ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__ )
+#define ESP_LOGD( tag, format, ... )    ESP_LOG_LEVEL( ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__ )
+#define ESP_LOGV( tag, format, ... )    ESP_LOG_LEVEL( ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__ )
+
+#endif /* HOST_ESP_LOG_H */
@@ -0,0 +1,46 @@
+/*
+ * esp_private/wifi.h
+ *
+ * Host stand-in for the internal ESP-IDF Wi-Fi data path used by the
+ * network interface.
+ */
+
+#ifndef HOST_ESP_PRIVATE_WIFI_H
+#define HOST_ESP_PRIVATE_WIFI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_wifi.h"
+
+typedef esp_err_t (* wifi_rxcb_t)( void * buffer,
+                                   uint16_t len,
+                                   void * eb );
+
+/* buffer is copied before esp_wifi_internal_tx() returns. */
+int esp_wifi_internal_tx( wifi_interface_t ifx,
+                          void * buffer,
+                          uint16_t len );
+/* Not part of ESP-IDF: a hook of the host port that hands several frames
+ * to the network backend in one call, each copied before it returns, and
+ * returns the number of frames accepted. The network interface uses it when
+ * HOST_WIFI_TX_BATCH_HOOK is defined, the ESP32 sends every frame with
+ * esp_wifi_internal_tx(). */
+#define HOST_WIFI_TX_BATCH_HOOK
+
+typedef struct
+{
+    void * pvBuffer;
+    uint16_t usLength;
+} HostWifiTxFrame_t;
+
+size_t uxHostWifiTxBatch( wifi_interface_t ifx,
+                          const HostWifiTxFrame_t * pxFrames,
+                          size_t uxCount );
+
+esp_err_t esp_wifi_internal_reg_rxcb( wifi_interface_t ifx,
+                                      wifi_rxcb_t fn );
+
+/* Give a received frame back to the driver. */
+void esp_wifi_internal_free_rx_buffer( void * buffer );
+
+#endif /* HOST_ESP_PRIVATE_WIFI_H */
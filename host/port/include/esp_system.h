@@ -0,0 +1,17 @@
+/*
+ * esp_system.h
+ *
+ * Host stand-in for the ESP-IDF system API.
+ */
+
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/* Returns the MAC address of the selected network backend. */
+esp_err_t esp_efuse_mac_get_default( uint8_t * mac );
+void esp_restart( void );
+
+#endif /* HOST_ESP_SYSTEM_H */
@@ -0,0 +1,57 @@
+/*
+ * esp_timer.h
+ *
+ * Host stand-in for the ESP-IDF high resolution timer. One-shot timers only;
+ * their callbacks run one at a time on a dispatch thread, like the
+ * esp_timer task.
+ */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_timer * esp_timer_handle_t;
+
+typedef void ( * esp_timer_cb_t )( void * arg );
+
+typedef enum
+{
+    ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void * arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char * name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create( const esp_timer_create_args_t * create_args,
+                            esp_timer_handle_t * out_handle );
+
+/* ESP_ERR_INVALID_STATE if the timer is already armed. */
+esp_err_t esp_timer_start_once( esp_timer_handle_t timer,
+                                uint64_t timeout_us );
+
+/* ESP_ERR_INVALID_STATE if the timer is not armed. */
+esp_err_t esp_timer_stop( esp_timer_handle_t timer );
+esp_err_t esp_timer_delete( esp_timer_handle_t timer );
+
+/* Microseconds of a monotonic clock, like the time since boot on the chip. */
+int64_t esp_timer_get_time( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_ESP_TIMER_H */
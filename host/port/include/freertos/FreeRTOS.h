@@ -0,0 +1,104 @@
+/*
+ * FreeRTOS.h
+ *
+ * Host (Linux/POSIX) stand-in for the ESP-IDF FreeRTOS headers. Only the
+ * subset of the kernel API used by the RINA components is provided; tasks
+ * are pthreads, one tick is one millisecond and critical sections take a
+ * single process-wide recursive lock.
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <sys/types.h>
+
+/* ESP-IDF makes the error codes visible through the FreeRTOS headers and
+ * the components rely on it. */
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdTRUE                          ( ( BaseType_t ) 1 )
+#define pdFALSE                         ( ( BaseType_t ) 0 )
+#define pdPASS                          ( pdTRUE )
+#define pdFAIL                          ( pdFALSE )
+#define errQUEUE_EMPTY                  ( ( BaseType_t ) 0 )
+#define errQUEUE_FULL                   ( ( BaseType_t ) 0 )
+
+#define portMAX_DELAY                   ( ( TickType_t ) 0xffffffffUL )
+#define configTICK_RATE_HZ              ( 1000 )
+#define portTICK_PERIOD_MS              ( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+#define pdMS_TO_TICKS( xTimeInMs )      ( ( TickType_t ) ( ( ( TickType_t ) ( xTimeInMs ) * ( TickType_t ) configTICK_RATE_HZ ) / ( TickType_t ) 1000U ) )
+
+#define configASSERT( x )               do { if( !( x ) ) { abort(); } } while( 0 )
+#define configMAX_PRIORITIES            ( 25 )
+#define configMINIMAL_STACK_SIZE        ( 768 )
+#define configSUPPORT_STATIC_ALLOCATION ( 1 )
+#define configQUEUE_REGISTRY_SIZE       ( 0 )
+
+/* Tasks are spread over this many virtual cores, see xPortGetCoreID(). */
+#define portNUM_PROCESSORS              ( 2 )
+#define portINLINE                      inline
+#define portYIELD_FROM_ISR()
+
+#ifndef likely
+    #define likely( x )                 __builtin_expect( !!( x ), 1 )
+#endif
+#ifndef unlikely
+    #define unlikely( x )               __builtin_expect( !!( x ), 0 )
+#endif
+
+/* Spinlocks of the ESP-IDF SMP port. They all map onto the same lock. */
+typedef struct xPORT_MUX
+{
+    uint32_t ulUnused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+#define portMUX_INITIALIZE( pxMux )     ( ( pxMux )->ulUnused = 0 )
+
+void vPortEnterCritical( portMUX_TYPE * pxMux );
+void vPortExitCritical( portMUX_TYPE * pxMux );
+UBaseType_t uxPortSetInterruptMask( void );
+void vPortClearInterruptMask( UBaseType_t uxSavedStatus );
+
+#define portENTER_CRITICAL( pxMux )         vPortEnterCritical( pxMux )
+#define portEXIT_CRITICAL( pxMux )          vPortExitCritical( pxMux )
+#define portENTER_CRITICAL_ISR( pxMux )     vPortEnterCritical( pxMux )
+#define portEXIT_CRITICAL_ISR( pxMux )      vPortExitCritical( pxMux )
+#define portENTER_CRITICAL_SAFE( pxMux )    vPortEnterCritical( pxMux )
+#define portEXIT_CRITICAL_SAFE( pxMux )     vPortExitCritical( pxMux )
+#define taskENTER_CRITICAL( pxMux )         vPortEnterCritical( pxMux )
+#define taskEXIT_CRITICAL( pxMux )          vPortExitCritical( pxMux )
+#define taskENTER_CRITICAL_ISR( pxMux )     vPortEnterCritical( pxMux )
+#define taskEXIT_CRITICAL_ISR( pxMux )      vPortExitCritical( pxMux )
+
+#define portSET_INTERRUPT_MASK_FROM_ISR()               uxPortSetInterruptMask()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSaved )    vPortClearInterruptMask( uxSaved )
+
+BaseType_t xPortGetCoreID( void );
+BaseType_t xPortInIsrContext( void );
+
+void * pvPortMalloc( size_t xWantedSize );
+void vPortFree( void * pv );
+size_t xPortGetFreeHeapSize( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "freertos/list.h"
+
+#endif /* HOST_FREERTOS_H */
@@ -0,0 +1,43 @@
+/*
+ * event_groups.h
+ *
+ * Host stand-in for the FreeRTOS event group API.
+ */
+
+#ifndef HOST_EVENT_GROUPS_H
+#define HOST_EVENT_GROUPS_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct EventGroupDef_t * EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+#ifndef BIT0
+    #define BIT0    ( 1UL << 0 )
+    #define BIT1    ( 1UL << 1 )
+    #define BIT2    ( 1UL << 2 )
+    #define BIT3    ( 1UL << 3 )
+#endif
+
+EventGroupHandle_t xEventGroupCreate( void );
+void vEventGroupDelete( EventGroupHandle_t xEventGroup );
+EventBits_t xEventGroupSetBits( EventGroupHandle_t xEventGroup,
+                                const EventBits_t uxBitsToSet );
+EventBits_t xEventGroupClearBits( EventGroupHandle_t xEventGroup,
+                                  const EventBits_t uxBitsToClear );
+EventBits_t xEventGroupGetBits( EventGroupHandle_t xEventGroup );
+EventBits_t xEventGroupWaitBits( EventGroupHandle_t xEventGroup,
+                                 const EventBits_t uxBitsToWaitFor,
+                                 const BaseType_t xClearOnExit,
+                                 const BaseType_t xWaitForAllBits,
+                                 TickType_t xTicksToWait );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_EVENT_GROUPS_H */
@@ -0,0 +1,78 @@
+/*
+ * list.h
+ *
+ * Host stand-in for the FreeRTOS list API, with the same semantics: lists
+ * are circular and doubly linked around an end marker holding portMAX_DELAY,
+ * and vListInsert() keeps them sorted by item value.
+ */
+
+#ifndef HOST_LIST_H
+#define HOST_LIST_H
+
+#ifndef HOST_FREERTOS_H
+    #error "include freertos/FreeRTOS.h before freertos/list.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct xLIST;
+
+typedef struct xLIST_ITEM
+{
+    TickType_t xItemValue;
+    struct xLIST_ITEM * pxNext;
+    struct xLIST_ITEM * pxPrevious;
+    void * pvOwner;
+    struct xLIST * pxContainer;
+} ListItem_t;
+
+typedef ListItem_t MiniListItem_t;
+
+typedef struct xLIST
+{
+    volatile UBaseType_t uxNumberOfItems;
+    ListItem_t * pxIndex;
+    MiniListItem_t xListEnd;
+} List_t;
+
+#define listSET_LIST_ITEM_OWNER( pxListItem, pxOwner )     ( ( pxListItem )->pvOwner = ( void * ) ( pxOwner ) )
+#define listGET_LIST_ITEM_OWNER( pxListItem )              ( ( pxListItem )->pvOwner )
+#define listSET_LIST_ITEM_VALUE( pxListItem, xValue )      ( ( pxListItem )->xItemValue = ( xValue ) )
+#define listGET_LIST_ITEM_VALUE( pxListItem )              ( ( pxListItem )->xItemValue )
+#define listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxList )         ( ( ( pxList )->xListEnd ).pxNext->xItemValue )
+#define listGET_HEAD_ENTRY( pxList )                       ( ( ( pxList )->xListEnd ).pxNext )
+#define listGET_NEXT( pxListItem )                         ( ( pxListItem )->pxNext )
+#define listGET_END_MARKER( pxList )                       ( ( ListItem_t const * ) ( &( ( pxList )->xListEnd ) ) )
+#define listLIST_IS_EMPTY( pxList )                        ( ( ( pxList )->uxNumberOfItems == ( UBaseType_t ) 0 ) ? pdTRUE : pdFALSE )
+#define listCURRENT_LIST_LENGTH( pxList )                  ( ( pxList )->uxNumberOfItems )
+#define listGET_OWNER_OF_HEAD_ENTRY( pxList )              ( ( &( ( pxList )->xListEnd ) )->pxNext->pvOwner )
+#define listIS_CONTAINED_WITHIN( pxList, pxListItem )      ( ( ( pxListItem )->pxContainer == ( pxList ) ) ? ( pdTRUE ) : ( pdFALSE ) )
+#define listLIST_ITEM_CONTAINER( pxListItem )              ( ( pxListItem )->pxContainer )
+#define listLIST_IS_INITIALISED( pxList )                  ( ( pxList )->xListEnd.xItemValue == portMAX_DELAY )
+
+#define listGET_OWNER_OF_NEXT_ENTRY( pxTCB, pxList )                                           \
+    {                                                                                          \
+        List_t * const pxConstList = ( pxList );                                               \
+        ( pxConstList )->pxIndex = ( pxConstList )->pxIndex->pxNext;                           \
+        if( ( void * ) ( pxConstList )->pxIndex == ( void * ) &( ( pxConstList )->xListEnd ) ) \
+        {                                                                                      \
+            ( pxConstList )->pxIndex = ( pxConstList )->pxIndex->pxNext;                       \
+        }                                                                                      \
+        ( pxTCB ) = ( pxConstList )->pxIndex->pvOwner;                                         \
+    }
+
+void vListInitialise( List_t * const pxList );
+void vListInitialiseItem( ListItem_t * const pxItem );
+void vListInsert( List_t * const pxList,
+                  ListItem_t * const pxNewListItem );
+void vListInsertEnd( List_t * const pxList,
+                     ListItem_t * const pxNewListItem );
+UBaseType_t uxListRemove( ListItem_t * const pxItemToRemove );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LIST_H */
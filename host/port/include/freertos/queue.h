@@ -0,0 +1,57 @@
+/*
+ * queue.h
+ *
+ * Host stand-in for the FreeRTOS queue API. A queue is a ring of fixed-size
+ * items protected by a mutex and two condition variables.
+ */
+
+#ifndef HOST_QUEUE_H
+#define HOST_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct QueueDefinition * QueueHandle_t;
+
+typedef struct xSTATIC_QUEUE
+{
+    void * pvDummy;
+} StaticQueue_t;
+
+QueueHandle_t xQueueCreate( const UBaseType_t uxQueueLength,
+                            const UBaseType_t uxItemSize );
+QueueHandle_t xQueueCreateStatic( const UBaseType_t uxQueueLength,
+                                  const UBaseType_t uxItemSize,
+                                  uint8_t * pucQueueStorage,
+                                  StaticQueue_t * pxStaticQueue );
+void vQueueDelete( QueueHandle_t xQueue );
+
+BaseType_t xQueueSendToBack( QueueHandle_t xQueue,
+                             const void * const pvItemToQueue,
+                             TickType_t xTicksToWait );
+BaseType_t xQueueSendToFront( QueueHandle_t xQueue,
+                              const void * const pvItemToQueue,
+                              TickType_t xTicksToWait );
+BaseType_t xQueueSendToBackFromISR( QueueHandle_t xQueue,
+                                    const void * const pvItemToQueue,
+                                    BaseType_t * const pxHigherPriorityTaskWoken );
+BaseType_t xQueueReceive( QueueHandle_t xQueue,
+                          void * const pvBuffer,
+                          TickType_t xTicksToWait );
+BaseType_t xQueueReceiveFromISR( QueueHandle_t xQueue,
+                                 void * const pvBuffer,
+                                 BaseType_t * const pxHigherPriorityTaskWoken );
+UBaseType_t uxQueueMessagesWaiting( const QueueHandle_t xQueue );
+UBaseType_t uxQueueSpacesAvailable( const QueueHandle_t xQueue );
+
+#define xQueueSend( xQueue, pvItemToQueue, xTicksToWait )    xQueueSendToBack( ( xQueue ), ( pvItemToQueue ), ( xTicksToWait ) )
+#define vQueueAddToRegistry( xQueue, pcName )                ( ( void ) ( xQueue ), ( void ) ( pcName ) )
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_QUEUE_H */
@@ -0,0 +1,47 @@
+/*
+ * semphr.h
+ *
+ * Host stand-in for the FreeRTOS semaphore API, built on zero-item-size
+ * queues as in the real kernel.
+ */
+
+#ifndef HOST_SEMPHR_H
+#define HOST_SEMPHR_H
+
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+SemaphoreHandle_t xSemaphoreCreateCounting( UBaseType_t uxMaxCount,
+                                            UBaseType_t uxInitialCount );
+SemaphoreHandle_t xSemaphoreCreateCountingStatic( UBaseType_t uxMaxCount,
+                                                  UBaseType_t uxInitialCount,
+                                                  StaticSemaphore_t * pxSemaphoreBuffer );
+SemaphoreHandle_t xSemaphoreCreateBinary( void );
+SemaphoreHandle_t xSemaphoreCreateMutex( void );
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void );
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore,
+                           TickType_t xBlockTime );
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore );
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t xMutex,
+                                    TickType_t xBlockTime );
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t xMutex );
+BaseType_t xSemaphoreTakeFromISR( SemaphoreHandle_t xSemaphore,
+                                  BaseType_t * pxHigherPriorityTaskWoken );
+BaseType_t xSemaphoreGiveFromISR( SemaphoreHandle_t xSemaphore,
+                                  BaseType_t * pxHigherPriorityTaskWoken );
+UBaseType_t uxSemaphoreGetCount( SemaphoreHandle_t xSemaphore );
+
+#define vSemaphoreDelete( xSemaphore )    vQueueDelete( ( QueueHandle_t ) ( xSemaphore ) )
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_SEMPHR_H */
@@ -0,0 +1,86 @@
+/*
+ * task.h
+ *
+ * Host stand-in for the FreeRTOS task API. Every task is a detached pthread;
+ * priorities and stack sizes are accepted and ignored.
+ */
+
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xHOST_TASK * TaskHandle_t;
+typedef void (* TaskFunction_t)( void * pvParameters );
+
+typedef struct xSTATIC_TCB
+{
+    void * pvDummy;
+} StaticTask_t;
+
+typedef struct xTIME_OUT
+{
+    BaseType_t xOverflowCount;
+    TickType_t xTimeOnEntering;
+} TimeOut_t;
+
+#define tskIDLE_PRIORITY    ( ( UBaseType_t ) 0U )
+#define tskNO_AFFINITY      ( ( BaseType_t ) 0x7FFFFFFF )
+
+BaseType_t xTaskCreate( TaskFunction_t pxTaskCode,
+                        const char * const pcName,
+                        const uint32_t usStackDepth,
+                        void * const pvParameters,
+                        UBaseType_t uxPriority,
+                        TaskHandle_t * const pxCreatedTask );
+BaseType_t xTaskCreatePinnedToCore( TaskFunction_t pxTaskCode,
+                                    const char * const pcName,
+                                    const uint32_t usStackDepth,
+                                    void * const pvParameters,
+                                    UBaseType_t uxPriority,
+                                    TaskHandle_t * const pxCreatedTask,
+                                    const BaseType_t xCoreID );
+TaskHandle_t xTaskCreateStatic( TaskFunction_t pxTaskCode,
+                                const char * const pcName,
+                                const uint32_t ulStackDepth,
+                                void * const pvParameters,
+                                UBaseType_t uxPriority,
+                                StackType_t * const puxStackBuffer,
+                                StaticTask_t * const pxTaskBuffer );
+TaskHandle_t xTaskCreateStaticPinnedToCore( TaskFunction_t pxTaskCode,
+                                            const char * const pcName,
+                                            const uint32_t ulStackDepth,
+                                            void * const pvParameters,
+                                            UBaseType_t uxPriority,
+                                            StackType_t * const puxStackBuffer,
+                                            StaticTask_t * const pxTaskBuffer,
+                                            const BaseType_t xCoreID );
+void vTaskDelete( TaskHandle_t xTaskToDelete );
+void vTaskDelay( const TickType_t xTicksToDelay );
+
+TickType_t xTaskGetTickCount( void );
+TickType_t xTaskGetTickCountFromISR( void );
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+
+void vTaskSetTimeOutState( TimeOut_t * const pxTimeOut );
+BaseType_t xTaskCheckForTimeOut( TimeOut_t * const pxTimeOut,
+                                 TickType_t * const pxTicksToWait );
+
+BaseType_t xTaskNotifyGive( TaskHandle_t xTaskToNotify );
+void vTaskNotifyGiveFromISR( TaskHandle_t xTaskToNotify,
+                             BaseType_t * pxHigherPriorityTaskWoken );
+uint32_t ulTaskNotifyTake( BaseType_t xClearCountOnExit,
+                           TickType_t xTicksToWait );
+
+void vTaskSuspendAll( void );
+BaseType_t xTaskResumeAll( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_TASK_H */
@@ -0,0 +1,10 @@
+/*
+ * netif/wlanif.h
+ *
+ * Host stand-in, lwIP is not used by the RINA stack.
+ */
+
+#ifndef HOST_WLANIF_H
+#define HOST_WLANIF_H
+
+#endif /* HOST_WLANIF_H */
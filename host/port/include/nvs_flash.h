@@ -0,0 +1,14 @@
+/*
+ * nvs_flash.h
+ *
+ * Host stand-in, there is no flash to initialise.
+ */
+
+#ifndef HOST_NVS_FLASH_H
+#define HOST_NVS_FLASH_H
+
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init( void );
+
+#endif /* HOST_NVS_FLASH_H */
@@ -0,0 +1,921 @@
+/*
+ * port.c
+ *
+ * Host (Linux/POSIX) implementation of the FreeRTOS kernel services used by
+ * the RINA components. Tasks are detached pthreads, blocking calls wait on
+ * condition variables with CLOCK_MONOTONIC deadlines, and every critical
+ * section takes the same recursive lock, which stands for both the ESP-IDF
+ * spinlocks and masked interrupts.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+
+struct xHOST_TASK
+{
+    TaskFunction_t pxTaskCode;
+    void * pvParameters;
+    BaseType_t xCoreID;
+    pthread_mutex_t xLock;
+    pthread_cond_t xNotified;
+    uint32_t ulNotifyValue;
+};
+
+struct QueueDefinition
+{
+    pthread_mutex_t xLock;
+    pthread_cond_t xNotEmpty;
+    pthread_cond_t xNotFull;
+    UBaseType_t uxLength;
+    UBaseType_t uxItemSize;
+    UBaseType_t uxMessagesWaiting;
+    UBaseType_t uxHead;
+    uint8_t * pucStorage;
+
+    /* Recursive mutexes only: only the holder reads or writes these. */
+    TaskHandle_t xMutexHolder;
+    UBaseType_t uxRecursiveCallCount;
+};
+
+struct EventGroupDef_t
+{
+    pthread_mutex_t xLock;
+    pthread_cond_t xChanged;
+    EventBits_t uxEventBits;
+};
+
+static pthread_mutex_t xCriticalLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static pthread_once_t xStartOnce = PTHREAD_ONCE_INIT;
+static struct timespec xStartTime;
+
+/* Unpinned tasks are spread over the virtual cores in creation order. */
+static UBaseType_t uxNextCore = 0U;
+
+static __thread struct xHOST_TASK * pxCurrentTask = NULL;
+
+static void prvStartClock( void );
+static void prvCondInit( pthread_cond_t * pxCond );
+static void prvDeadline( struct timespec * pxDeadline,
+                         TickType_t xTicksToWait );
+static BaseType_t prvWait( pthread_cond_t * pxCond,
+                           pthread_mutex_t * pxLock,
+                           TickType_t xTicksToWait,
+                           const struct timespec * pxDeadline );
+static BaseType_t prvQueueSend( QueueHandle_t xQueue,
+                                const void * pvItemToQueue,
+                                TickType_t xTicksToWait,
+                                BaseType_t xToFront );
+static void * prvTaskEntry( void * pvArgument );
+static struct xHOST_TASK * prvTaskAllocate( void );
+
+/*-----------------------------------------------------------*/
+
+static void prvStartClock( void )
+{
+    clock_gettime( CLOCK_MONOTONIC, &xStartTime );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCondInit( pthread_cond_t * pxCond )
+{
+    pthread_condattr_t xAttr;
+
+    pthread_condattr_init( &xAttr );
+    pthread_condattr_setclock( &xAttr, CLOCK_MONOTONIC );
+    pthread_cond_init( pxCond, &xAttr );
+    pthread_condattr_destroy( &xAttr );
+}
+/*-----------------------------------------------------------*/
+
+static void prvDeadline( struct timespec * pxDeadline,
+                         TickType_t xTicksToWait )
+{
+    clock_gettime( CLOCK_MONOTONIC, pxDeadline );
+
+    if( xTicksToWait != portMAX_DELAY )
+    {
+        pxDeadline->tv_sec += ( time_t ) ( xTicksToWait / 1000U );
+        pxDeadline->tv_nsec += ( long ) ( xTicksToWait % 1000U ) * 1000000L;
+
+        if( pxDeadline->tv_nsec >= 1000000000L )
+        {
+            pxDeadline->tv_sec++;
+            pxDeadline->tv_nsec -= 1000000000L;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Returns pdFALSE once the deadline has passed. */
+static BaseType_t prvWait( pthread_cond_t * pxCond,
+                           pthread_mutex_t * pxLock,
+                           TickType_t xTicksToWait,
+                           const struct timespec * pxDeadline )
+{
+    if( xTicksToWait == 0U )
+    {
+        return pdFALSE;
+    }
+
+    if( xTicksToWait == portMAX_DELAY )
+    {
+        pthread_cond_wait( pxCond, pxLock );
+        return pdTRUE;
+    }
+
+    return ( pthread_cond_timedwait( pxCond, pxLock, pxDeadline ) == ETIMEDOUT ) ? pdFALSE : pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( portMUX_TYPE * pxMux )
+{
+    ( void ) pxMux;
+    pthread_mutex_lock( &xCriticalLock );
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( portMUX_TYPE * pxMux )
+{
+    ( void ) pxMux;
+    pthread_mutex_unlock( &xCriticalLock );
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxPortSetInterruptMask( void )
+{
+    pthread_mutex_lock( &xCriticalLock );
+    return 0U;
+}
+/*-----------------------------------------------------------*/
+
+void vPortClearInterruptMask( UBaseType_t uxSavedStatus )
+{
+    ( void ) uxSavedStatus;
+    pthread_mutex_unlock( &xCriticalLock );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortGetCoreID( void )
+{
+    return ( pxCurrentTask != NULL ) ? pxCurrentTask->xCoreID : 0;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortInIsrContext( void )
+{
+    return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+    return malloc( xWantedSize );
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void * pv )
+{
+    free( pv );
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+    return ( size_t ) INT_MAX;
+}
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void )
+{
+    struct timespec xNow;
+
+    pthread_once( &xStartOnce, prvStartClock );
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( TickType_t ) ( ( xNow.tv_sec - xStartTime.tv_sec ) * 1000 +
+                            ( xNow.tv_nsec - xStartTime.tv_nsec ) / 1000000L );
+}
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCountFromISR( void )
+{
+    return xTaskGetTickCount();
+}
+/*-----------------------------------------------------------*/
+
+static struct xHOST_TASK * prvTaskAllocate( void )
+{
+    struct xHOST_TASK * pxTask = calloc( 1, sizeof( *pxTask ) );
+
+    if( pxTask != NULL )
+    {
+        pthread_mutex_init( &( pxTask->xLock ), NULL );
+        prvCondInit( &( pxTask->xNotified ) );
+    }
+
+    return pxTask;
+}
+/*-----------------------------------------------------------*/
+
+static void * prvTaskEntry( void * pvArgument )
+{
+    struct xHOST_TASK * pxTask = pvArgument;
+
+    pxCurrentTask = pxTask;
+    pxTask->pxTaskCode( pxTask->pvParameters );
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskCreatePinnedToCore( TaskFunction_t pxTaskCode,
+                                    const char * const pcName,
+                                    const uint32_t usStackDepth,
+                                    void * const pvParameters,
+                                    UBaseType_t uxPriority,
+                                    TaskHandle_t * const pxCreatedTask,
+                                    const BaseType_t xCoreID )
+{
+    struct xHOST_TASK * pxTask;
+    pthread_t xThread;
+
+    ( void ) usStackDepth;
+    ( void ) uxPriority;
+
+    pxTask = prvTaskAllocate();
+
+    if( pxTask == NULL )
+    {
+        return pdFAIL;
+    }
+
+    pxTask->pxTaskCode = pxTaskCode;
+    pxTask->pvParameters = pvParameters;
+
+    if( ( xCoreID >= 0 ) && ( xCoreID < portNUM_PROCESSORS ) )
+    {
+        pxTask->xCoreID = xCoreID;
+    }
+    else
+    {
+        taskENTER_CRITICAL( NULL );
+        pxTask->xCoreID = ( BaseType_t ) ( uxNextCore++ % portNUM_PROCESSORS );
+        taskEXIT_CRITICAL( NULL );
+    }
+
+    if( pxCreatedTask != NULL )
+    {
+        *pxCreatedTask = pxTask;
+    }
+
+    if( pthread_create( &xThread, NULL, prvTaskEntry, pxTask ) != 0 )
+    {
+        free( pxTask );
+        return pdFAIL;
+    }
+
+    if( pcName != NULL )
+    {
+        char cThreadName[ 16 ];
+
+        /* Linux limits thread names to 15 characters. */
+        strncpy( cThreadName, pcName, sizeof( cThreadName ) - 1U );
+        cThreadName[ sizeof( cThreadName ) - 1U ] = '\0';
+        ( void ) pthread_setname_np( xThread, cThreadName );
+    }
+
+    pthread_detach( xThread );
+
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskCreate( TaskFunction_t pxTaskCode,
+                        const char * const pcName,
+                        const uint32_t usStackDepth,
+                        void * const pvParameters,
+                        UBaseType_t uxPriority,
+                        TaskHandle_t * const pxCreatedTask )
+{
+    return xTaskCreatePinnedToCore( pxTaskCode, pcName, usStackDepth, pvParameters,
+                                    uxPriority, pxCreatedTask, tskNO_AFFINITY );
+}
+/*-----------------------------------------------------------*/
+
+TaskHandle_t xTaskCreateStatic( TaskFunction_t pxTaskCode,
+                                const char * const pcName,
+                                const uint32_t ulStackDepth,
+                                void * const pvParameters,
+                                UBaseType_t uxPriority,
+                                StackType_t * const puxStackBuffer,
+                                StaticTask_t * const pxTaskBuffer )
+{
+    TaskHandle_t xHandle = NULL;
+
+    ( void ) puxStackBuffer;
+    ( void ) pxTaskBuffer;
+    ( void ) xTaskCreate( pxTaskCode, pcName, ulStackDepth, pvParameters, uxPriority, &xHandle );
+
+    return xHandle;
+}
+/*-----------------------------------------------------------*/
+
+TaskHandle_t xTaskCreateStaticPinnedToCore( TaskFunction_t pxTaskCode,
+                                            const char * const pcName,
+                                            const uint32_t ulStackDepth,
+                                            void * const pvParameters,
+                                            UBaseType_t uxPriority,
+                                            StackType_t * const puxStackBuffer,
+                                            StaticTask_t * const pxTaskBuffer,
+                                            const BaseType_t xCoreID )
+{
+    TaskHandle_t xHandle = NULL;
+
+    ( void ) puxStackBuffer;
+    ( void ) pxTaskBuffer;
+    ( void ) xTaskCreatePinnedToCore( pxTaskCode, pcName, ulStackDepth, pvParameters,
+                                      uxPriority, &xHandle, xCoreID );
+
+    return xHandle;
+}
+/*-----------------------------------------------------------*/
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+    /* Threads not created by xTaskCreate(), such as main(), get a handle on
+     * first use so they can be notified too. */
+    if( pxCurrentTask == NULL )
+    {
+        pxCurrentTask = prvTaskAllocate();
+    }
+
+    return pxCurrentTask;
+}
+/*-----------------------------------------------------------*/
+
+void vTaskDelete( TaskHandle_t xTaskToDelete )
+{
+    /* Only a task deleting itself is supported. */
+    if( ( xTaskToDelete == NULL ) || ( xTaskToDelete == pxCurrentTask ) )
+    {
+        pthread_exit( NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vTaskDelay( const TickType_t xTicksToDelay )
+{
+    struct timespec xDelay;
+
+    if( xTicksToDelay == 0U )
+    {
+        ( void ) sched_yield();
+        return;
+    }
+
+    xDelay.tv_sec = ( time_t ) ( xTicksToDelay / 1000U );
+    xDelay.tv_nsec = ( long ) ( xTicksToDelay % 1000U ) * 1000000L;
+
+    while( nanosleep( &xDelay, &xDelay ) != 0 )
+    {
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vTaskSetTimeOutState( TimeOut_t * const pxTimeOut )
+{
+    pxTimeOut->xOverflowCount = 0;
+    pxTimeOut->xTimeOnEntering = xTaskGetTickCount();
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskCheckForTimeOut( TimeOut_t * const pxTimeOut,
+                                 TickType_t * const pxTicksToWait )
+{
+    const TickType_t xNow = xTaskGetTickCount();
+    const TickType_t xElapsed = xNow - pxTimeOut->xTimeOnEntering;
+
+    if( *pxTicksToWait == portMAX_DELAY )
+    {
+        return pdFALSE;
+    }
+
+    if( xElapsed >= *pxTicksToWait )
+    {
+        *pxTicksToWait = 0U;
+        return pdTRUE;
+    }
+
+    *pxTicksToWait -= xElapsed;
+    pxTimeOut->xTimeOnEntering = xNow;
+
+    return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskNotifyGive( TaskHandle_t xTaskToNotify )
+{
+    pthread_mutex_lock( &( xTaskToNotify->xLock ) );
+    xTaskToNotify->ulNotifyValue++;
+    pthread_cond_signal( &( xTaskToNotify->xNotified ) );
+    pthread_mutex_unlock( &( xTaskToNotify->xLock ) );
+
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+void vTaskNotifyGiveFromISR( TaskHandle_t xTaskToNotify,
+                             BaseType_t * pxHigherPriorityTaskWoken )
+{
+    if( pxHigherPriorityTaskWoken != NULL )
+    {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+
+    ( void ) xTaskNotifyGive( xTaskToNotify );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulTaskNotifyTake( BaseType_t xClearCountOnExit,
+                           TickType_t xTicksToWait )
+{
+    struct xHOST_TASK * pxTask = xTaskGetCurrentTaskHandle();
+    struct timespec xDeadline;
+    uint32_t ulReturn;
+
+    prvDeadline( &xDeadline, xTicksToWait );
+    pthread_mutex_lock( &( pxTask->xLock ) );
+
+    while( pxTask->ulNotifyValue == 0U )
+    {
+        if( prvWait( &( pxTask->xNotified ), &( pxTask->xLock ), xTicksToWait, &xDeadline ) == pdFALSE )
+        {
+            break;
+        }
+    }
+
+    ulReturn = pxTask->ulNotifyValue;
+
+    if( ulReturn != 0U )
+    {
+        pxTask->ulNotifyValue = ( xClearCountOnExit != pdFALSE ) ? 0U : ( ulReturn - 1U );
+    }
+
+    pthread_mutex_unlock( &( pxTask->xLock ) );
+
+    return ulReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vTaskSuspendAll( void )
+{
+    pthread_mutex_lock( &xCriticalLock );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskResumeAll( void )
+{
+    pthread_mutex_unlock( &xCriticalLock );
+    return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+QueueHandle_t xQueueCreate( const UBaseType_t uxQueueLength,
+                            const UBaseType_t uxItemSize )
+{
+    QueueHandle_t xQueue = calloc( 1, sizeof( *xQueue ) );
+
+    if( xQueue == NULL )
+    {
+        return NULL;
+    }
+
+    pthread_mutex_init( &( xQueue->xLock ), NULL );
+    prvCondInit( &( xQueue->xNotEmpty ) );
+    prvCondInit( &( xQueue->xNotFull ) );
+    xQueue->uxLength = uxQueueLength;
+    xQueue->uxItemSize = uxItemSize;
+
+    if( uxItemSize > 0U )
+    {
+        xQueue->pucStorage = malloc( uxQueueLength * uxItemSize );
+
+        if( xQueue->pucStorage == NULL )
+        {
+            free( xQueue );
+            return NULL;
+        }
+    }
+
+    return xQueue;
+}
+/*-----------------------------------------------------------*/
+
+QueueHandle_t xQueueCreateStatic( const UBaseType_t uxQueueLength,
+                                  const UBaseType_t uxItemSize,
+                                  uint8_t * pucQueueStorage,
+                                  StaticQueue_t * pxStaticQueue )
+{
+    ( void ) pucQueueStorage;
+    ( void ) pxStaticQueue;
+
+    return xQueueCreate( uxQueueLength, uxItemSize );
+}
+/*-----------------------------------------------------------*/
+
+void vQueueDelete( QueueHandle_t xQueue )
+{
+    if( xQueue != NULL )
+    {
+        pthread_cond_destroy( &( xQueue->xNotEmpty ) );
+        pthread_cond_destroy( &( xQueue->xNotFull ) );
+        pthread_mutex_destroy( &( xQueue->xLock ) );
+        free( xQueue->pucStorage );
+        free( xQueue );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvQueueSend( QueueHandle_t xQueue,
+                                const void * pvItemToQueue,
+                                TickType_t xTicksToWait,
+                                BaseType_t xToFront )
+{
+    struct timespec xDeadline;
+    UBaseType_t uxPosition;
+
+    prvDeadline( &xDeadline, xTicksToWait );
+    pthread_mutex_lock( &( xQueue->xLock ) );
+
+    while( xQueue->uxMessagesWaiting == xQueue->uxLength )
+    {
+        if( prvWait( &( xQueue->xNotFull ), &( xQueue->xLock ), xTicksToWait, &xDeadline ) == pdFALSE )
+        {
+            if( xQueue->uxMessagesWaiting == xQueue->uxLength )
+            {
+                pthread_mutex_unlock( &( xQueue->xLock ) );
+                return errQUEUE_FULL;
+            }
+        }
+    }
+
+    if( xQueue->uxItemSize > 0U )
+    {
+        if( xToFront != pdFALSE )
+        {
+            xQueue->uxHead = ( xQueue->uxHead + xQueue->uxLength - 1U ) % xQueue->uxLength;
+            uxPosition = xQueue->uxHead;
+        }
+        else
+        {
+            uxPosition = ( xQueue->uxHead + xQueue->uxMessagesWaiting ) % xQueue->uxLength;
+        }
+
+        memcpy( xQueue->pucStorage + ( uxPosition * xQueue->uxItemSize ), pvItemToQueue, xQueue->uxItemSize );
+    }
+
+    xQueue->uxMessagesWaiting++;
+    pthread_cond_signal( &( xQueue->xNotEmpty ) );
+    pthread_mutex_unlock( &( xQueue->xLock ) );
+
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueSendToBack( QueueHandle_t xQueue,
+                             const void * const pvItemToQueue,
+                             TickType_t xTicksToWait )
+{
+    return prvQueueSend( xQueue, pvItemToQueue, xTicksToWait, pdFALSE );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueSendToFront( QueueHandle_t xQueue,
+                              const void * const pvItemToQueue,
+                              TickType_t xTicksToWait )
+{
+    return prvQueueSend( xQueue, pvItemToQueue, xTicksToWait, pdTRUE );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueSendToBackFromISR( QueueHandle_t xQueue,
+                                    const void * const pvItemToQueue,
+                                    BaseType_t * const pxHigherPriorityTaskWoken )
+{
+    if( pxHigherPriorityTaskWoken != NULL )
+    {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+
+    return prvQueueSend( xQueue, pvItemToQueue, 0U, pdFALSE );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueReceive( QueueHandle_t xQueue,
+                          void * const pvBuffer,
+                          TickType_t xTicksToWait )
+{
+    struct timespec xDeadline;
+
+    prvDeadline( &xDeadline, xTicksToWait );
+    pthread_mutex_lock( &( xQueue->xLock ) );
+
+    while( xQueue->uxMessagesWaiting == 0U )
+    {
+        if( prvWait( &( xQueue->xNotEmpty ), &( xQueue->xLock ), xTicksToWait, &xDeadline ) == pdFALSE )
+        {
+            if( xQueue->uxMessagesWaiting == 0U )
+            {
+                pthread_mutex_unlock( &( xQueue->xLock ) );
+                return errQUEUE_EMPTY;
+            }
+        }
+    }
+
+    if( xQueue->uxItemSize > 0U )
+    {
+        memcpy( pvBuffer, xQueue->pucStorage + ( xQueue->uxHead * xQueue->uxItemSize ), xQueue->uxItemSize );
+        xQueue->uxHead = ( xQueue->uxHead + 1U ) % xQueue->uxLength;
+    }
+
+    xQueue->uxMessagesWaiting--;
+    pthread_cond_signal( &( xQueue->xNotFull ) );
+    pthread_mutex_unlock( &( xQueue->xLock ) );
+
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueReceiveFromISR( QueueHandle_t xQueue,
+                                 void * const pvBuffer,
+                                 BaseType_t * const pxHigherPriorityTaskWoken )
+{
+    if( pxHigherPriorityTaskWoken != NULL )
+    {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+
+    return xQueueReceive( xQueue, pvBuffer, 0U );
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxQueueMessagesWaiting( const QueueHandle_t xQueue )
+{
+    UBaseType_t uxReturn;
+
+    pthread_mutex_lock( &( xQueue->xLock ) );
+    uxReturn = xQueue->uxMessagesWaiting;
+    pthread_mutex_unlock( &( xQueue->xLock ) );
+
+    return uxReturn;
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxQueueSpacesAvailable( const QueueHandle_t xQueue )
+{
+    UBaseType_t uxReturn;
+
+    pthread_mutex_lock( &( xQueue->xLock ) );
+    uxReturn = xQueue->uxLength - xQueue->uxMessagesWaiting;
+    pthread_mutex_unlock( &( xQueue->xLock ) );
+
+    return uxReturn;
+}
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateCounting( UBaseType_t uxMaxCount,
+                                            UBaseType_t uxInitialCount )
+{
+    SemaphoreHandle_t xSemaphore = xQueueCreate( uxMaxCount, 0U );
+
+    if( xSemaphore != NULL )
+    {
+        xSemaphore->uxMessagesWaiting = uxInitialCount;
+    }
+
+    return xSemaphore;
+}
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic( UBaseType_t uxMaxCount,
+                                                  UBaseType_t uxInitialCount,
+                                                  StaticSemaphore_t * pxSemaphoreBuffer )
+{
+    ( void ) pxSemaphoreBuffer;
+
+    return xSemaphoreCreateCounting( uxMaxCount, uxInitialCount );
+}
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateBinary( void )
+{
+    return xSemaphoreCreateCounting( 1U, 0U );
+}
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateMutex( void )
+{
+    /* No priority inheritance, all tasks run at the same priority. */
+    return xSemaphoreCreateCounting( 1U, 1U );
+}
+/*-----------------------------------------------------------*/
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void )
+{
+    return xSemaphoreCreateMutex();
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore,
+                           TickType_t xBlockTime )
+{
+    return xQueueReceive( xSemaphore, NULL, xBlockTime );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t xMutex,
+                                    TickType_t xBlockTime )
+{
+    TaskHandle_t xSelf = xTaskGetCurrentTaskHandle();
+
+    if( xMutex->xMutexHolder == xSelf )
+    {
+        xMutex->uxRecursiveCallCount++;
+        return pdPASS;
+    }
+
+    if( xQueueReceive( xMutex, NULL, xBlockTime ) != pdPASS )
+    {
+        return pdFAIL;
+    }
+
+    xMutex->xMutexHolder = xSelf;
+    xMutex->uxRecursiveCallCount = 1U;
+
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t xMutex )
+{
+    if( xMutex->xMutexHolder != xTaskGetCurrentTaskHandle() )
+    {
+        return pdFAIL;
+    }
+
+    if( --( xMutex->uxRecursiveCallCount ) == 0U )
+    {
+        xMutex->xMutexHolder = NULL;
+        ( void ) prvQueueSend( xMutex, NULL, 0U, pdFALSE );
+    }
+
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore )
+{
+    return prvQueueSend( xSemaphore, NULL, 0U, pdFALSE );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xSemaphoreTakeFromISR( SemaphoreHandle_t xSemaphore,
+                                  BaseType_t * pxHigherPriorityTaskWoken )
+{
+    return xQueueReceiveFromISR( xSemaphore, NULL, pxHigherPriorityTaskWoken );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xSemaphoreGiveFromISR( SemaphoreHandle_t xSemaphore,
+                                  BaseType_t * pxHigherPriorityTaskWoken )
+{
+    return xQueueSendToBackFromISR( xSemaphore, NULL, pxHigherPriorityTaskWoken );
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxSemaphoreGetCount( SemaphoreHandle_t xSemaphore )
+{
+    return uxQueueMessagesWaiting( xSemaphore );
+}
+/*-----------------------------------------------------------*/
+
+EventGroupHandle_t xEventGroupCreate( void )
+{
+    EventGroupHandle_t xEventGroup = calloc( 1, sizeof( *xEventGroup ) );
+
+    if( xEventGroup != NULL )
+    {
+        pthread_mutex_init( &( xEventGroup->xLock ), NULL );
+        prvCondInit( &( xEventGroup->xChanged ) );
+    }
+
+    return xEventGroup;
+}
+/*-----------------------------------------------------------*/
+
+void vEventGroupDelete( EventGroupHandle_t xEventGroup )
+{
+    if( xEventGroup != NULL )
+    {
+        pthread_cond_destroy( &( xEventGroup->xChanged ) );
+        pthread_mutex_destroy( &( xEventGroup->xLock ) );
+        free( xEventGroup );
+    }
+}
+/*-----------------------------------------------------------*/
+
+EventBits_t xEventGroupSetBits( EventGroupHandle_t xEventGroup,
+                                const EventBits_t uxBitsToSet )
+{
+    EventBits_t uxReturn;
+
+    pthread_mutex_lock( &( xEventGroup->xLock ) );
+    xEventGroup->uxEventBits |= uxBitsToSet;
+    uxReturn = xEventGroup->uxEventBits;
+    pthread_cond_broadcast( &( xEventGroup->xChanged ) );
+    pthread_mutex_unlock( &( xEventGroup->xLock ) );
+
+    return uxReturn;
+}
+/*-----------------------------------------------------------*/
+
+EventBits_t xEventGroupClearBits( EventGroupHandle_t xEventGroup,
+                                  const EventBits_t uxBitsToClear )
+{
+    EventBits_t uxReturn;
+
+    pthread_mutex_lock( &( xEventGroup->xLock ) );
+    uxReturn = xEventGroup->uxEventBits;
+    xEventGroup->uxEventBits &= ~uxBitsToClear;
+    pthread_mutex_unlock( &( xEventGroup->xLock ) );
+
+    return uxReturn;
+}
+/*-----------------------------------------------------------*/
+
+EventBits_t xEventGroupGetBits( EventGroupHandle_t xEventGroup )
+{
+    EventBits_t uxReturn;
+
+    pthread_mutex_lock( &( xEventGroup->xLock ) );
+    uxReturn = xEventGroup->uxEventBits;
+    pthread_mutex_unlock( &( xEventGroup->xLock ) );
+
+    return uxReturn;
+}
+/*-----------------------------------------------------------*/
+
+EventBits_t xEventGroupWaitBits( EventGroupHandle_t xEventGroup,
+                                 const EventBits_t uxBitsToWaitFor,
+                                 const BaseType_t xClearOnExit,
+                                 const BaseType_t xWaitForAllBits,
+                                 TickType_t xTicksToWait )
+{
+    struct timespec xDeadline;
+    EventBits_t uxReturn;
+    BaseType_t xConditionMet;
+
+    prvDeadline( &xDeadline, xTicksToWait );
+    pthread_mutex_lock( &( xEventGroup->xLock ) );
+
+    for( ; ; )
+    {
+        uxReturn = xEventGroup->uxEventBits;
+
+        if( xWaitForAllBits != pdFALSE )
+        {
+            xConditionMet = ( ( uxReturn & uxBitsToWaitFor ) == uxBitsToWaitFor ) ? pdTRUE : pdFALSE;
+        }
+        else
+        {
+            xConditionMet = ( ( uxReturn & uxBitsToWaitFor ) != 0U ) ? pdTRUE : pdFALSE;
+        }
+
+        if( ( xConditionMet != pdFALSE ) ||
+            ( prvWait( &( xEventGroup->xChanged ), &( xEventGroup->xLock ), xTicksToWait, &xDeadline ) == pdFALSE ) )
+        {
+            break;
+        }
+    }
+
+    /* The bits are returned as they were before clearing, as in FreeRTOS. */
+    if( ( xConditionMet != pdFALSE ) && ( xClearOnExit != pdFALSE ) )
+    {
+        xEventGroup->uxEventBits &= ~uxBitsToWaitFor;
+    }
+
+    pthread_mutex_unlock( &( xEventGroup->xLock ) );
+
+    return uxReturn;
+}
@@ -0,0 +1,197 @@
+/*
+ * rxbench.c
+ *
+ * Measures the receive path from the Wi-Fi driver callback through the
+ * task that takes the frames (the RX task with IPCP_USE_PIPELINE, else the
+ * IPCP task), first with the frames handed
+ * over in bursts of 1, 8 and 32, then with received frames copied into the
+ * buffer pool and wrapped in place in the driver receive slot (zero-copy):
+ *     rinasense_rxbench [frames]
+ * The bursts are only compared when built with USE_LINKED_RX_MESSAGES=1.
+ *
+ * The frames are ARP packets with an unhandled operation, which the IPCP
+ * task drops as soon as it has read their header, so the stack does as
+ * little as possible besides moving the frame.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "configSensor.h"
+#include "ARP826.h"
+#include "IPCP.h"
+#include "NetworkInterface.h"
+#include "BufferManagement.h"
+
+#include "HostNetworkBackend.h"
+
+#define RXBENCH_ETH_HEADER_LENGTH    ( 14U )
+
+static const size_t uxFrameSizes[] = { 64U, 512U, 1514U };
+#if ( USE_LINKED_RX_MESSAGES != 0 )
+    static const UBaseType_t uxBursts[] = { 1U, 8U, 32U };
+#endif
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000ULL ) + ( uint64_t ) xNow.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static void prvBuildFrame( uint8_t * pucFrame,
+                           size_t uxLength )
+{
+    uint8_t * pucArp = pucFrame + RXBENCH_ETH_HEADER_LENGTH;
+
+    memset( pucFrame, 0, uxLength );
+
+    /* Broadcast from a peer, then the ARP header with operation 0. */
+    memset( pucFrame, 0xff, 6U );
+    pucFrame[ 6 ] = 0x02;
+    pucFrame[ 11 ] = 0x09;
+    pucFrame[ 12 ] = ( uint8_t ) ( ETH_P_ARP >> 8 );
+    pucFrame[ 13 ] = ( uint8_t ) ( ETH_P_ARP & 0xff );
+
+    pucArp[ 0 ] = 0x00;
+    pucArp[ 1 ] = ( uint8_t ) ARP_HARDWARE_TYPE_ETHERNET;
+    pucArp[ 2 ] = ( uint8_t ) ( ETH_P_RINA >> 8 );
+    pucArp[ 3 ] = ( uint8_t ) ( ETH_P_RINA & 0xff );
+    pucArp[ 4 ] = 6U;
+    pucArp[ 5 ] = 4U;
+}
+/*-----------------------------------------------------------*/
+
+/* Waits for the station to come up and the IPCP task to take frames. */
+static BaseType_t prvWaitForStack( void )
+{
+    uint8_t ucFrame[ 64 ];
+    UBaseType_t uxTries;
+
+    prvBuildFrame( ucFrame, sizeof( ucFrame ) );
+
+    for( uxTries = 0U; uxTries < 100U; uxTries++ )
+    {
+        if( xHostNetworkBackendReceive( ucFrame, sizeof( ucFrame ) ) == pdTRUE )
+        {
+            return pdTRUE;
+        }
+
+        vTaskDelay( pdMS_TO_TICKS( 100U ) );
+    }
+
+    return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+/* Feeds ulFrames frames, returns the frames per second the stack took. */
+static double prvRun( BaseType_t xZeroCopy,
+                      size_t uxLength,
+                      uint32_t ulFrames,
+                      double * pxCallbackNs,
+                      uint32_t * pulRefused )
+{
+    static uint8_t ucFrame[ 1514 ];
+    uint64_t ullStart, ullCallStart, ullCallNs = 0U;
+    uint64_t ullElapsedNs;
+    uint32_t ulAccepted = 0U, ulRefused = 0U;
+
+    prvBuildFrame( ucFrame, uxLength );
+    vNetworkInterfaceSetRxZeroCopy( xZeroCopy );
+
+    /* Let the previous run drain. */
+    vTaskDelay( pdMS_TO_TICKS( 100U ) );
+
+    ullStart = prvNowNs();
+
+    while( ulAccepted < ulFrames )
+    {
+        ullCallStart = prvNowNs();
+
+        if( xHostNetworkBackendReceive( ucFrame, uxLength ) == pdTRUE )
+        {
+            ullCallNs += prvNowNs() - ullCallStart;
+            ulAccepted++;
+        }
+        else
+        {
+            /* The stack is behind: no slot or no buffer left. */
+            ulRefused++;
+            sched_yield();
+        }
+    }
+
+    ullElapsedNs = prvNowNs() - ullStart;
+
+    *pxCallbackNs = ( double ) ullCallNs / ( double ) ulAccepted;
+    *pulRefused = ulRefused;
+
+    return ( double ) ulAccepted * 1e9 / ( double ) ullElapsedNs;
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc, char ** argv )
+{
+    HostNetworkBackendStats_t xStats;
+    uint32_t ulFrames = 200000UL;
+    uint32_t ulRefused;
+    double xCallbackNs, xRate;
+    size_t x;
+
+    if( argc > 1 )
+    {
+        ulFrames = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    setvbuf( stdout, NULL, _IOLBF, 0 );
+    esp_log_level_set( "*", ESP_LOG_NONE );
+
+    vHostNetworkBackendSet( NULL );
+
+    if( ( RINA_IPCPInit() != pdTRUE ) || ( prvWaitForStack() != pdTRUE ) )
+    {
+        fprintf( stderr, "the stack did not come up\n" );
+        return EXIT_FAILURE;
+    }
+
+    #if ( USE_LINKED_RX_MESSAGES != 0 )
+        for( x = 0U; x < ( sizeof( uxBursts ) / sizeof( uxBursts[ 0 ] ) ); x++ )
+        {
+            vNetworkInterfaceSetRxBurst( uxBursts[ x ], NETWORK_INTERFACE_RX_HOLD_US );
+            xRate = prvRun( pdFALSE, 64U, ulFrames, &xCallbackNs, &ulRefused );
+
+            printf( "burst %2u    64 bytes: %9.0f frames/s, %7.1f ns per callback, %u refused\n",
+                    ( unsigned ) uxBursts[ x ], xRate, xCallbackNs, ( unsigned ) ulRefused );
+        }
+
+        vNetworkInterfaceSetRxBurst( NETWORK_INTERFACE_RX_BURST, NETWORK_INTERFACE_RX_HOLD_US );
+    #endif /* USE_LINKED_RX_MESSAGES */
+
+    for( x = 0U; x < ( sizeof( uxFrameSizes ) / sizeof( uxFrameSizes[ 0 ] ) ); x++ )
+    {
+        xRate = prvRun( pdFALSE, uxFrameSizes[ x ], ulFrames, &xCallbackNs, &ulRefused );
+        printf( "copy      %5u bytes: %9.0f frames/s, %7.1f ns per callback, %u refused\n",
+                ( unsigned ) uxFrameSizes[ x ], xRate, xCallbackNs, ( unsigned ) ulRefused );
+
+        xRate = prvRun( pdTRUE, uxFrameSizes[ x ], ulFrames, &xCallbackNs, &ulRefused );
+        printf( "zero-copy %5u bytes: %9.0f frames/s, %7.1f ns per callback, %u refused\n",
+                ( unsigned ) uxFrameSizes[ x ], xRate, xCallbackNs, ( unsigned ) ulRefused );
+    }
+
+    vHostNetworkBackendGetStats( &xStats );
+    printf( "receive slots used at most %u, ISR pool drops %u\n",
+            ( unsigned ) xStats.ulRxSlotsMaxInUse, ( unsigned ) uxGetNetworkBufferIsrDrops() );
+
+    return EXIT_SUCCESS;
+}
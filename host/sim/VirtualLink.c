@@ -0,0 +1,566 @@
+/*
+ * VirtualLink.c
+ *
+ * Frames in flight are kept in a binary heap ordered by delivery time. The
+ * transmit side runs in the sending stack's task and only computes the
+ * delivery time; a thread per direction sleeps until the earliest frame is
+ * due and hands it to the receiving stack.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "VirtualLink.h"
+
+#define linkETHERNET_HEADER_LENGTH    ( 14U )
+#define linkPCI_LENGTH                ( 14U )
+#define linkPCI_TYPE_OFFSET           ( linkETHERNET_HEADER_LENGTH + 6U )
+#define linkETH_P_RINA                ( 0xD1F0U )
+#define linkETH_P_ARP                 ( 0x4305U )
+#define linkPDU_TYPE_DT               ( 0x80U )
+#define linkPDU_TYPE_MGMT             ( 0x40U )
+
+typedef struct xLINK_FRAME
+{
+    uint64_t ullDeliverNs;
+    uint64_t ullSentNs;
+    uint32_t ulSequence;
+    size_t uxLength;
+    uint8_t ucData[];
+} LinkFrame_t;
+
+typedef struct xLINK_SAMPLES
+{
+    uint32_t * pulUs;
+    size_t uxCount;
+    size_t uxSize;
+} LinkSamples_t;
+
+struct xVIRTUAL_LINK
+{
+    const char * pcName;
+    VirtualLinkConfig_t xConfig;
+    VirtualLinkDeliver_t pxDeliver;
+
+    pthread_t xThread;
+    pthread_mutex_t xLock;
+    pthread_cond_t xChanged;
+    BaseType_t xStop;
+
+    LinkFrame_t ** ppxHeap;
+    size_t uxHeapCount;
+    size_t uxHeapSize;
+
+    uint64_t ullCreatedNs;
+    uint64_t ullBusyUntilNs;
+    uint64_t ullRandom;
+    uint32_t ulSequence;
+
+    VirtualLinkStats_t xStats;
+    LinkSamples_t xSamples[ eLinkClassCount ];
+};
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNow( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000ULL ) + ( uint64_t ) xNow.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+/* xorshift64*, good enough for impairments and cheap to reseed. */
+static uint64_t prvRandom( VirtualLink_t * pxLink )
+{
+    pxLink->ullRandom ^= pxLink->ullRandom >> 12;
+    pxLink->ullRandom ^= pxLink->ullRandom << 25;
+    pxLink->ullRandom ^= pxLink->ullRandom >> 27;
+
+    return pxLink->ullRandom * 2685821657736338717ULL;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvChance( VirtualLink_t * pxLink,
+                             uint16_t usBasisPoints )
+{
+    if( usBasisPoints == 0U )
+    {
+        return pdFALSE;
+    }
+
+    return ( ( prvRandom( pxLink ) % 10000U ) < usBasisPoints ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+static eVirtualLinkClass_t prvClassify( const uint8_t * pucFrame,
+                                        size_t uxLength )
+{
+    uint16_t usType;
+
+    if( uxLength < linkETHERNET_HEADER_LENGTH )
+    {
+        return eLinkClassOther;
+    }
+
+    usType = ( uint16_t ) ( ( pucFrame[ 12 ] << 8 ) | pucFrame[ 13 ] );
+
+    if( usType == linkETH_P_ARP )
+    {
+        return eLinkClassArp;
+    }
+
+    if( ( usType != linkETH_P_RINA ) || ( uxLength <= linkPCI_TYPE_OFFSET ) )
+    {
+        return eLinkClassOther;
+    }
+
+    switch( pucFrame[ linkPCI_TYPE_OFFSET ] )
+    {
+        case linkPDU_TYPE_DT:
+            return eLinkClassData;
+
+        case linkPDU_TYPE_MGMT:
+            return eLinkClassMgmt;
+
+        default:
+            return eLinkClassOther;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvEarlier( const LinkFrame_t * pxA,
+                              const LinkFrame_t * pxB )
+{
+    if( pxA->ullDeliverNs != pxB->ullDeliverNs )
+    {
+        return ( pxA->ullDeliverNs < pxB->ullDeliverNs ) ? pdTRUE : pdFALSE;
+    }
+
+    return ( pxA->ulSequence < pxB->ulSequence ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapPush( VirtualLink_t * pxLink,
+                         LinkFrame_t * pxFrame )
+{
+    size_t uxIndex = pxLink->uxHeapCount++;
+
+    while( uxIndex > 0U )
+    {
+        size_t uxParent = ( uxIndex - 1U ) / 2U;
+
+        if( prvEarlier( pxFrame, pxLink->ppxHeap[ uxParent ] ) == pdFALSE )
+        {
+            break;
+        }
+
+        pxLink->ppxHeap[ uxIndex ] = pxLink->ppxHeap[ uxParent ];
+        uxIndex = uxParent;
+    }
+
+    pxLink->ppxHeap[ uxIndex ] = pxFrame;
+}
+/*-----------------------------------------------------------*/
+
+static LinkFrame_t * prvHeapPop( VirtualLink_t * pxLink )
+{
+    LinkFrame_t * pxTop = pxLink->ppxHeap[ 0 ];
+    LinkFrame_t * pxLast = pxLink->ppxHeap[ --pxLink->uxHeapCount ];
+    size_t uxIndex = 0U;
+
+    for( ; ; )
+    {
+        size_t uxChild = ( 2U * uxIndex ) + 1U;
+
+        if( uxChild >= pxLink->uxHeapCount )
+        {
+            break;
+        }
+
+        if( ( ( uxChild + 1U ) < pxLink->uxHeapCount ) &&
+            ( prvEarlier( pxLink->ppxHeap[ uxChild + 1U ], pxLink->ppxHeap[ uxChild ] ) != pdFALSE ) )
+        {
+            uxChild++;
+        }
+
+        if( prvEarlier( pxLink->ppxHeap[ uxChild ], pxLast ) == pdFALSE )
+        {
+            break;
+        }
+
+        pxLink->ppxHeap[ uxIndex ] = pxLink->ppxHeap[ uxChild ];
+        uxIndex = uxChild;
+    }
+
+    if( pxLink->uxHeapCount > 0U )
+    {
+        pxLink->ppxHeap[ uxIndex ] = pxLast;
+    }
+
+    return pxTop;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRecord( VirtualLink_t * pxLink,
+                       const LinkFrame_t * pxFrame,
+                       uint64_t ullNow,
+                       BaseType_t xAccepted )
+{
+    eVirtualLinkClass_t eClass = prvClassify( pxFrame->ucData, pxFrame->uxLength );
+    LinkSamples_t * pxSamples = &( pxLink->xSamples[ eClass ] );
+
+    if( xAccepted == pdFALSE )
+    {
+        pxLink->xStats.ulRefused++;
+        return;
+    }
+
+    pxLink->xStats.ulDelivered++;
+    pxLink->xStats.ullDeliveredBytes += pxFrame->uxLength;
+    pxLink->xStats.ulClassDelivered[ eClass ]++;
+
+    if( pxLink->xStats.ullFirstDeliveryUs[ eClass ] == 0U )
+    {
+        pxLink->xStats.ullFirstDeliveryUs[ eClass ] = ( ullNow - pxLink->ullCreatedNs ) / 1000U;
+    }
+
+    if( ( eClass == eLinkClassData ) &&
+        ( pxFrame->uxLength > ( linkETHERNET_HEADER_LENGTH + linkPCI_LENGTH ) ) )
+    {
+        pxLink->xStats.ullGoodputBytes += pxFrame->uxLength - linkETHERNET_HEADER_LENGTH - linkPCI_LENGTH;
+    }
+
+    if( pxSamples->uxCount == pxSamples->uxSize )
+    {
+        size_t uxSize = ( pxSamples->uxSize == 0U ) ? 1024U : pxSamples->uxSize * 2U;
+        uint32_t * pulUs = realloc( pxSamples->pulUs, uxSize * sizeof( uint32_t ) );
+
+        if( pulUs == NULL )
+        {
+            return;
+        }
+
+        pxSamples->pulUs = pulUs;
+        pxSamples->uxSize = uxSize;
+    }
+
+    pxSamples->pulUs[ pxSamples->uxCount++ ] = ( uint32_t ) ( ( ullNow - pxFrame->ullSentNs ) / 1000U );
+}
+/*-----------------------------------------------------------*/
+
+static void * prvDeliveryThread( void * pvArgument )
+{
+    VirtualLink_t * pxLink = pvArgument;
+
+    pthread_mutex_lock( &( pxLink->xLock ) );
+
+    while( pxLink->xStop == pdFALSE )
+    {
+        LinkFrame_t * pxFrame;
+        uint64_t ullNow = prvNow();
+        BaseType_t xAccepted;
+
+        if( pxLink->uxHeapCount == 0U )
+        {
+            pthread_cond_wait( &( pxLink->xChanged ), &( pxLink->xLock ) );
+            continue;
+        }
+
+        if( pxLink->ppxHeap[ 0 ]->ullDeliverNs > ullNow )
+        {
+            struct timespec xDeadline;
+            uint64_t ullDeliverNs = pxLink->ppxHeap[ 0 ]->ullDeliverNs;
+
+            xDeadline.tv_sec = ( time_t ) ( ullDeliverNs / 1000000000ULL );
+            xDeadline.tv_nsec = ( long ) ( ullDeliverNs % 1000000000ULL );
+            ( void ) pthread_cond_timedwait( &( pxLink->xChanged ), &( pxLink->xLock ), &xDeadline );
+            continue;
+        }
+
+        pxFrame = prvHeapPop( pxLink );
+
+        /* The peer copies the frame and may transmit on the opposite
+         * direction from here, so the lock is not held. */
+        pthread_mutex_unlock( &( pxLink->xLock ) );
+        xAccepted = pxLink->pxDeliver( pxFrame->ucData, pxFrame->uxLength );
+        ullNow = prvNow();
+        pthread_mutex_lock( &( pxLink->xLock ) );
+
+        prvRecord( pxLink, pxFrame, ullNow, xAccepted );
+        free( pxFrame );
+    }
+
+    pthread_mutex_unlock( &( pxLink->xLock ) );
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+VirtualLink_t * pxVirtualLinkCreate( const char * pcName,
+                                     const VirtualLinkConfig_t * pxConfig,
+                                     VirtualLinkDeliver_t pxDeliver )
+{
+    VirtualLink_t * pxLink = calloc( 1, sizeof( *pxLink ) );
+    pthread_condattr_t xAttr;
+
+    if( pxLink == NULL )
+    {
+        return NULL;
+    }
+
+    pxLink->pcName = pcName;
+    pxLink->xConfig = *pxConfig;
+    pxLink->pxDeliver = pxDeliver;
+    pxLink->uxHeapSize = ( pxConfig->ulQueueFrames > 0U ) ? pxConfig->ulQueueFrames : 1U;
+    pxLink->ppxHeap = calloc( pxLink->uxHeapSize, sizeof( LinkFrame_t * ) );
+    pxLink->ullCreatedNs = prvNow();
+
+    /* xorshift must not start from zero. */
+    pxLink->ullRandom = ( ( uint64_t ) pxConfig->ulSeed << 32 ) ^ 0x9E3779B97F4A7C15ULL;
+
+    if( pxLink->ppxHeap == NULL )
+    {
+        free( pxLink );
+        return NULL;
+    }
+
+    pthread_mutex_init( &( pxLink->xLock ), NULL );
+    pthread_condattr_init( &xAttr );
+    pthread_condattr_setclock( &xAttr, CLOCK_MONOTONIC );
+    pthread_cond_init( &( pxLink->xChanged ), &xAttr );
+    pthread_condattr_destroy( &xAttr );
+
+    if( pthread_create( &( pxLink->xThread ), NULL, prvDeliveryThread, pxLink ) != 0 )
+    {
+        free( pxLink->ppxHeap );
+        free( pxLink );
+        return NULL;
+    }
+
+    ( void ) pthread_setname_np( pxLink->xThread, pcName );
+
+    return pxLink;
+}
+/*-----------------------------------------------------------*/
+
+void vVirtualLinkDelete( VirtualLink_t * pxLink )
+{
+    size_t uxIndex;
+
+    pthread_mutex_lock( &( pxLink->xLock ) );
+    pxLink->xStop = pdTRUE;
+    pthread_cond_signal( &( pxLink->xChanged ) );
+    pthread_mutex_unlock( &( pxLink->xLock ) );
+
+    pthread_join( pxLink->xThread, NULL );
+
+    for( uxIndex = 0U; uxIndex < pxLink->uxHeapCount; uxIndex++ )
+    {
+        free( pxLink->ppxHeap[ uxIndex ] );
+    }
+
+    for( uxIndex = 0U; uxIndex < eLinkClassCount; uxIndex++ )
+    {
+        free( pxLink->xSamples[ uxIndex ].pulUs );
+    }
+
+    pthread_cond_destroy( &( pxLink->xChanged ) );
+    pthread_mutex_destroy( &( pxLink->xLock ) );
+    free( pxLink->ppxHeap );
+    free( pxLink );
+}
+/*-----------------------------------------------------------*/
+
+/* Must be called with the lock held. Queues one frame sent at ullNow. */
+static BaseType_t prvTransmit( VirtualLink_t * pxLink,
+                               const uint8_t * pucFrame,
+                               size_t uxLength,
+                               uint64_t ullNow )
+{
+    const VirtualLinkConfig_t * pxConfig = &( pxLink->xConfig );
+    LinkFrame_t * pxFrame;
+    uint64_t ullStartNs;
+    int64_t llDelayNs;
+
+    pxLink->xStats.ulOffered++;
+
+    /* A lost frame still takes its time on the medium. */
+    ullStartNs = ( pxLink->ullBusyUntilNs > ullNow ) ? pxLink->ullBusyUntilNs : ullNow;
+
+    if( pxConfig->ulBandwidthKbps > 0U )
+    {
+        pxLink->ullBusyUntilNs = ullStartNs + ( ( uint64_t ) uxLength * 8000000ULL ) / pxConfig->ulBandwidthKbps;
+    }
+    else
+    {
+        pxLink->ullBusyUntilNs = ullStartNs;
+    }
+
+    if( prvChance( pxLink, pxConfig->usLossBp ) != pdFALSE )
+    {
+        pxLink->xStats.ulLost++;
+
+        /* The driver does not know about losses on the air. */
+        return pdTRUE;
+    }
+
+    if( pxLink->uxHeapCount >= pxLink->uxHeapSize )
+    {
+        pxLink->xStats.ulOverflow++;
+
+        return pdFALSE;
+    }
+
+    pxFrame = malloc( sizeof( *pxFrame ) + uxLength );
+
+    if( pxFrame == NULL )
+    {
+        pxLink->xStats.ulOverflow++;
+
+        return pdFALSE;
+    }
+
+    if( prvChance( pxLink, pxConfig->usReorderBp ) != pdFALSE )
+    {
+        pxLink->xStats.ulReordered++;
+        llDelayNs = 0;
+    }
+    else
+    {
+        llDelayNs = ( int64_t ) pxConfig->ulLatencyUs * 1000;
+
+        if( pxConfig->ulJitterUs > 0U )
+        {
+            int64_t llSpanUs = ( 2 * ( int64_t ) pxConfig->ulJitterUs ) + 1;
+
+            llDelayNs += ( ( int64_t ) ( prvRandom( pxLink ) % ( uint64_t ) llSpanUs ) - ( int64_t ) pxConfig->ulJitterUs ) * 1000;
+        }
+
+        if( llDelayNs < 0 )
+        {
+            llDelayNs = 0;
+        }
+    }
+
+    pxFrame->ullSentNs = ullNow;
+    pxFrame->ullDeliverNs = pxLink->ullBusyUntilNs + ( uint64_t ) llDelayNs;
+    pxFrame->ulSequence = pxLink->ulSequence++;
+    pxFrame->uxLength = uxLength;
+    memcpy( pxFrame->ucData, pucFrame, uxLength );
+
+    prvHeapPush( pxLink, pxFrame );
+
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xVirtualLinkTransmit( void * pvContext,
+                                 const uint8_t * pucFrame,
+                                 size_t uxLength )
+{
+    VirtualLink_t * pxLink = pvContext;
+    uint64_t ullNow = prvNow();
+    BaseType_t xReturn;
+
+    pthread_mutex_lock( &( pxLink->xLock ) );
+    xReturn = prvTransmit( pxLink, pucFrame, uxLength, ullNow );
+    pthread_cond_signal( &( pxLink->xChanged ) );
+    pthread_mutex_unlock( &( pxLink->xLock ) );
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+size_t uxVirtualLinkTransmitBatch( void * pvContext,
+                                   const HostNetworkFrame_t * pxFrames,
+                                   size_t uxCount )
+{
+    VirtualLink_t * pxLink = pvContext;
+    uint64_t ullNow = prvNow();
+    size_t uxAccepted = 0U;
+    size_t x;
+
+    pthread_mutex_lock( &( pxLink->xLock ) );
+
+    for( x = 0U; x < uxCount; x++ )
+    {
+        if( prvTransmit( pxLink, pxFrames[ x ].pucFrame, pxFrames[ x ].uxLength, ullNow ) != pdFALSE )
+        {
+            uxAccepted++;
+        }
+    }
+
+    pthread_cond_signal( &( pxLink->xChanged ) );
+    pthread_mutex_unlock( &( pxLink->xLock ) );
+
+    return uxAccepted;
+}
+/*-----------------------------------------------------------*/
+
+void vVirtualLinkGetStats( VirtualLink_t * pxLink,
+                           VirtualLinkStats_t * pxStats )
+{
+    pthread_mutex_lock( &( pxLink->xLock ) );
+    *pxStats = pxLink->xStats;
+    pthread_mutex_unlock( &( pxLink->xLock ) );
+}
+/*-----------------------------------------------------------*/
+
+static int prvCompare( const void * pvA,
+                       const void * pvB )
+{
+    uint32_t ulA = *( const uint32_t * ) pvA;
+    uint32_t ulB = *( const uint32_t * ) pvB;
+
+    return ( ulA > ulB ) - ( ulA < ulB );
+}
+/*-----------------------------------------------------------*/
+
+size_t uxVirtualLinkLatency( VirtualLink_t * pxLink,
+                             eVirtualLinkClass_t eClass,
+                             const double * pxPercentiles,
+                             uint32_t * pulPercentileUs,
+                             size_t uxCount )
+{
+    LinkSamples_t * pxSamples = &( pxLink->xSamples[ eClass ] );
+    size_t uxSamples;
+    size_t uxIndex;
+
+    pthread_mutex_lock( &( pxLink->xLock ) );
+
+    uxSamples = pxSamples->uxCount;
+
+    if( uxSamples > 0U )
+    {
+        qsort( pxSamples->pulUs, uxSamples, sizeof( uint32_t ), prvCompare );
+
+        /* Nearest rank. */
+        for( uxIndex = 0U; uxIndex < uxCount; uxIndex++ )
+        {
+            size_t uxRank = ( size_t ) ( ( pxPercentiles[ uxIndex ] / 100.0 ) * ( double ) uxSamples + 0.999999 );
+
+            if( uxRank == 0U )
+            {
+                uxRank = 1U;
+            }
+            else if( uxRank > uxSamples )
+            {
+                uxRank = uxSamples;
+            }
+
+            pulPercentileUs[ uxIndex ] = pxSamples->pulUs[ uxRank - 1U ];
+        }
+    }
+
+    pthread_mutex_unlock( &( pxLink->xLock ) );
+
+    return uxSamples;
+}
@@ -0,0 +1,103 @@
+/*
+ * VirtualLink.h
+ *
+ * One direction of the simulated link between two stacks. Every frame is
+ * serialised at the configured bandwidth, delayed by the latency plus a
+ * uniformly distributed jitter and then handed to the receiving stack by a
+ * delivery thread. Frames can be lost, tail-dropped when too many are in
+ * flight, or reordered. Random decisions come from a seeded generator, so a
+ * run with the same seed and the same frame sequence impairs the same
+ * frames.
+ */
+
+#ifndef VIRTUAL_LINK_H
+#define VIRTUAL_LINK_H
+
+#include "freertos/FreeRTOS.h"
+
+#include "HostNetworkBackend.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xVIRTUAL_LINK_CONFIG
+{
+    uint32_t ulBandwidthKbps;   /* 0: frames are not serialised. */
+    uint32_t ulLatencyUs;       /* One-way propagation delay. */
+    uint32_t ulJitterUs;        /* The delay varies in latency +/- jitter. */
+    uint16_t usLossBp;          /* Frames lost, in 1/10000 (as max_loss). */
+    uint16_t usReorderBp;       /* Frames sent without the propagation delay,
+                                 * overtaking the ones in flight. */
+    uint32_t ulQueueFrames;     /* Frames in flight before tail drop. */
+    uint32_t ulSeed;
+} VirtualLinkConfig_t;
+
+/* Hands a frame to the receiving stack, xHostNetworkBackendReceive() of the
+ * peer. */
+typedef BaseType_t ( * VirtualLinkDeliver_t )( const uint8_t * pucFrame,
+                                               size_t uxLength );
+
+/* HostNetworkBackend_t.uxTransmitBatch: the frames of a batch are queued
+ * under one lock and with one wake-up of the delivery thread. */
+size_t uxVirtualLinkTransmitBatch( void * pvContext,
+                                   const HostNetworkFrame_t * pxFrames,
+                                   size_t uxCount );
+
+/* Frames are classified by EtherType and PDU type for the statistics. */
+typedef enum eVIRTUAL_LINK_CLASS
+{
+    eLinkClassArp = 0,
+    eLinkClassMgmt,
+    eLinkClassData,
+    eLinkClassOther,
+    eLinkClassCount
+} eVirtualLinkClass_t;
+
+typedef struct xVIRTUAL_LINK_STATS
+{
+    uint32_t ulOffered;
+    uint32_t ulLost;
+    uint32_t ulOverflow;
+    uint32_t ulReordered;
+    uint32_t ulDelivered;
+    uint32_t ulRefused;         /* Delivered but not accepted by the peer. */
+    uint64_t ullDeliveredBytes;
+    uint64_t ullGoodputBytes;   /* User data of the DT PDUs delivered. */
+    uint32_t ulClassDelivered[ eLinkClassCount ];
+    uint64_t ullFirstDeliveryUs[ eLinkClassCount ];  /* Since the link was
+                                                      * created, 0: none. */
+} VirtualLinkStats_t;
+
+typedef struct xVIRTUAL_LINK VirtualLink_t;
+
+VirtualLink_t * pxVirtualLinkCreate( const char * pcName,
+                                     const VirtualLinkConfig_t * pxConfig,
+                                     VirtualLinkDeliver_t pxDeliver );
+
+/* Stops the delivery thread, frames still in flight are discarded. */
+void vVirtualLinkDelete( VirtualLink_t * pxLink );
+
+/* HostNetworkBackend_t.xTransmit, with the link as context. */
+BaseType_t xVirtualLinkTransmit( void * pvContext,
+                                 const uint8_t * pucFrame,
+                                 size_t uxLength );
+
+void vVirtualLinkGetStats( VirtualLink_t * pxLink,
+                           VirtualLinkStats_t * pxStats );
+
+/* One-way latency, from the transmit call to the hand-over to the peer, of
+ * the frames of a class delivered so far. Fills pulPercentileUs with one
+ * value per entry of pxPercentiles (0 to 100) and returns the number of
+ * samples, 0 if there are none. */
+size_t uxVirtualLinkLatency( VirtualLink_t * pxLink,
+                             eVirtualLinkClass_t eClass,
+                             const double * pxPercentiles,
+                             uint32_t * pulPercentileUs,
+                             size_t uxCount );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VIRTUAL_LINK_H */
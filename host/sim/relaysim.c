@@ -0,0 +1,905 @@
+/*
+ * relaysim.c
+ *
+ * Runs the normal IPCP of the host stack as a relaying node: the N-1 flows
+ * are stand-ins bound to its RMT, the routes are set with pffAdd() and
+ * pffRemove() and the policy sets with selectPolicySet() and
+ * setPolicySetParam(), as the layer management would. PDUs for other
+ * addresses come in on one N-1 port and the stand-ins record where and in
+ * which order they go out.
+ *
+ *   relaysim [--log none|error|info|debug]
+ *
+ * It checks that
+ *   - PDUs are relayed unchanged to the next hop of their destination, and
+ *     dropped once the route is removed or when the only next hop is the
+ *     port they came in from;
+ *   - with several next hops, all the PDUs of a connection leave by the same
+ *     one, and only the connections of a next hop that goes move;
+ *   - each policy set sends the PDUs queued on a port in its order;
+ *   - an SDU to the relay's own address reaches its user once, without
+ *     going through the RMT;
+ *   - a connection of the relay whose PDUs the AQM of a slow port marks
+ *     hands the RMT fewer PDUs than it is offered.
+ * It prints one line per check and exits with 1 if any of them failed.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "configSensor.h"
+#include "configRINA.h"
+#include "BufferManagement.h"
+#include "IPCP.h"
+#include "IpcManager.h"
+#include "RINA_API.h"
+#include "pci.h"
+#include "du.h"
+#include "pff.h"
+#include "rmtPs.h"
+#include "EFCP.h"
+#include "dtp.h"
+
+#include "HostNetworkBackend.h"
+
+/* Next to the address of the relay, see configRINA.h. */
+#define relayADDRESS_A           ( ( address_t ) 5 )
+#define relayADDRESS_B           ( ( address_t ) 7 )
+#define relayADDRESS_C           ( ( address_t ) 8 )
+#define relayADDRESS_NONE        ( ( address_t ) 9 )
+
+/* N-1 ports of the relay, away from those the stack allocates. */
+#define relayPORT_IN             ( ( portId_t ) 20 )
+#define relayPORT_OUT            ( ( portId_t ) 21 )
+#define relayPORTS               ( 4U )
+
+#define relayMAX_RECORDS         ( 2048U )
+#define relayCONNECTIONS         ( 64U )
+#define relayPDUS_PER_CONNECTION ( 8U )
+#define relayPAYLOAD             ( 32U )
+
+/* PDUs of 1200 bytes: a drr round of weight 1 holds one of them. */
+#define relaySCHED_PAYLOAD       ( 1200U - sizeof( pci_t ) )
+#define relaySCHED_WEIGHT_LOW    "1"
+#define relaySCHED_WEIGHT_HIGH   "3"
+
+/* Flow ports of the connections of the relay itself. */
+#define relayPORT_FLOW           ( ( portId_t ) 30 )
+#define relayPORT_LOOPBACK       ( ( portId_t ) 31 )
+
+/* The slow out port takes a PDU every relayLINK_US, the connection is
+ * offered one every relayOFFER_US for relayOFFER_MS. */
+#define relayLINK_US             ( 10000U )
+#define relayOFFER_US            ( 2000U )
+#define relayOFFER_MS            ( 1600U )
+#define relayCONGESTION_PAYLOAD  ( 100U )
+
+/* One PDU written to an N-1 port. */
+typedef struct xRELAY_RECORD
+{
+    portId_t xPortId;
+    pci_t xPci;
+    size_t uxLength;
+} RelayRecord_t;
+
+static pthread_mutex_t xRecordLock = PTHREAD_MUTEX_INITIALIZER;
+static RelayRecord_t xRecords[ relayMAX_RECORDS ];
+static size_t uxRecords;
+
+static ipcpInstance_t * pxRelay;
+static ipcpInstance_t xN1Ipcp;
+static struct ipcpInstanceOps_t xN1Ops;
+
+/* The user of the relay's own flows: counts the SDUs it gets. */
+static ipcpInstance_t xUserIpcp;
+static struct ipcpInstanceOps_t xUserOps;
+static size_t uxSdus;
+static size_t uxSduLength;
+
+/* The out port stops after each PDU until prvLinkThread enables it. */
+static volatile BaseType_t xSlowLink;
+
+static UBaseType_t uxFailed;
+/*-----------------------------------------------------------*/
+
+/* The N-1 flows: record the PDU and free it. */
+static BaseType_t prvN1DuWrite( struct ipcpInstanceData_t * pxData,
+                                portId_t xPortId,
+                                struct du_t * pxDu,
+                                BaseType_t xBlocking )
+{
+    const pci_t * pxPci = vCastPointerTo_pci_t( pxDu->pxNetworkBuffer->pucEthernetBuffer );
+
+    ( void ) pxData;
+    ( void ) xBlocking;
+
+    pthread_mutex_lock( &xRecordLock );
+
+    if( uxRecords < relayMAX_RECORDS )
+    {
+        xRecords[ uxRecords ].xPortId = xPortId;
+        xRecords[ uxRecords ].xPci = *pxPci;
+        xRecords[ uxRecords ].uxLength = xDuLen( pxDu );
+        uxRecords++;
+    }
+
+    pthread_mutex_unlock( &xRecordLock );
+
+    xDuDestroy( pxDu );
+
+    if( xSlowLink && ( xPortId == relayPORT_OUT ) )
+    {
+        ( void ) pxRelay->pxOps->disableWrite( pxRelay->pxData, xPortId );
+    }
+
+    return pdTRUE;
+}
+
+static BaseType_t prvUserDuEnqueue( struct ipcpInstanceData_t * pxData,
+                                    portId_t xPortId,
+                                    struct du_t * pxDu )
+{
+    ( void ) pxData;
+    ( void ) xPortId;
+
+    pthread_mutex_lock( &xRecordLock );
+    uxSdus++;
+    uxSduLength = xDuLen( pxDu );
+    pthread_mutex_unlock( &xRecordLock );
+
+    xDuDestroy( pxDu );
+
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheck( BaseType_t xPassed,
+                      const char * pcWhat,
+                      const char * pcDetail )
+{
+    printf( "%s: %s%s%s\n", xPassed ? "pass" : "FAIL", pcWhat,
+            pcDetail[ 0 ] ? ", " : "", pcDetail );
+
+    if( !xPassed )
+    {
+        uxFailed++;
+    }
+}
+
+static size_t prvTakeRecords( RelayRecord_t * pxRecords,
+                              size_t uxExpected )
+{
+    size_t uxCount;
+    UBaseType_t uxTries;
+
+    /* Queued PDUs leave from the IPCP task, which may still be busy
+     * enrolling the shim. */
+    for( uxTries = 0U; uxTries < 500U; uxTries++ )
+    {
+        pthread_mutex_lock( &xRecordLock );
+        uxCount = uxRecords;
+        pthread_mutex_unlock( &xRecordLock );
+
+        if( uxCount >= uxExpected )
+        {
+            break;
+        }
+
+        usleep( 10000U );
+    }
+
+#if ( IPCP_USE_PIPELINE == 0 )
+    /* The data-plane lock is empty: let the egress worker return before
+     * the ports change under it. */
+    if( uxExpected > 0U )
+    {
+        usleep( 50000U );
+    }
+#endif
+
+    pthread_mutex_lock( &xRecordLock );
+    uxCount = uxRecords;
+    memcpy( pxRecords, xRecords, uxCount * sizeof( xRecords[ 0 ] ) );
+    uxRecords = 0U;
+    pthread_mutex_unlock( &xRecordLock );
+
+    return uxCount;
+}
+/*-----------------------------------------------------------*/
+
+/* A PDU from address A arriving on xFrom, as the N-1 IPCP hands it. */
+static void prvReceive( portId_t xFrom,
+                        address_t xDestination,
+                        qosId_t xQosId,
+                        cepId_t xCepId,
+                        seqNum_t xSequence,
+                        size_t uxPayload )
+{
+    NetworkBufferDescriptor_t * pxBuffer;
+    struct du_t * pxDu;
+    pci_t * pxPci;
+
+    pxBuffer = pxGetNetworkBufferWithDescriptor( sizeof( pci_t ) + uxPayload, 0U );
+    pxDu = pvPortMalloc( sizeof( *pxDu ) );
+
+    if( ( pxBuffer == NULL ) || ( pxDu == NULL ) )
+    {
+        fprintf( stderr, "out of buffers\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    pxBuffer->xDataLength = sizeof( pci_t ) + uxPayload;
+    memset( pxBuffer->pucEthernetBuffer, 0, pxBuffer->xDataLength );
+
+    pxPci = vCastPointerTo_pci_t( pxBuffer->pucEthernetBuffer );
+    pxPci->ucVersion = 1U;
+    pxPci->xDestination = xDestination;
+    pxPci->xSource = relayADDRESS_A;
+    pxPci->connectionId_t.xQosId = xQosId;
+    pxPci->connectionId_t.xDestination = xCepId;
+    pxPci->connectionId_t.xSource = xCepId;
+    pxPci->xType = PDU_TYPE_DT;
+    pxPci->xPduLen = ( uint16_t ) pxBuffer->xDataLength;
+    pxPci->xSequenceNumber = xSequence;
+
+    pxDu->pxCfg = NULL;
+    pxDu->pxPci = NULL;
+    pxDu->pxNetworkBuffer = pxBuffer;
+
+    vIpcpDataPlaneLock();
+    ( void ) pxRelay->pxOps->duEnqueue( pxRelay->pxData, xFrom, pxDu );
+    vIpcpDataPlaneUnlock();
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvBindPorts( BaseType_t xBind )
+{
+    portId_t xPortId;
+    BaseType_t xReturn = pdTRUE;
+
+    for( xPortId = relayPORT_IN; xPortId < relayPORT_IN + ( portId_t ) relayPORTS; xPortId++ )
+    {
+        if( xBind )
+        {
+            xReturn &= pxRelay->pxOps->flowBindingIpcp( pxRelay->pxData, xPortId, ( struct ipcpInstance_t * ) &xN1Ipcp );
+        }
+        else
+        {
+            xReturn &= pxRelay->pxOps->flowUnbindingIpcp( pxRelay->pxData, xPortId );
+        }
+    }
+
+    return xReturn;
+}
+
+static BaseType_t prvRoute( address_t xAddress,
+                            const portId_t * pxPorts,
+                            size_t uxPorts )
+{
+    return pxRelay->pxOps->pffAdd( pxRelay->pxData, xAddress, PFF_QOS_ANY, pxPorts, uxPorts );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRelay( void )
+{
+    static RelayRecord_t xTaken[ relayMAX_RECORDS ];
+    const portId_t xOut = relayPORT_OUT;
+    const portId_t xIn = relayPORT_IN;
+    char cDetail[ 128 ];
+    size_t uxCount;
+    BaseType_t xPassed;
+
+    ( void ) prvRoute( relayADDRESS_B, &xOut, 1U );
+    ( void ) prvRoute( relayADDRESS_C, &xIn, 1U );
+
+    prvReceive( relayPORT_IN, relayADDRESS_B, 1U, 1U, 42U, relayPAYLOAD );
+    uxCount = prvTakeRecords( xTaken, 1U );
+    xPassed = ( uxCount == 1U ) &&
+              ( xTaken[ 0 ].xPortId == relayPORT_OUT ) &&
+              ( xTaken[ 0 ].uxLength == sizeof( pci_t ) + relayPAYLOAD ) &&
+              ( xTaken[ 0 ].xPci.xDestination == relayADDRESS_B ) &&
+              ( xTaken[ 0 ].xPci.xSource == relayADDRESS_A ) &&
+              ( xTaken[ 0 ].xPci.xSequenceNumber == 42U );
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%zu PDU out, port %d", uxCount,
+                       uxCount ? ( int ) xTaken[ 0 ].xPortId : -1 );
+    prvCheck( xPassed, "relayed unchanged to the next hop", cDetail );
+
+    prvReceive( relayPORT_IN, relayADDRESS_NONE, 1U, 1U, 43U, relayPAYLOAD );
+    uxCount = prvTakeRecords( xTaken, 0U );
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%zu PDU out", uxCount );
+    prvCheck( uxCount == 0U, "dropped without a route", cDetail );
+
+    prvReceive( relayPORT_IN, relayADDRESS_C, 1U, 1U, 44U, relayPAYLOAD );
+    uxCount = prvTakeRecords( xTaken, 0U );
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%zu PDU out", uxCount );
+    prvCheck( uxCount == 0U, "not sent back out of its ingress port", cDetail );
+
+    ( void ) pxRelay->pxOps->pffRemove( pxRelay->pxData, relayADDRESS_B, PFF_QOS_ANY );
+    ( void ) pxRelay->pxOps->pffRemove( pxRelay->pxData, relayADDRESS_C, PFF_QOS_ANY );
+    prvReceive( relayPORT_IN, relayADDRESS_B, 1U, 1U, 45U, relayPAYLOAD );
+    uxCount = prvTakeRecords( xTaken, 0U );
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%zu PDU out", uxCount );
+    prvCheck( uxCount == 0U, "dropped once the route is removed", cDetail );
+}
+/*-----------------------------------------------------------*/
+
+/* Relays relayPDUS_PER_CONNECTION PDUs of each connection with xPorts as
+ * next hops and gives the port each connection left by. pdFALSE if a PDU
+ * is missing or a connection used more than one port. */
+static BaseType_t prvSpread( const portId_t * pxPorts,
+                             size_t uxPorts,
+                             portId_t * pxPortOf )
+{
+    static RelayRecord_t xTaken[ relayMAX_RECORDS ];
+    size_t uxCount, uxRecord;
+    cepId_t xCepId;
+    uint32_t ulPdu;
+    BaseType_t xSticky = pdTRUE;
+
+    ( void ) prvRoute( relayADDRESS_B, pxPorts, uxPorts );
+
+    for( xCepId = 0U; xCepId < relayCONNECTIONS; xCepId++ )
+    {
+        pxPortOf[ xCepId ] = -1;
+    }
+
+    /* The connections interleaved, as they would arrive. */
+    for( ulPdu = 0U; ulPdu < relayPDUS_PER_CONNECTION; ulPdu++ )
+    {
+        for( xCepId = 0U; xCepId < relayCONNECTIONS; xCepId++ )
+        {
+            prvReceive( relayPORT_IN, relayADDRESS_B, 1U, xCepId, ulPdu, relayPAYLOAD );
+        }
+    }
+
+    uxCount = prvTakeRecords( xTaken, relayCONNECTIONS * relayPDUS_PER_CONNECTION );
+
+    for( uxRecord = 0U; uxRecord < uxCount; uxRecord++ )
+    {
+        xCepId = xTaken[ uxRecord ].xPci.connectionId_t.xSource;
+
+        if( pxPortOf[ xCepId ] < 0 )
+        {
+            pxPortOf[ xCepId ] = xTaken[ uxRecord ].xPortId;
+        }
+        else if( pxPortOf[ xCepId ] != xTaken[ uxRecord ].xPortId )
+        {
+            xSticky = pdFALSE;
+        }
+    }
+
+    return ( uxCount == relayCONNECTIONS * relayPDUS_PER_CONNECTION ) && xSticky;
+}
+
+static void prvMultipath( void )
+{
+    static const portId_t xThree[] = { relayPORT_OUT, relayPORT_OUT + 1, relayPORT_OUT + 2 };
+    portId_t xBefore[ relayCONNECTIONS ];
+    portId_t xAfter[ relayCONNECTIONS ];
+    UBaseType_t uxOn[ relayPORTS ] = { 0U };
+    UBaseType_t uxMoved = 0U, uxMovedWrongly = 0U, uxUsed = 0U;
+    char cDetail[ 128 ];
+    BaseType_t xSticky;
+    cepId_t xCepId;
+    size_t uxPort;
+
+    ( void ) pxRelay->pxOps->setPolicySetParam( pxRelay->pxData, "rmt", "multipath", "hash" );
+
+    xSticky = prvSpread( xThree, 3U, xBefore );
+
+    for( xCepId = 0U; xCepId < relayCONNECTIONS; xCepId++ )
+    {
+        if( xBefore[ xCepId ] >= relayPORT_IN )
+        {
+            uxOn[ xBefore[ xCepId ] - relayPORT_IN ]++;
+        }
+    }
+
+    for( uxPort = 0U; uxPort < relayPORTS; uxPort++ )
+    {
+        uxUsed += ( uxOn[ uxPort ] > 0U ) ? 1U : 0U;
+    }
+
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%u connections on ports 21/22/23: %u/%u/%u",
+                       ( unsigned ) relayCONNECTIONS, ( unsigned ) uxOn[ 1 ], ( unsigned ) uxOn[ 2 ],
+                       ( unsigned ) uxOn[ 3 ] );
+    prvCheck( xSticky && ( uxUsed == 3U ), "each connection stays on one next hop", cDetail );
+
+    /* Port 23 goes: only its connections move. */
+    xSticky = prvSpread( xThree, 2U, xAfter );
+
+    for( xCepId = 0U; xCepId < relayCONNECTIONS; xCepId++ )
+    {
+        if( xBefore[ xCepId ] != xAfter[ xCepId ] )
+        {
+            uxMoved++;
+
+            if( xBefore[ xCepId ] != xThree[ 2 ] )
+            {
+                uxMovedWrongly++;
+            }
+        }
+    }
+
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%u moved, %u of them from another port",
+                       ( unsigned ) uxMoved, ( unsigned ) uxMovedWrongly );
+    prvCheck( xSticky && ( uxMoved == uxOn[ 3 ] ) && ( uxMovedWrongly == 0U ),
+              "only the connections of a removed next hop move", cDetail );
+
+    ( void ) pxRelay->pxOps->pffRemove( pxRelay->pxData, relayADDRESS_B, PFF_QOS_ANY );
+}
+/*-----------------------------------------------------------*/
+
+/* Queues uxPerQos PDUs of qos-id xFirst then as many of the other one,
+ * 1 or 2, on the out port while it is disabled, and takes the order they
+ * leave it in once it is enabled. Without IPCP_USE_PIPELINE the data-plane
+ * lock is empty, but the RMT egress worker has nothing to do until then. */
+static size_t prvSchedule( const char * pcPolicySet,
+                           const char * pcWeight1,
+                           const char * pcWeight2,
+                           qosId_t xFirst,
+                           qosId_t * pxOrder,
+                           size_t uxPerQos )
+{
+    static RelayRecord_t xTaken[ relayMAX_RECORDS ];
+    const portId_t xOut = relayPORT_OUT;
+    size_t uxCount, uxRecord;
+    qosId_t xQosId;
+    size_t uxQos, uxPdu;
+
+    /* The policy set can only change with no N-1 port bound. */
+    if( !prvBindPorts( pdFALSE ) ||
+        !pxRelay->pxOps->selectPolicySet( pxRelay->pxData, "rmt", ( string_t ) pcPolicySet ) ||
+        !pxRelay->pxOps->setPolicySetParam( pxRelay->pxData, "rmt", "weight-1", ( string_t ) pcWeight1 ) ||
+        !pxRelay->pxOps->setPolicySetParam( pxRelay->pxData, "rmt", "weight-2", ( string_t ) pcWeight2 ) ||
+        !prvBindPorts( pdTRUE ) ||
+        !prvRoute( relayADDRESS_B, &xOut, 1U ) ||
+        !pxRelay->pxOps->disableWrite( pxRelay->pxData, relayPORT_OUT ) )
+    {
+        return 0U;
+    }
+
+    xQosId = xFirst;
+
+    for( uxQos = 0U; uxQos < 2U; uxQos++ )
+    {
+        for( uxPdu = 0U; uxPdu < uxPerQos; uxPdu++ )
+        {
+            prvReceive( relayPORT_IN, relayADDRESS_B, xQosId, xQosId, ( seqNum_t ) uxPdu, relaySCHED_PAYLOAD );
+        }
+
+        xQosId = ( xQosId == 1U ) ? 2U : 1U;
+    }
+
+    ( void ) pxRelay->pxOps->enableWrite( pxRelay->pxData, relayPORT_OUT );
+
+    uxCount = prvTakeRecords( xTaken, 2U * uxPerQos );
+
+    if( uxCount > 2U * uxPerQos )
+    {
+        uxCount = 2U * uxPerQos;
+    }
+
+    for( uxRecord = 0U; uxRecord < uxCount; uxRecord++ )
+    {
+        pxOrder[ uxRecord ] = xTaken[ uxRecord ].xPci.connectionId_t.xQosId;
+    }
+
+    ( void ) pxRelay->pxOps->pffRemove( pxRelay->pxData, relayADDRESS_B, PFF_QOS_ANY );
+
+    return uxCount;
+}
+
+/* PDUs of qos-id 2 in the first uxPerQos sent, while both were queued. */
+static size_t prvShare( const qosId_t * pxOrder,
+                        size_t uxCount,
+                        size_t uxPerQos )
+{
+    size_t uxRecord, uxQos2 = 0U;
+
+    for( uxRecord = 0U; ( uxRecord < uxCount ) && ( uxRecord < uxPerQos ); uxRecord++ )
+    {
+        if( pxOrder[ uxRecord ] == 2U )
+        {
+            uxQos2++;
+        }
+    }
+
+    return uxQos2;
+}
+
+static BaseType_t prvAll( const qosId_t * pxOrder,
+                          size_t uxFrom,
+                          size_t uxTo,
+                          qosId_t xQosId )
+{
+    size_t uxRecord;
+
+    for( uxRecord = uxFrom; uxRecord < uxTo; uxRecord++ )
+    {
+        if( pxOrder[ uxRecord ] != xQosId )
+        {
+            return pdFALSE;
+        }
+    }
+
+    return pdTRUE;
+}
+
+static void prvSchedulers( void )
+{
+    /* All of them fit in the single queue of the default policy set. */
+    const size_t uxPerQos = RMT_QUEUE_LENGTH / 2U;
+    qosId_t xOrder[ RMT_QUEUE_LENGTH ];
+    char cDetail[ 128 ];
+    size_t uxCount, uxQos2;
+
+    uxCount = prvSchedule( RMT_PS_DEFAULT, relaySCHED_WEIGHT_LOW, relaySCHED_WEIGHT_HIGH, 1U, xOrder, uxPerQos );
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%zu of %zu PDUs", uxCount, 2U * uxPerQos );
+    prvCheck( ( uxCount == 2U * uxPerQos ) && prvAll( xOrder, 0U, uxPerQos, 1U ),
+              RMT_PS_DEFAULT ": in the order they came", cDetail );
+
+    uxCount = prvSchedule( RMT_PS_STRICT_PRIORITY, relaySCHED_WEIGHT_LOW, relaySCHED_WEIGHT_HIGH, 1U, xOrder, uxPerQos );
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%zu of %zu PDUs", uxCount, 2U * uxPerQos );
+    prvCheck( ( uxCount == 2U * uxPerQos ) && prvAll( xOrder, 0U, uxPerQos, 2U ),
+              RMT_PS_STRICT_PRIORITY ": the highest weight first", cDetail );
+
+    uxCount = prvSchedule( RMT_PS_STRICT_PRIORITY, relaySCHED_WEIGHT_LOW, relaySCHED_WEIGHT_LOW, 2U, xOrder, uxPerQos );
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%zu of %zu PDUs", uxCount, 2U * uxPerQos );
+    prvCheck( ( uxCount == 2U * uxPerQos ) && prvAll( xOrder, 0U, uxPerQos, 1U ),
+              RMT_PS_STRICT_PRIORITY ": the lowest qos-id first at equal weights", cDetail );
+
+    /* Weights 1:3, so 3 in 4 of the first PDUs are of qos-id 2. */
+    uxCount = prvSchedule( RMT_PS_DRR, relaySCHED_WEIGHT_LOW, relaySCHED_WEIGHT_HIGH, 1U, xOrder, uxPerQos );
+    uxQos2 = prvShare( xOrder, uxCount, uxPerQos );
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%zu of the first %zu PDUs of qos-id 2, weights 1:3", uxQos2, uxPerQos );
+    prvCheck( ( uxCount == 2U * uxPerQos ) && ( uxQos2 + 1U >= uxPerQos * 3U / 4U ) && ( uxQos2 <= uxPerQos * 3U / 4U + 1U ),
+              RMT_PS_DRR ": the link shared by weight", cDetail );
+
+    uxCount = prvSchedule( RMT_PS_WFQ, relaySCHED_WEIGHT_LOW, relaySCHED_WEIGHT_HIGH, 1U, xOrder, uxPerQos );
+    uxQos2 = prvShare( xOrder, uxCount, uxPerQos );
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%zu of the first %zu PDUs of qos-id 2, weights 1:3", uxQos2, uxPerQos );
+    prvCheck( ( uxCount == 2U * uxPerQos ) && ( uxQos2 + 1U >= uxPerQos * 3U / 4U ) && ( uxQos2 <= uxPerQos * 3U / 4U + 1U ),
+              RMT_PS_WFQ ": the link shared by weight", cDetail );
+}
+/*-----------------------------------------------------------*/
+
+/* A connection of the relay from xPortId to xAddress, used by xUserIpcp. */
+static BaseType_t prvConnect( portId_t xPortId,
+                              address_t xAddress )
+{
+    static policy_t xPolicy = { ( string_t ) DTP_POLICY_SET_NAME, ( string_t ) DTP_POLICY_SET_VERSION };
+    static dtpConfig_t xDtpCfg;
+    cepId_t xCepId;
+
+    xDtpCfg.xDtcpPresent = DTP_DTCP_PRESENT;
+    xDtpCfg.xInitialATimer = DTP_INITIAL_A_TIMER;
+    xDtpCfg.pxDtpPolicySet = &xPolicy;
+
+    if( !pxRelay->pxOps->flowPrebind( pxRelay->pxData, &xUserIpcp, xPortId ) )
+    {
+        return pdFALSE;
+    }
+
+    xCepId = pxRelay->pxOps->connectionCreate( pxRelay->pxData, xPortId, LOCAL_ADDRESS, xAddress,
+                                               1U, &xDtpCfg, NULL );
+
+    /* The remote end has the same CEP-id. */
+    return is_cep_id_ok( xCepId ) &&
+           pxRelay->pxOps->connectionUpdate( pxRelay->pxData, xPortId, xCepId, xCepId );
+}
+
+/* An SDU of uxLength bytes written to the flow xPortId, as an application
+ * would. */
+static BaseType_t prvWrite( portId_t xPortId,
+                            size_t uxLength )
+{
+    NetworkBufferDescriptor_t * pxBuffer;
+    struct du_t * pxDu;
+    BaseType_t xReturn;
+
+    /* With the queues full the buffers can run out, as they would for an
+     * application. */
+    pxBuffer = pxGetNetworkBufferWithDescriptor( uxLength, 0U );
+
+    if( pxBuffer == NULL )
+    {
+        return pdFALSE;
+    }
+
+    pxDu = pvPortMalloc( sizeof( *pxDu ) );
+
+    if( pxDu == NULL )
+    {
+        fprintf( stderr, "out of memory\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    pxBuffer->xDataLength = uxLength;
+    memset( pxBuffer->pucEthernetBuffer, 0xA5, uxLength );
+
+    pxDu->pxCfg = NULL;
+    pxDu->pxPci = NULL;
+    pxDu->pxNetworkBuffer = pxBuffer;
+
+    vIpcpDataPlaneLock();
+    xReturn = pxRelay->pxOps->duWrite( pxRelay->pxData, xPortId, pxDu, pdFALSE );
+    vIpcpDataPlaneUnlock();
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTimerProbe( void * pvArgument )
+{
+    *( volatile BaseType_t * ) pvArgument = pdTRUE;
+}
+
+/* Waits, up to a few seconds, for the IPCP task to run the timers: it is
+ * busy bringing the shim up for a while after RINA_IPCPInit(), and the DTP
+ * paces its senders from a timer. */
+static BaseType_t prvTimersRunning( void )
+{
+    static timerWheelTimer_t xProbe;
+    static volatile BaseType_t xFired;
+    UBaseType_t uxTries;
+
+    xFired = pdFALSE;
+    vTimerWheelTimerInit( &xProbe, prvTimerProbe, ( void * ) &xFired );
+    vIpcpTimerStart( &xProbe, 1U );
+
+    for( uxTries = 0U; ( uxTries < 100U ) && !xFired; uxTries++ )
+    {
+        vTaskDelay( pdMS_TO_TICKS( 50U ) );
+    }
+
+    return xFired;
+}
+
+/* A connection from the relay to itself: the SDU reaches its user once,
+ * through EFCP alone, with nothing handed to the RMT or the N-1 ports. */
+static void prvLoopback( void )
+{
+    static RelayRecord_t xTaken[ relayMAX_RECORDS ];
+    DtpStats_t xBefore, xAfter;
+    char cDetail[ 128 ];
+    size_t uxCount, uxGot, uxLength;
+
+    if( !prvConnect( relayPORT_LOOPBACK, LOCAL_ADDRESS ) )
+    {
+        prvCheck( pdFALSE, "delivered locally without the RMT", "no connection" );
+        return;
+    }
+
+    pthread_mutex_lock( &xRecordLock );
+    uxSdus = 0U;
+    uxSduLength = 0U;
+    pthread_mutex_unlock( &xRecordLock );
+
+    vDtpGetStats( &xBefore );
+    ( void ) prvWrite( relayPORT_LOOPBACK, relayPAYLOAD );
+    vDtpGetStats( &xAfter );
+
+    uxCount = prvTakeRecords( xTaken, 0U );
+
+    pthread_mutex_lock( &xRecordLock );
+    uxGot = uxSdus;
+    uxLength = uxSduLength;
+    pthread_mutex_unlock( &xRecordLock );
+
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%zu SDU of %zu bytes, %u sent to the RMT, %zu PDU out",
+                       uxGot, uxLength, ( unsigned ) ( xAfter.ulSent - xBefore.ulSent ), uxCount );
+    prvCheck( ( uxGot == 1U ) && ( uxLength == relayPAYLOAD ) &&
+              ( xAfter.ulSent == xBefore.ulSent ) && ( uxCount == 0U ),
+              "delivered locally without the RMT", cDetail );
+}
+/*-----------------------------------------------------------*/
+
+/* The slow link: enables the out port every relayLINK_US. */
+static void * prvLinkThread( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    while( xSlowLink )
+    {
+        usleep( relayLINK_US );
+
+        vIpcpDataPlaneLock();
+        ( void ) pxRelay->pxOps->enableWrite( pxRelay->pxData, relayPORT_OUT );
+        vIpcpDataPlaneUnlock();
+    }
+
+    return NULL;
+}
+
+/* The connection is offered five times what the link takes. Once the AQM
+ * of the out port marks its PDUs, the DTP has to keep sending at about the
+ * rate of the link: in the second half, some but less than half of what it
+ * is offered. */
+static void prvCongestion( void )
+{
+    static RelayRecord_t xTaken[ relayMAX_RECORDS ];
+    const portId_t xOut = relayPORT_OUT;
+    DtpStats_t xBefore, xHalf, xAfter;
+    pthread_t xLink;
+    char cDetail[ 160 ];
+    uint32_t ulOffered = relayOFFER_MS * 1000U / relayOFFER_US;
+    uint32_t ulWrite, ulSentLate;
+    size_t uxCount, uxRecord, uxMarked = 0U;
+
+#if ( IPCP_USE_PIPELINE == 0 )
+    /* The link thread would run the RMT next to the IPCP task with the
+     * data-plane lock empty. */
+    prvCheck( pdTRUE, "a marked connection slows down", "skipped without IPCP_USE_PIPELINE" );
+    return;
+#endif
+
+    if( !prvTimersRunning() )
+    {
+        prvCheck( pdFALSE, "a marked connection slows down", "the IPCP timers do not run" );
+        return;
+    }
+
+    if( !prvConnect( relayPORT_FLOW, relayADDRESS_B ) ||
+        !prvRoute( relayADDRESS_B, &xOut, 1U ) )
+    {
+        prvCheck( pdFALSE, "a marked connection slows down", "no connection" );
+        return;
+    }
+
+    xSlowLink = pdTRUE;
+
+    if( pthread_create( &xLink, NULL, prvLinkThread, NULL ) != 0 )
+    {
+        fprintf( stderr, "could not start the link thread\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    vDtpGetStats( &xBefore );
+
+    for( ulWrite = 0U; ulWrite < ulOffered; ulWrite++ )
+    {
+        if( ulWrite == ulOffered / 2U )
+        {
+            vDtpGetStats( &xHalf );
+        }
+
+        ( void ) prvWrite( relayPORT_FLOW, relayCONGESTION_PAYLOAD );
+        usleep( relayOFFER_US );
+    }
+
+    vDtpGetStats( &xAfter );
+
+    xSlowLink = pdFALSE;
+    ( void ) pthread_join( xLink, NULL );
+
+    vIpcpDataPlaneLock();
+    ( void ) pxRelay->pxOps->enableWrite( pxRelay->pxData, relayPORT_OUT );
+    vIpcpDataPlaneUnlock();
+
+    /* What the closed window queue still holds leaves within a second. */
+    usleep( 1000000U );
+    uxCount = prvTakeRecords( xTaken, 0U );
+
+    for( uxRecord = 0U; uxRecord < uxCount; uxRecord++ )
+    {
+        if( xTaken[ uxRecord ].xPci.xFlags & PDU_FLAGS_EXPLICIT_CONGESTION )
+        {
+            uxMarked++;
+        }
+    }
+
+    ulSentLate = xAfter.ulSent - xHalf.ulSent;
+    ( void ) snprintf( cDetail, sizeof( cDetail ), "%u rate cuts, %zu of %zu PDUs marked, "
+                                                   "sent %u of the last %u offered",
+                       ( unsigned ) ( xAfter.ulRateCuts - xBefore.ulRateCuts ), uxMarked, uxCount,
+                       ( unsigned ) ulSentLate, ( unsigned ) ( ulOffered - ulOffered / 2U ) );
+    prvCheck( ( uxMarked > 0U ) && ( xAfter.ulRateCuts > xBefore.ulRateCuts ) &&
+              ( ulSentLate > 0U ) && ( ulSentLate < ( ulOffered - ulOffered / 2U ) / 2U ),
+              "a marked connection slows down", cDetail );
+
+    ( void ) pxRelay->pxOps->pffRemove( pxRelay->pxData, relayADDRESS_B, PFF_QOS_ANY );
+}
+/*-----------------------------------------------------------*/
+
+static esp_log_level_t prvParseLogLevel( const char * pcLevel )
+{
+    static const char * const pcLevels[] = { "none", "error", "warn", "info", "debug", "verbose" };
+    size_t uxIndex;
+
+    for( uxIndex = 0U; uxIndex < sizeof( pcLevels ) / sizeof( pcLevels[ 0 ] ); uxIndex++ )
+    {
+        if( strcmp( pcLevel, pcLevels[ uxIndex ] ) == 0 )
+        {
+            return ( esp_log_level_t ) uxIndex;
+        }
+    }
+
+    fprintf( stderr, "unknown log level %s\n", pcLevel );
+    exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc, char ** argv )
+{
+    static const struct option xOptions[] =
+    {
+        { "log", required_argument, NULL, 'v' },
+        { NULL,  0,                 NULL, 0   }
+    };
+    esp_log_level_t xLevel = ESP_LOG_NONE;
+    UBaseType_t uxTries;
+    int iOption;
+
+    while( ( iOption = getopt_long( argc, argv, "v:", xOptions, NULL ) ) != -1 )
+    {
+        switch( iOption )
+        {
+            case 'v': xLevel = prvParseLogLevel( optarg ); break;
+            default:
+                fprintf( stderr, "usage: %s [--log level]\n", argv[ 0 ] );
+                return EXIT_FAILURE;
+        }
+    }
+
+    setvbuf( stdout, NULL, _IOLBF, 0 );
+    esp_log_level_set( "*", xLevel );
+
+    /* Nothing answers the shim, so no N-1 flow of the stack gets bound. */
+    vHostNetworkBackendSet( NULL );
+
+    if( RINA_IPCPInit() != pdTRUE )
+    {
+        fprintf( stderr, "RINA_IPCPInit failed\n" );
+        return EXIT_FAILURE;
+    }
+
+    for( uxTries = 0U; ( uxTries < 100U ) && ( pxRelay == NULL ); uxTries++ )
+    {
+        vTaskDelay( pdMS_TO_TICKS( 50U ) );
+        pxRelay = pxIpcManagerFindInstanceByType( eNormal );
+    }
+
+    if( pxRelay == NULL )
+    {
+        fprintf( stderr, "the normal IPCP was not created\n" );
+        return EXIT_FAILURE;
+    }
+
+    xN1Ops.duWrite = prvN1DuWrite;
+    xN1Ipcp.xType = eShimWiFi;
+    xN1Ipcp.pxOps = &xN1Ops;
+    xUserOps.duEnqueue = prvUserDuEnqueue;
+    xUserIpcp.xType = eNormal;
+    xUserIpcp.pxOps = &xUserOps;
+
+    if( !prvBindPorts( pdTRUE ) )
+    {
+        fprintf( stderr, "could not bind the N-1 ports\n" );
+        return EXIT_FAILURE;
+    }
+
+    printf( "relay: address %u, in on port %d, out on ports %d-%d\n",
+            ( unsigned ) LOCAL_ADDRESS, ( int ) relayPORT_IN, ( int ) relayPORT_OUT,
+            ( int ) ( relayPORT_IN + relayPORTS - 1U ) );
+
+    prvRelay();
+    prvMultipath();
+    prvSchedulers();
+    prvLoopback();
+    prvCongestion();
+
+    printf( "relay: %u check(s) failed\n", ( unsigned ) uxFailed );
+
+    /* The stack's tasks never return, so the process exits with them. */
+    fflush( stdout );
+    _exit( uxFailed ? EXIT_FAILURE : EXIT_SUCCESS );
+}
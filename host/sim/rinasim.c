@@ -0,0 +1,686 @@
+/*
+ * rinasim.c
+ *
+ * Runs the two sides of configRINA.h, ue1.mobile and ar1.mobile, in one
+ * process connected by a simulated link, and reports what went over the
+ * link once the run is over.
+ *
+ * Each side is a separate build of the stack (rinasim_ue1.so and
+ * rinasim_ar1.so) loaded with RTLD_LOCAL, so both keep their own globals:
+ * IPCP task, buffer pools, ARP cache, RIB and Wi-Fi stand-in. Their Wi-Fi
+ * backends transmit into the two directions of the link.
+ *
+ *   rinasim [--duration s] [--bandwidth kbps] [--latency ms] [--jitter ms]
+ *           [--loss %] [--reorder %] [--queue frames] [--seed n]
+ *           [--log none|error|info|debug] [--modules dir] [--tx-queued]
+ *           [--rate sdu/s] [--size bytes]
+ *
+ * Once ue1 is enrolled it allocates a flow to ar1.mobile and writes --rate
+ * SDUs of --size bytes per second on it; ar1 accepts the flow and reports
+ * the SDUs it read with their end-to-end latency, from RINA_flow_write() on
+ * one side to RINA_flow_read() on the other.
+ *
+ * --tx-queued makes the task that drives the interface (the TX task, or the
+ * IPCP task without IPCP_USE_PIPELINE) post its own frames to itself as
+ * eNetworkTxEvent, as other tasks do, instead of sending them at the end of
+ * the event that produced them (NETWORK_INTERFACE_TX_DIRECT).
+ */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "common.h"
+#include "NetworkInterface.h"
+#include "IPCP.h"
+#include "RINA_API.h"
+#include "EFCP.h"
+#include "dtp.h"
+#include "HostNetworkBackend.h"
+#include "VirtualLink.h"
+
+#define simDEFAULT_DURATION_S    ( 10U )
+#define simDEFAULT_QUEUE         ( 256U )
+#define simDEFAULT_RATE          ( 100U )
+#define simDEFAULT_SDU_SIZE      ( 200U )
+#define simMAX_LATENCY_SAMPLES   ( 1U << 16 )
+#define simALLOC_RETRY_US        ( 200000U )
+
+/* Entry points of one stack build. */
+typedef struct xSIM_STACK
+{
+    const char * pcName;
+    const char * pcModule;
+    uint8_t ucMacAddress[ 6 ];
+    void * pvHandle;
+    HostNetworkBackend_t xBackend;
+
+    BaseType_t ( * xIPCPInit )( void );
+    void ( * vBackendSet )( const HostNetworkBackend_t * pxBackend );
+    BaseType_t ( * xBackendReceive )( const uint8_t * pucFrame,
+                                      size_t uxLength );
+    void ( * vBackendGetStats )( HostNetworkBackendStats_t * pxStats );
+    void ( * vLogLevelSet )( const char * pcTag,
+                             esp_log_level_t xLevel );
+    void ( * vSetTxDirect )( BaseType_t xDirect );
+    void ( * vGetTxStats )( NetworkInterfaceTxStats_t * pxStats );
+    void ( * vGetLaneStats )( IpcpEventLaneStats_t pxStats[ eIpcpLaneCount ] );
+    void ( * vGetDtpStats )( DtpStats_t * pxStats );
+    void ( * vGetLockStats )( IpcpDataPlaneLockStats_t * pxStats );
+    portId_t ( * xFlowAlloc )( string_t pcNameDIF,
+                               string_t pcLocalApp,
+                               string_t pcRemoteApp,
+                               struct rinaFlowSpec_t * pxFlowSpec,
+                               uint8_t ucFlags );
+    portId_t ( * xFlowAccept )( struct appRegistration_t * pxAppRegistration,
+                                string_t pcRemoteApp,
+                                struct rinaFlowSpec_t * pxFlowSpec,
+                                uint8_t ucFlags );
+    BaseType_t ( * xFlowWrite )( portId_t xPortId,
+                                 void * pvBuffer,
+                                 size_t uxLength );
+    BaseType_t ( * xFlowRead )( portId_t xPortId,
+                                void * pvBuffer,
+                                size_t uxLength );
+} SimStack_t;
+
+/* Head of every SDU of the application traffic. */
+typedef struct xSIM_SDU_HEADER
+{
+    uint32_t ulSequence;
+    uint64_t ullSentNs;
+} SimSduHeader_t;
+
+/* The application traffic, ue1 writing and ar1 reading. */
+typedef struct xSIM_TRAFFIC
+{
+    uint32_t ulRate;
+    size_t uxSize;
+
+    pthread_mutex_t xLock;
+    portId_t xTxPort;
+    portId_t xRxPort;
+    uint64_t ullFirstSentNs;
+    uint32_t ulSent;
+    uint32_t ulWriteFailed;
+    uint32_t ulReceived;
+    uint32_t ulOutOfOrder;
+    uint32_t ulNextSequence;
+    uint64_t ullReceivedBytes;
+    uint64_t ullFirstReceivedNs;
+    uint64_t ullLastReceivedNs;
+    size_t uxSamples;
+    uint32_t ulLatencyUs[ simMAX_LATENCY_SAMPLES ];
+} SimTraffic_t;
+
+static SimTraffic_t xTraffic =
+{
+    .ulRate  = simDEFAULT_RATE,
+    .uxSize  = simDEFAULT_SDU_SIZE,
+    .xLock   = PTHREAD_MUTEX_INITIALIZER,
+    .xTxPort = -1,
+    .xRxPort = -1
+};
+
+static SimStack_t xUe1 =
+{
+    .pcName       = "ue1.mobile",
+    .pcModule     = "rinasim_ue1.so",
+    .ucMacAddress = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 }
+};
+
+static SimStack_t xAr1 =
+{
+    .pcName       = "ar1.mobile",
+    .pcModule     = "rinasim_ar1.so",
+    .ucMacAddress = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x03 }
+};
+
+/* The delivery callbacks carry no context, one per side. */
+static BaseType_t prvDeliverToUe1( const uint8_t * pucFrame,
+                                   size_t uxLength )
+{
+    return xUe1.xBackendReceive( pucFrame, uxLength );
+}
+
+static BaseType_t prvDeliverToAr1( const uint8_t * pucFrame,
+                                   size_t uxLength )
+{
+    return xAr1.xBackendReceive( pucFrame, uxLength );
+}
+/*-----------------------------------------------------------*/
+
+static void * prvSymbol( SimStack_t * pxStack,
+                         const char * pcSymbol )
+{
+    void * pvSymbol = dlsym( pxStack->pvHandle, pcSymbol );
+
+    if( pvSymbol == NULL )
+    {
+        fprintf( stderr, "%s: missing %s\n", pxStack->pcModule, pcSymbol );
+        exit( EXIT_FAILURE );
+    }
+
+    return pvSymbol;
+}
+/*-----------------------------------------------------------*/
+
+static void prvLoad( SimStack_t * pxStack,
+                     const char * pcDirectory,
+                     VirtualLink_t * pxTxLink,
+                     esp_log_level_t xLevel,
+                     BaseType_t xTxDirect )
+{
+    char cPath[ PATH_MAX ];
+
+    ( void ) snprintf( cPath, sizeof( cPath ), "%s/%s", pcDirectory, pxStack->pcModule );
+
+    pxStack->pvHandle = dlopen( cPath, RTLD_NOW | RTLD_LOCAL );
+
+    if( pxStack->pvHandle == NULL )
+    {
+        fprintf( stderr, "%s\n", dlerror() );
+        exit( EXIT_FAILURE );
+    }
+
+    *( void ** ) &( pxStack->xIPCPInit ) = prvSymbol( pxStack, "RINA_IPCPInit" );
+    *( void ** ) &( pxStack->vBackendSet ) = prvSymbol( pxStack, "vHostNetworkBackendSet" );
+    *( void ** ) &( pxStack->xBackendReceive ) = prvSymbol( pxStack, "xHostNetworkBackendReceive" );
+    *( void ** ) &( pxStack->vBackendGetStats ) = prvSymbol( pxStack, "vHostNetworkBackendGetStats" );
+    *( void ** ) &( pxStack->vLogLevelSet ) = prvSymbol( pxStack, "esp_log_level_set" );
+    *( void ** ) &( pxStack->vSetTxDirect ) = prvSymbol( pxStack, "vNetworkInterfaceSetTxDirect" );
+    *( void ** ) &( pxStack->vGetTxStats ) = prvSymbol( pxStack, "vNetworkInterfaceGetTxStats" );
+    *( void ** ) &( pxStack->vGetLaneStats ) = prvSymbol( pxStack, "vIpcpGetEventLaneStats" );
+    *( void ** ) &( pxStack->vGetDtpStats ) = prvSymbol( pxStack, "vDtpGetStats" );
+    *( void ** ) &( pxStack->vGetLockStats ) = prvSymbol( pxStack, "vIpcpGetDataPlaneLockStats" );
+    *( void ** ) &( pxStack->xFlowAlloc ) = prvSymbol( pxStack, "RINA_flow_alloc" );
+    *( void ** ) &( pxStack->xFlowAccept ) = prvSymbol( pxStack, "RINA_flow_accept" );
+    *( void ** ) &( pxStack->xFlowWrite ) = prvSymbol( pxStack, "RINA_flow_write" );
+    *( void ** ) &( pxStack->xFlowRead ) = prvSymbol( pxStack, "RINA_flow_read" );
+
+    pxStack->xBackend.pcName = pxStack->pcName;
+    memcpy( pxStack->xBackend.ucMacAddress, pxStack->ucMacAddress, sizeof( pxStack->ucMacAddress ) );
+    pxStack->xBackend.xStart = NULL;
+    pxStack->xBackend.xTransmit = xVirtualLinkTransmit;
+    pxStack->xBackend.uxTransmitBatch = uxVirtualLinkTransmitBatch;
+    pxStack->xBackend.pvContext = pxTxLink;
+
+    pxStack->vLogLevelSet( "*", xLevel );
+    pxStack->vSetTxDirect( xTxDirect );
+    pxStack->vBackendSet( &( pxStack->xBackend ) );
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( uint64_t ) xNow.tv_sec * 1000000000ULL + ( uint64_t ) xNow.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+/* ue1: allocates the flow once enrolled, then writes at the set rate. */
+static void * prvSenderThread( void * pvParameters )
+{
+    SimTraffic_t * pxTraffic = ( SimTraffic_t * ) pvParameters;
+    uint8_t * pucSdu = calloc( 1U, pxTraffic->uxSize );
+    SimSduHeader_t xHeader = { 0 };
+    struct timespec xNext;
+    portId_t xPortId;
+
+    /* The flow allocator refuses the flow until enrollment is over. */
+    while( ( xPortId = xUe1.xFlowAlloc( "mobile.DIF", ( string_t ) xUe1.pcName,
+                                        ( string_t ) xAr1.pcName, NULL, 0U ) ) < 0 )
+    {
+        usleep( simALLOC_RETRY_US );
+    }
+
+    pthread_mutex_lock( &( pxTraffic->xLock ) );
+    pxTraffic->xTxPort = xPortId;
+    pxTraffic->ullFirstSentNs = prvNowNs();
+    pthread_mutex_unlock( &( pxTraffic->xLock ) );
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNext );
+
+    for( ; ; )
+    {
+        xHeader.ullSentNs = prvNowNs();
+        memcpy( pucSdu, &xHeader, sizeof( xHeader ) );
+
+        if( xUe1.xFlowWrite( xPortId, pucSdu, pxTraffic->uxSize ) == pdTRUE )
+        {
+            pthread_mutex_lock( &( pxTraffic->xLock ) );
+            pxTraffic->ulSent++;
+            pthread_mutex_unlock( &( pxTraffic->xLock ) );
+        }
+        else
+        {
+            pthread_mutex_lock( &( pxTraffic->xLock ) );
+            pxTraffic->ulWriteFailed++;
+            pthread_mutex_unlock( &( pxTraffic->xLock ) );
+        }
+
+        xHeader.ulSequence++;
+
+        xNext.tv_nsec += ( long ) ( 1000000000UL / pxTraffic->ulRate );
+
+        while( xNext.tv_nsec >= 1000000000L )
+        {
+            xNext.tv_nsec -= 1000000000L;
+            xNext.tv_sec++;
+        }
+
+        ( void ) clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &xNext, NULL );
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+/* ar1: accepts the flow and times every SDU read from it. */
+static void * prvReceiverThread( void * pvParameters )
+{
+    SimTraffic_t * pxTraffic = ( SimTraffic_t * ) pvParameters;
+    uint8_t * pucSdu = malloc( pxTraffic->uxSize );
+    SimSduHeader_t xHeader;
+    portId_t xPortId;
+    BaseType_t xLength;
+    uint64_t ullNow;
+
+    xPortId = xAr1.xFlowAccept( NULL, ( string_t ) xUe1.pcName, NULL, 0U );
+
+    pthread_mutex_lock( &( pxTraffic->xLock ) );
+    pxTraffic->xRxPort = xPortId;
+    pthread_mutex_unlock( &( pxTraffic->xLock ) );
+
+    if( xPortId < 0 )
+    {
+        return NULL;
+    }
+
+    for( ; ; )
+    {
+        xLength = xAr1.xFlowRead( xPortId, pucSdu, pxTraffic->uxSize );
+        ullNow = prvNowNs();
+
+        if( xLength < ( BaseType_t ) sizeof( xHeader ) )
+        {
+            continue;
+        }
+
+        memcpy( &xHeader, pucSdu, sizeof( xHeader ) );
+
+        pthread_mutex_lock( &( pxTraffic->xLock ) );
+
+        if( pxTraffic->ulReceived == 0U )
+        {
+            pxTraffic->ullFirstReceivedNs = ullNow;
+        }
+
+        pxTraffic->ullLastReceivedNs = ullNow;
+        pxTraffic->ulReceived++;
+        pxTraffic->ullReceivedBytes += ( uint64_t ) xLength;
+
+        if( xHeader.ulSequence < pxTraffic->ulNextSequence )
+        {
+            pxTraffic->ulOutOfOrder++;
+        }
+        else
+        {
+            pxTraffic->ulNextSequence = xHeader.ulSequence + 1U;
+        }
+
+        if( pxTraffic->uxSamples < simMAX_LATENCY_SAMPLES )
+        {
+            pxTraffic->ulLatencyUs[ pxTraffic->uxSamples++ ] = ( uint32_t ) ( ( ullNow - xHeader.ullSentNs ) / 1000U );
+        }
+
+        pthread_mutex_unlock( &( pxTraffic->xLock ) );
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static int prvCompareU32( const void * pvA,
+                          const void * pvB )
+{
+    uint32_t ulA = *( const uint32_t * ) pvA;
+    uint32_t ulB = *( const uint32_t * ) pvB;
+
+    return ( ulA > ulB ) - ( ulA < ulB );
+}
+
+static void prvReportTraffic( SimTraffic_t * pxTraffic )
+{
+    static const double xPercentiles[] = { 50.0, 90.0, 99.0, 100.0 };
+    uint32_t ulLatencyUs[ sizeof( xPercentiles ) / sizeof( xPercentiles[ 0 ] ) ];
+    double xSeconds;
+    size_t uxIndex;
+
+    pthread_mutex_lock( &( pxTraffic->xLock ) );
+
+    if( pxTraffic->xTxPort < 0 )
+    {
+        printf( "flow: not allocated\n" );
+        pthread_mutex_unlock( &( pxTraffic->xLock ) );
+        return;
+    }
+
+    printf( "flow: port %d -> port %d, %u SDUs of %zu bytes at %u/s, sent %u (write failed %u), "
+            "received %u, out of order %u\n",
+            ( int ) pxTraffic->xTxPort, ( int ) pxTraffic->xRxPort, ( unsigned ) pxTraffic->ulSent + pxTraffic->ulWriteFailed,
+            pxTraffic->uxSize, ( unsigned ) pxTraffic->ulRate, ( unsigned ) pxTraffic->ulSent,
+            ( unsigned ) pxTraffic->ulWriteFailed, ( unsigned ) pxTraffic->ulReceived,
+            ( unsigned ) pxTraffic->ulOutOfOrder );
+
+    if( pxTraffic->uxSamples > 0U )
+    {
+        /* Over the time the flow was in use, from its first write. */
+        xSeconds = ( double ) ( pxTraffic->ullLastReceivedNs - pxTraffic->ullFirstSentNs ) / 1e9;
+
+        qsort( pxTraffic->ulLatencyUs, pxTraffic->uxSamples, sizeof( uint32_t ), prvCompareU32 );
+
+        for( uxIndex = 0U; uxIndex < sizeof( xPercentiles ) / sizeof( xPercentiles[ 0 ] ); uxIndex++ )
+        {
+            size_t uxRank = ( size_t ) ( xPercentiles[ uxIndex ] / 100.0 * ( double ) ( pxTraffic->uxSamples - 1U ) + 0.5 );
+
+            ulLatencyUs[ uxIndex ] = pxTraffic->ulLatencyUs[ uxRank ];
+        }
+
+        printf( "flow: goodput %.1f kbit/s (%llu bytes of SDUs), first SDU at %.3f ms of the flow\n",
+                ( xSeconds > 0.0 ) ? ( ( double ) pxTraffic->ullReceivedBytes * 8.0 / 1000.0 / xSeconds ) : 0.0,
+                ( unsigned long long ) pxTraffic->ullReceivedBytes,
+                ( double ) ( pxTraffic->ullFirstReceivedNs - pxTraffic->ullFirstSentNs ) / 1e6 );
+        printf( "flow: latency us p50 %u p90 %u p99 %u max %u\n",
+                ( unsigned ) ulLatencyUs[ 0 ], ( unsigned ) ulLatencyUs[ 1 ],
+                ( unsigned ) ulLatencyUs[ 2 ], ( unsigned ) ulLatencyUs[ 3 ] );
+    }
+
+    pthread_mutex_unlock( &( pxTraffic->xLock ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReportDirection( const char * pcName,
+                                VirtualLink_t * pxLink,
+                                double xSeconds )
+{
+    static const char * const pcClass[ eLinkClassCount ] = { "arp", "mgmt", "data", "other" };
+    static const double xPercentiles[] = { 50.0, 90.0, 99.0, 100.0 };
+    uint32_t ulLatencyUs[ sizeof( xPercentiles ) / sizeof( xPercentiles[ 0 ] ) ];
+    VirtualLinkStats_t xStats;
+    size_t uxClass;
+
+    vVirtualLinkGetStats( pxLink, &xStats );
+
+    printf( "%s: offered %u, delivered %u (%llu bytes), lost %u, overflow %u, reordered %u, refused %u\n",
+            pcName, ( unsigned ) xStats.ulOffered, ( unsigned ) xStats.ulDelivered,
+            ( unsigned long long ) xStats.ullDeliveredBytes, ( unsigned ) xStats.ulLost,
+            ( unsigned ) xStats.ulOverflow, ( unsigned ) xStats.ulReordered, ( unsigned ) xStats.ulRefused );
+    printf( "%s: goodput %.1f kbit/s (%llu bytes of user data)\n",
+            pcName, ( xSeconds > 0.0 ) ? ( ( double ) xStats.ullGoodputBytes * 8.0 / 1000.0 / xSeconds ) : 0.0,
+            ( unsigned long long ) xStats.ullGoodputBytes );
+
+    for( uxClass = 0U; uxClass < eLinkClassCount; uxClass++ )
+    {
+        size_t uxSamples = uxVirtualLinkLatency( pxLink, ( eVirtualLinkClass_t ) uxClass, xPercentiles,
+                                                 ulLatencyUs, sizeof( xPercentiles ) / sizeof( xPercentiles[ 0 ] ) );
+
+        if( uxSamples == 0U )
+        {
+            continue;
+        }
+
+        printf( "%s:   %-5s %6zu frames, first at %8.3f ms, latency us p50 %u p90 %u p99 %u max %u\n",
+                pcName, pcClass[ uxClass ], uxSamples,
+                ( double ) xStats.ullFirstDeliveryUs[ uxClass ] / 1000.0,
+                ( unsigned ) ulLatencyUs[ 0 ], ( unsigned ) ulLatencyUs[ 1 ],
+                ( unsigned ) ulLatencyUs[ 2 ], ( unsigned ) ulLatencyUs[ 3 ] );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvReportStack( SimStack_t * pxStack )
+{
+    static const char * const pcLane[ eIpcpLaneCount ] = { "control", "management", "data" };
+    HostNetworkBackendStats_t xStats;
+    NetworkInterfaceTxStats_t xTxStats;
+    IpcpEventLaneStats_t xLaneStats[ eIpcpLaneCount ];
+    DtpStats_t xDtpStats;
+    IpcpDataPlaneLockStats_t xLockStats;
+    size_t uxLane;
+
+    pxStack->vBackendGetStats( &xStats );
+    pxStack->vGetTxStats( &xTxStats );
+    pxStack->vGetLaneStats( xLaneStats );
+    pxStack->vGetDtpStats( &xDtpStats );
+    pxStack->vGetLockStats( &xLockStats );
+
+    printf( "%s: driver tx %u (dropped %u) rx %u (dropped %u)\n",
+            pxStack->pcName, ( unsigned ) xStats.ulTxFrames, ( unsigned ) xStats.ulTxDropped,
+            ( unsigned ) xStats.ulRxFrames, ( unsigned ) xStats.ulRxDropped );
+
+    /* Time from the shim handing a frame to the interface to the driver. */
+    if( xTxStats.ulQueued > 0U )
+    {
+        printf( "%s: tx ring %u frames, %u events, waited avg %.1f us max %u us\n",
+                pxStack->pcName, ( unsigned ) xTxStats.ulQueued, ( unsigned ) xTxStats.ulDrainEvents,
+                ( double ) xTxStats.ullDelayUs / ( double ) xTxStats.ulQueued,
+                ( unsigned ) xTxStats.ulMaxDelayUs );
+    }
+
+    /* PDUs the DTP sent and delivered, behind its window edge or not. */
+    if( ( xDtpStats.ulSent > 0U ) || ( xDtpStats.ulDelivered > 0U ) || ( xDtpStats.ulDropped > 0U ) )
+    {
+        printf( "%s: dtp sent %u (rate cuts %u), delivered %u (late %u), dropped %u, ecn %u\n",
+                pxStack->pcName, ( unsigned ) xDtpStats.ulSent, ( unsigned ) xDtpStats.ulRateCuts,
+                ( unsigned ) xDtpStats.ulDelivered, ( unsigned ) xDtpStats.ulLate,
+                ( unsigned ) xDtpStats.ulDropped, ( unsigned ) xDtpStats.ulEcn );
+    }
+
+    /* How often the RX, TX and IPCP tasks waited for each other. */
+    if( xLockStats.ulTaken > 0U )
+    {
+        printf( "%s: data-plane lock taken %u, waited %u, waited avg %.1f us max %u us\n",
+                pxStack->pcName, ( unsigned ) xLockStats.ulTaken, ( unsigned ) xLockStats.ulWaited,
+                ( xLockStats.ulWaited > 0U ) ? ( double ) xLockStats.ullWaitUs / ( double ) xLockStats.ulWaited : 0.0,
+                ( unsigned ) xLockStats.ulMaxWaitUs );
+    }
+
+    /* Time events waited for the IPCP task, per priority lane. */
+    for( uxLane = 0U; uxLane < eIpcpLaneCount; uxLane++ )
+    {
+        const IpcpEventLaneStats_t * pxLane = &( xLaneStats[ uxLane ] );
+
+        if( ( pxLane->ulEvents > 0U ) || ( pxLane->ulFull > 0U ) )
+        {
+            printf( "%s: %-10s lane %u events (guard %u, full %u), depth max %u, waited avg %.1f us max %u us\n",
+                    pxStack->pcName, pcLane[ uxLane ], ( unsigned ) pxLane->ulEvents,
+                    ( unsigned ) pxLane->ulGuardServed, ( unsigned ) pxLane->ulFull,
+                    ( unsigned ) pxLane->uxHighWater,
+                    ( pxLane->ulEvents > 0U ) ? ( double ) pxLane->ullDelayUs / ( double ) pxLane->ulEvents : 0.0,
+                    ( unsigned ) pxLane->ulMaxDelayUs );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static esp_log_level_t prvParseLogLevel( const char * pcLevel )
+{
+    static const char * const pcLevels[] = { "none", "error", "warn", "info", "debug", "verbose" };
+    size_t uxIndex;
+
+    for( uxIndex = 0U; uxIndex < sizeof( pcLevels ) / sizeof( pcLevels[ 0 ] ); uxIndex++ )
+    {
+        if( strcmp( pcLevel, pcLevels[ uxIndex ] ) == 0 )
+        {
+            return ( esp_log_level_t ) uxIndex;
+        }
+    }
+
+    fprintf( stderr, "unknown log level %s\n", pcLevel );
+    exit( EXIT_FAILURE );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvParseMs( const char * pcValue )
+{
+    return ( uint32_t ) ( strtod( pcValue, NULL ) * 1000.0 + 0.5 );
+}
+
+static uint16_t prvParsePercent( const char * pcValue )
+{
+    double xPercent = strtod( pcValue, NULL );
+
+    if( xPercent < 0.0 )
+    {
+        xPercent = 0.0;
+    }
+    else if( xPercent > 100.0 )
+    {
+        xPercent = 100.0;
+    }
+
+    return ( uint16_t ) ( xPercent * 100.0 + 0.5 );
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc, char ** argv )
+{
+    static const struct option xOptions[] =
+    {
+        { "duration",  required_argument, NULL, 'd' },
+        { "bandwidth", required_argument, NULL, 'b' },
+        { "latency",   required_argument, NULL, 'l' },
+        { "jitter",    required_argument, NULL, 'j' },
+        { "loss",      required_argument, NULL, 'p' },
+        { "reorder",   required_argument, NULL, 'r' },
+        { "queue",     required_argument, NULL, 'q' },
+        { "seed",      required_argument, NULL, 's' },
+        { "log",       required_argument, NULL, 'v' },
+        { "modules",   required_argument, NULL, 'm' },
+        { "tx-queued", no_argument,       NULL, 't' },
+        { "rate",      required_argument, NULL, 'R' },
+        { "size",      required_argument, NULL, 'S' },
+        { NULL,        0,                 NULL, 0   }
+    };
+    VirtualLinkConfig_t xConfig =
+    {
+        .ulQueueFrames = simDEFAULT_QUEUE,
+        .ulSeed        = 1U
+    };
+    VirtualLinkConfig_t xReverse;
+    VirtualLink_t * pxUplink;
+    VirtualLink_t * pxDownlink;
+    unsigned long ulDuration = simDEFAULT_DURATION_S;
+    esp_log_level_t xLevel = ESP_LOG_NONE;
+    char cSelf[ PATH_MAX ];
+    const char * pcModules = NULL;
+    BaseType_t xTxDirect = pdTRUE;
+    pthread_t xSender;
+    pthread_t xReceiver;
+    int iOption;
+
+    while( ( iOption = getopt_long( argc, argv, "d:b:l:j:p:r:q:s:v:m:tR:S:", xOptions, NULL ) ) != -1 )
+    {
+        switch( iOption )
+        {
+            case 'd': ulDuration = strtoul( optarg, NULL, 10 ); break;
+            case 'b': xConfig.ulBandwidthKbps = ( uint32_t ) strtoul( optarg, NULL, 10 ); break;
+            case 'l': xConfig.ulLatencyUs = prvParseMs( optarg ); break;
+            case 'j': xConfig.ulJitterUs = prvParseMs( optarg ); break;
+            case 'p': xConfig.usLossBp = prvParsePercent( optarg ); break;
+            case 'r': xConfig.usReorderBp = prvParsePercent( optarg ); break;
+            case 'q': xConfig.ulQueueFrames = ( uint32_t ) strtoul( optarg, NULL, 10 ); break;
+            case 's': xConfig.ulSeed = ( uint32_t ) strtoul( optarg, NULL, 10 ); break;
+            case 'v': xLevel = prvParseLogLevel( optarg ); break;
+            case 'm': pcModules = optarg; break;
+            case 't': xTxDirect = pdFALSE; break;
+            case 'R': xTraffic.ulRate = ( uint32_t ) strtoul( optarg, NULL, 10 ); break;
+            case 'S': xTraffic.uxSize = ( size_t ) strtoul( optarg, NULL, 10 ); break;
+            default:
+                fprintf( stderr, "usage: %s [--duration s] [--bandwidth kbps] [--latency ms] [--jitter ms] "
+                                 "[--loss %%] [--reorder %%] [--queue frames] [--seed n] [--log level] [--modules dir] "
+                                 "[--tx-queued] [--rate sdu/s] [--size bytes]\n",
+                         argv[ 0 ] );
+                return EXIT_FAILURE;
+        }
+    }
+
+    if( ( xTraffic.ulRate == 0U ) || ( xTraffic.uxSize < sizeof( SimSduHeader_t ) ) || ( xTraffic.uxSize > MAX_SDU_SIZE ) )
+    {
+        fprintf( stderr, "--rate must be positive and --size between %zu and %u\n",
+                 sizeof( SimSduHeader_t ), ( unsigned ) MAX_SDU_SIZE );
+        return EXIT_FAILURE;
+    }
+
+    /* The stack builds live next to the executable by default. */
+    if( pcModules == NULL )
+    {
+        ssize_t xLength = readlink( "/proc/self/exe", cSelf, sizeof( cSelf ) - 1U );
+
+        cSelf[ ( xLength > 0 ) ? xLength : 0 ] = '\0';
+        pcModules = ( xLength > 0 ) ? dirname( cSelf ) : ".";
+    }
+
+    setvbuf( stdout, NULL, _IOLBF, 0 );
+
+    printf( "link: %u kbit/s, latency %.3f ms, jitter %.3f ms, loss %.2f %%, reorder %.2f %%, queue %u, seed %u\n",
+            ( unsigned ) xConfig.ulBandwidthKbps, xConfig.ulLatencyUs / 1000.0, xConfig.ulJitterUs / 1000.0,
+            xConfig.usLossBp / 100.0, xConfig.usReorderBp / 100.0, ( unsigned ) xConfig.ulQueueFrames,
+            ( unsigned ) xConfig.ulSeed );
+
+    /* Both directions draw from their own sequence. */
+    xReverse = xConfig;
+    xReverse.ulSeed = ~xConfig.ulSeed;
+
+    pxUplink = pxVirtualLinkCreate( "link-ue1-ar1", &xConfig, prvDeliverToAr1 );
+    pxDownlink = pxVirtualLinkCreate( "link-ar1-ue1", &xReverse, prvDeliverToUe1 );
+
+    if( ( pxUplink == NULL ) || ( pxDownlink == NULL ) )
+    {
+        fprintf( stderr, "could not create the link\n" );
+        return EXIT_FAILURE;
+    }
+
+    prvLoad( &xUe1, pcModules, pxUplink, xLevel, xTxDirect );
+    prvLoad( &xAr1, pcModules, pxDownlink, xLevel, xTxDirect );
+
+    /* The access router comes up first, as it would in the field. */
+    if( ( xAr1.xIPCPInit() != pdTRUE ) || ( xUe1.xIPCPInit() != pdTRUE ) )
+    {
+        fprintf( stderr, "RINA_IPCPInit failed\n" );
+        return EXIT_FAILURE;
+    }
+
+    if( ( pthread_create( &xReceiver, NULL, prvReceiverThread, &xTraffic ) != 0 ) ||
+        ( pthread_create( &xSender, NULL, prvSenderThread, &xTraffic ) != 0 ) )
+    {
+        fprintf( stderr, "could not start the application traffic\n" );
+        return EXIT_FAILURE;
+    }
+
+    sleep( ( unsigned ) ulDuration );
+
+    prvReportTraffic( &xTraffic );
+    prvReportStack( &xUe1 );
+    prvReportStack( &xAr1 );
+    prvReportDirection( "ue1->ar1", pxUplink, ( double ) ulDuration );
+    prvReportDirection( "ar1->ue1", pxDownlink, ( double ) ulDuration );
+
+    /* The stacks' tasks never return, so the process exits with them. */
+    fflush( stdout );
+    _exit( EXIT_SUCCESS );
+}
@@ -0,0 +1,284 @@
+/*
+ * timerbench.c
+ *
+ * Timer churn at the scale of thousands of connections, each restarting its
+ * timer on every PDU:
+ *     rinasense_timerbench [timers] [ticks] [restarts per tick]
+ *
+ * All the timers are started, then on every tick random timers of 90% of
+ * them are restarted and the remaining 10% are left to expire. The same
+ * sequence runs on a timer wheel and on a flat array of deadlines scanned
+ * on every tick, as the IPCP task did for its ARP timer, and both must
+ * expire the same timers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "timerWheel.h"
+
+typedef struct xBENCH_TIMER
+{
+    timerWheelTimer_t xTimer;
+    TickType_t xDeadline;
+    BaseType_t xArmed;
+} BenchTimer_t;
+
+typedef struct xBENCH_RESULT
+{
+    uint64_t ullStartNs;
+    uint64_t ullRestartNs;
+    uint64_t ullTickNs;
+    uint32_t ulFired;
+} BenchResult_t;
+
+static TickType_t xCurrentTick;
+static uint32_t ulFired;
+static uint32_t ulLate;
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRandom( uint32_t * pulState )
+{
+    uint32_t ulValue = *pulState;
+
+    ulValue ^= ulValue << 13;
+    ulValue ^= ulValue >> 17;
+    ulValue ^= ulValue << 5;
+    *pulState = ulValue;
+
+    return ulValue;
+}
+/*-----------------------------------------------------------*/
+
+/* Between 100 ticks and 5 s, fixed per timer. */
+static TickType_t prvDuration( uint32_t ulTimer )
+{
+    return ( TickType_t ) ( 100U + ( ( ulTimer * 7919U ) % 4900U ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvExpired( void * pvArgument )
+{
+    BenchTimer_t * pxTimer = ( BenchTimer_t * ) pvArgument;
+
+    ulFired++;
+
+    if( pxTimer->xTimer.xExpiry != xCurrentTick )
+    {
+        ulLate++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunWheel( BenchTimer_t * pxTimers,
+                         uint32_t ulTimers,
+                         uint32_t ulTicks,
+                         uint32_t ulRestarts,
+                         BenchResult_t * pxResult )
+{
+    static timerWheel_t xWheel;
+    uint32_t ulState = 0x12345678UL;
+    uint32_t ulActive = ulTimers - ( ulTimers / 10U );
+    uint32_t ulTimer, ulTick, ulRestart;
+    volatile TickType_t xSleep;
+    uint64_t ullStart;
+
+    vTimerWheelInit( &xWheel, 0 );
+    ulFired = 0;
+    ulLate = 0;
+
+    ullStart = prvNowNs();
+
+    for( ulTimer = 0; ulTimer < ulTimers; ulTimer++ )
+    {
+        vTimerWheelTimerInit( &pxTimers[ ulTimer ].xTimer, prvExpired, &pxTimers[ ulTimer ] );
+        vTimerWheelStart( &xWheel, &pxTimers[ ulTimer ].xTimer, prvDuration( ulTimer ) );
+    }
+
+    pxResult->ullStartNs = prvNowNs() - ullStart;
+    pxResult->ullRestartNs = 0;
+    pxResult->ullTickNs = 0;
+
+    for( ulTick = 1; ulTick <= ulTicks; ulTick++ )
+    {
+        xCurrentTick = ( TickType_t ) ulTick;
+
+        ullStart = prvNowNs();
+
+        for( ulRestart = 0; ulRestart < ulRestarts; ulRestart++ )
+        {
+            ulTimer = prvRandom( &ulState ) % ulActive;
+            vTimerWheelStart( &xWheel, &pxTimers[ ulTimer ].xTimer, xCurrentTick + prvDuration( ulTimer ) );
+        }
+
+        pxResult->ullRestartNs += prvNowNs() - ullStart;
+
+        /* What the IPCP task does each time it wakes up. */
+        ullStart = prvNowNs();
+        ( void ) uxTimerWheelAdvance( &xWheel, xCurrentTick );
+        xSleep = xTimerWheelTicksToNext( &xWheel, xCurrentTick );
+        pxResult->ullTickNs += prvNowNs() - ullStart;
+    }
+
+    ( void ) xSleep;
+    pxResult->ulFired = ulFired;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunScan( BenchTimer_t * pxTimers,
+                        uint32_t ulTimers,
+                        uint32_t ulTicks,
+                        uint32_t ulRestarts,
+                        BenchResult_t * pxResult )
+{
+    uint32_t ulState = 0x12345678UL;
+    uint32_t ulActive = ulTimers - ( ulTimers / 10U );
+    uint32_t ulTimer, ulTick, ulRestart;
+    volatile TickType_t xSleep;
+    TickType_t xRemaining;
+    uint64_t ullStart;
+
+    ulFired = 0;
+
+    ullStart = prvNowNs();
+
+    for( ulTimer = 0; ulTimer < ulTimers; ulTimer++ )
+    {
+        pxTimers[ ulTimer ].xDeadline = prvDuration( ulTimer );
+        pxTimers[ ulTimer ].xArmed = pdTRUE;
+    }
+
+    pxResult->ullStartNs = prvNowNs() - ullStart;
+    pxResult->ullRestartNs = 0;
+    pxResult->ullTickNs = 0;
+
+    for( ulTick = 1; ulTick <= ulTicks; ulTick++ )
+    {
+        xCurrentTick = ( TickType_t ) ulTick;
+
+        ullStart = prvNowNs();
+
+        for( ulRestart = 0; ulRestart < ulRestarts; ulRestart++ )
+        {
+            ulTimer = prvRandom( &ulState ) % ulActive;
+            pxTimers[ ulTimer ].xDeadline = xCurrentTick + prvDuration( ulTimer );
+            pxTimers[ ulTimer ].xArmed = pdTRUE;
+        }
+
+        pxResult->ullRestartNs += prvNowNs() - ullStart;
+
+        ullStart = prvNowNs();
+        xSleep = portMAX_DELAY;
+
+        for( ulTimer = 0; ulTimer < ulTimers; ulTimer++ )
+        {
+            if( pxTimers[ ulTimer ].xArmed == pdFALSE )
+            {
+                continue;
+            }
+
+            xRemaining = pxTimers[ ulTimer ].xDeadline - xCurrentTick;
+
+            if( ( xRemaining == 0 ) || ( xRemaining > ( portMAX_DELAY / 2U ) ) )
+            {
+                pxTimers[ ulTimer ].xArmed = pdFALSE;
+                ulFired++;
+            }
+            else if( xRemaining < xSleep )
+            {
+                xSleep = xRemaining;
+            }
+        }
+
+        pxResult->ullTickNs += prvNowNs() - ullStart;
+    }
+
+    ( void ) xSleep;
+    pxResult->ulFired = ulFired;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReport( const char * pcName,
+                       const BenchResult_t * pxResult,
+                       uint32_t ulTimers,
+                       uint32_t ulTicks,
+                       uint32_t ulRestarts )
+{
+    printf( "%-6s start %6.1f ns, restart %6.1f ns, tick %9.1f ns, expired %u\n",
+            pcName,
+            ( double ) pxResult->ullStartNs / ( double ) ulTimers,
+            ( double ) pxResult->ullRestartNs / ( ( double ) ulTicks * ( double ) ulRestarts ),
+            ( double ) pxResult->ullTickNs / ( double ) ulTicks,
+            ( unsigned ) pxResult->ulFired );
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc, char ** argv )
+{
+    uint32_t ulTimers = 10000UL;
+    uint32_t ulTicks = 20000UL;
+    uint32_t ulRestarts = 100UL;
+    BenchResult_t xWheelResult, xScanResult;
+    BenchTimer_t * pxTimers;
+
+    if( argc > 1 )
+    {
+        ulTimers = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    if( argc > 2 )
+    {
+        ulTicks = ( uint32_t ) strtoul( argv[ 2 ], NULL, 10 );
+    }
+
+    if( argc > 3 )
+    {
+        ulRestarts = ( uint32_t ) strtoul( argv[ 3 ], NULL, 10 );
+    }
+
+    if( ( ulTimers < 10U ) || ( ulTicks == 0U ) || ( ulRestarts == 0U ) )
+    {
+        fprintf( stderr, "usage: %s [timers >= 10] [ticks] [restarts per tick]\n", argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    pxTimers = calloc( ulTimers, sizeof( *pxTimers ) );
+
+    if( pxTimers == NULL )
+    {
+        fprintf( stderr, "out of memory\n" );
+        return EXIT_FAILURE;
+    }
+
+    printf( "%u timers, %u ticks, %u restarts per tick\n",
+            ( unsigned ) ulTimers, ( unsigned ) ulTicks, ( unsigned ) ulRestarts );
+
+    prvRunWheel( pxTimers, ulTimers, ulTicks, ulRestarts, &xWheelResult );
+    prvReport( "wheel", &xWheelResult, ulTimers, ulTicks, ulRestarts );
+
+    prvRunScan( pxTimers, ulTimers, ulTicks, ulRestarts, &xScanResult );
+    prvReport( "scan", &xScanResult, ulTimers, ulTicks, ulRestarts );
+
+    free( pxTimers );
+
+    if( ( ulLate != 0U ) || ( xWheelResult.ulFired != xScanResult.ulFired ) )
+    {
+        fprintf( stderr, "timer wheel mismatch: %u late, %u expired against %u\n",
+                 ( unsigned ) ulLate, ( unsigned ) xWheelResult.ulFired, ( unsigned ) xScanResult.ulFired );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
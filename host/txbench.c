@@ -0,0 +1,241 @@
+/*
+ * txbench.c
+ *
+ * Measures the transmit path from a task other than the IPCP task down to
+ * the Wi-Fi driver, with one eNetworkTxEvent per frame, as the shim used to
+ * send, and through the interface TX ring:
+ *     rinasense_txbench [frames]
+ *
+ * The sender writes bursts of 1, 8 and 16 frames and waits for each burst to
+ * reach the driver before the next one. On the ring a burst is queued with
+ * one uxNetworkInterfaceEnqueueBatch() call. The frames go to a backend that
+ * accepts and discards them, so the numbers are those of the stack alone.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "configSensor.h"
+#include "ARP826.h"
+#include "IPCP.h"
+#include "NetworkInterface.h"
+#include "BufferManagement.h"
+
+#include "HostNetworkBackend.h"
+
+#define TXBENCH_FRAME_LENGTH    ( 64U )
+
+static const uint32_t ulBursts[] = { 1U, 8U, NETWORK_INTERFACE_TX_RING };
+
+static BaseType_t prvTransmit( void * pvContext,
+                               const uint8_t * pucFrame,
+                               size_t uxLength )
+{
+    ( void ) pvContext;
+    ( void ) pucFrame;
+    ( void ) uxLength;
+
+    return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvTransmitBatch( void * pvContext,
+                                const HostNetworkFrame_t * pxFrames,
+                                size_t uxCount )
+{
+    ( void ) pvContext;
+    ( void ) pxFrames;
+
+    return uxCount;
+}
+/*-----------------------------------------------------------*/
+
+static const HostNetworkBackend_t xDiscardBackend =
+{
+    .pcName          = "discard",
+    .xStart          = NULL,
+    .xTransmit       = prvTransmit,
+    .uxTransmitBatch = prvTransmitBatch,
+    .pvContext       = NULL
+};
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000ULL ) + ( uint64_t ) xNow.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+/* Waits for the station to come up and the IPCP task to take frames. */
+static BaseType_t prvWaitForStack( void )
+{
+    uint8_t ucFrame[ 64 ] = { 0 };
+    UBaseType_t uxTries;
+
+    ucFrame[ 12 ] = ( uint8_t ) ( ETH_P_ARP >> 8 );
+    ucFrame[ 13 ] = ( uint8_t ) ( ETH_P_ARP & 0xff );
+
+    for( uxTries = 0U; uxTries < 100U; uxTries++ )
+    {
+        if( xHostNetworkBackendReceive( ucFrame, sizeof( ucFrame ) ) == pdTRUE )
+        {
+            return pdTRUE;
+        }
+
+        vTaskDelay( pdMS_TO_TICKS( 100U ) );
+    }
+
+    return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvBackendFrames( void )
+{
+    HostNetworkBackendStats_t xStats;
+
+    vHostNetworkBackendGetStats( &xStats );
+
+    return xStats.ulTxFrames + xStats.ulTxDropped;
+}
+/*-----------------------------------------------------------*/
+
+/* Sends ulFrames frames in bursts of ulBurst, returns the frames per second
+ * the stack took. */
+static double prvRun( BaseType_t xRing,
+                      uint32_t ulBurst,
+                      uint32_t ulFrames,
+                      uint32_t * pulEvents,
+                      uint32_t * pulDriverCalls,
+                      uint32_t * pulDropped )
+{
+    NetworkBufferDescriptor_t * pxNetworkBuffer;
+    NetworkBufferDescriptor_t * pxBurst[ NETWORK_INTERFACE_TX_RING ];
+    UBaseType_t uxBurst;
+    NetworkInterfaceTxStats_t xBefore, xAfter;
+    HostNetworkBackendStats_t xBackendBefore, xBackendAfter;
+    RINAStackEvent_t xTxEvent = { eNetworkTxEvent, NULL };
+    uint32_t ulSent = 0U, ulDropped = 0U, ulExpected, x;
+    uint64_t ullStart, ullElapsedNs;
+
+    vNetworkInterfaceGetTxStats( &xBefore );
+    vHostNetworkBackendGetStats( &xBackendBefore );
+    ulExpected = xBackendBefore.ulTxFrames + xBackendBefore.ulTxDropped;
+    ullStart = prvNowNs();
+
+    while( ulSent < ulFrames )
+    {
+        uxBurst = 0U;
+
+        for( x = 0U; ( x < ulBurst ) && ( ulSent < ulFrames ); x++ )
+        {
+            pxNetworkBuffer = pxGetNetworkBufferWithDescriptor( TXBENCH_FRAME_LENGTH, pdMS_TO_TICKS( 250U ) );
+
+            if( pxNetworkBuffer == NULL )
+            {
+                break;
+            }
+
+            memset( pxNetworkBuffer->pucEthernetBuffer, 0xff, TXBENCH_FRAME_LENGTH );
+            pxNetworkBuffer->xDataLength = TXBENCH_FRAME_LENGTH;
+            ulSent++;
+
+            if( xRing != pdFALSE )
+            {
+                pxBurst[ uxBurst++ ] = pxNetworkBuffer;
+                continue;
+            }
+            else
+            {
+                xTxEvent.pvData = pxNetworkBuffer;
+
+                if( xSendEventStructToIPCPTask( &xTxEvent, pdMS_TO_TICKS( 250U ) ) == pdFAIL )
+                {
+                    vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+                    ulDropped++;
+                    continue;
+                }
+            }
+
+            ulExpected++;
+        }
+
+        if( uxBurst > 0U )
+        {
+            UBaseType_t uxQueued = uxNetworkInterfaceEnqueueBatch( pxBurst, uxBurst );
+
+            ulDropped += ( uint32_t ) ( uxBurst - uxQueued );
+            ulExpected += ( uint32_t ) uxQueued;
+        }
+
+        /* Wait for the IPCP task to hand the burst to the driver. */
+        while( prvBackendFrames() != ulExpected )
+        {
+            sched_yield();
+        }
+    }
+
+    ullElapsedNs = prvNowNs() - ullStart;
+    vNetworkInterfaceGetTxStats( &xAfter );
+    vHostNetworkBackendGetStats( &xBackendAfter );
+
+    *pulEvents = ( xRing != pdFALSE ) ? ( xAfter.ulDrainEvents - xBefore.ulDrainEvents ) : ( ulSent - ulDropped );
+    *pulDriverCalls = xBackendAfter.ulTxCalls - xBackendBefore.ulTxCalls;
+    *pulDropped = ulDropped;
+
+    return ( double ) ( ulSent - ulDropped ) * 1e9 / ( double ) ullElapsedNs;
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc, char ** argv )
+{
+    uint32_t ulFrames = 200000UL;
+    uint32_t ulEvents, ulDriverCalls, ulDropped;
+    double xRate;
+    BaseType_t xRing;
+    size_t x;
+
+    if( argc > 1 )
+    {
+        ulFrames = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    setvbuf( stdout, NULL, _IOLBF, 0 );
+    esp_log_level_set( "*", ESP_LOG_NONE );
+
+    vHostNetworkBackendSet( &xDiscardBackend );
+
+    if( ( RINA_IPCPInit() != pdTRUE ) || ( prvWaitForStack() != pdTRUE ) )
+    {
+        fprintf( stderr, "the stack did not come up\n" );
+        return EXIT_FAILURE;
+    }
+
+    for( x = 0U; x < ( sizeof( ulBursts ) / sizeof( ulBursts[ 0 ] ) ); x++ )
+    {
+        for( xRing = pdFALSE; xRing <= pdTRUE; xRing++ )
+        {
+            xRate = prvRun( xRing, ulBursts[ x ], ulFrames, &ulEvents, &ulDriverCalls, &ulDropped );
+
+            printf( "burst %2u %-15s %9.0f frames/s, %5.3f events and %5.3f driver calls per frame, %u dropped\n",
+                    ( unsigned ) ulBursts[ x ],
+                    ( xRing != pdFALSE ) ? "tx ring" : "event per frame",
+                    xRate,
+                    ( double ) ulEvents / ( double ) ( ulFrames - ulDropped ),
+                    ( double ) ulDriverCalls / ( double ) ( ulFrames - ulDropped ),
+                    ( unsigned ) ulDropped );
+        }
+    }
+
+    return EXIT_SUCCESS;
+}